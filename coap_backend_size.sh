@@ -0,0 +1,22 @@
+#!/usr/bin/env bash
+
+# Builds the firmware once per COAP_BACKEND and compares the image sizes.
+# Extra arguments are passed to both builds, e.g. -DOTA_EN=0.
+
+set -e
+
+for BACKEND in 0 1; do
+    echo "=== COAP_BACKEND=$BACKEND ==="
+    idf.py -B "build-coap$BACKEND" -DCOAP_BACKEND="$BACKEND" "$@" build > /dev/null
+    idf.py -B "build-coap$BACKEND" size
+done
+
+echo ""
+echo "=== Image size ==="
+declare -a FW_SIZES
+for BACKEND in 0 1; do
+    BIN_FILE="build-coap$BACKEND/df-firmware.bin"
+    FW_SIZES[$BACKEND]=$(stat -c%s "$BIN_FILE" 2>/dev/null || stat -f%z "$BIN_FILE")
+    echo "COAP_BACKEND=$BACKEND: ${FW_SIZES[$BACKEND]} bytes"
+done
+echo "libcoap delta: $((FW_SIZES[1] - FW_SIZES[0])) bytes"
@@ -2,10 +2,12 @@
 
 #include <unistd.h>
 #include <functional>
+#include <span>
 #include <string>
 
 extern "C" {
 #include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
 #include "freertos/semphr.h"
 }
 
@@ -34,6 +36,16 @@ typedef struct {
     size_t payload_len;        // Length of payload (0 if not needed)
 } ATCommand_t;
 
+/**
+ * @struct SslOpenProfile_t
+ * @brief What openSSLSocket() has learned about the modem's QSSLOPEN dialect.
+ * A zero-initialised profile knows nothing, so every form is probed.
+ */
+typedef struct {
+    uint8_t open_variant;        ///< 1-based QSSLOPEN syntax variant known to work, 0 if unknown
+    bool contextid_unsupported;  ///< The firmware rejects QSSLCFG "contextid"
+} SslOpenProfile_t;
+
 using ModemChunkCallback = std::function<bool(const uint8_t*, size_t)>;
 
 /**
@@ -41,7 +53,8 @@ using ModemChunkCallback = std::function<bool(const uint8_t*, size_t)>;
  * @brief Handles AT command transmission and response parsing for cellular modems.
  *
  * Provides methods to send AT commands via UART and parse responses with
- * timeout handling and expected response validation.
+ * timeout handling and expected response validation. Responses are received
+ * through the modem reader task (see ModemReader), which must be started first.
  */
 class ATCommandHndlr {
 public:
@@ -68,6 +81,33 @@ public:
      */
     bool sendAndCapture(const ATCommand_t& atCmd, char* out_buf, size_t out_len);
 
+    /**
+     * @brief Send an AT command answered with bare information text (e.g. AT+GMR) and capture it.
+     *
+     * The first line that is neither a command echo nor a known response is kept; the
+     * command must then finish with OK. `atCmd.expect` is not used.
+     *
+     * @param atCmd AT command to send
+     * @param out_buf Buffer to receive the information line
+     * @param out_len Length of the provided buffer
+     * @return true if a line was captured and the command ended in OK, false otherwise
+     */
+    bool sendAndCaptureInfo(const ATCommand_t& atCmd, char* out_buf, size_t out_len);
+
+    /**
+     * @brief Send a query answered with a response line and OK (e.g. AT+CEREG?) and capture the line.
+     *
+     * Unlike sendAndCapture(), it reads up to the final OK, so the OK is not left behind as the
+     * next command's answer, and a query that lists nothing (AT+QIACT? with no context active
+     * answers a bare OK) returns at once instead of running into the timeout.
+     *
+     * @param atCmd AT command to send
+     * @param out_buf Buffer to receive the response line
+     * @param out_len Length of the provided buffer
+     * @return true if an expected response line came before OK, false otherwise
+     */
+    bool sendQuery(const ATCommand_t& atCmd, char* out_buf, size_t out_len);
+
     /**
      * @brief Opens an IP socket (TCP/UDP) using the modem.
      *
@@ -101,13 +141,19 @@ public:
      * @brief Opens a modem-managed SSL/TLS socket using QSSLOPEN.
      *
      * Configures TLS context with permissive defaults for OTA fetches and
-     * waits for asynchronous +QSSLOPEN result.
+     * waits for asynchronous +QSSLOPEN result. Modem firmware differs in the
+     * QSSLOPEN syntax it accepts, so the known forms are tried in turn.
+     *
+     * @param profile Optional. In: a form known to work is tried alone, and only a
+     *        syntax rejection falls back to the full scan. Out: the form that opened
+     *        the socket; cleared after a timeout so the next call rescans.
      */
     bool openSSLSocket(const char* host,
                        uint16_t port,
                        uint8_t ssl_context_id = 1,
                        uint8_t connect_id = 1,
-                       int timeout_ms = 45000);
+                       int timeout_ms = 45000,
+                       SslOpenProfile_t* profile = nullptr);
 
     /**
      * @brief Sends raw bytes through an already-open modem socket.
@@ -117,6 +163,17 @@ public:
                         size_t payload_len,
                         int timeout_ms = 5000);
 
+    /**
+     * @brief Sends one datagram gathered from a header and a payload through an already-open socket.
+     *
+     * Both parts follow a single `AT+QISEND` prompt, so callers never concatenate them into
+     * a frame buffer.
+     */
+    bool sendSocketData(uint8_t connect_id,
+                        std::span<const uint8_t> header,
+                        std::span<const uint8_t> payload,
+                        int timeout_ms = 5000);
+
     /**
      * @brief Reads pending bytes from an already-open modem socket using AT+QIRD.
      *
@@ -156,25 +213,46 @@ public:
     };
     
 private:
+    static constexpr uint8_t SSL_OPEN_VARIANTS = 7;
+
+    enum class SslOpenOutcome : uint8_t {
+        Opened,
+        Failed,    ///< Accepted, but +QSSLOPEN reported an error code
+        Rejected,  ///< The modem answered ERROR: syntax not supported
+        Timeout
+    };
+
+    /**
+     * @brief Sends one QSSLOPEN syntax variant and waits for its result.
+     * @param variant 1-based variant number
+     */
+    SslOpenOutcome openSSLVariant(uint8_t variant,
+                                  const char* host,
+                                  uint16_t port,
+                                  uint8_t ssl_context_id,
+                                  uint8_t connect_id,
+                                  int timeout_ms);
+
     /**
      * @struct ResponseState
      * @brief Maintains the state of response parsing for an AT command.
      */
     struct ResponseState {
-        char line_buffer[256];      ///< Buffer for accumulating received line
-        size_t line_len = 0;        ///< Current length of data in buffer
+        char line_buffer[256];      ///< Current response line
+        size_t line_len = 0;        ///< Length of the current line
         bool got_expected = false;  ///< Flag indicating expected response was received
         bool success = false;       ///< Flag indicating overall command success
     };
 
     /**
-     * @brief Processes incoming UART data byte-by-byte and accumulates response lines.
+     * @brief Waits for the next response line from the modem reader and processes it.
      * 
      * @param state Current response parsing state
      * @param atCmd The AT command being processed
+     * @param deadline Tick count at which to stop waiting for a line
      * @return true if response processing is complete (success or error), false if still waiting
      */
-    bool processResponse(ResponseState& state, const ATCommand_t& atCmd);
+    bool processResponse(ResponseState& state, const ATCommand_t& atCmd, TickType_t deadline);
     
     /**
      * @brief Handles a complete line received from the modem.
@@ -195,14 +273,27 @@ private:
      */
     bool waitForPrompt(int timeout_ms);
 
+    /**
+     * @brief Sends an AT command, writing the payload and an optional tail after the prompt.
+     *
+     * @param atCmd The AT command structure
+     * @param payload_tail Bytes written straight after atCmd.payload (may be empty)
+     * @return true if the command succeeded, false otherwise
+     */
+    bool sendCommand(const ATCommand_t& atCmd, std::span<const uint8_t> payload_tail);
+
     /**
      * @brief Sends binary payload data and waits for confirmation.
      * 
      * @param payload Pointer to payload data
      * @param payload_len Length of payload
+     * @param payload_tail Bytes written straight after the payload (may be empty)
      * @return true if data sent and acknowledged, false otherwise
      */
-    bool sendPayloadAndWaitResponse(const uint8_t* payload, size_t payload_len, int target_socket_id = -1);
+    bool sendPayloadAndWaitResponse(const uint8_t* payload,
+                                    size_t payload_len,
+                                    std::span<const uint8_t> payload_tail,
+                                    int target_socket_id = -1);
 
     /**
      * @brief Ensures the command mutex is available.
@@ -212,6 +303,7 @@ private:
     
     /**
      * @brief Locks the command mutex to ensure exclusive access to the modem.
+     * The outermost lock also routes modem responses to the calling task.
      * @return true if lock acquired, false on failure
      */
     bool lockCmd();
@@ -223,4 +315,59 @@ private:
     void unlockCmd();
 
     static SemaphoreHandle_t s_cmd_mutex;
-};
\ No newline at end of file
+    static int s_lock_depth;  ///< Recursion depth of s_cmd_mutex held by the current owner
+};
+
+/**
+ * @class SocketRecvWatch
+ * @brief Wakes a task when the modem reports data on, or the loss of, one socket.
+ *
+ * Sockets are opened in buffer access mode: the modem keeps received data until it is
+ * read with AT+QIRD and announces it with `+QIURC: "recv",<id>` once the buffer goes
+ * from empty to non-empty. The watch subscribes to those URCs through the modem reader,
+ * so a receiver sleeps until data is there and only needs to poll as a fallback.
+ */
+class SocketRecvWatch {
+public:
+    enum class Event : uint8_t {
+        Data,     ///< Data is waiting in the modem's receive buffer
+        Closed,   ///< Socket closed by the peer or the PDP context was deactivated
+        Timeout   ///< Nothing reported before the deadline
+    };
+
+    explicit SocketRecvWatch(uint8_t connect_id) : m_connect_id(connect_id) {}
+    ~SocketRecvWatch() { end(); }
+
+    SocketRecvWatch(const SocketRecvWatch&) = delete;
+    SocketRecvWatch& operator=(const SocketRecvWatch&) = delete;
+
+    /**
+     * @brief Subscribes to socket URCs. Safe to call again while active.
+     * @return false if the subscription could not be made (callers then poll)
+     */
+    bool begin();
+
+    /**
+     * @brief Drops the subscription.
+     */
+    void end();
+
+    bool active() const { return m_queue != nullptr; }
+
+    /**
+     * @brief Discards events reported so far, e.g. before a new socket with the same id is used.
+     */
+    void clear();
+
+    /**
+     * @brief Waits for the next event on this socket.
+     * URCs for other sockets are consumed and ignored.
+     */
+    Event wait(TickType_t deadline);
+
+private:
+    static constexpr UBaseType_t QUEUE_DEPTH = 4;
+
+    uint8_t m_connect_id;
+    QueueHandle_t m_queue = nullptr;
+};
@@ -3,6 +3,7 @@
 #include <sys/socket.h>
 #include <string>
 #include "IPacket.hpp"
+#include "CborSchema.hpp"
 
 #include <cbor.h>
 #include "esp_log.h"
@@ -21,26 +22,16 @@
 class ActivatePkt : public IPacket
 {
 private:
-    std::string secretKeyUser;
-    std::string GPSCoord;
-    std::string HwVer;
-    std::string simModSN;
-    std::string simCardSN;
-    std::string chassisVer;
-    
-    static constexpr const char* NODE_ID_KEY = "node_id";
-    static constexpr const char* GPS_KEY = "gps";
-    static constexpr const char* SECRET_KEY_KEY = "secretkey";
-    static constexpr const char* KEY_KEY = "key";
-    static constexpr const char* FW_VER_KEY = "fw_ver";
-    static constexpr const char* HW_VER_KEY = "hw_ver";
-    static constexpr const char* SIM_MOD_SN_KEY = "sim_mod_sn";
-    static constexpr const char* SIM_CARD_SN_KEY = "sim_card_sn";
-    static constexpr const char* CHASSIS_VER_KEY = "chassis_ver";
+    std::string_view secretKeyUser;
+    GpsFix_t GPSFix;
+    std::string_view HwVer;
+    std::string_view simModSN;
+    std::string_view simCardSN;
+    std::string_view chassisVer;
 
 public:
-    ActivatePkt(PktType _pkt_type, std::string _node_id, std::string _uri, std::string _secret_key, std::string _gps_coord, std::string _hw_ver, std::string _sim_mod_sn, std::string _sim_card_sn, std::string _chassis_ver)
-        : IPacket(_pkt_type, _node_id, _uri), secretKeyUser(_secret_key), GPSCoord(_gps_coord), HwVer(_hw_ver), simModSN(_sim_mod_sn), simCardSN(_sim_card_sn), chassisVer(_chassis_ver)
+    ActivatePkt(PktType _pkt_type, std::string_view _node_id, std::string_view _uri, std::string_view _secret_key, const GpsFix_t &_gps_fix, std::string_view _hw_ver, std::string_view _sim_mod_sn, std::string_view _sim_card_sn, std::string_view _chassis_ver)
+        : IPacket(_pkt_type, _node_id, _uri), secretKeyUser(_secret_key), GPSFix(_gps_fix), HwVer(_hw_ver), simModSN(_sim_mod_sn), simCardSN(_sim_card_sn), chassisVer(_chassis_ver)
     {
     }
 
@@ -0,0 +1,216 @@
+#pragma once
+
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "ATCommandHndlr.hpp"
+
+extern "C" {
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+}
+
+/**
+ * @class AtTask
+ * @brief Coroutine returned by modem operations that run on the AT engine.
+ *
+ * The task is lazy: it starts when awaited by another AtTask or when handed to
+ * AtEngine::spawn(), and resumes its awaiter when it finishes. All AtTasks run on
+ * the engine's task, so they never race each other.
+ */
+template <typename T>
+class AtTask {
+public:
+    struct promise_type {
+        T value{};
+        std::coroutine_handle<> continuation;
+
+        AtTask get_return_object() { return AtTask(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+
+        struct FinalAwaiter {
+            bool await_ready() noexcept { return false; }
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<promise_type> h) noexcept {
+                auto next = h.promise().continuation;
+                return next ? next : std::noop_coroutine();
+            }
+            void await_resume() noexcept {}
+        };
+
+        FinalAwaiter final_suspend() noexcept { return {}; }
+        void return_value(T v) { value = std::move(v); }
+        void unhandled_exception() { abort(); }  // Built without exceptions
+    };
+
+    AtTask(AtTask&& other) noexcept : m_handle(std::exchange(other.m_handle, {})) {}
+    AtTask(const AtTask&) = delete;
+    AtTask& operator=(const AtTask&) = delete;
+    ~AtTask() {
+        if (m_handle) {
+            m_handle.destroy();
+        }
+    }
+
+    bool await_ready() const noexcept { return false; }
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiter) noexcept {
+        m_handle.promise().continuation = awaiter;
+        return m_handle;
+    }
+    T await_resume() { return std::move(m_handle.promise().value); }
+
+private:
+    explicit AtTask(std::coroutine_handle<promise_type> h) : m_handle(h) {}
+
+    std::coroutine_handle<promise_type> m_handle;
+};
+
+/**
+ * @class AtJob
+ * @brief Handle through which an ordinary FreeRTOS task follows a spawned AtTask.
+ * Copies share the same job. A default-constructed handle refers to no job.
+ */
+class AtJob {
+public:
+    AtJob() = default;
+
+    bool valid() const { return m_state != nullptr; }
+
+    /**
+     * @brief Whether the job has finished.
+     */
+    bool done() const;
+
+    /**
+     * @brief Blocks the caller until the job finishes or the deadline passes.
+     * @param deadline Tick count to give up at, or portMAX_DELAY to wait until the job finishes
+     * @return the job's result; false on timeout or for an invalid handle
+     */
+    bool wait(TickType_t deadline) const;
+
+private:
+    friend class AtEngine;
+
+    struct State {
+        SemaphoreHandle_t finished = nullptr;
+        volatile bool done = false;
+        volatile bool result = false;
+        ~State();
+    };
+
+    explicit AtJob(std::shared_ptr<State> state) : m_state(std::move(state)) {}
+
+    std::shared_ptr<State> m_state;
+};
+
+/**
+ * @class AtEngine
+ * @brief Runs modem operations written as coroutines on a single task.
+ *
+ * A blocking ATCommandHndlr call holds the calling task for the whole command
+ * timeout, and a vTaskDelay() between commands holds it for the delay. Written as
+ * AtTasks, the same sequences instead suspend at each `co_await`: the engine task
+ * executes queued commands one at a time (the modem is serial anyway) and sleeps
+ * only when every job is waiting on a delay. The task that spawned the job is free
+ * meanwhile and collects the result through the AtJob handle.
+ *
+ * Commands issued by the engine and by other tasks through their own ATCommandHndlr
+ * are still serialised by the AT command lock, so both can be used side by side.
+ *
+ * GPS acquisition is the only sequence on the engine so far. SimConnection::connect(),
+ * the OTA download and the telnet session still make blocking ATCommandHndlr calls;
+ * moving them needs awaiters for the socket reads (readSocketData(), httpGetStream())
+ * and for URC waits, which the engine does not have yet.
+ */
+class AtEngine {
+public:
+    /**
+     * @brief Creates the spawn queue and starts the engine task. Safe to call again.
+     * @return true if the engine is running
+     */
+    bool start();
+
+    bool running() const { return m_task != nullptr; }
+
+    /**
+     * @brief Starts `task` on the engine.
+     * @return Handle to follow the job; invalid if the engine is not running or out of memory
+     */
+    AtJob spawn(AtTask<bool> task);
+
+    struct CommandAwaiter {
+        AtEngine& engine;
+        const ATCommand_t& cmd;
+        char* out_buf;
+        size_t out_len;
+        bool result = false;
+        std::coroutine_handle<> handle;
+
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<> h);
+        bool await_resume() const noexcept { return result; }
+    };
+
+    struct DelayAwaiter {
+        AtEngine& engine;
+        TickType_t ticks;
+
+        bool await_ready() const noexcept { return ticks == 0; }
+        void await_suspend(std::coroutine_handle<> h);
+        void await_resume() const noexcept {}
+    };
+
+    /**
+     * @brief `co_await send(cmd)` runs an AT command; see ATCommandHndlr::send().
+     */
+    CommandAwaiter send(const ATCommand_t& cmd) { return {*this, cmd, nullptr, 0, false, {}}; }
+
+    /**
+     * @brief `co_await sendAndCapture(cmd, buf, len)` runs an AT command and keeps its response.
+     * The buffer must stay valid until the await completes; see ATCommandHndlr::sendAndCapture().
+     */
+    CommandAwaiter sendAndCapture(const ATCommand_t& cmd, char* out_buf, size_t out_len) {
+        return {*this, cmd, out_buf, out_len, false, {}};
+    }
+
+    /**
+     * @brief `co_await delay(ticks)` lets other jobs use the modem for `ticks`.
+     */
+    DelayAwaiter delay(TickType_t ticks) { return {*this, ticks}; }
+
+private:
+    static constexpr UBaseType_t SPAWN_QUEUE_DEPTH = 4;
+
+    struct Timer {
+        TickType_t wake_tick;
+        std::coroutine_handle<> handle;
+    };
+
+    struct RootTask;
+    static RootTask runRoot(AtTask<bool> task, std::shared_ptr<AtJob::State> state);
+
+    static void engineTaskEntry(void* arg);
+    void engineLoop();
+    void runReady();
+    bool runNextCommand();
+    TickType_t nextWakeDelay() const;
+    void wakeExpiredTimers();
+
+    ATCommandHndlr m_hndlr;
+    TaskHandle_t m_task = nullptr;
+    QueueHandle_t m_spawned = nullptr;  ///< Root coroutine handles from other tasks
+
+    // Touched only by the engine task
+    std::deque<std::coroutine_handle<>> m_ready;
+    std::deque<CommandAwaiter*> m_commands;
+    std::vector<Timer> m_timers;
+};
+
+extern AtEngine g_at_engine;
@@ -0,0 +1,166 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+/**
+ * @enum AtResult
+ * @brief Which response a modem line is, as recognised by parseAtResponse().
+ */
+enum class AtResult : uint8_t {
+    Other,      ///< Information text, command echo or a response not in the table
+    Ok,
+    Error,
+    CmeError,
+    CmsError,
+    Prompt,     ///< Data prompt, delivered by the reader as ">"
+    Connect,
+    NoCarrier,
+    SendOk,
+    SendFail,
+    Ready,      ///< "RDY" once the modem has booted
+    // Prefixed responses and URCs; their fields follow the ':'
+    QiOpen,
+    QsslOpen,
+    QiUrc,
+    QiRd,
+    QiAct,
+    QhttpGet,
+    QhttpRead,
+    QcoapSend,
+    Cereg,
+    Cfun,
+    Cpin,
+    CedrxRdp
+};
+
+/**
+ * @struct AtResponse
+ * @brief A classified modem line and its comma-separated fields.
+ *
+ * Field text points into the parsed line, so the line must outlive the response.
+ * Quoted fields are given without their quotes.
+ */
+struct AtResponse {
+    static constexpr size_t MAX_FIELDS = 10;
+
+    struct Field {
+        std::string_view text;
+        int32_t value = 0;
+        bool numeric = false;  ///< Unquoted decimal integer within int32_t, held in `value`
+    };
+
+    AtResult result = AtResult::Other;
+    uint8_t field_count = 0;
+    Field fields[MAX_FIELDS];
+
+    bool is(AtResult r) const { return result == r; }
+    bool isError() const { return result == AtResult::Error || result == AtResult::CmeError || result == AtResult::CmsError; }
+
+    /**
+     * @brief Reads field `index` as an integer.
+     * @return false if the field is missing or not numeric
+     */
+    bool intField(size_t index, int32_t& out) const {
+        if (index >= field_count || !fields[index].numeric) {
+            return false;
+        }
+        out = fields[index].value;
+        return true;
+    }
+
+    /**
+     * @brief Field `index` as text; empty if missing.
+     */
+    std::string_view textField(size_t index) const {
+        return (index < field_count) ? fields[index].text : std::string_view{};
+    }
+};
+
+/**
+ * @brief Classifies one modem line (CR/LF already stripped) and extracts its fields.
+ *
+ * The head of the line — everything before the ':' for "+XXX:" responses, the whole
+ * line otherwise — is hashed while it is scanned and looked up in a collision-free
+ * table built at compile time from AT_RESPONSE_PATTERNS, so a line costs one pass
+ * and one string compare however many responses the table knows.
+ */
+AtResponse parseAtResponse(std::string_view line);
+
+struct AtResponsePattern {
+    std::string_view head;
+    AtResult result;
+};
+
+inline constexpr AtResponsePattern AT_RESPONSE_PATTERNS[] = {
+    {"OK", AtResult::Ok},
+    {"ERROR", AtResult::Error},
+    {"+CME ERROR", AtResult::CmeError},
+    {"+CMS ERROR", AtResult::CmsError},
+    {">", AtResult::Prompt},
+    {"CONNECT", AtResult::Connect},
+    {"NO CARRIER", AtResult::NoCarrier},
+    {"SEND OK", AtResult::SendOk},
+    {"SEND FAIL", AtResult::SendFail},
+    {"RDY", AtResult::Ready},
+    {"+QIOPEN", AtResult::QiOpen},
+    {"+QSSLOPEN", AtResult::QsslOpen},
+    {"+QIURC", AtResult::QiUrc},
+    {"+QIRD", AtResult::QiRd},
+    {"+QIACT", AtResult::QiAct},
+    {"+QHTTPGET", AtResult::QhttpGet},
+    {"+QHTTPREAD", AtResult::QhttpRead},
+    {"+QCOAPSEND", AtResult::QcoapSend},
+    {"+CEREG", AtResult::Cereg},
+    {"+CFUN", AtResult::Cfun},
+    {"+CPIN", AtResult::Cpin},
+    {"+CEDRXRDP", AtResult::CedrxRdp},
+};
+
+namespace at_response_detail {
+
+constexpr uint32_t HASH_MUL = 11;
+constexpr size_t HASH_SLOTS = 64;
+
+constexpr uint32_t hashStep(uint32_t hash, char c) {
+    return hash * HASH_MUL + static_cast<uint8_t>(c);
+}
+
+constexpr size_t slotOf(std::string_view head) {
+    uint32_t hash = 0;
+    for (const char c : head) {
+        hash = hashStep(hash, c);
+    }
+    return hash % HASH_SLOTS;
+}
+
+constexpr bool headsCollide() {
+    std::array<bool, HASH_SLOTS> used{};
+    for (const auto& pattern : AT_RESPONSE_PATTERNS) {
+        const size_t slot = slotOf(pattern.head);
+        if (used[slot]) {
+            return true;
+        }
+        used[slot] = true;
+    }
+    return false;
+}
+
+constexpr std::array<int8_t, HASH_SLOTS> buildSlots() {
+    std::array<int8_t, HASH_SLOTS> slots{};
+    slots.fill(-1);
+    for (size_t i = 0; i < std::size(AT_RESPONSE_PATTERNS); ++i) {
+        slots[slotOf(AT_RESPONSE_PATTERNS[i].head)] = static_cast<int8_t>(i);
+    }
+    return slots;
+}
+
+// A new pattern that collides needs another HASH_MUL (or more slots)
+static_assert(!headsCollide(), "AT response heads collide in the hash table");
+
+/** Slot -> index into AT_RESPONSE_PATTERNS, or -1. */
+inline constexpr std::array<int8_t, HASH_SLOTS> SLOTS = buildSlots();
+
+}  // namespace at_response_detail
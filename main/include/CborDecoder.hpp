@@ -1,21 +1,192 @@
 #pragma once
 
-#include <string>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
 
-struct CborStringTransform {
-    std::string incoming;
-    std::string outgoing;
+/**
+ * @brief Value types a field table entry can accept.
+ */
+enum class CborFieldKind : uint8_t {
+    Uint,   ///< Unsigned integer (major type 0)
+    Int,    ///< Signed integer (major types 0 and 1)
+    Bool,   ///< true / false
+    Text,   ///< Text string, delivered in fragments
+    Bytes,  ///< Byte string, delivered in fragments
+    String  ///< Text or byte string; delivered as Text or Bytes
 };
 
-class CborDecoder {
+/**
+ * @brief One decoded value handed to a field callback.
+ *
+ * Strings are delivered as fragments that view the chunk being fed, so nothing is copied;
+ * a string split across chunks arrives as several fragments, the last one flagged.
+ */
+typedef struct {
+    CborFieldKind kind;
+    uint64_t uint_value;                  ///< Uint
+    int64_t int_value;                    ///< Int
+    bool bool_value;                      ///< Bool
+    std::span<const uint8_t> fragment;    ///< Text/Bytes: this piece of the string
+    size_t offset;                        ///< Text/Bytes: position of the fragment within the string
+    size_t total_len;                     ///< Text/Bytes: length of the whole string
+    bool last;                            ///< Text/Bytes: the fragment completes the string
+} CborFieldValue_t;
+
+/**
+ * @brief Map key a field table entry matches.
+ */
+typedef struct {
+    std::string_view text;   ///< Text key; empty when the entry matches an integer key or the root
+    int32_t number;          ///< Unsigned integer key, or -1
+} CborFieldKey_t;
+
+constexpr CborFieldKey_t cborTextKey(std::string_view text) { return {text, -1}; }
+constexpr CborFieldKey_t cborUintKey(int32_t number) { return {{}, number}; }
+
+/**
+ * @brief Key matching a reply that is a bare top-level string instead of a map.
+ */
+constexpr CborFieldKey_t cborRootKey() { return {{}, -1}; }
+
+/**
+ * @class CborDecoder
+ * @brief Incremental, allocation-free decoder for CBOR server replies (RFC 8949).
+ *
+ * Walks a top-level map as chunks arrive and hands the values of known keys to field
+ * callbacks; unknown keys, nested containers and tags are skipped. A top-level text or byte
+ * string is delivered to the root field, so replies that are a bare string keep working.
+ * Item heads and keys split across chunks are buffered internally (a few bytes); string
+ * values are never buffered. Indefinite-length maps and arrays are accepted, indefinite-length
+ * strings are not.
+ */
+class CborDecoder
+{
 public:
+    virtual ~CborDecoder() = default;
+
+    /**
+     * @brief Start decoding a new reply.
+     */
+    void reset();
+
+    /**
+     * @brief Decode the next chunk of the reply.
+     * @param chunk Received bytes; string fragments passed to callbacks point into it
+     * @return false if the reply is malformed, a callback rejected a value, or data follows the reply
+     */
+    bool feed(std::span<const uint8_t> chunk);
+
     /**
-     * @brief Decodes transform.incoming as CBOR text/bytes into transform.outgoing.
+     * @brief Whether a complete top-level item has been decoded.
      */
-    static bool decodeText(CborStringTransform& transform);
-    
+    bool complete() const { return m_state == State::Done; }
+
+protected:
+    static constexpr int NO_FIELD = -1;
+
     /**
-     * @brief Decodes transform.incoming as CBOR byte string into transform.outgoing.
+     * @brief Find the field table entry for a key.
+     * @return Entry index, or NO_FIELD
      */
-    static bool decodeBytes(CborStringTransform& transform);
+    virtual int findField(std::string_view text_key, int64_t number_key, bool is_root) const = 0;
+
+    virtual CborFieldKind fieldKind(int field) const = 0;
+
+    virtual bool deliver(int field, const CborFieldValue_t& value) = 0;
+
+private:
+    static constexpr size_t MAX_DEPTH = 8;
+    static constexpr size_t KEY_MAX = 32;
+    static constexpr uint64_t INDEFINITE = UINT64_MAX;
+
+    enum class State : uint8_t { Head, StringBody, Done, Error };
+    enum class Role : uint8_t { Root, Key, Value, Skip };
+
+    struct Level
+    {
+        uint64_t remaining;  ///< Items left, or INDEFINITE until a break
+    };
+
+    State m_state = State::Head;
+    uint8_t m_head[9] = {};
+    size_t m_head_len = 0;
+    size_t m_head_need = 0;
+
+    Level m_levels[MAX_DEPTH] = {};
+    size_t m_depth = 0;
+    bool m_expect_key = true;
+    int m_field = NO_FIELD;
+
+    Role m_string_role = Role::Skip;
+    uint8_t m_string_major = 0;
+    uint64_t m_string_len = 0;
+    uint64_t m_string_pos = 0;
+
+    char m_key[KEY_MAX] = {};
+    size_t m_key_len = 0;
+    bool m_key_truncated = false;
+
+    Role currentRole() const;
+    bool processHead();
+    bool startString(Role role, uint8_t major, uint64_t len);
+    bool consumeString(std::span<const uint8_t> bytes);
+    bool finishKey(std::string_view text_key, int64_t number_key);
+    bool deliverScalar(uint8_t major, uint8_t info, uint64_t arg);
+    bool pushLevel(uint64_t items);
+    bool itemDone();
+};
+
+/**
+ * @class CborMapDecoder
+ * @brief CborDecoder driven by a compile-time field table with callbacks typed on a context.
+ */
+template <typename Context>
+class CborMapDecoder : public CborDecoder
+{
+public:
+    /**
+     * @brief Field table entry: key, accepted kind and callback.
+     */
+    struct Field
+    {
+        CborFieldKey_t key;
+        CborFieldKind kind;
+        bool (*handler)(Context&, const CborFieldValue_t&);
+    };
+
+    CborMapDecoder(std::span<const Field> fields, Context& context) : m_fields(fields), m_context(context) {}
+
+protected:
+    int findField(std::string_view text_key, int64_t number_key, bool is_root) const override
+    {
+        for (size_t i = 0; i < m_fields.size(); ++i)
+        {
+            const CborFieldKey_t& key = m_fields[i].key;
+            const bool entry_is_root = key.text.empty() && key.number < 0;
+
+            if (is_root ? entry_is_root
+                        : ((!key.text.empty() && key.text == text_key) || (key.number >= 0 && key.number == number_key)))
+            {
+                return static_cast<int>(i);
+            }
+        }
+
+        return NO_FIELD;
+    }
+
+    CborFieldKind fieldKind(int field) const override
+    {
+        return m_fields[static_cast<size_t>(field)].kind;
+    }
+
+    bool deliver(int field, const CborFieldValue_t& value) override
+    {
+        return m_fields[static_cast<size_t>(field)].handler(m_context, value);
+    }
+
+private:
+    std::span<const Field> m_fields;
+    Context& m_context;
 };
@@ -0,0 +1,288 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+#include "DeviceConfig.hpp"
+
+/**
+ * @class CborWriter
+ * @brief Minimal CBOR writer (RFC 8949) for the schema-compiled packet encoders.
+ *
+ * Emits definite-length items and pre-encoded byte sequences into a caller buffer. The first
+ * write that does not fit marks the writer failed and every later write is ignored, so an
+ * encoder can emit a whole packet and check ok() once without losing an error.
+ */
+class CborWriter
+{
+public:
+    CborWriter(uint8_t *buffer, size_t capacity) : m_buffer(buffer), m_capacity(capacity) {}
+
+    void map(size_t count) { head(MAJOR_MAP, count); }
+    void array(size_t count) { head(MAJOR_ARRAY, count); }
+    void uint(uint64_t value) { head(MAJOR_UINT, value); }
+    void sint(int64_t value) { value < 0 ? head(MAJOR_NINT, static_cast<uint64_t>(-1 - value)) : head(MAJOR_UINT, static_cast<uint64_t>(value)); }
+    void tag(uint64_t value) { head(MAJOR_TAG, value); }
+    void text(std::string_view value);
+    void bytes(std::span<const uint8_t> value);
+    void float32(float value);
+
+    /**
+     * @brief Copy already-encoded CBOR (a key, or a cached run of key/value pairs).
+     */
+    void raw(std::span<const uint8_t> encoded);
+
+    bool ok() const { return m_ok; }
+    size_t size() const { return m_len; }
+
+private:
+    static constexpr uint8_t MAJOR_UINT = 0;
+    static constexpr uint8_t MAJOR_NINT = 1;
+    static constexpr uint8_t MAJOR_BYTES = 2;
+    static constexpr uint8_t MAJOR_TEXT = 3;
+    static constexpr uint8_t MAJOR_ARRAY = 4;
+    static constexpr uint8_t MAJOR_MAP = 5;
+    static constexpr uint8_t MAJOR_TAG = 6;
+
+    uint8_t *m_buffer;
+    size_t m_capacity;
+    size_t m_len = 0;
+    bool m_ok = true;
+
+    void head(uint8_t major, uint64_t value);
+};
+
+/**
+ * @brief Fields a packet schema can carry.
+ *
+ * Identity fields are the same for every packet of a wake cycle and are pre-encoded by
+ * PacketSchema::cacheIdentity; per-packet fields are encoded by the packet class; the
+ * authentication trailer is written by PacketSchema::encode and ends every layout.
+ */
+enum class SchemaField : uint8_t {
+    // Identity
+    Encoding,
+    NodeId,
+    FwVer,
+    // Per packet
+    SecretKey,
+    Gps,
+    HwVer,
+    SimModSn,
+    SimCardSn,
+    ChassisVer,
+    MType,
+    Samples,
+    // Authentication trailer
+    Session,
+    Seq,
+    Mac
+};
+
+/**
+ * @brief Map key encoded at compile time.
+ */
+struct SchemaKey
+{
+    static constexpr size_t MAX_LEN = 16;
+
+    std::array<uint8_t, MAX_LEN> bytes;
+    size_t len;  ///< 0 if the key did not fit
+
+    constexpr std::span<const uint8_t> span() const { return std::span<const uint8_t>(bytes.data(), len); }
+};
+
+/**
+ * @brief Encode a text map key (major type 3) at compile time.
+ */
+constexpr SchemaKey textKey(std::string_view name)
+{
+    SchemaKey key = {};
+    size_t offset = 0;
+
+    if (name.size() + 2 > SchemaKey::MAX_LEN)
+    {
+        return key;
+    }
+
+    if (name.size() < 24)
+    {
+        key.bytes[offset++] = static_cast<uint8_t>(0x60 | name.size());
+    }
+    else
+    {
+        key.bytes[offset++] = 0x78;
+        key.bytes[offset++] = static_cast<uint8_t>(name.size());
+    }
+
+    for (const char c : name)
+    {
+        key.bytes[offset++] = static_cast<uint8_t>(c);
+    }
+
+    key.len = offset;
+    return key;
+}
+
+/**
+ * @brief Encode a small unsigned integer map key (major type 0) at compile time.
+ */
+constexpr SchemaKey uintKey(uint8_t value)
+{
+    SchemaKey key = {};
+
+    if (value < 24)
+    {
+        key.bytes[0] = value;
+        key.len = 1;
+    }
+    else
+    {
+        key.bytes[0] = 0x18;
+        key.bytes[1] = value;
+        key.len = 2;
+    }
+
+    return key;
+}
+
+/**
+ * @brief One key/value pair of a packet map.
+ */
+struct SchemaEntry
+{
+    SchemaKey key;
+    SchemaField field;
+};
+
+/**
+ * @brief Packet map layouts, declared once in CborSchema.cpp.
+ */
+enum class PacketLayout : uint8_t {
+    Activate,
+    GpsUpdate,
+    ReadingLegacy,
+    ReadingCompact,
+    Count
+};
+
+/**
+ * @class PacketSchema
+ * @brief Packet map layouts compiled into encoders.
+ *
+ * Each layout is a constexpr table of pre-encoded keys with the identity fields first. The
+ * identity run (keys and values for node ID, firmware version and, for compact readings, the
+ * encoding marker) is encoded once per layout by cacheIdentity and copied into every packet;
+ * packets then encode only their own fields after it.
+ *
+ * Every layout ends with the session count, a sequence number and a truncated HMAC-SHA256 tag
+ * (Key::computeTag) over all bytes of the payload before the tag's key. The sequence number
+ * restarts with each session; it is kept in RTC memory so a wake that fails before the session
+ * count is saved does not reuse a (session, seq) pair.
+ */
+class PacketSchema
+{
+public:
+    static constexpr size_t IDENTITY_PREFIX_MAX = 160;
+    static constexpr size_t TRAILER_FIELDS = 3;  ///< Session, Seq, Mac
+    static constexpr size_t TRAILER_GROWTH_MAX = 16;  ///< Re-signing can lengthen session and seq by 8 bytes each
+
+    /**
+     * @brief Pre-encode the identity prefix of every layout and load the packet MAC key.
+     *
+     * Called at the start of a wake cycle and again whenever the node ID, key or firmware
+     * version changes (activation computes the key). Also latches the session count that
+     * packets of this wake carry.
+     *
+     * @param config Device configuration
+     * @return true if every prefix was encoded and the MAC key was loaded
+     */
+    static bool cacheIdentity(const DeviceConfig &config);
+
+    /**
+     * @brief Encode a GPS fix as [lat, lon] or [lat, lon, hdop, alt].
+     *
+     * Coordinates are integers in 1e-7 degrees, HDOP in tenths and altitude in decimetres; the
+     * last two are only sent when the modem reported them.
+     */
+    static void writeGps(CborWriter &writer, const GpsFix_t &fix);
+
+    /**
+     * @brief Encode a packet map: map header, cached identity prefix, per-packet fields, then the trailer.
+     * @param layout Packet layout
+     * @param node_id Node ID the packet was built for; must match the cached identity
+     * @param out Output buffer
+     * @param write_field Callable bool(CborWriter&, SchemaField) that encodes one per-packet value
+     * @return Encoded length, or 0 on error
+     */
+    template <typename WriteField>
+    static size_t encode(PacketLayout layout, std::string_view node_id, std::span<uint8_t> out, WriteField &&write_field)
+    {
+        const std::span<const uint8_t> prefix = identityPrefix(layout, node_id);
+
+        if (prefix.empty())
+        {
+            return 0;
+        }
+
+        const std::span<const SchemaEntry> entries = fields(layout);
+        CborWriter writer(out.data(), out.size());
+
+        writer.map(entries.size());
+        writer.raw(prefix);
+
+        const size_t identity_count = identityCount(layout);
+
+        for (const SchemaEntry &entry : entries.subspan(identity_count, entries.size() - identity_count - TRAILER_FIELDS))
+        {
+            writer.raw(entry.key.span());
+
+            if (!write_field(writer, entry.field))
+            {
+                return 0;
+            }
+        }
+
+        const std::span<const SchemaEntry> trailer = entries.last(TRAILER_FIELDS);
+        const TrailerKeys trailer_keys = {trailer[0].key.span(), trailer[1].key.span(), trailer[2].key.span()};
+
+        return writeTrailer(trailer_keys, writer, out.data()) ? writer.size() : 0;
+    }
+
+    /**
+     * @brief Re-encode a stored packet with the current session, a new sequence number and a new tag.
+     *
+     * Packets kept across wakes still carry the trailer of the wake that encoded them, which the
+     * server would reject as a replayed (session, seq) pair. Everything before the trailer is
+     * copied unchanged, including its keys, so packets of any layout can be re-signed.
+     *
+     * @param payload Packet map as produced by encode
+     * @param out Output buffer; allow TRAILER_GROWTH_MAX bytes more than the payload
+     * @return Encoded length, or 0 if the payload is not a packet map or no MAC key is loaded
+     */
+    static size_t refreshTrailer(std::span<const uint8_t> payload, std::span<uint8_t> out);
+
+private:
+    using TrailerKeys = std::array<std::span<const uint8_t>, TRAILER_FIELDS>;
+
+    static std::span<const SchemaEntry> fields(PacketLayout layout);
+    static size_t identityCount(PacketLayout layout);
+
+    /**
+     * @brief Cached identity prefix of a layout, checked against the packet's node ID.
+     * @return Prefix bytes, or an empty span if it is not cached, lacks a key, or is for another node
+     */
+    static std::span<const uint8_t> identityPrefix(PacketLayout layout, std::string_view node_id);
+
+    /**
+     * @brief Write the session, next sequence number and the tag over everything written so far.
+     * @param keys Encoded session, seq and MAC keys
+     * @param writer Writer positioned after the per-packet fields
+     * @param start Start of the payload the writer fills
+     * @return true if the trailer was written
+     */
+    static bool writeTrailer(const TrailerKeys &keys, CborWriter &writer, const uint8_t *start);
+};
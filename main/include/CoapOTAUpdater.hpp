@@ -9,6 +9,7 @@ extern "C" {
 #ifdef __cplusplus
 }
 #endif
+#include "CborDecoder.hpp"
 #include "Communication.hpp"
 
 class CoapOTAUpdater {
@@ -30,6 +31,23 @@ public:
      * Note: This function does not perform any OTA update actions, it only checks for the availability of an update.
      */
     bool isFirmwareAvailable();
+
+    /**
+     * @brief Starts decoding a firmware version response.
+     * Used when the version request rides in a pipelined batch with other uplink packets: the
+     * returned callback is the request's payload callback and decodes each chunk as it arrives.
+     * The response is either a bare version string or a map with "version" and an optional
+     * "url" for the HTTPS fallback, which then needs no separate firmware-bin request.
+     * @return Payload callback feeding the version decoder; the updater must outlive the request.
+     */
+    PacketChunkCallback versionResponseSink();
+
+    /**
+     * @brief Evaluates the firmware version response decoded since versionResponseSink().
+     * @return true if a newer firmware version is available, false otherwise.
+     * The available version string is stored internally for use during the update process if this returns true.
+     */
+    bool evaluateVersionResponse();
     
     /**
      * @brief Executes the OTA update process.
@@ -43,6 +61,47 @@ public:
     bool executeUpdate();
 
 private:
+    /**
+     * @brief Outcome of a block-wise firmware download attempt.
+     */
+    enum class BlockwiseResult : uint8_t {
+        Complete,    ///< Whole image written to the OTA partition
+        Failed,      ///< Transfer interrupted; progress persisted for the next attempt
+        Unsupported  ///< Server did not serve block 0; caller may fall back to HTTPS
+    };
+
+    /**
+     * Progress is flushed to NVS on flash sector boundaries so a resumed download restarts
+     * at the beginning of a sector that esp_ota_resume will erase and rewrite.
+     */
+    static constexpr uint32_t OTA_PROGRESS_FLUSH_BYTES = 4096;
+    static constexpr int OTA_BLOCK_MAX_FAILURES = 3;
+
+    /**
+     * @brief Downloads the firmware image as CoAP Block2 transfers straight into the OTA partition.
+     * Resumes from persisted progress when it matches the target version, otherwise starts a new
+     * OTA session. The block size starts at the transport's limit and follows the server if it
+     * answers with smaller blocks.
+     * @param partition OTA partition to write.
+     * @param version Firmware version being downloaded (used to validate resume state).
+     * @param ota_handle Output OTA handle; valid on Complete.
+     * @param total_written Output number of image bytes written.
+     * @return Outcome of the transfer.
+     */
+    BlockwiseResult streamFirmwareBlockwise(const esp_partition_t* partition,
+                                            const std::string& version,
+                                            esp_ota_handle_t& ota_handle,
+                                            size_t& total_written);
+
+    /**
+     * @brief Legacy path: fetches a firmware URL over CoAP and streams the image over HTTPS.
+     * @param partition OTA partition to write.
+     * @param ota_handle Output OTA handle; valid on success.
+     * @param total_written Output number of image bytes written.
+     * @return true if the image was downloaded and written, false otherwise (the OTA session is aborted).
+     */
+    bool downloadFirmwareViaUrl(const esp_partition_t* partition, esp_ota_handle_t& ota_handle, size_t& total_written);
+
     /**
      * @brief Helper function to stream firmware from an HTTPS URL directly to the OTA partition.
      * @param firmware_url The HTTPS URL from which to download the firmware binary.
@@ -62,8 +121,28 @@ private:
      */
     int compareVersions(const std::string& v1, const std::string& v2);
 
+    /**
+     * @brief Checks that a complete version response was decoded and trims the version.
+     * @return true if a non-empty version was decoded
+     */
+    bool finishVersionResponse();
+
+    static constexpr size_t VERSION_MAX_LEN = 64;
+    static constexpr size_t URL_MAX_LEN = 1024;
+
+    static bool onVersionField(CoapOTAUpdater& ota, const CborFieldValue_t& value);
+    static bool onUrlField(CoapOTAUpdater& ota, const CborFieldValue_t& value);
+
+    /** Version response: bare string, or map with "version" and optional "url". */
+    static const CborMapDecoder<CoapOTAUpdater>::Field VERSION_RESPONSE_FIELDS[3];
+    /** Firmware-bin response: bare URL string, or map with "url". */
+    static const CborMapDecoder<CoapOTAUpdater>::Field URL_RESPONSE_FIELDS[2];
+
     Communication& comm;
     std::string current_version;
     std::string available_version;
+    std::string reply_url;  ///< Image URL from the version or firmware-bin response
+    CborMapDecoder<CoapOTAUpdater> version_decoder;
+    CborMapDecoder<CoapOTAUpdater> url_decoder;
     esp_http_client_config_t http_config;
 };
@@ -1,7 +1,9 @@
 #pragma once
 
+#include <cstdint>
+#include <span>
 #include <stdlib.h>
-#include <string>
+#include <string_view>
 #include <unistd.h>
 
 // CoAP Protocol Constants
@@ -33,6 +35,9 @@
 // CoAP Option Numbers
 #define COAP_OPTION_URI_PATH        11
 #define COAP_OPTION_CONTENT_FORMAT  12
+#define COAP_OPTION_MAX_AGE         14
+#define COAP_OPTION_BLOCK2          23
+#define COAP_OPTION_BLOCK1          27
 
 // CoAP Option Deltas
 #define COAP_DELTA_URI_PATH         11
@@ -51,6 +56,7 @@
 #define COAP_DEFAULT_TOKEN_LEN      4
 #define COAP_OPTION_EXTENDED_LEN    13
 #define COAP_OPTION_MAX_STANDARD    12
+#define COAP_DEFAULT_MAX_AGE_S      60
 
 // Packet response timing defaults (milliseconds)
 #define PKT_RESPONSE_WIN_DEFAULT_MS            15000
@@ -59,15 +65,26 @@
 #define PKT_SOCKET_READ_TIMEOUT_DEFAULT_MS     1200
 #define PKT_SOCKET_READ_TIMEOUT_FW_DOWNLOAD_MS 2000
 
+// Block-wise transfer (RFC 7959): block size is 2^(SZX + 4) bytes
+#define COAP_BLOCK_SZX_MAX          6
+#define COAP_BLOCK_SIZE(szx)        (16U << (szx))
+
+// CoAP Transmission Parameters (RFC 7252 Section 4.8)
+#define COAP_ACK_TIMEOUT_MS         2000
+#define COAP_ACK_RANDOM_FACTOR_PCT  150
+#define COAP_MAX_RETRANSMIT         4
+
+// Outstanding requests per exchange. RFC 7252 defaults NSTART to 1; responses are told apart
+// by random per-request tokens, so the device server is configured to accept more.
+#define COAP_NSTART                 4
+
 // CoAP Special Values
 #define COAP_PAYLOAD_MARKER         0xFF
-#define COAP_INITIAL_MSG_ID         0x1234
+#define COAP_HEADER_SIZE            4
+#define COAP_CODE_EMPTY             0x00
 
-// Token Constants
-#define COAP_TOKEN_BYTE_0           0x01
-#define COAP_TOKEN_BYTE_1           0x02
-#define COAP_TOKEN_BYTE_2           0x03
-#define COAP_TOKEN_BYTE_3           0x04
+// Largest request prefix: header, token, Uri-Path, Content-Format, Block2 and payload marker
+#define COAP_FRAME_HEADER_MAX       40
 
 // Bit Masks
 #define COAP_VERSION_MASK           0x03
@@ -84,6 +101,11 @@
 #define COAP_CODE_CLASS_SHIFT       5
 #define COAP_OPTION_DELTA_SHIFT     4
 
+// Option nibble values that signal extended delta/length fields
+#define COAP_OPTION_EXT_8BIT        13
+#define COAP_OPTION_EXT_16BIT       14
+#define COAP_OPTION_EXT_16BIT_BASE  269
+#define COAP_OPTION_EXT_RESERVED    15
 
 
 enum PktType
@@ -92,7 +114,8 @@ enum PktType
 	Reading,
 	FirmwareVersion,
 	FirmwareDownload,
-	GpsUpdate
+	GpsUpdate,
+	FirmwareImage
 };
 
 enum CoapMethod 
@@ -108,24 +131,130 @@ typedef struct {
 	int response_win;
 	int socket_read_timeout;
 } PktEntry_t;
+
+/**
+ * @brief Request bytes up to and including the payload marker.
+ * Sent ahead of the payload as a gather write, so the payload is never copied into a frame buffer.
+ */
+typedef struct {
+	uint8_t bytes[COAP_FRAME_HEADER_MAX];
+	size_t len;
+} CoapFrameHeader_t;
+
+/**
+ * @brief Decoded Block1/Block2 option value (RFC 7959 Section 2.2).
+ */
+typedef struct {
+	uint32_t num;
+	bool more;
+	uint8_t szx;
+} CoapBlockOpt_t;
+
+/**
+ * @brief View of a received CoAP message (RFC 7252 Section 3).
+ * Token and payload refer into the datagram that was parsed, which must outlive the view.
+ */
+typedef struct {
+	uint8_t type;
+	uint8_t code;
+	uint16_t msg_id;
+	std::span<const uint8_t> token;
+	bool has_content_format;
+	uint16_t content_format;
+	uint32_t max_age;                 ///< Seconds; COAP_DEFAULT_MAX_AGE_S when the option is absent
+	bool has_block1;
+	CoapBlockOpt_t block1;
+	bool has_block2;
+	CoapBlockOpt_t block2;
+	std::span<const uint8_t> payload;
+} CoapMessage_t;
+
 class CoapPktAssm
 {
 public:
 	/**
-	 * @brief 
-	 * @param coap_buffer 
-	 * @param pkt_type
-	 * @param buffer
-	 * @param buffler_len
+	 * @brief Build the header of a confirmable CoAP request for a CBOR payload
+	 *
+	 * The header, Uri-Path and Content-Format options come from a per-packet-type template
+	 * generated at compile time; only the message ID and a random token are written per request.
+	 * @param header Output header, ending with the payload marker when has_payload is set
+	 * @param pkt_config Packet configuration selecting method and Uri-Path
+	 * @param has_payload Whether a payload follows the header
+	 * @param block2 Optional Block2 option to request a specific block of the response
+	 * @return Number of bytes written to the header, or 0 on error
 	 */
-	static size_t buildCoapBuffer(uint8_t coap_buffer[], const uint8_t *buffer, const size_t buffer_len, PktEntry_t pkt_config);
-	
+	static size_t buildHeader(CoapFrameHeader_t &header, PktEntry_t pkt_config, bool has_payload,
+	                          const CoapBlockOpt_t *block2 = nullptr);
+
 	/**
 	 * @brief Get the URI path string based on the packet type
-	 * @param pkt_type The type of the packet (Activate, Reading, FirmwareVersion, or GpsUpdate)
-	 * @return The corresponding URI path string (e.g., "activate", "reading", "firmware-version", or "gps-update")
+	 * @param pkt_type The type of the packet
+	 * @return The corresponding URI path (e.g., "activate", "reading", "firmware-version", or "gps-update")
+	 */
+	static constexpr std::string_view getUriPath(PktType pkt_type)
+	{
+		switch (pkt_type)
+		{
+		case PktType::Activate:
+			return "activate";
+		case PktType::Reading:
+			return "reading";
+		case PktType::GpsUpdate:
+			return "gps-update";
+		case PktType::FirmwareVersion:
+			return "firmware-version";
+		case PktType::FirmwareDownload:
+			return "firmware-bin";
+		case PktType::FirmwareImage:
+			return "firmware-image";
+		default:
+			return "";
+		}
+	}
+
+	/**
+	 * @brief Get the request code detail for a method
+	 * @param method CoAP method
+	 * @return Code detail (GET 0.01, POST 0.02, PUT 0.03)
+	 */
+	static constexpr uint8_t getMethodCode(CoapMethod method)
+	{
+		switch (method)
+		{
+		case CoapMethod::PUT:
+			return COAP_CODE_DETAIL_PUT;
+		case CoapMethod::POST:
+			return COAP_CODE_DETAIL_POST;
+		case CoapMethod::GET:
+			return COAP_CODE_DETAIL_GET;
+		default:
+			return 0;
+		}
+	}
+
+	static constexpr size_t PKT_TYPE_COUNT = static_cast<size_t>(PktType::FirmwareImage) + 1;
+	static constexpr size_t METHOD_COUNT = static_cast<size_t>(CoapMethod::PUT) + 1;
+
+	/**
+	 * @brief Parse a received CoAP datagram in place
+	 *
+	 * Decodes the header, token and every option, resolving extended deltas and lengths.
+	 * Content-Format, Max-Age, Block1 and Block2 are extracted; other elective options are
+	 * skipped, while unrecognised critical options make the message invalid as required by
+	 * RFC 7252 Section 5.4.1. Nothing is copied: token and payload are views into the datagram.
+	 * @param datagram Received datagram
+	 * @param msg Output message view
+	 * @return true if the datagram is a well-formed CoAP message, false otherwise
+	 */
+	static bool parseMessage(std::span<const uint8_t> datagram, CoapMessage_t &msg);
+
+	/**
+	 * @brief Build an empty ACK used to acknowledge a separate (CON) response
+	 * @param buffer Output buffer, at least COAP_HEADER_SIZE bytes
+	 * @param msg_id Message ID of the confirmable message being acknowledged
+	 * @return Number of bytes written to the buffer (COAP_HEADER_SIZE)
 	 */
-	static std::string getUriPath(PktType pkt_type);
+	static size_t buildEmptyAck(uint8_t *buffer, uint16_t msg_id);
 
 
 private:
@@ -138,15 +267,6 @@ private:
 	 * @return Number of bytes written to the buffer (should be 1)
 	 */
 	static size_t setHeader(uint8_t *buffer, uint8_t version, uint8_t type, uint8_t token_len);
-	/**
-	 * @brief Set the CoAP code field (Class and Detail)
-	 * @param buffer Pointer to the buffer where the code will be written
-	 * @param code_class CoAP code class (0 for requests, 2 for success
-	 * responses, 4 for client errors, 5 for server errors)
-	 * @param code_detail CoAP code detail (specific to the class)
-	 * @return Number of bytes written to the buffer (should be 1)
-	 */
-	static size_t setCode(uint8_t *buffer, uint8_t code_class, uint8_t code_detail);
 	
 	/**
 	 * @brief Set the CoAP Message ID field
@@ -166,23 +286,13 @@ private:
 	static size_t setToken(uint8_t *buffer, const uint8_t *token, uint8_t token_len);
 	
 	/**
-	 * @brief Set the Uri-Path option in the CoAP packet
+	 * @brief Set a Block1/Block2 option using the shortest uint encoding of NUM|M|SZX
 	 * @param buffer Pointer to the buffer where the option will be written
-	 * @param uri_path The URI path string to set (e.g., "activate"
-	 * 	or "reading")
-	 * @param delta The option delta value (should be COAP_DELTA_URI_PATH)
-	 * @return Number of bytes written to the buffer (varies based on uri_path length
-	 */
-	static size_t setUriPathOption(uint8_t *buffer, const std::string &uri_path, uint8_t delta);
-	/**
-	 * @brief Set the Content-Format option in the CoAP packet
-	 * @param buffer Pointer to the buffer where the option will be written
-	 * @param content_format The content format value (e.g., COAP_CONTENT_FORMAT_CB
-	 * 	OR)
-	 * @param delta The option delta value (should be COAP_DELTA_CONTENT_FORMAT)
-	 * @return Number of bytes written to the buffer (should be 2)
+	 * @param block Block number, more flag and size exponent
+	 * @param delta The option delta value (relative to the previous option)
+	 * @return Number of bytes written to the buffer (1 to 4)
 	 */
-	static size_t setContentFormatOption(uint8_t *buffer, uint8_t content_format, uint8_t delta);
+	static size_t setBlockOption(uint8_t *buffer, const CoapBlockOpt_t &block, uint8_t delta);
 	
 	/**
 	 * @brief Set the Payload Marker in the CoAP packet
@@ -191,15 +301,6 @@ private:
 	 */
 	static size_t setPayloadMarker(uint8_t *buffer);
 	
-	/**
-	 * @brief Set the payload data in the CoAP packet
-	 * @param buffer Pointer to the buffer where the payload will be written
-	 * @param payload Pointer to the payload data bytes
-	 * @param payload_len Length of the payload data in bytes
-	 * @return Number of bytes written to the buffer (should be equal to payload_len)
-	 */
-	static size_t setPayload(uint8_t *buffer, const uint8_t *payload, size_t payload_len);
-	
 	/**
 	 * @brief Set a generic CoAP option with specified delta, length, and value
 	 * @param buffer Pointer to the buffer where the option will be written
@@ -209,6 +310,33 @@ private:
 	 * @return Number of bytes written to the buffer (varies based on length)
 	 */
 	static size_t setOption(uint8_t *buffer, uint8_t delta, uint8_t length, const uint8_t *value);
+
+	/**
+	 * @brief Resolve an option delta or length nibble, consuming its extended bytes
+	 * @param datagram Datagram being parsed
+	 * @param offset Read position, advanced past the extended bytes
+	 * @param nibble 4-bit delta or length from the option byte
+	 * @param value Output resolved value
+	 * @return false if the nibble is reserved or the extended bytes are truncated
+	 */
+	static bool readOptionField(std::span<const uint8_t> datagram, size_t &offset, uint8_t nibble, uint32_t &value);
+
+	/**
+	 * @brief Decode a uint option value (big-endian, leading zeros omitted)
+	 * @param value Option value bytes
+	 * @param max_len Largest length allowed for the option
+	 * @param out Output value
+	 * @return false if the value is longer than max_len
+	 */
+	static bool decodeUintOption(std::span<const uint8_t> value, size_t max_len, uint32_t &out);
+
+	/**
+	 * @brief Decode a Block1/Block2 option value into NUM, M and SZX
+	 * @param value Option value bytes (0 to 3)
+	 * @param block Output block option
+	 * @return false if the value is too long or uses the reserved SZX 7
+	 */
+	static bool decodeBlockOption(std::span<const uint8_t> value, CoapBlockOpt_t &block);
 	
 	/**
 	 * @brief Generate the next Message ID for CoAP packets
@@ -222,4 +350,5 @@ extern PktEntry_t activate_entry;
 extern PktEntry_t reading_entry;
 extern PktEntry_t gpsupdate_entry;
 extern PktEntry_t firmwareversion_entry;
-extern PktEntry_t firmwaredownload_entry;
\ No newline at end of file
+extern PktEntry_t firmwaredownload_entry;
+extern PktEntry_t firmwareimage_entry;
\ No newline at end of file
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <span>
+
+#include "CoapPktAssm.hpp"
+#include "IConnection.hpp"
+#include "RttEstimator.hpp"
+
+extern "C" {
+	#include "freertos/FreeRTOS.h"
+}
+
+/**
+ * @brief Transport hook that writes one datagram to the server, gathered from a header and a
+ * payload span (the payload may be empty). Returns true once the transport accepted the datagram.
+ */
+using CoapDatagramSend = std::function<bool(std::span<const uint8_t>, std::span<const uint8_t>)>;
+
+/**
+ * @brief Transport hook that reads at most one datagram, waiting up to timeout_ms.
+ * Sets the received length to 0 when nothing arrived; returns false only on transport failure.
+ */
+using CoapDatagramRecv = std::function<bool(uint8_t*, size_t, size_t*, int)>;
+
+/**
+ * @brief One confirmable request of an exchange.
+ */
+typedef struct {
+	CoapFrameHeader_t header;         ///< Request header as produced by CoapPktAssm::buildHeader
+	std::span<const uint8_t> payload; ///< Request payload, sent after the header without being copied
+	std::span<const uint8_t> frame;   ///< Header and payload contiguous in a pooled frame; empty when the payload has no headroom
+	PktEntry_t pkt_config;            ///< response_win bounds this request from its first transmission
+	PacketChunkCallback onPayload;    ///< Optional; when empty the request completes once acknowledged
+	CoapBlockOpt_t* block2_out;       ///< Optional output for the response's Block2 option
+	bool success;                     ///< Set by the exchange
+} CoapRequest_t;
+
+/**
+ * @class CoapTransaction
+ * @brief Confirmable request/response exchanges on top of a datagram transport (RFC 7252 Section 4).
+ *
+ * Up to COAP_NSTART requests are kept in flight in a transaction table. Each is retransmitted
+ * with exponential backoff, starting from a randomised ACK timeout derived from the
+ * transport's RTT estimate (RttEstimator::ackTimeoutMs) and doubling up to MAX_RETRANSMIT
+ * times, until an ACK with its message ID arrives. Piggybacked responses are delivered
+ * straight away; after an empty ACK the request waits for a separate response carrying
+ * its token, which is acknowledged if it was sent confirmable. Because every request has a random
+ * token, responses are demultiplexed regardless of the order they arrive in, and stale responses
+ * from earlier cycles cannot be mistaken for current ones.
+ *
+ * Requests acknowledged on their first transmission feed the transport's RttEstimator, and
+ * each request's response window is derived from that estimate within its configured bound.
+ */
+class CoapTransaction
+{
+public:
+	/**
+	 * @brief Run a set of confirmable requests, pipelining up to COAP_NSTART at a time.
+	 * @param requests Requests to run; each one's success flag is set on return
+	 * @param send Transport send hook
+	 * @param recv Transport receive hook
+	 * @param transport Transport whose RTT estimate sizes the response windows
+	 * @return Number of requests that were acknowledged (and delivered a success response, when requested)
+	 */
+	static size_t exchange(std::span<CoapRequest_t> requests,
+	                       const CoapDatagramSend& send,
+	                       const CoapDatagramRecv& recv,
+	                       RttEstimator::Transport transport);
+
+	/**
+	 * @brief Fill in a request around a CBOR payload, building its header.
+	 * When the payload sits in a FramePool frame, the header is also written into the frame's
+	 * headroom so the request goes out as one contiguous datagram.
+	 * On failure the header is left empty, so the exchange rejects the request without sending it.
+	 * @param request Output request
+	 * @param cbor_buffer CBOR payload (may be null when cbor_buffer_len is 0)
+	 * @param cbor_buffer_len Length of the payload in bytes
+	 * @param pkt_config Packet configuration
+	 * @param onPayload Optional callback receiving the response payload
+	 * @param request_block Optional Block2 option to include in the request
+	 * @param response_block Optional output for the response's Block2 option
+	 * @return true if the request is ready to send
+	 */
+	static bool prepare(CoapRequest_t& request,
+	                    const uint8_t* cbor_buffer,
+	                    size_t cbor_buffer_len,
+	                    const PktEntry_t pkt_config,
+	                    const PacketChunkCallback& onPayload,
+	                    const CoapBlockOpt_t* request_block = nullptr,
+	                    CoapBlockOpt_t* response_block = nullptr);
+
+private:
+	/**
+	 * @brief Retransmission state of one in-flight request.
+	 */
+	typedef struct {
+		CoapRequest_t* request;
+		CoapMessage_t identity;
+		TickType_t sent_at;
+		TickType_t exchange_deadline;
+		TickType_t retransmit_deadline;
+		int timeout_ms;
+		int retransmits;
+		bool acked;
+	} PendingRequest_t;
+
+	/**
+	 * @brief Read the message ID and token of an outgoing request header.
+	 * @param header Request header
+	 * @param request Output fields; the token is a view into header
+	 * @return true if the header holds a complete CoAP header and token
+	 */
+	static bool readRequestIdentity(const CoapFrameHeader_t& header, CoapMessage_t& request);
+
+	/**
+	 * @brief Check whether a received message carries a request's token.
+	 * @param msg Received message
+	 * @param request Identity of the request
+	 * @return true if the tokens are equal
+	 */
+	static bool tokenMatches(const CoapMessage_t& msg, const CoapMessage_t& request);
+
+	/**
+	 * @brief Write a request to the transport, as one span when it has a contiguous frame.
+	 * @param request Request to send
+	 * @param send Transport send hook
+	 * @return true if the transport accepted the datagram
+	 */
+	static bool sendRequest(const CoapRequest_t& request, const CoapDatagramSend& send);
+
+	/**
+	 * @brief Initial retransmission timeout, uniformly drawn from [ACK_TIMEOUT, ACK_TIMEOUT * ACK_RANDOM_FACTOR]
+	 *        with ACK_TIMEOUT from RttEstimator::ackTimeoutMs().
+	 * @param transport Transport the request is sent over
+	 * @return Timeout in milliseconds
+	 */
+	static int initialTimeoutMs(RttEstimator::Transport transport);
+
+	/**
+	 * @brief Copy the response's Block2 option to the caller, if requested.
+	 * A response without one is reported as block 0 with no more blocks and szx left unchanged.
+	 * @param msg Parsed response
+	 * @param block2_out Caller output (may be null)
+	 */
+	static void reportBlock2(const CoapMessage_t& msg, CoapBlockOpt_t* block2_out);
+
+	/**
+	 * @brief Deliver a response payload to the caller, rejecting error response codes.
+	 * @param msg Parsed response
+	 * @param onPayload Caller callback (may be empty)
+	 * @return true if the response code is a success class and the callback accepted the payload
+	 */
+	static bool deliverResponse(const CoapMessage_t& msg, const PacketChunkCallback& onPayload);
+};
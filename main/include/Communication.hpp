@@ -1,8 +1,15 @@
 #pragma once
 
 #include <memory>
+#include <vector>
 #include "IConnection.hpp"
 
+extern "C" {
+    #include "freertos/FreeRTOS.h"
+}
+
+#define SEND_BACKLOG_MAX_BYTES      2048  ///< NVS space reserved for packets left unsent at the end of a cycle
+
 /**
  * @enum ConnectionType
  * @brief Defines available connection types for communication.
@@ -16,6 +23,39 @@ enum class ConnectionType : uint8_t {
     ETHERNET   ///< Ethernet (wired) connection
 };
 
+/**
+ * @enum PktPriority
+ * @brief Send order of queued packets. Lower values are sent first.
+ */
+enum class PktPriority : uint8_t {
+    Activation,   ///< Activation handshake
+    Reading,      ///< Sensor readings
+    GpsUpdate,    ///< Location updates
+    Maintenance   ///< Diagnostics, logs and firmware checks
+};
+
+/**
+ * @enum QueuedPktState
+ * @brief Outcome of a queued packet after Communication::drainQueue.
+ */
+enum class QueuedPktState : uint8_t {
+    Pending,   ///< Not drained yet
+    Sent,      ///< Acknowledged by the server
+    Failed,    ///< Sent but not acknowledged
+    Deferred   ///< Not sent: past its deadline or outside the awake budget
+};
+
+/**
+ * @brief One packet in the outbound queue. The payload and callback are owned by the caller.
+ */
+typedef struct {
+    PacketRequest_t request;   ///< Payload, packet configuration and response callback
+    PktPriority priority;      ///< Send order
+    TickType_t deadline;       ///< Tick after which the packet is no longer worth sending, 0 for none
+    bool persist;              ///< Keep the payload in NVS if it is not delivered this cycle
+    QueuedPktState state;      ///< Set by drainQueue
+} QueuedPacket_t;
+
 /**
  * @class Communication
  * @brief Manages communication setup and control for multiple connection types.
@@ -106,7 +146,70 @@ public:
     bool streamHttpsGet(const std::string& url,
                         const PacketChunkCallback& onChunk);
 
+    /**
+     * @brief Sends several packets over the active connection with overlapping response windows.
+     * @param requests Packets to send; each one's success flag is set on return.
+     * @return Number of packets that were acknowledged.
+     */
+    size_t sendPacketBatch(std::span<PacketRequest_t> requests);
+
+    /**
+     * @brief Requests one block of a block-wise CoAP response using the active connection.
+     * @param pkt_config Configuration of the block-wise resource.
+     * @param request_block Block number and size exponent to request.
+     * @param response_block Block2 option returned by the server.
+     * @param onChunk Callback receiving the block payload.
+     * @return true if the block was received, false otherwise.
+     */
+    bool fetchBlock(const PktEntry_t pkt_config,
+                    const CoapBlockOpt_t& request_block,
+                    CoapBlockOpt_t& response_block,
+                    const PacketChunkCallback& onChunk);
+
+    /**
+     * @brief Largest block size exponent the active connection can receive in one read.
+     * @return SZX value (block size is 2^(SZX + 4) bytes).
+     */
+    uint8_t maxBlockSzx() const;
+
+    /**
+     * @brief Adds a packet to the outbound queue. It is sent by the next drainQueue call.
+     * @param item Packet to queue. Must stay valid until drainQueue returns.
+     */
+    void enqueue(QueuedPacket_t& item);
+
+    /**
+     * @brief Sends queued packets in priority order within the remaining awake budget.
+     *
+     * When include_backlog is set, packets persisted by earlier cycles are restored, re-signed
+     * with a fresh sequence number and queued behind fresh packets of the same priority. Packets are admitted highest priority first for as long as the
+     * worst-case duration of the batch, derived from the RTT-based response window, still
+     * ends before the awake deadline and before each packet's own deadline. The head of the
+     * queue is always attempted. Admitted packets are sent as one pipelined batch. In a backlog
+     * drain, packets that fail or are deferred and are marked persist are written back to NVS,
+     * lowest priority dropped first when the backlog is full; other drains leave NVS untouched.
+     * Only one drain per wake should include the backlog.
+     *
+     * @param awake_deadline Tick by which the device must be done with the network.
+     * @param include_backlog Restore the NVS backlog into this drain and persist what is left of it.
+     * @return Number of packets that were acknowledged.
+     */
+    size_t drainQueue(TickType_t awake_deadline, bool include_backlog);
+
 private:
+    /**
+     * @brief A packet restored from the NVS backlog, owning its payload.
+     */
+    struct RestoredPacket {
+        QueuedPacket_t item;
+        std::vector<uint8_t> payload;
+    };
+
     ConnectionType connection_type;
     std::unique_ptr<IConnection> connection;  ///< Smart pointer to the active connection implementation.
+    std::vector<QueuedPacket_t*> send_queue;  ///< Packets waiting for drainQueue.
+
+    void restoreBacklog(std::vector<std::unique_ptr<RestoredPacket>>& restored);
+    void persistBacklog(const std::vector<QueuedPacket_t*>& queue);
+    int worstCaseWindowMs(const std::vector<QueuedPacket_t*>& queue) const;
 };
@@ -15,3 +15,6 @@ constexpr char ACT_TAG[] = "ActivatePacket";
 constexpr int sleep_time_sec = 60;
 
 constexpr int NPK_COLLECT_SIZE = 25;
+
+// Time the device may spend awake per cycle; the send queue schedules uplink packets within it.
+constexpr int AWAKE_BUDGET_MS = 180000;
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "Config.hpp"
+#include "MeasurementType.hpp"
+
+/**
+ * @brief Report-by-exception policy deciding whether a cycle needs to upload readings.
+ *
+ * Each measurement type has a deadband made of an absolute threshold (raw sensor units)
+ * and a relative threshold (per-mille of the last transmitted value); the effective band is
+ * the larger of the two. A reading is significant when it leaves the band around the last
+ * transmitted value, or when the type has been silent for longer than its heartbeat interval.
+ *
+ * The last transmitted values live in RTC memory so they survive deep sleep without an NVS
+ * write per cycle. After a power-on reset the state is invalid and the first cycle always
+ * reports, which re-seeds the reference values.
+ */
+class DeadbandPolicy
+{
+public:
+    /**
+     * @brief Deadband configuration for a single measurement type.
+     */
+    struct PolicyEntry
+    {
+        MeasurementType type;
+        uint16_t abs_threshold;    ///< Absolute band in raw sensor units
+        uint16_t rel_threshold_pm; ///< Relative band in per-mille of the last sent value
+        uint32_t max_silence_sec;  ///< Heartbeat: force a report after this long without one
+    };
+
+    static constexpr size_t MEASUREMENT_COUNT = 6;
+
+    /**
+     * @brief Per-type deadbands. Raw units follow the sensor registers:
+     * N/P/K in mg/kg, moisture in 0.1 %, pH in 0.01 pH, temperature in 0.1 degC.
+     */
+    static constexpr PolicyEntry POLICY_TABLE[MEASUREMENT_COUNT] = {
+        {MeasurementType::Nitrogen,    5,  50, 21600},
+        {MeasurementType::Phosphorus,  5,  50, 21600},
+        {MeasurementType::Potassium,   5,  50, 21600},
+        {MeasurementType::Moisture,    10, 50, 10800},
+        {MeasurementType::PH,          10, 0,  21600},
+        {MeasurementType::Temperature, 10, 0,  10800}
+    };
+
+    /**
+     * @brief Validate the RTC state, clearing it after a cold boot or layout change.
+     */
+    static void begin();
+
+    /**
+     * @brief Reduce a sample window to the value compared against the deadband (median).
+     * @param reading Samples collected for one measurement type
+     * @return Median of the window
+     */
+    static uint16_t summarize(const uint16_t reading[NPK_COLLECT_SIZE]);
+
+    /**
+     * @brief Check whether a value must be reported for a measurement type.
+     * @param type Measurement type
+     * @param value Summarized value for this cycle
+     * @return true if outside the deadband, never reported, or heartbeat expired
+     */
+    static bool isSignificant(MeasurementType type, uint16_t value);
+
+    /**
+     * @brief Record a successfully transmitted value as the new reference.
+     * @param type Measurement type
+     * @param value Value that was transmitted
+     */
+    static void markSent(MeasurementType type, uint16_t value);
+
+private:
+    /**
+     * @brief Reference state for one measurement type, kept in RTC memory.
+     */
+    struct SentState
+    {
+        uint16_t last_value;
+        bool has_value;
+        int64_t last_sent_sec;
+    };
+
+    /**
+     * @brief RTC-resident policy state, tagged with a magic to detect cold boots.
+     */
+    struct RtcState
+    {
+        uint32_t magic;
+        SentState sent[MEASUREMENT_COUNT];
+    };
+
+    static constexpr uint32_t RTC_STATE_MAGIC = 0xDBA0D026;
+
+    static RtcState s_rtc_state;
+
+    static const PolicyEntry* findPolicy(MeasurementType type);
+    static SentState* findState(MeasurementType type);
+    static int64_t nowSec();
+};
@@ -34,11 +34,26 @@ typedef struct {
     MANF_entry_t chassis_ver;
 } MANF_info_t;
 
+/**
+ * @brief GPS fix in fixed point.
+ *
+ * Coordinates are in 1e-7 degrees, which holds the modem's four-decimal minutes without loss.
+ * HDOP and altitude are only set when the modem reported both.
+ */
+typedef struct {
+    int32_t lat_e7;       ///< Latitude, 1e-7 degrees, south negative
+    int32_t lon_e7;       ///< Longitude, 1e-7 degrees, west negative
+    uint16_t hdop_x10;    ///< Horizontal dilution of precision, tenths
+    int32_t alt_dm;       ///< Altitude above mean sea level, decimetres
+    bool has_quality;     ///< hdop_x10 and alt_dm are valid
+} GpsFix_t;
+
 typedef struct {
     bool has_activated;
-    std::string gps_coord;
+    GpsFix_t gps;
     uint32_t main_app_delay;
     uint64_t session_count;
+    uint32_t cmd_ver;
     uint8_t secretKey[32];
     MANF_info_t manf_info;
     NPK_Calib_t calib;
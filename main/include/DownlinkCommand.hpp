@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "DeviceConfig.hpp"
+
+struct CborValue;
+
+/**
+ * @brief Follow-up actions a downlink command can request for the next attached cycle.
+ */
+enum DownlinkAction : uint8_t {
+    DOWNLINK_ACTION_NONE = 0,
+    DOWNLINK_ACTION_OTA  = 1 << 0, ///< Attach on the next wake so the firmware version check runs
+    DOWNLINK_ACTION_GPS  = 1 << 1  ///< Attach on the next wake so a fresh GPS fix is uploaded
+};
+
+/**
+ * @brief Server-to-device commands carried in the payload of reading acknowledgements.
+ *
+ * The server answers a reading POST with an optional CBOR map keyed by small integers:
+ *
+ * | Key | Value | Effect |
+ * |-----|-------|--------|
+ * | 0 | uint  | Command version (required) |
+ * | 1 | uint  | New main_app_delay in seconds |
+ * | 2 | bool  | OTA trigger |
+ * | 3 | bool  | Forced GPS refresh |
+ * | 4 | array of [type, offset, gain] | Calibration update |
+ *
+ * A map is applied only when its version is newer than the last applied one, which is
+ * persisted in NVS with the rest of DeviceConfig. Every reading acknowledgement of a cycle
+ * may therefore carry the same map, and retransmissions are harmless. Maps are validated in
+ * full before anything is applied. Unknown keys are skipped so the server can add commands
+ * without breaking older firmware.
+ *
+ * Triggers are kept in RTC memory and force the next wake to attach even when the readings
+ * are within their deadband. Each trigger is cleared once the packet it asks for is delivered.
+ */
+class DownlinkCommand
+{
+public:
+    static constexpr uint32_t MIN_APP_DELAY_SEC = 10;
+    static constexpr uint32_t MAX_APP_DELAY_SEC = 86400;
+
+    /**
+     * @brief Validate the RTC state, clearing it after a cold boot or layout change.
+     */
+    static void begin();
+
+    /**
+     * @brief Decode a command map and apply it to the device configuration.
+     * The caller is responsible for persisting the configuration afterwards.
+     * @param payload Response payload of a reading acknowledgement
+     * @param len Length of the payload in bytes
+     * @param config Configuration to update
+     * @return true if a new command version was applied
+     */
+    static bool apply(const uint8_t* payload, size_t len, DeviceConfig& config);
+
+    /**
+     * @brief Triggers still waiting for an attached cycle.
+     * @return Bitmask of DownlinkAction values
+     */
+    static uint8_t pendingActions();
+
+    /**
+     * @brief Clear triggers whose packets have been delivered.
+     * @param actions Bitmask of DownlinkAction values
+     */
+    static void clearPending(uint8_t actions);
+
+private:
+    /**
+     * @brief Integer keys of the command map.
+     */
+    enum CommandKey : uint8_t {
+        KEY_VERSION = 0,
+        KEY_APP_DELAY = 1,
+        KEY_OTA = 2,
+        KEY_GPS = 3,
+        KEY_CALIB = 4
+    };
+
+    static constexpr size_t CALIB_COUNT = sizeof(NPK_Calib_t::calib_list) / sizeof(DataCalib_t);
+
+    /**
+     * @brief Fully validated command map, staged before it is applied.
+     */
+    struct CommandSet
+    {
+        bool has_version;
+        uint32_t version;
+        bool has_app_delay;
+        uint32_t app_delay;
+        uint8_t actions;
+        size_t calib_count;
+        DataCalib_t calib[CALIB_COUNT];
+    };
+
+    /**
+     * @brief RTC-resident trigger state, tagged with a magic to detect cold boots.
+     */
+    struct RtcState
+    {
+        uint32_t magic;
+        uint8_t pending_actions;
+    };
+
+    static constexpr uint32_t RTC_STATE_MAGIC = 0xD0C0D031;
+
+    static RtcState s_rtc_state;
+
+    static bool parse(const uint8_t* payload, size_t len, CommandSet& commands);
+    static bool parseCalib(CborValue* array, CommandSet& commands);
+    static bool readU32(CborValue* value, uint32_t* dest);
+    static bool readFloat(CborValue* value, float* dest);
+    static bool readTrigger(CborValue* value, uint8_t action, CommandSet& commands);
+};
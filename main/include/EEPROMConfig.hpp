@@ -6,6 +6,40 @@
 #include "Types.hpp"
 #include "DeviceConfig.hpp"
 
+/**
+ * @brief Progress of a block-wise firmware download, persisted so an interrupted transfer
+ * can resume from the last flushed block instead of starting over.
+ */
+typedef struct {
+    char version[MANF_MAX_LEN]; ///< Firmware version being downloaded
+    uint32_t bytes_written;     ///< Image bytes written to the OTA partition so far
+    uint8_t szx;                ///< Negotiated Block2 size exponent
+} OtaProgress_t;
+
+/**
+ * @brief LTE power-saving timers granted by the network, persisted so the modem can be left
+ * attached across deep sleep and the sleep schedule can be planned around them.
+ */
+typedef struct {
+    uint32_t periodic_tau_s;    ///< Negotiated T3412 (extended), 0 if PSM was not granted
+    uint32_t active_time_s;     ///< Negotiated T3324, 0 if PSM was not granted
+    uint32_t edrx_cycle_ms;     ///< Negotiated eDRX cycle, 0 if eDRX was not granted
+    uint32_t paging_window_ms;  ///< Negotiated eDRX paging time window
+    bool psm_granted;
+    bool edrx_granted;
+    bool left_attached;         ///< The modem was left registered at the last disconnect
+} ModemPowerSaving_t;
+
+/**
+ * @brief Modem SSL behaviour learned by probing, persisted so later opens go straight to the
+ * working QSSLOPEN form. Only valid for the modem firmware revision it was learned on.
+ */
+typedef struct {
+    char revision[48];           ///< AT+GMR answer of the modem the profile was learned on
+    uint8_t open_variant;        ///< 1-based QSSLOPEN syntax variant that works, 0 if unknown
+    bool contextid_unsupported;  ///< The firmware rejects QSSLCFG "contextid"
+} ModemSslCache_t;
+
 /**
  * @brief Manages persistent device configuration storage using ESP-IDF NVS.
  *
@@ -171,6 +205,76 @@ public:
      * @return true on success, false if the erase or commit failed.
      */
     bool eraseConfig();
+
+    /**
+     * @brief Persists block-wise OTA download progress as a single blob and commits it.
+     * @param progress Progress to store.
+     * @return true on success, false on NVS write or commit error.
+     */
+    bool saveOtaProgress(const OtaProgress_t& progress);
+
+    /**
+     * @brief Reads persisted block-wise OTA download progress.
+     * @param progress Destination for the stored progress.
+     * @return true if progress was found, false otherwise.
+     */
+    bool loadOtaProgress(OtaProgress_t& progress);
+
+    /**
+     * @brief Removes persisted OTA download progress once a transfer completes or is abandoned.
+     * @return true on success (including when nothing was stored), false on NVS error.
+     */
+    bool clearOtaProgress();
+
+    /**
+     * @brief Persists the negotiated LTE power-saving state as a single blob and commits it.
+     * @param state State to store.
+     * @return true on success, false on NVS write or commit error.
+     */
+    bool saveModemPowerSaving(const ModemPowerSaving_t& state);
+
+    /**
+     * @brief Reads the persisted LTE power-saving state.
+     * @param state Destination for the stored state.
+     * @return true if a state was found, false otherwise.
+     */
+    bool loadModemPowerSaving(ModemPowerSaving_t& state);
+
+    /**
+     * @brief Persists the learned modem SSL profile as a single blob and commits it.
+     * @param cache Profile to store.
+     * @return true on success, false on NVS write or commit error.
+     */
+    bool saveModemSslCache(const ModemSslCache_t& cache);
+
+    /**
+     * @brief Reads the persisted modem SSL profile.
+     * @param cache Destination for the stored profile.
+     * @return true if a profile was found, false otherwise.
+     */
+    bool loadModemSslCache(ModemSslCache_t& cache);
+
+    /**
+     * @brief Persists the serialised send backlog (packets left unsent at the end of a cycle) and commits it.
+     * @param data Serialised backlog records.
+     * @param len  Length of @p data in bytes.
+     * @return true on success, false on NVS write or commit error.
+     */
+    bool saveSendBacklog(const uint8_t* data, size_t len);
+
+    /**
+     * @brief Reads the persisted send backlog.
+     * @param data Destination buffer.
+     * @param len  In: capacity of @p data. Out: length of the stored backlog.
+     * @return true if a backlog was found and fits in @p data, false otherwise.
+     */
+    bool loadSendBacklog(uint8_t* data, size_t* len);
+
+    /**
+     * @brief Removes the persisted send backlog once its packets have been handed back to the send queue.
+     * @return true on success (including when nothing was stored), false on NVS error.
+     */
+    bool clearSendBacklog();
 };
 
 extern EEPROMConfig eeprom;
\ No newline at end of file
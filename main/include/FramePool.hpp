@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "CoapPktAssm.hpp"
+#include "Types.hpp"
+
+/**
+ * @class FramePool
+ * @brief Fixed set of statically allocated CoAP frame buffers.
+ *
+ * Each frame reserves COAP_FRAME_HEADER_MAX bytes of headroom in front of its payload area.
+ * Packet classes encode their CBOR payload straight into the payload area, and
+ * CoapTransaction::prepare writes the request header into the headroom so that header and
+ * payload form one contiguous datagram without copying the payload. The receive side of an
+ * exchange borrows a whole frame for incoming datagrams. One frame per in-flight message keeps
+ * the footprint fixed and off the task stacks.
+ */
+class FramePool
+{
+public:
+	static constexpr size_t FRAME_SIZE = GEN_BUFFER_SIZE + 64;           ///< Largest datagram sent or received
+	static constexpr size_t HEADROOM = COAP_FRAME_HEADER_MAX;            ///< Bytes reserved for the request header
+	static constexpr size_t PAYLOAD_CAPACITY = FRAME_SIZE - HEADROOM;    ///< Largest CBOR payload
+	static constexpr size_t FRAME_COUNT = 10;  ///< Six readings, GPS update, activation, receive frame and a spare
+
+	/**
+	 * @brief Take a free frame from the pool.
+	 * @return Start of the frame (FRAME_SIZE bytes), or nullptr when every frame is in use
+	 */
+	static uint8_t* take();
+
+	/**
+	 * @brief Return a frame to the pool. Null is ignored.
+	 * @param frame Frame obtained from take()
+	 */
+	static void give(uint8_t* frame);
+
+	/**
+	 * @brief Find the frame whose payload area starts at a given address.
+	 * @param payload Payload pointer, as returned by FrameBuffer::payload()
+	 * @return Start of the frame, or nullptr if payload is not the payload area of a pooled frame
+	 */
+	static uint8_t* frameOf(const uint8_t* payload);
+};
+
+/**
+ * @class FrameBuffer
+ * @brief Move-only owner of one pooled frame, returned to the pool on destruction.
+ */
+class FrameBuffer
+{
+public:
+	FrameBuffer() = default;
+	~FrameBuffer() { release(); }
+
+	FrameBuffer(const FrameBuffer&) = delete;
+	FrameBuffer& operator=(const FrameBuffer&) = delete;
+
+	FrameBuffer(FrameBuffer&& other) noexcept : m_frame(other.m_frame) { other.m_frame = nullptr; }
+
+	FrameBuffer& operator=(FrameBuffer&& other) noexcept
+	{
+		if (this != &other)
+		{
+			release();
+			m_frame = other.m_frame;
+			other.m_frame = nullptr;
+		}
+		return *this;
+	}
+
+	/**
+	 * @brief Take a frame from the pool unless one is already held.
+	 * @return true if a frame is held on return
+	 */
+	bool acquire()
+	{
+		if (!m_frame)
+		{
+			m_frame = FramePool::take();
+		}
+		return m_frame != nullptr;
+	}
+
+	/**
+	 * @brief Return the held frame to the pool.
+	 */
+	void release()
+	{
+		FramePool::give(m_frame);
+		m_frame = nullptr;
+	}
+
+	uint8_t* frame() const { return m_frame; }
+	uint8_t* payload() const { return m_frame ? m_frame + FramePool::HEADROOM : nullptr; }
+
+private:
+	uint8_t* m_frame = nullptr;
+};
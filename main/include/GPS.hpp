@@ -1,18 +1,26 @@
 #pragma once
 
-#include <string>
 #include "ATCommandHndlr.hpp"
+#include "AtEngine.hpp"
+#include "DeviceConfig.hpp"
 
 class GPS {
 public:
     GPS();
     /**
-     * @brief Query modem for GPS coordinates and return formatted "lat, lon" string.
-     * @param out String to receive formatted coordinates
+     * @brief Query modem for a GPS fix.
+     * Blocks the caller until acquireFix() finishes on the AT engine.
+     * @param out Receives the fix in fixed point
      * @return true if coordinates retrieved and parsed, false otherwise
      */
-    bool getCoordinates(std::string &out);
+    bool getCoordinates(GpsFix_t &out);
 
-private:
-    ATCommandHndlr m_hndlr;
+    /**
+     * @brief Enables GNSS and polls the modem for a fix, as a job on the AT engine.
+     * The acquisition waits are spent suspended, so other modem work runs in between.
+     * @param engine Engine the job runs on
+     * @param out Receives the fix in fixed point; must outlive the job
+     * @return true if coordinates retrieved and parsed, false otherwise
+     */
+    AtTask<bool> acquireFix(AtEngine& engine, GpsFix_t &out);
 };
@@ -3,6 +3,7 @@
 #include <sys/socket.h>
 #include <string>
 #include "IPacket.hpp"
+#include "CborSchema.hpp"
 
 #include <cbor.h>
 #include "esp_log.h"
@@ -21,18 +22,11 @@
 class GpsUpdatePkt : public IPacket
 {
 private:
-    std::string GPSCoord;
-
-    static constexpr const char* NODE_ID_KEY = "node_id";
-    static constexpr const char* GPS_KEY = "gps";
-    static constexpr const char* SECRET_KEY_KEY = "secretkey";
-    static constexpr const char* KEY_KEY = "key";
-    static constexpr const char* FW_VER_KEY = "fw_ver";
-
+    GpsFix_t GPSFix;
 
 public:
-    GpsUpdatePkt(PktType _pkt_type, std::string _node_id, std::string _uri, std::string _gps_coord)
-        : IPacket(_pkt_type, _node_id, _uri), GPSCoord(_gps_coord)
+    GpsUpdatePkt(PktType _pkt_type, std::string_view _node_id, std::string_view _uri, const GpsFix_t &_gps_fix)
+        : IPacket(_pkt_type, _node_id, _uri), GPSFix(_gps_fix)
     {
     }
 
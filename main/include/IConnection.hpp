@@ -3,10 +3,22 @@
 #include <unistd.h>
 #include <string>
 #include <functional>
+#include <span>
 #include "CoapPktAssm.hpp"
 
 using PacketChunkCallback = std::function<bool(const uint8_t*, size_t)>;
 
+/**
+ * @brief One request of a pipelined batch (see IConnection::sendPacketBatch).
+ */
+typedef struct {
+    const uint8_t* cbor_buffer;    ///< CBOR payload (may be null when cbor_buffer_len is 0)
+    size_t cbor_buffer_len;        ///< Payload length in bytes
+    PktEntry_t pkt_config;         ///< Packet configuration
+    PacketChunkCallback onChunk;   ///< Optional response payload callback
+    bool success;                  ///< Set by sendPacketBatch
+} PacketRequest_t;
+
 /**
  * @class IConnection
  * @brief Interface for network connection implementations.
@@ -85,4 +97,65 @@ public:
         (void)onChunk;
         return false;
     }
+
+    /**
+     * @brief Sends several packets, keeping up to COAP_NSTART of them in flight at once.
+     *
+     * Responses are matched to requests by token, so the batch completes within roughly one
+     * response window instead of one window per packet. The default implementation sends the
+     * packets one after another.
+     *
+     * @param requests Packets to send; each one's success flag is set on return.
+     * @return Number of packets that were acknowledged.
+     */
+    virtual size_t sendPacketBatch(std::span<PacketRequest_t> requests)
+    {
+        size_t succeeded = 0;
+
+        for (PacketRequest_t& request : requests)
+        {
+            request.success = sendPacketStream(request.cbor_buffer, request.cbor_buffer_len,
+                                               request.pkt_config, request.onChunk);
+            if (request.success)
+            {
+                succeeded++;
+            }
+        }
+
+        return succeeded;
+    }
+
+    /**
+     * @brief Requests one block of a block-wise (RFC 7959 Block2) response.
+     *
+     * @param pkt_config Packet configuration of the block-wise resource.
+     * @param request_block Block number and size exponent to request.
+     * @param response_block Block2 option returned by the server; the server may answer with a
+     *                       smaller block size than requested. Populated before onChunk runs so
+     *                       the callback can validate the block position.
+     * @param onChunk Callback receiving the block payload.
+     * @return True if the block was received, false otherwise (including when the transport
+     *         does not support block-wise transfers).
+     */
+    virtual bool fetchBlock(const PktEntry_t pkt_config,
+                            const CoapBlockOpt_t& request_block,
+                            CoapBlockOpt_t& response_block,
+                            const PacketChunkCallback& onChunk)
+    {
+        (void)pkt_config;
+        (void)request_block;
+        (void)response_block;
+        (void)onChunk;
+        return false;
+    }
+
+    /**
+     * @brief Largest Block2 size exponent whose response still fits a single transport read.
+     *
+     * @return SZX value (block size is 2^(SZX + 4) bytes).
+     */
+    virtual uint8_t maxBlockSzx() const
+    {
+        return COAP_BLOCK_SZX_MAX;
+    }
 };
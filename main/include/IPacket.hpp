@@ -1,6 +1,6 @@
 #pragma once
 
-#include <string>
+#include <string_view>
 #include <cstdint>
 #include <sys/socket.h>
 #include "coap3/coap.h"
@@ -9,6 +9,7 @@
 #include <cstddef>
 #include "Types.hpp"
 #include "CoapPktAssm.hpp"
+#include "FramePool.hpp"
 
 /**
  * @class IPacket
@@ -17,25 +18,43 @@
  * Provides an interface for creating, serializing, and sending packets
  * over a CoAP network. Derived classes should implement the serialization
  * method to convert packet data into a buffer.
+ *
+ * Packets encode into a frame borrowed from FramePool, after the headroom the
+ * transport uses for the CoAP header. The frame is held until the packet is destroyed.
+ * String fields are views, so the strings they refer to must outlive the packet.
  */
 class IPacket
 {
 protected:
     PktType pkt_type;
-    std::string node_id;     ///< Unique identifier for the node sending the packet
-    std::string uri;         ///< URI endpoint for the CoAP packet
-    size_t bufferLength = 0; ///< Length of the serialized packet buffer
-    uint8_t buffer[GEN_BUFFER_SIZE];
+    std::string_view node_id; ///< Unique identifier for the node sending the packet
+    std::string_view uri;     ///< URI endpoint for the CoAP packet
+    size_t bufferLength = 0;  ///< Length of the serialized packet buffer
+    FrameBuffer frame;        ///< Pooled frame holding the serialized payload
+
+    /**
+     * @brief Payload area of the packet's frame, taking a frame from the pool on first use.
+     * @return Buffer of FramePool::PAYLOAD_CAPACITY bytes, or nullptr if the pool is exhausted.
+     */
+    uint8_t *payloadBuffer()
+    {
+        return frame.acquire() ? frame.payload() : nullptr;
+    }
 
 public:
+    IPacket(PktType _pkt_type, std::string_view _node_id, std::string_view _uri) : pkt_type(_pkt_type), node_id(_node_id), uri(_uri)
+    {
+    }
+
     /**
      * @brief Virtual destructor.
      *
-     * Ensures proper cleanup of derived packet classes.
+     * Ensures proper cleanup of derived packet classes and returns the frame to the pool.
      */
-    IPacket(PktType _pkt_type, std::string _node_id, std::string _uri) : pkt_type(_pkt_type), node_id(_node_id), uri(_uri)
-    {
-    }
+    virtual ~IPacket() = default;
+
+    IPacket(IPacket&&) = default;
+    IPacket& operator=(IPacket&&) = default;
 
     /**
      * @brief Serializes the packet into a buffer.
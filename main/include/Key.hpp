@@ -1,16 +1,42 @@
 #pragma once
 #include <cstddef>
 #include <cstdint>
+#include <span>
 
 class Key {
 public:
     static constexpr size_t HMAC_SIZE = 32;  // public so callers can size their buffers
+    static constexpr size_t TAG_SIZE = 8;    ///< Truncated HMAC-SHA256 tag carried in each packet
+
     /**
      * @brief Computes an HMAC key using the device's secret key and stores it in the provided output buffer.
      * @param out_hmac Pointer to the buffer where the computed HMAC will be stored
      * @param out_len Size of the output buffer in bytes. Must be at least Key::HMAC_SIZE.
+     * @return true if the key was derived; on false the buffer contents are unspecified
+     */
+    static bool computeKey(uint8_t* out_hmac, size_t out_len);
+
+    /**
+     * @brief Imports the device key into PSA for packet MACs.
+     * The key handle is kept until the next call, so each packet only pays for the MAC itself.
+     * Deep sleep restarts the chip, so this runs once per wake and again after activation derives the key.
+     * @param device_key Device key (the stored HMAC key)
+     * @return true if the key was imported; false leaves no key loaded
+     */
+    static bool loadMacKey(std::span<const uint8_t, HMAC_SIZE> device_key);
+
+    /**
+     * @brief Whether a MAC key is loaded.
+     */
+    static bool macReady();
+
+    /**
+     * @brief Computes the truncated HMAC-SHA256 tag of a message with the loaded key.
+     * @param message Bytes to authenticate
+     * @param tag Output tag
+     * @return true on success
      */
-    static void computeKey(uint8_t* out_hmac, size_t out_len);
+    static bool computeTag(std::span<const uint8_t> message, std::span<uint8_t, TAG_SIZE> tag);
 
 private:
     static constexpr size_t HMAC_KEY_SIZE = 32;
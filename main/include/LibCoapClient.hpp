@@ -0,0 +1,55 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+#include "CoapPktAssm.hpp"
+#include "IConnection.hpp"
+
+// CoAP framing backends, selected at build time with COAP_BACKEND
+#define COAP_BACKEND_BUILTIN        0
+#define COAP_BACKEND_LIBCOAP        1
+
+#ifndef COAP_BACKEND
+#define COAP_BACKEND COAP_BACKEND_BUILTIN
+#endif
+
+/**
+ * @brief One confirmable request run through libcoap.
+ */
+typedef struct {
+	std::span<const uint8_t> payload;     ///< CBOR payload (may be empty)
+	PktEntry_t pkt_config;                ///< Method, Uri-Path and response window
+	PacketChunkCallback onPayload;        ///< Optional callback receiving the response payload
+	const CoapBlockOpt_t* request_block;  ///< Optional Block2 option to include in the request
+	CoapBlockOpt_t* block2_out;           ///< Optional output for the response's Block2 option
+	bool success;                         ///< Set by the exchange
+} LibCoapRequest_t;
+
+/**
+ * @class LibCoapClient
+ * @brief CoAP client backend built on the libcoap PDU and session machinery.
+ *
+ * Requests are sent over a libcoap UDP client session, which owns message IDs, tokens,
+ * retransmission (using the same RTT-derived ACK timeout, ACK_RANDOM_FACTOR and
+ * MAX_RETRANSMIT as CoapTransaction), NSTART queueing, separate responses and option parsing. Block-wise
+ * transfers are left to the caller, as with the built-in backend, so OTA downloads keep
+ * their resumable per-block progress. Response windows come from the Wi-Fi RttEstimator,
+ * which is fed with responses that arrive before the first retransmission could have been sent.
+ *
+ * libcoap opens its own sockets, so this backend is available where lwIP is the transport
+ * (Wi-Fi). Modem AT sockets keep the built-in CoapPktAssm/CoapTransaction path.
+ */
+class LibCoapClient
+{
+public:
+	/**
+	 * @brief Run a set of confirmable requests against a server.
+	 * @param requests Requests to run; each one's success flag is set on return
+	 * @param host Server IPv4 address
+	 * @param port Server UDP port
+	 * @return Number of requests that received a success response
+	 */
+	static size_t exchange(std::span<LibCoapRequest_t> requests, const char* host, uint16_t port);
+};
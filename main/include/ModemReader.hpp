@@ -0,0 +1,152 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+extern "C" {
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/stream_buffer.h"
+#include "freertos/task.h"
+}
+
+class UARTDriver;
+
+/** Longest modem line delivered, excluding the terminator. */
+constexpr size_t MODEM_LINE_MAX = 255;
+
+/**
+ * @struct ModemLine_t
+ * @brief One line received from the modem, CR/LF stripped and NUL-terminated.
+ *
+ * A bare data prompt (`> `) is delivered as the line ">".
+ */
+typedef struct {
+    char text[MODEM_LINE_MAX + 1];
+    uint16_t len;
+} ModemLine_t;
+
+/**
+ * @struct ModemPayloadRule_t
+ * @brief Tells the reader that raw bytes follow a response line.
+ *
+ * When a line delivered to the active command starts with `prefix`, the next
+ * `length` bytes (or, if `length` is negative, the count given by the first
+ * integer after the prefix) are forwarded as payload instead of being framed
+ * as lines. Used for `+QIRD: <len>` and the QHTTPREAD `CONNECT` body.
+ */
+typedef struct {
+    const char* prefix;
+    int length;
+} ModemPayloadRule_t;
+
+/**
+ * @class ModemReader
+ * @brief Single task that owns the modem RX side.
+ *
+ * Frames lines and binary payloads off the modem UART and routes them:
+ *  - every line whose prefix matches a subscription is copied to that
+ *    subscriber's FreeRTOS queue (URCs such as `+QIURC:` reach their owner
+ *    whichever task happens to be talking to the modem);
+ *  - every line and payload byte received while a command is active goes to
+ *    the task that holds the AT command lock, through a response queue and a
+ *    payload stream buffer.
+ * Lines that match neither are logged and dropped. Transmission stays with the
+ * caller, serialised by the AT command lock.
+ */
+class ModemReader {
+public:
+    explicit ModemReader(UARTDriver& uart) : m_uart(uart) {}
+
+    /**
+     * @brief Creates the queues and starts the reader task.
+     * Must be called after the UART driver is installed. Safe to call again.
+     * @return true if the reader is running
+     */
+    bool start();
+
+    /**
+     * @brief Whether start() succeeded.
+     */
+    bool running() const { return m_task != nullptr; }
+
+    /**
+     * @brief Routes lines starting with `prefix` to `queue`.
+     * @param prefix Line prefix, e.g. "+QIURC:"; must outlive the subscription
+     * @param queue Queue of ModemLine_t owned by the subscriber; full queues drop lines
+     * @return false if the subscription table is full
+     */
+    bool subscribe(const char* prefix, QueueHandle_t queue);
+
+    /**
+     * @brief Removes every subscription that delivers to `queue`.
+     */
+    void unsubscribe(QueueHandle_t queue);
+
+    /**
+     * @brief Starts routing responses to the calling task.
+     * Clears anything left over from the previous command. The caller must hold
+     * the AT command lock and call this before writing the command.
+     */
+    void beginCommand();
+
+    /**
+     * @brief Stops routing responses; later lines are treated as unsolicited.
+     */
+    void endCommand();
+
+    /**
+     * @brief Declares which response lines of the active command are followed by raw bytes.
+     * @param rules Up to MAX_PAYLOAD_RULES rules; replaces any previous rules until endCommand()
+     */
+    void expectPayload(std::span<const ModemPayloadRule_t> rules);
+
+    /**
+     * @brief Waits for the next line of the active command.
+     * @return false on timeout
+     */
+    bool nextLine(ModemLine_t& line, TickType_t deadline);
+
+    /**
+     * @brief Reads payload bytes announced by a payload rule.
+     * @return Number of bytes read; fewer than requested only on timeout
+     */
+    size_t readPayload(std::span<uint8_t> out, TickType_t deadline);
+
+    static constexpr size_t MAX_PAYLOAD_RULES = 2;
+
+private:
+    static constexpr size_t MAX_SUBSCRIBERS = 6;
+    static constexpr UBaseType_t RESPONSE_QUEUE_DEPTH = 8;
+    static constexpr size_t PAYLOAD_STREAM_SIZE = 1024;
+    static constexpr TickType_t READ_SLICE = pdMS_TO_TICKS(1000);
+    static constexpr TickType_t RESPONSE_SEND_TIMEOUT = pdMS_TO_TICKS(2000);
+    static constexpr TickType_t PAYLOAD_BYTE_TIMEOUT = pdMS_TO_TICKS(5000);
+
+    struct Subscription {
+        const char* prefix;
+        size_t prefix_len;
+        QueueHandle_t queue;
+    };
+
+    static void readerTaskEntry(void* arg);
+    void readerLoop();
+    void dispatch(const ModemLine_t& line);
+    int payloadLength(const ModemLine_t& line) const;
+    void forwardPayload(size_t len);
+
+    UARTDriver& m_uart;
+    TaskHandle_t m_task = nullptr;
+    SemaphoreHandle_t m_lock = nullptr;  ///< Guards the subscription table and command state
+    QueueHandle_t m_responses = nullptr;
+    StreamBufferHandle_t m_payload = nullptr;
+
+    Subscription m_subs[MAX_SUBSCRIBERS] = {};
+    volatile bool m_cmd_active = false;
+    ModemPayloadRule_t m_rules[MAX_PAYLOAD_RULES] = {};
+    size_t m_rule_count = 0;
+};
+
+extern ModemReader g_modem_reader;
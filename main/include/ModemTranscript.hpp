@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <span>
+
+extern "C" {
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/stream_buffer.h"
+#include "freertos/task.h"
+}
+
+/**
+ * @class ModemTranscript
+ * @brief Records timestamped modem UART traffic to a file on LittleFS.
+ *
+ * UARTDriver hands every byte it sends or receives on a traced port to record(),
+ * which copies it into a stream buffer without waiting on flash; a low-priority
+ * writer task drains the buffer to the file. Traffic that does not fit in the
+ * buffer is dropped, counted, and flagged on the next record, so a transcript
+ * never silently misses bytes.
+ *
+ * The file starts with the 8 bytes "MTRC", a format version (1) and three zero
+ * bytes, followed by one record per chunk of traffic:
+ *
+ *   uint32 time_us   microseconds since start(), little-endian
+ *   uint8  direction '<' modem to device, '>' device to modem
+ *   uint8  flags     bit 0: traffic was dropped just before this record
+ *   uint16 length    little-endian, then `length` bytes as sent on the wire
+ *
+ * A transcript stops growing before it would pass MAX_FILE_BYTES; later traffic
+ * is counted as dropped, so the file always ends on a whole record. The previous
+ * session's transcript is kept alongside as "<path>.1".
+ */
+class ModemTranscript {
+public:
+    enum class Direction : uint8_t {
+        Rx = '<',
+        Tx = '>'
+    };
+
+    static constexpr const char* DEFAULT_PATH = "/littlefs/modem.trc";
+
+    /**
+     * @brief Mounts LittleFS, opens a new transcript at `path` and starts the writer task.
+     * @return true if recording; false leaves the recorder idle
+     */
+    bool start(const char* path = DEFAULT_PATH);
+
+    /**
+     * @brief Writes out everything recorded so far and closes the file.
+     * Call before deep sleep or restart, after the last modem traffic.
+     */
+    void stop();
+
+    bool recording() const { return m_task != nullptr && !m_stopping; }
+
+    /**
+     * @brief Appends traffic to the transcript. Never blocks on flash.
+     */
+    void record(Direction dir, std::span<const uint8_t> bytes);
+
+private:
+    static constexpr const char* BASE_PATH = "/littlefs";
+    static constexpr const char* PARTITION_LABEL = "littlefs";
+    static constexpr size_t STREAM_SIZE = 4096;
+    static constexpr size_t RECORD_HEADER_SIZE = 8;
+    static constexpr size_t MAX_RECORD_BYTES = 512;
+    static constexpr size_t MAX_FILE_BYTES = 512 * 1024;
+    static constexpr uint32_t FLUSH_INTERVAL_MS = 1000;
+
+    static bool mount();
+    static void writerTaskEntry(void* arg);
+    void writerLoop();
+
+    FILE* m_file = nullptr;
+    TaskHandle_t m_task = nullptr;
+    StreamBufferHandle_t m_stream = nullptr;
+    SemaphoreHandle_t m_lock = nullptr;     ///< Serialises records from the TX and RX sides
+    SemaphoreHandle_t m_stopped = nullptr;  ///< Given by the writer once the file is closed
+    volatile bool m_stopping = false;
+
+    int64_t m_start_us = 0;
+    size_t m_written = 0;   ///< Touched only by the writer task
+    size_t m_reserved = 0;  ///< File bytes accepted by record(), under m_lock
+    uint32_t m_dropped = 0;
+    bool m_drop_pending = false;
+};
+
+extern ModemTranscript g_modem_transcript;
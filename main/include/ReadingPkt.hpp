@@ -3,6 +3,7 @@
 #include <sys/socket.h>
 #include <string>
 #include "IPacket.hpp"
+#include "CborSchema.hpp"
 #include "NPK.hpp"
 #include "CoapPktAssm.hpp"
 
@@ -12,23 +13,59 @@
 #include <cstddef>
 #include <cstring>  // For memcpy
 
+#ifndef READING_ENC
+#define READING_ENC 0
+#endif
+
+/**
+ * @brief Wire encodings of a reading packet, selected at build time with READING_ENC.
+ *
+ * Legacy uses text map keys and a float array. The compact encodings use integer map keys
+ * and carry their encoding in key 0, so the server can tell them apart:
+ *
+ * | Key | Value |
+ * |-----|-------|
+ * | 0 | Encoding (1 or 2) |
+ * | 1 | Node ID |
+ * | 2 | Measurement type (MeasurementType value) |
+ * | 4 | Samples |
+ * | 5 | Session |
+ * | 6 | Sequence number |
+ * | 7 | Truncated MAC (Key::TAG_SIZE bytes) |
+ *
+ * Key 3 carried the static device key before packets were authenticated with a MAC; it is not reused.
+ */
+enum class ReadingEncoding : uint8_t {
+    Legacy = 0,
+    TypedArray = 1,  ///< Samples as an RFC 8746 uint16 big-endian typed array (tag 65)
+    DeltaZigzag = 2  ///< Samples as a byte string of zigzag-encoded deltas in LEB128 varints
+};
+
+constexpr ReadingEncoding READING_ENCODING = static_cast<ReadingEncoding>(READING_ENC);
+
 class ReadingPkt : public IPacket
 {
 private:
     uint16_t reading[NPK_COLLECT_SIZE];  // ✅ Changed to uint16_t
     MeasurementType m_type;
-    uint64_t session_count;
     const char* mTypeToString() const;
 
-    static constexpr const char* NODE_ID_KEY = "node_id";
-    static constexpr const char* KEY_KEY = "key";
-    static constexpr const char* M_TYPE = "m_type";
-    static constexpr const char* READINGS_ARR = "readings";
-    static constexpr const char* SESSION = "session";
+    static constexpr CborTag TAG_UINT16_BE_ARRAY = 65;
+
+    // A zigzag-encoded uint16 delta needs at most 17 bits, i.e. three 7-bit varint groups
+    static constexpr size_t DELTA_VARINT_MAX = 3;
+
+    static constexpr PacketLayout LAYOUT = (READING_ENCODING == ReadingEncoding::Legacy)
+                                               ? PacketLayout::ReadingLegacy
+                                               : PacketLayout::ReadingCompact;
+
+    bool writeField(CborWriter &writer, SchemaField field) const;
+    size_t packSamplesBigEndian(uint8_t *out) const;
+    size_t packSamplesDeltaZigzag(uint8_t *out) const;
 
 public:
-    ReadingPkt(PktType _pkt_type, std::string _node_id, std::string _uri, uint16_t _reading[NPK_COLLECT_SIZE], MeasurementType _m_type, uint64_t _session_counter)
-        : IPacket(_pkt_type, _node_id, _uri), m_type(_m_type), session_count(_session_counter)
+    ReadingPkt(PktType _pkt_type, std::string_view _node_id, std::string_view _uri, const uint16_t _reading[NPK_COLLECT_SIZE], MeasurementType _m_type)
+        : IPacket(_pkt_type, _node_id, _uri), m_type(_m_type)
     {
         // ✅ COPY the readings array!
         memcpy(this->reading, _reading, sizeof(uint16_t) * NPK_COLLECT_SIZE);
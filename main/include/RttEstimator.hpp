@@ -0,0 +1,123 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include "CoapPktAssm.hpp"
+
+/**
+ * @class RttEstimator
+ * @brief Per-transport round-trip time estimate used to size CoAP response windows.
+ *
+ * Keeps a smoothed RTT and RTT variation per transport in the style of RFC 6298, fed with
+ * the time from first transmission to acknowledgement of requests that were not retransmitted
+ * (Karn's algorithm). The CoAP ACK timeout, response windows and modem poll intervals are
+ * derived from the estimate, always within configured bounds: the ACK timeout never exceeds
+ * COAP_ACK_TIMEOUT_MS and a window never exceeds the packet type's configured response window,
+ * so a node on a poor cell behaves exactly as before while a node on a good cell retransmits
+ * and gives up sooner when the server does not answer. A shortened window still lasts until
+ * the last transmission that times out within the configured window has timed out, so it never
+ * cuts off a retransmission the configured window would have waited for.
+ *
+ * The estimate lives in RTC memory, so it carries across deep sleep and converges over wake
+ * cycles. After a power-on reset there are no samples and the configured values apply.
+ */
+class RttEstimator
+{
+public:
+	/**
+	 * @brief Transports with independent estimates.
+	 */
+	enum class Transport : uint8_t {
+		Sim,
+		Wifi,
+		Count
+	};
+
+	static constexpr size_t TRANSPORT_COUNT = static_cast<size_t>(Transport::Count);
+
+	static constexpr uint32_t CLOCK_GRANULARITY_MS = 10;  ///< G in RFC 6298
+	static constexpr uint32_t MAX_SAMPLE_MS = 60000;      ///< Larger samples are discarded as bogus
+	static constexpr int RESPONSE_WIN_RTO_FACTOR = 4;     ///< Window spans this many RTOs
+	static constexpr uint32_t MIN_ACK_TIMEOUT_MS = 500;   ///< Lower bound on the derived ACK timeout
+	static constexpr int MIN_POLL_INTERVAL_MS = 20;
+	static constexpr int MAX_POLL_INTERVAL_MS = 250;
+
+	/**
+	 * @brief Record the RTT of a request acknowledged without retransmission.
+	 * @param transport Transport the request was sent over
+	 * @param rtt_ms Time from transmission to acknowledgement
+	 */
+	static void addSample(Transport transport, uint32_t rtt_ms);
+
+	/**
+	 * @brief Retransmission timeout from the current estimate (SRTT + max(G, 4 * RTTVAR)).
+	 * @param transport Transport to query
+	 * @return RTO in milliseconds, or 0 when there is no estimate yet
+	 */
+	static uint32_t rtoMs(Transport transport);
+
+	/**
+	 * @brief ACK timeout for the first transmission of a confirmable request.
+	 * @param transport Transport the request is sent over
+	 * @return The RTO within [MIN_ACK_TIMEOUT_MS, COAP_ACK_TIMEOUT_MS]; COAP_ACK_TIMEOUT_MS without an estimate
+	 */
+	static uint32_t ackTimeoutMs(Transport transport);
+
+	/**
+	 * @brief Time from the first transmission until the last retransmission times out.
+	 *
+	 * Sum of the backed-off timeouts of retransmits + 1 transmissions, each starting from the
+	 * largest randomised ACK timeout. With all COAP_MAX_RETRANSMIT retransmissions this is
+	 * MAX_TRANSMIT_WAIT in RFC 7252.
+	 *
+	 * @param ack_timeout_ms ACK timeout before randomisation
+	 * @param retransmits Number of retransmissions
+	 * @return Span in milliseconds
+	 */
+	static uint32_t retransmitSpanMs(uint32_t ack_timeout_ms, uint32_t retransmits = COAP_MAX_RETRANSMIT);
+
+	/**
+	 * @brief Response window for a request, derived from the RTO.
+	 * @param transport Transport the request is sent over
+	 * @param configured_ms Response window configured for the packet type (upper bound)
+	 * @return Window in milliseconds, at most configured_ms: 4 RTOs, but no shorter than the span of
+	 *         the retransmissions (with ackTimeoutMs()) that time out within configured_ms;
+	 *         configured_ms while ackTimeoutMs() is COAP_ACK_TIMEOUT_MS
+	 */
+	static int responseWindowMs(Transport transport, int configured_ms);
+
+	/**
+	 * @brief Interval between receive polls while waiting for a response.
+	 * @param transport Transport being polled
+	 * @param default_ms Interval to use while there is no estimate
+	 * @return Interval in milliseconds, within [MIN_POLL_INTERVAL_MS, MAX_POLL_INTERVAL_MS]
+	 */
+	static int pollIntervalMs(Transport transport, int default_ms);
+
+private:
+	/**
+	 * @brief Smoothed RTT and variation for one transport.
+	 */
+	struct Estimate
+	{
+		uint32_t srtt_ms;
+		uint32_t rttvar_ms;
+		uint32_t samples;
+	};
+
+	/**
+	 * @brief RTC-resident estimates, tagged with a magic to detect cold boots.
+	 */
+	struct RtcState
+	{
+		uint32_t magic;
+		Estimate estimates[TRANSPORT_COUNT];
+	};
+
+	static constexpr uint32_t RTC_STATE_MAGIC = 0x0A77E035;
+
+	static RtcState s_rtc_state;
+
+	static const Estimate* findEstimate(Transport transport);
+};
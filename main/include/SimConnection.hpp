@@ -3,6 +3,8 @@
 #include "IConnection.hpp"
 #include "ATCommandHndlr.hpp"
 #include "CoapPktAssm.hpp"
+#include "CoapTransaction.hpp"
+#include "EEPROMConfig.hpp"
 #include "TelnetSession.hpp"
 
 /**
@@ -19,6 +21,21 @@ enum class SimStatus : uint8_t {
 };
 
 
+/**
+ * @struct AttachTimings_t
+ * @brief Time spent in each phase of the last SimConnection::connect(), in milliseconds.
+ * Phases that were not reached are 0.
+ */
+typedef struct {
+    uint32_t modem_ready_ms;    ///< Until the modem answers AT with the radio on
+    uint32_t sim_ready_ms;      ///< Until CPIN reports READY
+    uint32_t registration_ms;   ///< Until CEREG reports home or roaming registration
+    uint32_t data_session_ms;   ///< PDP context and UDP socket
+    uint32_t reset_ms;          ///< CFUN reset and reboot, if the first attach failed
+    uint32_t total_ms;
+    bool reset_used;
+} AttachTimings_t;
+
 /**
  * @class SimConnection
  * @brief Implements a cellular SIM-based network connection.
@@ -35,6 +52,11 @@ public:
      */
     bool connect() override;
 
+    /**
+     * @brief Phase timings of the last connect() call.
+     */
+    const AttachTimings_t& lastAttachTimings() const { return attach_timings; }
+
     /**
      * @brief Checks if the SIM network connection is currently active.
      *
@@ -61,6 +83,16 @@ public:
                     const PktEntry_t pkt_config,
                     std::string* response = nullptr) override;
 
+    /**
+     * @brief Sends a confirmable CoAP request and waits for its ACK and response.
+     * Retransmits with exponential backoff until the request is acknowledged or the
+     * packet's response window expires (see CoapTransaction).
+     * @param cbor_buffer Pointer to the CBOR-encoded data buffer.
+     * @param cbor_buffer_len Length of the CBOR-encoded data buffer.
+     * @param pkt_config Packet configuration.
+     * @param onChunk Optional callback receiving the response payload.
+     * @return true if the request was acknowledged and, when requested, a response delivered.
+     */
     bool sendPacketStream(const uint8_t * cbor_buffer,
                           const size_t cbor_buffer_len,
                           const PktEntry_t pkt_config,
@@ -69,6 +101,32 @@ public:
     bool streamHttpsGet(const std::string& url,
                         const PacketChunkCallback& onChunk) override;
 
+    /**
+     * @brief Sends several packets over the CoAP UDP socket with up to COAP_NSTART in flight.
+     * @param requests Packets to send; each one's success flag is set on return.
+     * @return Number of packets that were acknowledged.
+     */
+    size_t sendPacketBatch(std::span<PacketRequest_t> requests) override;
+
+    /**
+     * @brief Requests one Block2 block over the CoAP UDP socket.
+     * @param pkt_config Packet configuration of the block-wise resource.
+     * @param request_block Block number and size exponent to request.
+     * @param response_block Block2 option returned by the server.
+     * @param onChunk Callback receiving the block payload.
+     * @return true if the block was received.
+     */
+    bool fetchBlock(const PktEntry_t pkt_config,
+                    const CoapBlockOpt_t& request_block,
+                    CoapBlockOpt_t& response_block,
+                    const PacketChunkCallback& onChunk) override;
+
+    /**
+     * @brief Block size limit imposed by the modem's socket read size.
+     * @return SZX value (block size is 2^(SZX + 4) bytes).
+     */
+    uint8_t maxBlockSzx() const override;
+
     /**
      * @brief Starts a telnet session over the SIM connection.
      * @return true if the session was successfully started, false otherwise.
@@ -77,9 +135,57 @@ public:
 
 private:
     SimStatus sim_stat = SimStatus::DISCONNECTED;  // Default value
-    static constexpr size_t RETRIES = 10;
-    static constexpr size_t REG_RETRIES = 60;
+    AttachTimings_t attach_timings = {};
+    ModemPowerSaving_t power_saving = {};  ///< Granted PSM/eDRX timers, mirrored in NVS
+    ModemSslCache_t ssl_cache = {};        ///< QSSLOPEN profile for the current modem firmware, mirrored in NVS
+
+    // Readiness is polled against a deadline per phase instead of sleeping for fixed delays
+    static constexpr int READY_POLL_INTERVAL_MS = 250;
+    static constexpr int REGISTRATION_POLL_INTERVAL_MS = 1000;
+    static constexpr int MODEM_READY_TIMEOUT_MS = 20000;
+    static constexpr int SIM_READY_TIMEOUT_MS = 20000;
+    static constexpr int REGISTRATION_TIMEOUT_MS = 180000;
+    static constexpr int PDP_READY_TIMEOUT_MS = 10000;
+    static constexpr int MODEM_BOOT_TIMEOUT_MS = 15000;
+    static constexpr int SOCKET_OPEN_TIMEOUT_MS = 5000;
+
+    static constexpr int MODEM_WAKE_PULSE_MS = 100;
+
+    static constexpr const char* UDP_HOST = "45.79.118.187";
+    static constexpr uint16_t UDP_PORT = 5683;
+    static constexpr int SOCKET_POLL_INTERVAL_MS = 100;
+    static constexpr int SOCKET_URC_FALLBACK_POLL_MS = 1000;  ///< Read interval when waiting on socket URCs
+
+    /**
+     * AT+QIRD reads at most 1024 bytes per call, so a 1024-byte block plus the CoAP header
+     * would be split across reads. 512-byte blocks (SZX 5) always arrive in one datagram read.
+     */
+    static constexpr uint8_t MAX_BLOCK_SZX = 5;
     
+    /**
+     * @brief Builds a CoAP request and runs it as a confirmable exchange over the UDP socket.
+     * @param cbor_buffer CBOR payload (may be null when cbor_buffer_len is 0).
+     * @param cbor_buffer_len Length of the payload.
+     * @param pkt_config Packet configuration.
+     * @param onChunk Optional callback receiving the response payload.
+     * @param request_block Optional Block2 option to include in the request.
+     * @param response_block Optional output for the response's Block2 option.
+     * @return true if the exchange completed successfully.
+     */
+    bool exchangePacket(const uint8_t * cbor_buffer,
+                        const size_t cbor_buffer_len,
+                        const PktEntry_t pkt_config,
+                        const PacketChunkCallback& onChunk,
+                        const CoapBlockOpt_t* request_block,
+                        CoapBlockOpt_t* response_block);
+
+    /**
+     * @brief Runs prepared requests over the UDP socket, reconnecting once if the first send fails.
+     * @param requests Requests to run; each one's success flag is set on return.
+     * @return Number of requests that completed successfully.
+     */
+    size_t runExchange(std::span<CoapRequest_t> requests);
+
     /**
      * @brief Closes COAP Session
      */
@@ -99,6 +205,66 @@ private:
      */
     bool estDataSession();
 
+    /**
+     * @brief Brings the modem from its current state to registered with a data session.
+     * Probes each phase (AT, radio, CPIN, CEREG, QIACT) and skips what is already done, polling
+     * with short intervals until the phase's deadline. Records phase timings in attach_timings.
+     * @return true if the data session is up, false if a phase deadline passed.
+     */
+    bool attachFromCurrentState();
+
+    /**
+     * @brief Reboots the modem with AT+CFUN=1,1 and waits for its RDY.
+     * Used only after attachFromCurrentState() has failed.
+     */
+    void resetModem();
+
+    /**
+     * @brief Whether PDP context 1 is active (AT+QIACT? lists it).
+     */
+    bool pdpContextActive();
+
+    /**
+     * @brief Opens UDP socket 0 to the CoAP server and waits for its +QIOPEN result.
+     * Closes a stale socket with the same id and retries once.
+     * @return true if the socket is open
+     */
+    bool openUdpSocket();
+
+    /**
+     * @brief Returns the QSSLOPEN profile learned on the modem's current firmware.
+     * Reads the revision with AT+GMR; a profile stored under another revision is discarded.
+     */
+    SslOpenProfile_t loadSslProfile();
+
+    /**
+     * @brief Persists what the last openSSLSocket() learned, if it changed.
+     */
+    void storeSslProfile(const SslOpenProfile_t& profile);
+
+    /**
+     * @brief Requests PSM and/or eDRX as selected by PSM_EN and records what the network granted.
+     * Logs the negotiated timers and persists them when they change. Runs only after a fresh registration;
+     * a modem that resumes the registration it was left with keeps the timers stored at the last sleep.
+     */
+    void configurePowerSaving();
+
+    /**
+     * @brief Whether disconnect() may leave the modem registered for the next wake.
+     */
+    bool keepAttachedAcrossSleep() const;
+
+    /**
+     * @brief Records whether the modem was left registered, persisting only on change.
+     */
+    void setLeftAttached(bool left_attached);
+
+    /**
+     * @brief Pulses MODEM_WAKE_GPIO low to bring the modem out of PSM; no-op if it is not wired.
+     */
+    void wakeModem();
+
     ATCommandHndlr hndlr;
+    SocketRecvWatch udp_watch{0};  ///< Data and close URCs for the UDP socket (connect id 0)
     TelnetSession telnet_session;
 };
@@ -27,6 +27,8 @@ private:
 
     ATCommandHndlr* hndlr = nullptr;
     TaskHandle_t session_task_handle = nullptr;
+    SocketRecvWatch recv_watch{TELNET_CONNECT_ID};  ///< Wakes the session when the modem reports data
+    bool data_pending = true;                        ///< Modem buffer may hold unread data
     volatile bool keep_running = false;
     volatile bool socket_open = false;
     char command_buffer[192] = {0};
@@ -40,6 +42,7 @@ private:
     static constexpr uint8_t TELNET_CONTEXT_ID = 1;
     static constexpr uint8_t TELNET_CONNECT_ID = 1;
     static constexpr TickType_t SESSION_POLL_INTERVAL = pdMS_TO_TICKS(100);
+    static constexpr TickType_t URC_FALLBACK_POLL_INTERVAL = pdMS_TO_TICKS(2000);
     static constexpr TickType_t KEEPALIVE_INTERVAL = pdMS_TO_TICKS(30000);
     static constexpr TickType_t RECONNECT_DELAY = pdMS_TO_TICKS(5000);
     static constexpr TickType_t MAX_RECONNECT_DELAY = pdMS_TO_TICKS(120000);
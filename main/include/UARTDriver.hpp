@@ -1,9 +1,14 @@
 #pragma once
 #include "driver/uart.h"
+#include <cstddef>
+#include <cstdint>
+#include <span>
 #include <string>
 #include "Types.hpp"
 
 
+class ModemTranscript;
+
 #define BAUD_4800 4800
 #define BAUD_115200 115200
 #define BAUD_9600 9600
@@ -19,6 +24,11 @@
  *
  * The console must be initialized with `init()` before any read or write
  * operations are performed.
+ *
+ * Reads are served from a small staging buffer that is refilled from the
+ * driver's RX ring buffer in bulk, so parsers can scan whole lines instead of
+ * making one driver call per byte. All read methods share the staging buffer
+ * and may be mixed freely.
  */
 class UARTDriver {
 public:
@@ -76,11 +86,84 @@ public:
      */
     void writef(const char* fmt, ...);
 
+    /**
+     * @brief Write a block of bytes to the UART.
+     *
+     * Hands the whole block to the driver in one call, blocking until it
+     * has been queued for transmission.
+     *
+     * @param data Bytes to send.
+     * @return Number of bytes queued, or `<0` on a driver error.
+     */
+    int write(std::span<const uint8_t> data);
 
     int writeByte(uint8_t byte);
 
     /**
-     * @brief Read a single byte from the UART (non-blocking).
+     * @brief Read exactly `out.size()` bytes, or as many as arrive before the deadline.
+     *
+     * Blocks inside the driver rather than polling.
+     *
+     * @param out Destination buffer.
+     * @param deadline Tick count at which to give up.
+     * @return Number of bytes read.
+     */
+    size_t read(std::span<uint8_t> out, TickType_t deadline);
+
+    /**
+     * @brief Read whatever is available, waiting until the deadline for the first byte.
+     *
+     * @param out Destination buffer.
+     * @param deadline Tick count at which to give up.
+     * @return Number of bytes read (0 on timeout).
+     */
+    size_t readSome(std::span<uint8_t> out, TickType_t deadline);
+
+    /**
+     * @brief Read up to and including a delimiter.
+     *
+     * The bytes before the delimiter are copied to `out` and NUL-terminated;
+     * the delimiter itself is consumed but not copied. Nothing is consumed
+     * until the delimiter arrives, so a call that times out mid-line loses no
+     * data. Lines that do not fit in `out` (or the staging buffer) are
+     * discarded and reading continues with the next one.
+     *
+     * @param delim Delimiter byte (e.g. '\n').
+     * @param out Destination buffer; must hold the line plus the terminator.
+     * @param deadline Tick count at which to give up.
+     * @return Line length, or `-1` on timeout.
+     */
+    int readUntil(char delim, std::span<char> out, TickType_t deadline);
+
+    /**
+     * @brief Return the next byte without consuming it.
+     *
+     * @param deadline Tick count at which to give up waiting for a byte.
+     * @return The byte, or `-1` on timeout.
+     */
+    int peek(TickType_t deadline);
+
+    /**
+     * @brief Number of bytes that can be read without blocking.
+     */
+    size_t available();
+
+    /**
+     * @brief Enable hardware detection of a line terminator.
+     *
+     * The driver records the ring buffer position of every occurrence of
+     * `pattern`, and readUntil() uses it to pull exactly one line per driver
+     * call. Bytes after the line (e.g. a binary payload announced by the line)
+     * are left in the ring buffer for read() to copy straight to the caller.
+     *
+     * @param pattern Byte to detect (e.g. '\n').
+     * @param queue_len Number of pending positions the driver keeps.
+     * @return true if detection was enabled.
+     */
+    bool enablePatternDetect(char pattern, int queue_len);
+
+    /**
+     * @brief Read a single byte from the UART (waits up to 50 ms).
      *
      * Attempts to read 1 byte from the UART RX buffer.  
      * If a byte is available, it is written into `out` and the function
@@ -103,8 +186,44 @@ public:
      */
     uart_port_t getPort() const { return m_uart_num; }
 
+    /**
+     * @brief Copy all traffic on this port to a transcript.
+     *
+     * @param transcript Recorder to feed, or nullptr to stop.
+     */
+    void setTranscript(ModemTranscript* transcript) { m_transcript = transcript; }
+
 private:
+    static constexpr size_t STAGE_SIZE = 256;  ///< Staging buffer; bounds the longest line readUntil() returns
+
     uart_port_t m_uart_num;  ///< UART port number for this instance
+
+    uint8_t m_stage[STAGE_SIZE] = {};  ///< Bytes pulled from the driver but not yet consumed
+    size_t m_stage_pos = 0;            ///< Offset of the first unconsumed byte
+    size_t m_stage_len = 0;            ///< Number of unconsumed bytes
+    bool m_pattern_enabled = false;
+    ModemTranscript* m_transcript = nullptr;  ///< Receives a copy of all traffic when set
+
+    /**
+     * @brief Pull more bytes from the driver into the staging buffer.
+     *
+     * Takes everything already buffered (or one pattern-delimited line),
+     * blocking only when the driver has nothing.
+     *
+     * @return true if at least one byte was staged before the deadline.
+     */
+    bool fill(TickType_t deadline);
+
+    /**
+     * @brief Copy staged bytes to `out` and consume them.
+     * @return Number of bytes copied.
+     */
+    size_t takeStaged(std::span<uint8_t> out);
+
+    /**
+     * @brief Hand traffic to the transcript, if one is attached.
+     */
+    void trace(bool rx, const void* data, int len);
 };
 
 extern UARTDriver m_modem_uart;
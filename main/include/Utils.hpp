@@ -3,6 +3,7 @@
 #include <iostream>
 #include <iomanip>
 #include <string>
+#include <string_view>
 #include <sstream>
 #include <stdexcept>
 #include <cstdint>
@@ -34,16 +35,6 @@ public:
 	 */
 	static std::string bytesToHexString(unsigned char high, unsigned char low);
 	
-	/**
-	 * @brief Extract a chunk of the CoAP payload from the source string, ensuring it does not exceed the specified length.
-	 * @param src The source string containing the CoAP payload.
-	 * @param src_len The length of the source string.
-	 * @param out A reference to a string where the extracted payload chunk will be stored.
-	 * @return The size of the extracted payload chunk.
-	 * @throws std::invalid_argument if the source string is empty or if the specified length
-	 */
-	static size_t extractCoapPayloadChunk(const char *src, size_t src_len, std::string &out);
-	
 	/**
 	 * @brief Convert a string to lowercase ASCII characters.
 	 * @param value The string to convert.
@@ -85,12 +76,23 @@ public:
 	static void trimTrailingWhitespace(std::string &value);
 	
 	/**
-	 * @brief Parse a GPS coordinate line in the format "latitude,longitude" and return it as a string.
-	 * @param line The GPS coordinate line to parse.
-	 * @return A string representing the parsed GPS coordinates in the format "latitude,longitude".
-	 * @throws std::invalid_argument if the input line is not in the expected format or
+	 * @brief Parse a +QGPSLOC response into a fixed-point GPS fix.
+	 * Coordinates are converted from degrees and decimal minutes with integer arithmetic; HDOP and
+	 * altitude are taken when the response carries both.
+	 * @param line The +QGPSLOC response line.
+	 * @param fix Receives the parsed fix; unchanged on failure.
+	 * @return true if latitude and longitude were parsed.
+	 */
+	static bool parseGPSLine(std::string_view line, GpsFix_t &fix);
+
+	/**
+	 * @brief Format a GPS fix as "latitude, longitude" in decimal degrees for logging.
+	 * @param fix The fix to format.
+	 * @param buf Output buffer.
+	 * @param len Size of the output buffer.
+	 * @return snprintf result.
 	 */
-	static std::string parseGPSLine(const std::string &line);
+	static int formatGpsFix(const GpsFix_t &fix, char *buf, size_t len);
 
 	/**
 	 * @brief Print the device configuration to the console for debugging purposes.
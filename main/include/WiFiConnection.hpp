@@ -1,6 +1,7 @@
 #pragma once
 
 #include "IConnection.hpp"
+#include "CoapTransaction.hpp"
 #include "esp_wifi.h"
 
 /**
@@ -28,6 +29,32 @@ private:
      */
     static void wifi_event_handler(void* arg, esp_event_base_t event_base, int32_t event_id, void* event_data);
 
+    /**
+     * @brief Builds a CoAP request and runs it as a confirmable exchange over a UDP socket.
+     *
+     * @param cbor_buffer CBOR payload (may be null when cbor_buffer_len is 0).
+     * @param cbor_buffer_len Length of the payload.
+     * @param pkt_config Packet configuration.
+     * @param onPayload Optional callback receiving the response payload.
+     * @param request_block Optional Block2 option to include in the request.
+     * @param response_block Optional output for the response's Block2 option.
+     * @return true if the exchange completed successfully.
+     */
+    bool exchangePacket(const uint8_t * cbor_buffer,
+                        const size_t cbor_buffer_len,
+                        const PktEntry_t pkt_config,
+                        const PacketChunkCallback& onPayload,
+                        const CoapBlockOpt_t* request_block,
+                        CoapBlockOpt_t* response_block);
+
+    /**
+     * @brief Runs prepared requests over a fresh UDP socket.
+     *
+     * @param requests Requests to run; each one's success flag is set on return.
+     * @return Number of requests that completed successfully.
+     */
+    size_t runExchange(std::span<CoapRequest_t> requests);
+
 public:
     /**
      * @brief Establishes a connection to the Wi-Fi network.
@@ -52,4 +79,26 @@ public:
                     const size_t cbor_buffer_len,
                     const PktEntry_t pkt_config,
                     std::string* response = nullptr) override;
+
+    /**
+     * @brief Sends several packets over UDP with up to COAP_NSTART in flight.
+     *
+     * @param requests Packets to send; each one's success flag is set on return.
+     * @return Number of packets that were acknowledged.
+     */
+    size_t sendPacketBatch(std::span<PacketRequest_t> requests) override;
+
+    /**
+     * @brief Requests one Block2 block over UDP.
+     *
+     * @param pkt_config Packet configuration of the block-wise resource.
+     * @param request_block Block number and size exponent to request.
+     * @param response_block Block2 option returned by the server.
+     * @param onChunk Callback receiving the block payload.
+     * @return true if the block was received.
+     */
+    bool fetchBlock(const PktEntry_t pkt_config,
+                    const CoapBlockOpt_t& request_block,
+                    CoapBlockOpt_t& response_block,
+                    const PacketChunkCallback& onChunk) override;
 };
@@ -1,15 +1,24 @@
 #include "AppRuntime.hpp"
 
+#include <array>
 #include <cctype>
+#include <memory>
 #include <stdio.h>
 #include <string.h>
+#include <vector>
 
 #include "ActivatePkt.hpp"
+#include "AtEngine.hpp"
+#include "CborSchema.hpp"
 #include "CoapOTAUpdater.hpp"
 #include "CoapPktAssm.hpp"
 #include "Config.hpp"
+#include "DeadbandPolicy.hpp"
+#include "DownlinkCommand.hpp"
 #include "HwTypes.hpp"
 #include "Key.hpp"
+#include "ModemReader.hpp"
+#include "ModemTranscript.hpp"
 // #include "Logger.hpp"
 #include "NPK.hpp"
 #include "ReadingPkt.hpp"
@@ -36,11 +45,26 @@ std::unique_ptr<Communication> g_comm;
 ConnectionType g_hw_var = ConnectionType::SIM;
 GPS m_gps;
 
+/**
+ * @brief Sensor window sampled at the start of a cycle, before any network attach.
+ */
+typedef struct {
+    MeasurementType type;
+    uint16_t reading[NPK_COLLECT_SIZE];
+    uint16_t summary;
+    bool valid;
+} CycleSample_t;
+
+static CycleSample_t s_samples[DeadbandPolicy::MEASUREMENT_COUNT];
+static bool s_link_attempted = false;
+static TickType_t s_awake_deadline = 0;
+
 static const DeviceConfig k_default_device_config = {
     .has_activated = false,
-    .gps_coord = "",
+    .gps = {},
     .main_app_delay = 30,
     .session_count = 0,
+    .cmd_ver = 0,
     .secretKey = "",
     .manf_info = {
         .hw_ver = {.value = ""},
@@ -63,11 +87,16 @@ void enter_deep_sleep()
     printf("Entering deep sleep for %llu seconds\n",
            static_cast<unsigned long long>(safe_sleep_seconds));
 
-    if (g_comm)
+    if (g_comm && s_link_attempted)
     {
         g_comm->disconnect();
     }
 
+#if MODEM_TRACE_EN == 1
+    m_modem_uart.setTranscript(nullptr);
+    g_modem_transcript.stop();
+#endif
+
     // g_logger.deinit();
     esp_sleep_enable_timer_wakeup(safe_sleep_seconds * 1000000ULL);
     vTaskDelay(pdMS_TO_TICKS(100));
@@ -116,6 +145,22 @@ void init_hw()
             2048,
             0
         );
+        // Modem responses are line-framed; let the driver mark line ends
+        m_modem_uart.enablePatternDetect('\n', 32);
+#if MODEM_TRACE_EN == 1
+        if (g_modem_transcript.start())
+        {
+            m_modem_uart.setTranscript(&g_modem_transcript);
+        }
+#endif
+        if (!g_modem_reader.start())
+        {
+            printf("Modem reader failed to start; AT commands will fail\n");
+        }
+        if (!g_at_engine.start())
+        {
+            printf("AT engine failed to start; GPS fixes will fail\n");
+        }
         break;
 
     default:
@@ -187,49 +232,60 @@ void hw_features(void)
     net_select(hw_ver);
 }
 
-static void read_gps()
+static AtTask<bool> acquire_gps_fix()
 {
-    const int gps_cold_start_delay_ms = 30000;
+    // GPS::acquireFix waits for satellite acquisition itself, once the receiver is on
     printf("Waiting for GPS fix (Cold Start may take 30-60 seconds)...\n");
-    vTaskDelay(pdMS_TO_TICKS(gps_cold_start_delay_ms));
+    co_return co_await m_gps.acquireFix(g_at_engine, g_device_config.gps);
+}
+
+/**
+ * @brief Starts acquiring a GPS fix on the AT engine; the caller carries on meanwhile.
+ * @return Job to pass to finish_gps_fix()
+ */
+static AtJob start_gps_fix()
+{
+    return g_at_engine.spawn(acquire_gps_fix());
+}
+
+/**
+ * @brief Waits for the fix started by start_gps_fix() and falls back to default coordinates.
+ * @param job Job returned by start_gps_fix()
+ */
+static void finish_gps_fix(const AtJob& job)
+{
+    char coords[48];
 
-    if (m_gps.getCoordinates(g_device_config.gps_coord))
+    if (job.wait(portMAX_DELAY))
     {
-        printf("GPS location retrieved: %s\n", g_device_config.gps_coord.c_str());
+        Utils::formatGpsFix(g_device_config.gps, coords, sizeof(coords));
+        printf("GPS location retrieved: %s\n", coords);
     }
     else
     {
-        g_device_config.gps_coord = "0.0,0.0";
-        printf("Failed to retrieve GPS location, using default coordinates: %s\n", g_device_config.gps_coord.c_str());
+        g_device_config.gps = {};
+        Utils::formatGpsFix(g_device_config.gps, coords, sizeof(coords));
+        printf("Failed to retrieve GPS location, using default coordinates: %s\n", coords);
     }
 }
 
-static void handle_gps_update()
+static void handle_activation()
 {
-    GpsUpdatePkt gpsupdatePkt(PktType::GpsUpdate, std::string(g_device_config.manf_info.nodeId.value), std::string(GPS_URI), g_device_config.gps_coord);
-
-    const uint8_t* pkt_1 = gpsupdatePkt.toBuffer();
-    const size_t buffer_len = gpsupdatePkt.getBufferLength();
-
-    if (!pkt_1 || buffer_len == 0)
+    // An unsigned activation would be rejected, and a zero key would be saved with it
+    if (!Key::computeKey(g_device_config.secretKey, Key::HMAC_SIZE))
     {
-        printf("Failed to build GPS update packet for node: %s\n", g_device_config.manf_info.nodeId.value);
+        printf("Failed to derive device key, skipping activation\n");
         return;
     }
 
-    if (!g_comm->sendPacket(pkt_1, buffer_len, gpsupdate_entry))
+    if (!PacketSchema::cacheIdentity(g_device_config))
     {
-        printf("Sending activation packet failed for node: %s\n", g_device_config.manf_info.nodeId.value);
+        printf("Failed to load packet identity or MAC key, skipping activation\n");
         return;
     }
-}
 
-static void handle_activation()
-{
-    Key::computeKey(g_device_config.secretKey, Key::HMAC_SIZE);
-    
-    ActivatePkt activatePkt(PktType::Activate, std::string(g_device_config.manf_info.nodeId.value),
-                            std::string(ACT_URI), std::string(g_device_config.manf_info.secretkey.value), g_device_config.gps_coord, g_device_config.manf_info.hw_ver.value,
+    ActivatePkt activatePkt(PktType::Activate, g_device_config.manf_info.nodeId.value,
+                            ACT_URI, g_device_config.manf_info.secretkey.value, g_device_config.gps, g_device_config.manf_info.hw_ver.value,
                             g_device_config.manf_info.sim_mod_sn.value, g_device_config.manf_info.sim_card_sn.value,
                             g_device_config.manf_info.chassis_ver.value);
 
@@ -251,7 +307,16 @@ static void handle_activation()
         return;
     }
 
-    if (!g_comm->sendPacket(pkt_1, buffer_len, activate_entry))
+    // Activation gates everything else, so it is drained on its own before the uplink is built
+    QueuedPacket_t activation = {};
+    activation.request = {pkt_1, buffer_len, activate_entry, nullptr, false};
+    activation.priority = PktPriority::Activation;
+    activation.persist = false;
+
+    g_comm->enqueue(activation);
+    g_comm->drainQueue(s_awake_deadline, false);
+
+    if (activation.state != QueuedPktState::Sent)
     {
         printf("Sending activation packet failed for node: %s\n", g_device_config.manf_info.nodeId.value);
         return;
@@ -269,53 +334,244 @@ static void handle_activation()
     }
 }
 
-static void collect_reading()
+static void sample_readings()
 {
-    uint16_t reading[NPK_COLLECT_SIZE];
+    size_t idx = 0;
+
+    DeadbandPolicy::begin();
 
     for (const NPK::MeasurementEntry& m_entry : NPK::MEASUREMENT_TABLE)
     {
-        memset(reading, 0, sizeof(reading));
+        CycleSample_t& sample = s_samples[idx++];
 
-        if (!NPK::npk_collect(m_entry, reading))
+        memset(&sample, 0, sizeof(sample));
+        sample.type = m_entry.type;
+
+        if (!NPK::npk_collect(m_entry, sample.reading))
         {
             printf("Failed to collect measurement type %d\n",
                    static_cast<int>(m_entry.type));
             continue;
         }
 
-        if (!(g_device_config.session_count < UINT64_MAX))
+        sample.summary = DeadbandPolicy::summarize(sample.reading);
+        sample.valid = true;
+    }
+}
+
+static bool readings_need_upload()
+{
+    bool significant = false;
+
+    for (const CycleSample_t& sample : s_samples)
+    {
+        // A sensor that stopped answering must not silence the node: attach so the
+        // heartbeat, GPS update and OTA check still go out and the fault is visible.
+        if (!sample.valid)
         {
-            printf("Error: session_count would overflow!\n");
+            printf("Measurement type %d unavailable, attaching anyway\n",
+                   static_cast<int>(sample.type));
+            significant = true;
             continue;
         }
 
-        ReadingPkt readingPkt(PktType::Reading,
-                              std::string(g_device_config.manf_info.nodeId.value),
-                              std::string(DATA_URI),
-                              reading,
-                              m_entry.type,
-                              g_device_config.session_count);
+        // Evaluate every type so each one logs its own verdict.
+        if (DeadbandPolicy::isSignificant(sample.type, sample.summary))
+        {
+            significant = true;
+        }
+    }
+
+    return significant;
+}
+
+#if OTA_EN == 1
+static void run_ota(CoapOTAUpdater& ota)
+{
+    if (!ota.evaluateVersionResponse())
+    {
+        printf("OTA check skipped: no update available\n");
+        return;
+    }
+
+    printf("Firmware update detected, starting OTA process\n");
 
-        const uint8_t* cbor_buffer = readingPkt.toBuffer();
-        const size_t cbor_buffer_len = readingPkt.getBufferLength();
+    if (ota.executeUpdate())
+    {
+        printf("OTA image ready, rebooting into updated firmware\n");
+        vTaskDelay(pdMS_TO_TICKS(1500));
+        esp_restart();
+    }
+    else
+    {
+        printf("OTA download/write failed\n");
+    }
+}
+#endif
 
-        if (!cbor_buffer || cbor_buffer_len == 0)
+/**
+ * @brief Queues the cycle's uplink packets and drains the send queue within the awake budget.
+ *
+ * Readings go out before the GPS update, and the firmware version check goes last. The queue
+ * pipelines whatever fits in the remaining budget; readings and the GPS update that are not
+ * delivered are kept in NVS and retried on the next attach. An available update is downloaded
+ * only after the readings have been delivered. Command maps the server piggybacks on reading
+ * acknowledgements are applied before the session is saved.
+ *
+ * @param include_gps_update Whether the GPS update packet is queued
+ */
+static void send_uplink(bool include_gps_update)
+{
+    std::vector<ReadingPkt> reading_pkts;
+    std::unique_ptr<GpsUpdatePkt> gps_pkt;
+    std::vector<QueuedPacket_t> items;
+    std::vector<const CycleSample_t*> item_samples;
+    std::array<std::string, DeadbandPolicy::MEASUREMENT_COUNT> downlink_payloads;
+    bool downlink_applied = false;
+#if OTA_EN == 1
+    // Decodes the version response as it arrives
+    CoapOTAUpdater ota(*g_comm, g_device_config.manf_info.fw_ver.value);
+#endif
+
+    // The queue holds pointers into items and payloads live in each packet's frame, so neither may reallocate
+    items.reserve(DeadbandPolicy::MEASUREMENT_COUNT + 2);
+    reading_pkts.reserve(DeadbandPolicy::MEASUREMENT_COUNT);
+
+    if (g_device_config.session_count < UINT64_MAX)
+    {
+        for (const CycleSample_t& sample : s_samples)
         {
-            printf("Failed to build measurement packet type %d\n", static_cast<int>(m_entry.type));
+            if (!sample.valid)
+            {
+                continue;
+            }
+
+            reading_pkts.emplace_back(PktType::Reading,
+                                      g_device_config.manf_info.nodeId.value,
+                                      DATA_URI,
+                                      sample.reading,
+                                      sample.type);
+
+            const uint8_t* cbor_buffer = reading_pkts.back().toBuffer();
+            const size_t cbor_buffer_len = reading_pkts.back().getBufferLength();
+
+            if (!cbor_buffer || cbor_buffer_len == 0)
+            {
+                printf("Failed to build measurement packet type %d\n", static_cast<int>(sample.type));
+                continue;
+            }
+
+            std::string& downlink = downlink_payloads[item_samples.size()];
+            QueuedPacket_t item = {};
+
+            // The session is already paid for, so every type is refreshed once the modem is attached.
+            item.request = {cbor_buffer, cbor_buffer_len, reading_entry,
+                            [&downlink](const uint8_t* chunk, size_t chunk_len) -> bool {
+                                downlink.append(reinterpret_cast<const char*>(chunk), chunk_len);
+                                return true;
+                            },
+                            false};
+            item.priority = PktPriority::Reading;
+            item.persist = true;
+            items.push_back(item);
+            item_samples.push_back(&sample);
+        }
+    }
+    else
+    {
+        printf("Error: session_count would overflow!\n");
+    }
+
+    if (include_gps_update)
+    {
+        gps_pkt = std::make_unique<GpsUpdatePkt>(PktType::GpsUpdate, g_device_config.manf_info.nodeId.value, GPS_URI, g_device_config.gps);
+
+        const uint8_t* cbor_buffer = gps_pkt->toBuffer();
+        const size_t cbor_buffer_len = gps_pkt->getBufferLength();
+
+        if (cbor_buffer && cbor_buffer_len > 0)
+        {
+            QueuedPacket_t item = {};
+            item.request = {cbor_buffer, cbor_buffer_len, gpsupdate_entry, nullptr, false};
+            item.priority = PktPriority::GpsUpdate;
+            item.persist = true;
+            items.push_back(item);
+            item_samples.push_back(nullptr);
+        }
+        else
+        {
+            printf("Failed to build GPS update packet for node: %s\n", g_device_config.manf_info.nodeId.value);
+        }
+    }
+
+#if OTA_EN == 1
+    {
+        // Only meaningful for this wake, so it is never persisted
+        QueuedPacket_t item = {};
+        item.request = {nullptr, 0, firmwareversion_entry, ota.versionResponseSink(), false};
+        item.priority = PktPriority::Maintenance;
+        item.persist = false;
+        items.push_back(item);
+        item_samples.push_back(nullptr);
+    }
+#endif
+
+    for (QueuedPacket_t& item : items)
+    {
+        g_comm->enqueue(item);
+    }
+
+    g_comm->drainQueue(s_awake_deadline, true);
+
+    for (size_t i = 0; i < items.size(); ++i)
+    {
+        const CycleSample_t* sample = item_samples[i];
+        const PacketRequest_t& request = items[i].request;
+
+        if (!sample)
+        {
+            if (items[i].state != QueuedPktState::Sent)
+            {
+                printf("Uplink packet for %s was not delivered\n",
+                       std::string(CoapPktAssm::getUriPath(request.pkt_config.pkt_type)).c_str());
+            }
+            else if (request.pkt_config.pkt_type == PktType::GpsUpdate)
+            {
+                DownlinkCommand::clearPending(DOWNLINK_ACTION_GPS);
+            }
+            else if (request.pkt_config.pkt_type == PktType::FirmwareVersion)
+            {
+                DownlinkCommand::clearPending(DOWNLINK_ACTION_OTA);
+            }
             continue;
         }
 
-        if (g_comm->sendPacket(cbor_buffer, cbor_buffer_len, reading_entry))
+        if (items[i].state == QueuedPktState::Sent)
         {
-            printf("Sent measurement type %d successfully\n", static_cast<int>(m_entry.type));
+            printf("Sent measurement type %d successfully\n", static_cast<int>(sample->type));
+            DeadbandPolicy::markSent(sample->type, sample->summary);
         }
         else
         {
-            printf("Failed to send measurement type %d, queuing to file\n", static_cast<int>(m_entry.type));
+            printf("Measurement type %d not delivered, kept in send backlog\n", static_cast<int>(sample->type));
         }
     }
 
+    // Every acknowledgement may repeat the same map; the command version makes re-application a no-op.
+    for (size_t i = 0; i < items.size(); ++i)
+    {
+        if (item_samples[i] && items[i].state == QueuedPktState::Sent && !downlink_payloads[i].empty())
+        {
+            downlink_applied |= DownlinkCommand::apply(reinterpret_cast<const uint8_t*>(downlink_payloads[i].data()),
+                                                       downlink_payloads[i].size(), g_device_config);
+        }
+    }
+
+    if (downlink_applied)
+    {
+        Utils::printDeviceConfig(g_device_config, "after downlink command");
+    }
+
     g_device_config.session_count++;
 
     if (eeprom.saveConfig(g_device_config))
@@ -328,6 +584,17 @@ static void collect_reading()
     }
 
     printf("Collection complete\n");
+
+#if OTA_EN == 1
+    if (!items.empty() && items.back().state == QueuedPktState::Sent)
+    {
+        run_ota(ota);
+    }
+    else
+    {
+        printf("OTA check skipped: no update available or timeout/no response\n");
+    }
+#endif
 }
 
 static bool has_required_identity_fields()
@@ -376,6 +643,10 @@ void start_app(void* arg)
 {
     bool connected_for_collection = false;
     bool identity_ready = false;
+    bool was_activated = false;
+    AtJob gps_job;
+
+    s_awake_deadline = xTaskGetTickCount() + pdMS_TO_TICKS(AWAKE_BUDGET_MS);
 
     if (!g_comm)
     {
@@ -383,6 +654,24 @@ void start_app(void* arg)
         goto cleanup;
     }
 
+    sample_readings();
+    DownlinkCommand::begin();
+    PacketSchema::cacheIdentity(g_device_config);
+
+    if (g_device_config.has_activated && !readings_need_upload())
+    {
+        if (DownlinkCommand::pendingActions() == DOWNLINK_ACTION_NONE)
+        {
+            printf("Readings within deadband, skipping network attach this cycle\n");
+            goto cleanup;
+        }
+
+        printf("Readings within deadband, attaching for pending downlink trigger(s) 0x%02x\n",
+               DownlinkCommand::pendingActions());
+    }
+
+    s_link_attempted = true;
+
     if (!g_comm->connect()) //If connection fails, enter deep sleep.
     {
         printf("Unable to connect to network\n");
@@ -392,51 +681,8 @@ void start_app(void* arg)
 
     printf("Device connected to network\n");
 
-#if OTA_EN == 1
-    if (g_comm->isConnected())
-    {
-        CoapOTAUpdater ota(*g_comm, g_device_config.manf_info.fw_ver.value);
-
-        if (ota.isFirmwareAvailable()) {
-            printf("Firmware update detected, starting OTA process\n");
-
-            if (ota.executeUpdate())
-            {
-                printf("OTA image ready, rebooting into updated firmware\n");
-                vTaskDelay(pdMS_TO_TICKS(1500));
-                esp_restart();
-                    // if (!activation_payload_ready())
-                    // {
-                    //     printf("Activation skipped: manufacturing identity not fully provisioned or node_id invalid\n");
-                    //     printf("nodeId='%s' (must be 6 alnum), hw_ver='%s', fw_ver='%s', sim_mod_sn='%s', sim_card_sn='%s', chassis_ver='%s'\n",
-                    //            g_device_config.manf_info.nodeId.value,
-                    //            g_device_config.manf_info.hw_ver.value,
-                    //            g_device_config.manf_info.fw_ver.value,
-                    //            g_device_config.manf_info.sim_mod_sn.value,
-                    //            g_device_config.manf_info.sim_card_sn.value,
-                    //            g_device_config.manf_info.chassis_ver.value);
-                    //     return;
-                    // }
-
-            }
-            else
-            {
-                printf("OTA download/write failed\n");
-            }
-        }
-        else
-        {
-            printf("OTA check skipped: no update available or timeout/no response\n");
-        }
-    }
-#endif
-
-    read_gps();
-
-    if (g_device_config.gps_coord.empty()) {
-        printf("No GPS coordinates available to send in update packet\n");
-        goto cleanup;
-    }
+    // The fix is acquired on the AT engine while the cycle carries on; joined where the coordinates are used
+    gps_job = start_gps_fix();
 
     identity_ready = has_required_identity_fields();
     if (g_device_config.has_activated && !identity_ready)
@@ -455,12 +701,7 @@ void start_app(void* arg)
            g_device_config.manf_info.nodeId.value,
            g_device_config.manf_info.hw_ver.value);
 
-    if (!g_device_config.has_activated) {
-        handle_activation();
-    }
-    else {
-        handle_gps_update();
-    }
+    was_activated = g_device_config.has_activated;
 
 #if TELNET_CLI_EN == 1
     if (!g_comm->startTelnetSession())
@@ -469,16 +710,22 @@ void start_app(void* arg)
     }
 #endif
 
+    finish_gps_fix(gps_job);
+
+    if (!was_activated) {
+        handle_activation();
+    }
+
     connected_for_collection = g_comm->isConnected();
     if (connected_for_collection)
     {
-        printf("Connection check passed, starting collect_reading()\n");
-        collect_reading();
+        printf("Connection check passed, starting send_uplink()\n");
+        send_uplink(was_activated);
         goto cleanup;
     }
     else
     {
-        printf("Connection check failed before collect_reading(), skipping collection this cycle\n");
+        printf("Connection check failed before send_uplink(), skipping collection this cycle\n");
         goto cleanup;
     }
 
@@ -134,6 +134,7 @@ bool EEPROMConfig::loadConfig(DeviceConfig& config) {
 
     readU32("main_app_delay", &config.main_app_delay);
     readU64("session_count", &config.session_count);
+    readU32("cmd_ver", &config.cmd_ver);
     
     // Load calibration data
     readFloat("cal_n_offset", &config.calib.calib_list[0].offset);
@@ -191,6 +192,7 @@ bool EEPROMConfig::saveConfig(const DeviceConfig& config) {
     writeBool("has_activated", config.has_activated);
     writeU32("main_app_delay", config.main_app_delay);
     writeU64("session_count", config.session_count);
+    writeU32("cmd_ver", config.cmd_ver);
 
     writeBlob("hmac_key", config.secretKey, sizeof(config.secretKey));
 
@@ -238,4 +240,110 @@ bool EEPROMConfig::eraseConfig() {
     nvs_commit(handle);
     ESP_LOGI(TAG, "Configuration erased");
     return true;
-}
\ No newline at end of file
+}
+
+bool EEPROMConfig::saveOtaProgress(const OtaProgress_t& progress) {
+    if (handle == 0) return false;
+
+    if (!writeBlob("ota_progress", &progress, sizeof(progress))) {
+        ESP_LOGE(TAG, "Failed to write OTA progress");
+        return false;
+    }
+
+    return (nvs_commit(handle) == ESP_OK);
+}
+
+bool EEPROMConfig::loadOtaProgress(OtaProgress_t& progress) {
+    if (handle == 0) return false;
+
+    if (!readBlob("ota_progress", &progress, sizeof(progress))) {
+        return false;
+    }
+
+    progress.version[MANF_MAX_LEN - 1] = '\0';
+    return true;
+}
+
+bool EEPROMConfig::clearOtaProgress() {
+    if (handle == 0) return false;
+
+    esp_err_t err = nvs_erase_key(handle, "ota_progress");
+    if (err == ESP_ERR_NVS_NOT_FOUND) {
+        return true;
+    }
+
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to clear OTA progress: %s", esp_err_to_name(err));
+        return false;
+    }
+
+    return (nvs_commit(handle) == ESP_OK);
+}
+
+bool EEPROMConfig::saveModemPowerSaving(const ModemPowerSaving_t& state) {
+    if (handle == 0) return false;
+
+    if (!writeBlob("modem_psm", &state, sizeof(state))) {
+        ESP_LOGE(TAG, "Failed to write modem power-saving state");
+        return false;
+    }
+
+    return (nvs_commit(handle) == ESP_OK);
+}
+
+bool EEPROMConfig::loadModemPowerSaving(ModemPowerSaving_t& state) {
+    if (handle == 0) return false;
+
+    return readBlob("modem_psm", &state, sizeof(state));
+}
+
+bool EEPROMConfig::saveModemSslCache(const ModemSslCache_t& cache) {
+    if (handle == 0) return false;
+
+    if (!writeBlob("modem_ssl", &cache, sizeof(cache))) {
+        ESP_LOGE(TAG, "Failed to write modem SSL profile");
+        return false;
+    }
+
+    return (nvs_commit(handle) == ESP_OK);
+}
+
+bool EEPROMConfig::loadModemSslCache(ModemSslCache_t& cache) {
+    if (handle == 0) return false;
+
+    return readBlob("modem_ssl", &cache, sizeof(cache));
+}
+
+bool EEPROMConfig::saveSendBacklog(const uint8_t* data, size_t len) {
+    if (handle == 0) return false;
+
+    if (!writeBlob("send_backlog", data, len)) {
+        ESP_LOGE(TAG, "Failed to write send backlog");
+        return false;
+    }
+
+    return (nvs_commit(handle) == ESP_OK);
+}
+
+bool EEPROMConfig::loadSendBacklog(uint8_t* data, size_t* len) {
+    if (handle == 0) return false;
+
+    // nvs_get_blob reports the stored length, and fails if it exceeds the capacity
+    return (nvs_get_blob(handle, "send_backlog", data, len) == ESP_OK);
+}
+
+bool EEPROMConfig::clearSendBacklog() {
+    if (handle == 0) return false;
+
+    esp_err_t err = nvs_erase_key(handle, "send_backlog");
+    if (err == ESP_ERR_NVS_NOT_FOUND) {
+        return true;
+    }
+
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to clear send backlog: %s", esp_err_to_name(err));
+        return false;
+    }
+
+    return (nvs_commit(handle) == ESP_OK);
+}
@@ -0,0 +1,181 @@
+#include "ModemTranscript.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+extern "C" {
+#include "esp_littlefs.h"
+#include "esp_timer.h"
+}
+
+bool ModemTranscript::mount() {
+    if (esp_littlefs_mounted(PARTITION_LABEL)) {
+        return true;
+    }
+
+    esp_vfs_littlefs_conf_t conf = {};
+    conf.base_path = BASE_PATH;
+    conf.partition_label = PARTITION_LABEL;
+    conf.format_if_mount_failed = true;
+
+    const esp_err_t err = esp_vfs_littlefs_register(&conf);
+    if (err != ESP_OK) {
+        printf("Failed to mount LittleFS: %s\n", esp_err_to_name(err));
+        return false;
+    }
+
+    return true;
+}
+
+bool ModemTranscript::start(const char* path) {
+    if (m_task != nullptr) {
+        return true;
+    }
+
+    if (path == nullptr || !mount()) {
+        return false;
+    }
+
+    if (m_lock == nullptr) {
+        m_lock = xSemaphoreCreateMutex();
+        m_stopped = xSemaphoreCreateBinary();
+        m_stream = xStreamBufferCreate(STREAM_SIZE, 1);
+    }
+
+    if (m_lock == nullptr || m_stopped == nullptr || m_stream == nullptr) {
+        printf("Failed to allocate modem transcript buffers\n");
+        return false;
+    }
+
+    // Keep the previous session; rename fails harmlessly on the first boot
+    char previous[64] = {0};
+    snprintf(previous, sizeof(previous), "%s.1", path);
+    remove(previous);
+    rename(path, previous);
+
+    m_file = fopen(path, "wb");
+    if (m_file == nullptr) {
+        printf("Failed to create modem transcript %s\n", path);
+        return false;
+    }
+
+    static constexpr uint8_t FILE_HEADER[8] = {'M', 'T', 'R', 'C', 1, 0, 0, 0};
+    fwrite(FILE_HEADER, 1, sizeof(FILE_HEADER), m_file);
+
+    (void)xStreamBufferReset(m_stream);
+    m_start_us = esp_timer_get_time();
+    m_written = sizeof(FILE_HEADER);
+    m_reserved = sizeof(FILE_HEADER);
+    m_dropped = 0;
+    m_drop_pending = false;
+    m_stopping = false;
+
+    // Below the modem tasks: flash writes must never hold up the reader
+    const BaseType_t created = xTaskCreate(writerTaskEntry, "modem_trace", 3072, this, 2, &m_task);
+    if (created != pdPASS) {
+        m_task = nullptr;
+        fclose(m_file);
+        m_file = nullptr;
+        printf("Failed to create modem transcript task\n");
+        return false;
+    }
+
+    printf("Recording modem transcript to %s\n", path);
+    return true;
+}
+
+void ModemTranscript::stop() {
+    if (m_task == nullptr) {
+        return;
+    }
+
+    m_stopping = true;
+    if (xSemaphoreTake(m_stopped, pdMS_TO_TICKS(2000)) != pdTRUE) {
+        printf("Modem transcript writer did not finish\n");
+        return;
+    }
+
+    m_task = nullptr;
+    printf("Modem transcript closed: %u bytes, %lu bytes dropped\n",
+           static_cast<unsigned>(m_written),
+           static_cast<unsigned long>(m_dropped));
+}
+
+void ModemTranscript::record(Direction dir, std::span<const uint8_t> bytes) {
+    if (!recording() || bytes.empty()) {
+        return;
+    }
+
+    // The reader must not stall behind a slow recorder on the other side
+    if (xSemaphoreTake(m_lock, pdMS_TO_TICKS(5)) != pdTRUE) {
+        m_dropped += static_cast<uint32_t>(bytes.size());
+        m_drop_pending = true;
+        return;
+    }
+
+    const uint32_t time_us = static_cast<uint32_t>(esp_timer_get_time() - m_start_us);
+
+    while (!bytes.empty()) {
+        const size_t len = std::min(bytes.size(), MAX_RECORD_BYTES);
+
+        // Records past the size limit are dropped whole, so the file always ends on a record boundary
+        if (m_reserved + RECORD_HEADER_SIZE + len > MAX_FILE_BYTES ||
+            xStreamBufferSpacesAvailable(m_stream) < RECORD_HEADER_SIZE + len) {
+            m_dropped += static_cast<uint32_t>(bytes.size());
+            m_drop_pending = true;
+            break;
+        }
+
+        const uint8_t header[RECORD_HEADER_SIZE] = {
+            static_cast<uint8_t>(time_us),
+            static_cast<uint8_t>(time_us >> 8),
+            static_cast<uint8_t>(time_us >> 16),
+            static_cast<uint8_t>(time_us >> 24),
+            static_cast<uint8_t>(dir),
+            static_cast<uint8_t>(m_drop_pending ? 0x01U : 0x00U),
+            static_cast<uint8_t>(len),
+            static_cast<uint8_t>(len >> 8)
+        };
+
+        (void)xStreamBufferSend(m_stream, header, sizeof(header), 0);
+        (void)xStreamBufferSend(m_stream, bytes.data(), len, 0);
+        m_reserved += RECORD_HEADER_SIZE + len;
+        m_drop_pending = false;
+        bytes = bytes.subspan(len);
+    }
+
+    xSemaphoreGive(m_lock);
+}
+
+void ModemTranscript::writerTaskEntry(void* arg) {
+    static_cast<ModemTranscript*>(arg)->writerLoop();
+}
+
+void ModemTranscript::writerLoop() {
+    uint8_t chunk[256];
+    TickType_t last_flush = xTaskGetTickCount();
+
+    while (true) {
+        const size_t n = xStreamBufferReceive(m_stream, chunk, sizeof(chunk), pdMS_TO_TICKS(100));
+
+        if (n > 0) {
+            m_written += fwrite(chunk, 1, n, m_file);
+        }
+
+        if (n == 0 && m_stopping) {
+            break;
+        }
+
+        if (xTaskGetTickCount() - last_flush >= pdMS_TO_TICKS(FLUSH_INTERVAL_MS)) {
+            fflush(m_file);
+            last_flush = xTaskGetTickCount();
+        }
+    }
+
+    fclose(m_file);
+    m_file = nullptr;
+    xSemaphoreGive(m_stopped);
+    vTaskDelete(nullptr);
+}
+
+ModemTranscript g_modem_transcript;
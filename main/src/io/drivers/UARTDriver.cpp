@@ -1,6 +1,22 @@
 #include "UARTDriver.hpp"
+#include "ModemTranscript.hpp"
 #include <string.h>
 #include <stdarg.h>
+#include <stdio.h>
+#include <algorithm>
+#include <memory>
+#include "freertos/task.h"
+
+static TickType_t ticksUntil(TickType_t deadline) {
+    // portMAX_DELAY is "forever", not a tick count that may already have passed
+    if (deadline == portMAX_DELAY) {
+        return portMAX_DELAY;
+    }
+
+    // Signed difference, so a deadline just past the tick counter wrap is still in the future
+    const TickType_t now = xTaskGetTickCount();
+    return (static_cast<int32_t>(deadline - now) > 0) ? (deadline - now) : 0;
+}
 
 
 UARTDriver::UARTDriver(uart_port_t uart_num) 
@@ -24,11 +40,30 @@ void UARTDriver::init(int baud, int tx_pin, int rx_pin,
     uart_driver_install(m_uart_num, rx_buffer_size, tx_buffer_size, 0, NULL, 0);
 }
 
+void UARTDriver::trace(bool rx, const void* data, int len) {
+    if (m_transcript == nullptr || len <= 0) {
+        return;
+    }
+
+    m_transcript->record(rx ? ModemTranscript::Direction::Rx : ModemTranscript::Direction::Tx,
+                         {static_cast<const uint8_t*>(data), static_cast<size_t>(len)});
+}
+
 void UARTDriver::write(const char* text) {
+    trace(false, text, static_cast<int>(strlen(text)));
     uart_write_bytes(m_uart_num, text, strlen(text));
 }
 
+int UARTDriver::write(std::span<const uint8_t> data) {
+    if (data.empty()) {
+        return 0;
+    }
+    trace(false, data.data(), static_cast<int>(data.size()));
+    return uart_write_bytes(m_uart_num, data.data(), data.size());
+}
+
 int UARTDriver::writeByte(uint8_t byte) {
+    trace(false, &byte, 1);
     return uart_write_bytes(m_uart_num, &byte, 1);
 }
 
@@ -36,16 +71,215 @@ void UARTDriver::writef(const char* fmt, ...) {
     char buf[256];
     va_list ap;
     va_start(ap, fmt);
-    vsnprintf(buf, sizeof(buf), fmt, ap);
+    const int len = vsnprintf(buf, sizeof(buf), fmt, ap);
+    va_end(ap);
+
+    if (len <= 0) {
+        return;
+    }
+
+    if (static_cast<size_t>(len) < sizeof(buf)) {
+        trace(false, buf, len);
+        uart_write_bytes(m_uart_num, buf, len);
+        return;
+    }
+
+    // Longer than the stack buffer: format again into a heap buffer rather than truncating
+    std::unique_ptr<char[]> big(new (std::nothrow) char[len + 1]);
+    if (!big) {
+        printf("UART writef: %d bytes dropped (out of memory)\n", len);
+        return;
+    }
+
+    va_start(ap, fmt);
+    vsnprintf(big.get(), len + 1, fmt, ap);
     va_end(ap);
-    write(buf);
+    trace(false, big.get(), len);
+    uart_write_bytes(m_uart_num, big.get(), len);
 }
 
 int UARTDriver::readByte(uint8_t &out) {
-    int len = uart_read_bytes(m_uart_num, &out, 1, pdMS_TO_TICKS(50)); // 0 ticks => immediate return
-    return (len > 0) ? 1 : 0;
+    if (m_stage_len == 0 && !fill(xTaskGetTickCount() + pdMS_TO_TICKS(50))) {
+        return 0;
+    }
+    return static_cast<int>(takeStaged({&out, 1}));
+}
+
+size_t UARTDriver::takeStaged(std::span<uint8_t> out) {
+    const size_t n = std::min(out.size(), m_stage_len);
+    memcpy(out.data(), m_stage + m_stage_pos, n);
+    m_stage_pos += n;
+    m_stage_len -= n;
+    if (m_stage_len == 0) {
+        m_stage_pos = 0;
+    }
+    return n;
 }
 
+bool UARTDriver::fill(TickType_t deadline) {
+    if (m_stage_pos > 0) {
+        memmove(m_stage, m_stage + m_stage_pos, m_stage_len);
+        m_stage_pos = 0;
+    }
+
+    const size_t space = STAGE_SIZE - m_stage_len;
+    if (space == 0) {
+        return false;
+    }
+
+    uint8_t* dst = m_stage + m_stage_len;
+    size_t want = 0;
+
+    if (m_pattern_enabled) {
+        // Position is relative to the driver's read point and tracks our reads
+        const int pos = uart_pattern_get_pos(m_uart_num);
+        if (pos >= 0) {
+            want = static_cast<size_t>(pos) + 1;
+        }
+    }
+
+    if (want == 0) {
+        size_t buffered = 0;
+        if (uart_get_buffered_data_len(m_uart_num, &buffered) == ESP_OK) {
+            want = buffered;
+        }
+    }
+
+    int got = 0;
+    if (want > 0) {
+        got = uart_read_bytes(m_uart_num, dst, static_cast<uint32_t>(std::min(want, space)), 0);
+    } else {
+        // Nothing buffered: block in the driver for the first byte
+        got = uart_read_bytes(m_uart_num, dst, 1, ticksUntil(deadline));
+    }
+
+    if (got <= 0) {
+        return false;
+    }
+
+    trace(true, dst, got);
+    m_stage_len += static_cast<size_t>(got);
+    return true;
+}
+
+size_t UARTDriver::read(std::span<uint8_t> out, TickType_t deadline) {
+    size_t total = takeStaged(out);
+
+    while (total < out.size()) {
+        const int got = uart_read_bytes(m_uart_num, out.data() + total, static_cast<uint32_t>(out.size() - total), ticksUntil(deadline));
+        if (got <= 0) {
+            break;
+        }
+        trace(true, out.data() + total, got);
+        total += static_cast<size_t>(got);
+    }
+
+    return total;
+}
+
+size_t UARTDriver::readSome(std::span<uint8_t> out, TickType_t deadline) {
+    if (out.empty()) {
+        return 0;
+    }
+
+    if (m_stage_len > 0) {
+        return takeStaged(out);
+    }
+
+    const int first = uart_read_bytes(m_uart_num, out.data(), 1, ticksUntil(deadline));
+    if (first <= 0) {
+        return 0;
+    }
+
+    size_t buffered = 0;
+    int rest = 0;
+    if (out.size() > 1 && uart_get_buffered_data_len(m_uart_num, &buffered) == ESP_OK && buffered > 0) {
+        rest = std::max(0, uart_read_bytes(m_uart_num, out.data() + 1, static_cast<uint32_t>(std::min(buffered, out.size() - 1)), 0));
+    }
+
+    trace(true, out.data(), 1 + rest);
+    return 1 + static_cast<size_t>(rest);
+}
+
+int UARTDriver::readUntil(char delim, std::span<char> out, TickType_t deadline) {
+    if (out.empty()) {
+        return -1;
+    }
+
+    size_t scanned = 0;
+    bool discarding = false;
+
+    while (true) {
+        const uint8_t* staged = m_stage + m_stage_pos;
+        const void* hit = memchr(staged + scanned, static_cast<unsigned char>(delim), m_stage_len - scanned);
+
+        if (hit != nullptr) {
+            const size_t line_len = static_cast<size_t>(static_cast<const uint8_t*>(hit) - staged);
+
+            if (discarding || line_len >= out.size()) {
+                // Tail of an overlong line: drop it and carry on with the next line
+                m_stage_pos += line_len + 1;
+                m_stage_len -= line_len + 1;
+                scanned = 0;
+                discarding = false;
+                continue;
+            }
+
+            memcpy(out.data(), staged, line_len);
+            out[line_len] = '\0';
+            m_stage_pos += line_len + 1;
+            m_stage_len -= line_len + 1;
+            if (m_stage_len == 0) {
+                m_stage_pos = 0;
+            }
+            return static_cast<int>(line_len);
+        }
+
+        if (m_stage_len == STAGE_SIZE) {
+            // No delimiter in a full staging buffer: the line cannot be returned
+            m_stage_pos = 0;
+            m_stage_len = 0;
+            discarding = true;
+        }
+
+        scanned = m_stage_len;
+        if (!fill(deadline)) {
+            return -1;
+        }
+    }
+}
+
+int UARTDriver::peek(TickType_t deadline) {
+    if (m_stage_len == 0 && !fill(deadline)) {
+        return -1;
+    }
+    return m_stage[m_stage_pos];
+}
+
+size_t UARTDriver::available() {
+    size_t buffered = 0;
+    if (uart_get_buffered_data_len(m_uart_num, &buffered) != ESP_OK) {
+        buffered = 0;
+    }
+    return m_stage_len + buffered;
+}
+
+bool UARTDriver::enablePatternDetect(char pattern, int queue_len) {
+    // Same gap settings as the IDF NMEA example: no idle time required around the terminator
+    if (uart_enable_pattern_det_baud_intr(m_uart_num, pattern, 1, 9, 0, 0) != ESP_OK) {
+        printf("UART%d: pattern detection unavailable\n", static_cast<int>(m_uart_num));
+        return false;
+    }
+
+    if (uart_pattern_queue_reset(m_uart_num, queue_len) != ESP_OK) {
+        uart_disable_pattern_det_intr(m_uart_num);
+        printf("UART%d: pattern queue allocation failed\n", static_cast<int>(m_uart_num));
+        return false;
+    }
+
+    m_pattern_enabled = true;
+    return true;
+}
 
 UARTDriver m_modem_uart(UART_NUM_1);
 UARTDriver rs485_uart(UART_NUM_2);
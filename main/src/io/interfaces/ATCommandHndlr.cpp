@@ -1,5 +1,9 @@
 #include "ATCommandHndlr.hpp"
+#include "AtResponse.hpp"
+#include "ModemReader.hpp"
 #include "UARTDriver.hpp"
+#include <algorithm>
+#include <cstring>
 // #include "Logger.hpp"
 
 extern "C" {
@@ -8,6 +12,7 @@ extern "C" {
 }
 
 SemaphoreHandle_t ATCommandHndlr::s_cmd_mutex = nullptr;
+int ATCommandHndlr::s_lock_depth = 0;
 
 static void sanitizePrintable(const char* src, char* dst, size_t dst_len)
 {
@@ -45,6 +50,25 @@ static void printSanitizedMsg(const char* prefix, const char* line)
     printf("%s%s\n", (prefix != nullptr) ? prefix : "", sanitized);
 }
 
+/**
+ * @brief Waits for the next line of the active command from the modem reader.
+ * Lines longer than the buffer are truncated; a data prompt arrives as ">".
+ * @return Line length, or -1 if no line arrived before the deadline
+ */
+static int readModemLine(char* buf, size_t len, TickType_t deadline)
+{
+    ModemLine_t line;
+    if (!g_modem_reader.nextLine(line, deadline))
+    {
+        return -1;
+    }
+
+    const size_t n = std::min<size_t>(line.len, len - 1);
+    memcpy(buf, line.text, n);
+    buf[n] = '\0';
+    return static_cast<int>(n);
+}
+
 static bool parseSocketIdFromSendCmd(const char* cmd, int* out_socket_id)
 {
     if (out_socket_id == nullptr || cmd == nullptr)
@@ -63,17 +87,17 @@ static bool parseSocketIdFromSendCmd(const char* cmd, int* out_socket_id)
     return false;
 }
 
-static bool parseClosedSocketUrc(const char* line, int* out_socket_id)
+static bool parseClosedSocketUrc(const AtResponse& resp, int* out_socket_id)
 {
-    if (line == nullptr || out_socket_id == nullptr)
+    if (out_socket_id == nullptr)
     {
         return false;
     }
 
-    int socket_id = -1;
-    if (sscanf(line, "+QIURC: \"closed\",%d", &socket_id) == 1)
+    int32_t socket_id = -1;
+    if (resp.is(AtResult::QiUrc) && resp.textField(0) == "closed" && resp.intField(1, socket_id))
     {
-        *out_socket_id = socket_id;
+        *out_socket_id = static_cast<int>(socket_id);
         return true;
     }
 
@@ -99,21 +123,37 @@ bool ATCommandHndlr::lockCmd() {
         return false;
     }
 
+    if (!g_modem_reader.running()) {
+        printf("Modem reader not running\n");
+        return false;
+    }
+
     if (xSemaphoreTakeRecursive(s_cmd_mutex, pdMS_TO_TICKS(15000)) != pdTRUE) {
         printf("Timeout waiting for AT command mutex\n");
         return false;
     }
 
+    if (s_lock_depth++ == 0) {
+        g_modem_reader.beginCommand();
+    }
+
     return true;
 }
 
 void ATCommandHndlr::unlockCmd() {
     if (s_cmd_mutex != nullptr) {
+        if (--s_lock_depth == 0) {
+            g_modem_reader.endCommand();
+        }
         (void)xSemaphoreGiveRecursive(s_cmd_mutex);
     }
 }
 
 bool ATCommandHndlr::send(const ATCommand_t& atCmd) {
+    return sendCommand(atCmd, {});
+}
+
+bool ATCommandHndlr::sendCommand(const ATCommand_t& atCmd, std::span<const uint8_t> payload_tail) {
     if (!lockCmd()) {
         return false;
     }
@@ -136,56 +176,38 @@ bool ATCommandHndlr::send(const ATCommand_t& atCmd) {
         auto waitForPayloadReady = [this, send_socket_id](const char* expect, int timeout_ms) -> bool {
             const TickType_t deadline = xTaskGetTickCount() + pdMS_TO_TICKS(timeout_ms);
             char line_buf[128] = {0};
-            size_t line_len = 0;
 
             while (xTaskGetTickCount() < deadline) {
-                uint8_t c = 0;
-                if (!m_modem_uart.readByte(c)) {
-                    vTaskDelay(pdMS_TO_TICKS(1));
+                const int line_len = readModemLine(line_buf, sizeof(line_buf), deadline);
+                if (line_len <= 0) {
                     continue;
                 }
 
-                if (c == '>') {
+                const AtResponse resp = parseAtResponse({line_buf, static_cast<size_t>(line_len)});
+                if (resp.is(AtResult::Prompt)) {
                     return true;
                 }
 
-                if (c == '\n') {
-                    line_buf[line_len] = '\0';
-                    if (line_len > 0 && line_buf[line_len - 1] == '\r') {
-                        line_buf[--line_len] = '\0';
-                    }
+                printSanitizedRx(line_buf);
 
-                    if (line_len > 0) {
-                        printSanitizedRx(line_buf);
-
-                        if (strcmp(line_buf, "ERROR") == 0 || strstr(line_buf, "+CME ERROR") != nullptr) {
-                            printSanitizedMsg("Payload readiness failed due to modem error: ", line_buf);
-                            return false;
-                        }
-
-                        int closed_socket_id = -1;
-                        if (parseClosedSocketUrc(line_buf, &closed_socket_id)) {
-                            if (send_socket_id >= 0 && closed_socket_id != send_socket_id) {
-                                printSanitizedMsg("Ignoring unrelated socket close URC during prompt wait: ", line_buf);
-                            } else {
-                                printSanitizedMsg("Payload readiness failed due to target socket close: ", line_buf);
-                                return false;
-                            }
-                        }
-
-                        if (expect != nullptr && expect[0] != '\0' && strstr(line_buf, expect) != nullptr) {
-                            return true;
-                        }
-                    }
+                if (resp.isError()) {
+                    printSanitizedMsg("Payload readiness failed due to modem error: ", line_buf);
+                    return false;
+                }
 
-                    line_len = 0;
-                } else if (c != '\r') {
-                    if (line_len < sizeof(line_buf) - 1) {
-                        line_buf[line_len++] = static_cast<char>(c);
+                int closed_socket_id = -1;
+                if (parseClosedSocketUrc(resp, &closed_socket_id)) {
+                    if (send_socket_id >= 0 && closed_socket_id != send_socket_id) {
+                        printSanitizedMsg("Ignoring unrelated socket close URC during prompt wait: ", line_buf);
                     } else {
-                        line_len = 0;
+                        printSanitizedMsg("Payload readiness failed due to target socket close: ", line_buf);
+                        return false;
                     }
                 }
+
+                if (expect != nullptr && expect[0] != '\0' && strstr(line_buf, expect) != nullptr) {
+                    return true;
+                }
             }
 
             return false;
@@ -198,7 +220,7 @@ bool ATCommandHndlr::send(const ATCommand_t& atCmd) {
         }
 
         // Send payload and wait for response
-        const bool success = sendPayloadAndWaitResponse(atCmd.payload, atCmd.payload_len, send_socket_id);
+        const bool success = sendPayloadAndWaitResponse(atCmd.payload, atCmd.payload_len, payload_tail, send_socket_id);
         unlockCmd();
         return success;
     } else {
@@ -207,11 +229,10 @@ bool ATCommandHndlr::send(const ATCommand_t& atCmd) {
         const TickType_t deadline = xTaskGetTickCount() + pdMS_TO_TICKS(atCmd.timeout_ms);
 
         while (xTaskGetTickCount() < deadline) {
-            if (processResponse(state, atCmd)) {
+            if (processResponse(state, atCmd, deadline)) {
                 unlockCmd();
                 return state.success;
             }
-            vTaskDelay(pdMS_TO_TICKS(1));
         }
 
         printf("AT TIMEOUT: %s (after %dms)\n", atCmd.cmd, atCmd.timeout_ms);
@@ -238,47 +259,129 @@ bool ATCommandHndlr::sendAndCapture(const ATCommand_t& atCmd, char* out_buf, siz
     const TickType_t deadline = xTaskGetTickCount() + pdMS_TO_TICKS(atCmd.timeout_ms);
 
     while (xTaskGetTickCount() < deadline) {
-        uint8_t c;
-        if (!m_modem_uart.readByte(c)) {
-            vTaskDelay(pdMS_TO_TICKS(1));
+        const int line_len = readModemLine(state.line_buffer, sizeof(state.line_buffer), deadline);
+        if (line_len <= 0) {
             continue;
         }
 
-        if (c == '\n') {
-            state.line_buffer[state.line_len] = '\0';
-            // strip trailing CR
-            if (state.line_len > 0 && state.line_buffer[state.line_len - 1] == '\r') {
-                state.line_buffer[--state.line_len] = '\0';
-            }
+        printSanitizedRx(state.line_buffer);
 
-            if (state.line_len > 0) {
-                printSanitizedRx(state.line_buffer);
+        // Check for CME or generic ERROR
+        if (parseAtResponse({state.line_buffer, static_cast<size_t>(line_len)}).isError()) {
+            printSanitizedMsg("AT response error (capture): ", state.line_buffer);
+            unlockCmd();
+            return false;
+        }
 
-                // Check for CME or generic ERROR
-                if (strcmp(state.line_buffer, "ERROR") == 0 || strstr(state.line_buffer, "+CME ERROR") != nullptr) {
-                    printSanitizedMsg("AT response error (capture): ", state.line_buffer);
-                    unlockCmd();
-                    return false;
-                }
+        // If the expected substring is present, capture and return success
+        if (strstr(state.line_buffer, atCmd.expect) != nullptr) {
+            // Copy into out_buf
+            strncpy(out_buf, state.line_buffer, out_len - 1);
+            out_buf[out_len - 1] = '\0';
+            unlockCmd();
+            return true;
+        }
+    }
 
-                // If the expected substring is present, capture and return success
-                if (strstr(state.line_buffer, atCmd.expect) != nullptr) {
-                    // Copy into out_buf
-                    strncpy(out_buf, state.line_buffer, out_len - 1);
-                    out_buf[out_len - 1] = '\0';
-                    unlockCmd();
-                    return true;
-                }
-            }
+    printf("AT TIMEOUT (capture): %s (after %dms)\n", atCmd.cmd, atCmd.timeout_ms);
+    unlockCmd();
+    return false;
+}
 
-            state.line_len = 0;
-        } else if (c != '\r') {
-            if (state.line_len < sizeof(state.line_buffer) - 1) {
-                state.line_buffer[state.line_len++] = c;
-            } else {
-                printf("RX buffer overflow in sendAndCapture, discarding line\n");
-                state.line_len = 0;
-            }
+bool ATCommandHndlr::sendAndCaptureInfo(const ATCommand_t& atCmd, char* out_buf, size_t out_len) {
+    if (!lockCmd()) {
+        return false;
+    }
+
+    if (!atCmd.cmd || out_buf == nullptr || out_len == 0) {
+        printf("Invalid parameters to sendAndCaptureInfo\n");
+        unlockCmd();
+        return false;
+    }
+
+    m_modem_uart.writef("%s\r\n", atCmd.cmd);
+
+    ResponseState state = {};
+    bool captured = false;
+    out_buf[0] = '\0';
+
+    const TickType_t deadline = xTaskGetTickCount() + pdMS_TO_TICKS(atCmd.timeout_ms);
+    while (xTaskGetTickCount() < deadline) {
+        const int line_len = readModemLine(state.line_buffer, sizeof(state.line_buffer), deadline);
+        if (line_len <= 0) {
+            continue;
+        }
+
+        printSanitizedRx(state.line_buffer);
+
+        const AtResponse resp = parseAtResponse({state.line_buffer, static_cast<size_t>(line_len)});
+        if (resp.isError()) {
+            printSanitizedMsg("AT response error (capture): ", state.line_buffer);
+            unlockCmd();
+            return false;
+        }
+
+        if (resp.is(AtResult::Ok)) {
+            unlockCmd();
+            return captured;
+        }
+
+        // Skip the echo (if ATE0 has not run yet) and unsolicited responses
+        if (!captured && resp.is(AtResult::Other) && strncmp(state.line_buffer, "AT", 2) != 0 &&
+            state.line_buffer[0] != '+') {
+            strncpy(out_buf, state.line_buffer, out_len - 1);
+            out_buf[out_len - 1] = '\0';
+            captured = true;
+        }
+    }
+
+    printf("AT TIMEOUT (capture): %s (after %dms)\n", atCmd.cmd, atCmd.timeout_ms);
+    unlockCmd();
+    return false;
+}
+
+bool ATCommandHndlr::sendQuery(const ATCommand_t& atCmd, char* out_buf, size_t out_len) {
+    if (!lockCmd()) {
+        return false;
+    }
+
+    if (!atCmd.cmd || !atCmd.expect || out_buf == nullptr || out_len == 0) {
+        printf("Invalid parameters to sendQuery\n");
+        unlockCmd();
+        return false;
+    }
+
+    m_modem_uart.writef("%s\r\n", atCmd.cmd);
+
+    ResponseState state = {};
+    bool captured = false;
+    out_buf[0] = '\0';
+
+    const TickType_t deadline = xTaskGetTickCount() + pdMS_TO_TICKS(atCmd.timeout_ms);
+    while (xTaskGetTickCount() < deadline) {
+        const int line_len = readModemLine(state.line_buffer, sizeof(state.line_buffer), deadline);
+        if (line_len <= 0) {
+            continue;
+        }
+
+        printSanitizedRx(state.line_buffer);
+
+        const AtResponse resp = parseAtResponse({state.line_buffer, static_cast<size_t>(line_len)});
+        if (resp.isError()) {
+            printSanitizedMsg("AT response error (capture): ", state.line_buffer);
+            unlockCmd();
+            return false;
+        }
+
+        if (resp.is(AtResult::Ok)) {
+            unlockCmd();
+            return captured;
+        }
+
+        if (!captured && strstr(state.line_buffer, atCmd.expect) != nullptr) {
+            strncpy(out_buf, state.line_buffer, out_len - 1);
+            out_buf[out_len - 1] = '\0';
+            captured = true;
         }
     }
 
@@ -322,55 +425,35 @@ bool ATCommandHndlr::openIPSocket(const char* protocol,
     m_modem_uart.writef("%s\r\n", cmd);
 
     char line_buf[256] = {0};
-    size_t line_len = 0;
     bool got_qiopen_for_target = false;
     int target_err_code = -1;
 
     const TickType_t deadline = xTaskGetTickCount() + pdMS_TO_TICKS(timeout_ms);
     while (xTaskGetTickCount() < deadline) {
-        uint8_t c = 0;
-        if (!m_modem_uart.readByte(c)) {
-            vTaskDelay(pdMS_TO_TICKS(1));
+        const int line_len = readModemLine(line_buf, sizeof(line_buf), deadline);
+        if (line_len <= 0) {
             continue;
         }
 
-        if (c == '\n') {
-            line_buf[line_len] = '\0';
-            if (line_len > 0 && line_buf[line_len - 1] == '\r') {
-                line_buf[--line_len] = '\0';
-            }
-
-            if (line_len > 0) {
-                printSanitizedRx(line_buf);
+        printSanitizedRx(line_buf);
 
-                if (strcmp(line_buf, "ERROR") == 0 || strstr(line_buf, "+CME ERROR") != nullptr) {
-                    printSanitizedMsg("AT response error while opening socket: ", line_buf);
-                    unlockCmd();
-                    return false;
-                }
+        const AtResponse resp = parseAtResponse({line_buf, static_cast<size_t>(line_len)});
+        if (resp.isError()) {
+            printSanitizedMsg("AT response error while opening socket: ", line_buf);
+            unlockCmd();
+            return false;
+        }
 
-                if (strncmp(line_buf, "+QIOPEN:", 8) == 0) {
-                    int resp_connect_id = -1;
-                    int err_code = -1;
-                    if (sscanf(line_buf, "+QIOPEN: %d,%d", &resp_connect_id, &err_code) == 2) {
-                        if (resp_connect_id == static_cast<int>(connect_id)) {
-                            got_qiopen_for_target = true;
-                            target_err_code = err_code;
-                            break;
-                        }
-
-                        printf("Ignoring QIOPEN for other socket id: %d\n", resp_connect_id);
-                    }
-                }
+        int32_t resp_connect_id = -1;
+        int32_t err_code = -1;
+        if (resp.is(AtResult::QiOpen) && resp.intField(0, resp_connect_id) && resp.intField(1, err_code)) {
+            if (resp_connect_id == static_cast<int32_t>(connect_id)) {
+                got_qiopen_for_target = true;
+                target_err_code = err_code;
+                break;
             }
 
-            line_len = 0;
-        } else if (c != '\r') {
-            if (line_len < sizeof(line_buf) - 1) {
-                line_buf[line_len++] = static_cast<char>(c);
-            } else {
-                line_len = 0;
-            }
+            printf("Ignoring QIOPEN for other socket id: %d\n", static_cast<int>(resp_connect_id));
         }
     }
 
@@ -404,12 +487,18 @@ bool ATCommandHndlr::openSSLSocket(const char* host,
                                    uint16_t port,
                                    uint8_t ssl_context_id,
                                    uint8_t connect_id,
-                                   int timeout_ms) {
+                                   int timeout_ms,
+                                   SslOpenProfile_t* profile) {
     if (host == nullptr || host[0] == '\0' || port == 0) {
         printf("Invalid parameters to openSSLSocket\n");
         return false;
     }
 
+    SslOpenProfile_t known = {};
+    if (profile != nullptr) {
+        known = *profile;
+    }
+
     char cfg_cmd[96] = {0};
     ATCommand_t cfg = {
         cfg_cmd,
@@ -439,158 +528,185 @@ bool ATCommandHndlr::openSSLSocket(const char* host,
     }
 
     // Bind SSL context to PDP context 1 for modems that require explicit context mapping.
-    snprintf(cfg_cmd, sizeof(cfg_cmd), "AT+QSSLCFG=\"contextid\",%u,1", static_cast<unsigned>(ssl_context_id));
-    if (!send(cfg)) {
-        // Not all Quectel firmware builds support this key; continue without it.
-        printf("QSSLCFG contextid unsupported/failed, continuing without explicit context binding\n");
-    }
-
-    static constexpr size_t kOpenFormatCount = 7;
-    for (size_t fmt_idx = 0; fmt_idx < kOpenFormatCount; ++fmt_idx) {
-        char open_cmd[160] = {0};
-        int written = 0;
-
-        if (fmt_idx == 0) {
-            written = snprintf(open_cmd,
-                               sizeof(open_cmd),
-                               "AT+QSSLOPEN=%u,%u,\"%s\",%u,0",
-                               static_cast<unsigned>(ssl_context_id),
-                               static_cast<unsigned>(connect_id),
-                               host,
-                               static_cast<unsigned>(port));
-        } else if (fmt_idx == 1) {
-            written = snprintf(open_cmd,
-                               sizeof(open_cmd),
-                               "AT+QSSLOPEN=%u,%u,\"%s\",%u",
-                               static_cast<unsigned>(ssl_context_id),
-                               static_cast<unsigned>(connect_id),
-                               host,
-                               static_cast<unsigned>(port));
-        } else if (fmt_idx == 2) {
-            written = snprintf(open_cmd,
-                               sizeof(open_cmd),
-                               "AT+QSSLOPEN=%u,\"%s\",%u,%u",
-                               static_cast<unsigned>(connect_id),
-                               host,
-                               static_cast<unsigned>(port),
-                               static_cast<unsigned>(ssl_context_id));
-        } else if (fmt_idx == 3) {
-            written = snprintf(open_cmd,
-                               sizeof(open_cmd),
-                               "AT+QSSLOPEN=%u,\"%s\",%u,0",
-                               static_cast<unsigned>(ssl_context_id),
-                               host,
-                               static_cast<unsigned>(port));
-        } else if (fmt_idx == 4) {
-            written = snprintf(open_cmd,
-                               sizeof(open_cmd),
-                               "AT+QSSLOPEN=%u,\"%s\",%u",
-                               static_cast<unsigned>(ssl_context_id),
-                               host,
-                               static_cast<unsigned>(port));
-        } else if (fmt_idx == 5) {
-            written = snprintf(open_cmd,
-                               sizeof(open_cmd),
-                               "AT+QSSLOPEN=%u,\"%s\",%u",
-                               static_cast<unsigned>(connect_id),
-                               host,
-                               static_cast<unsigned>(port));
-        } else {
-            written = snprintf(open_cmd,
-                               sizeof(open_cmd),
-                               "AT+QSSLOPEN=\"%s\",%u",
-                               host,
-                               static_cast<unsigned>(port));
+    if (!known.contextid_unsupported) {
+        snprintf(cfg_cmd, sizeof(cfg_cmd), "AT+QSSLCFG=\"contextid\",%u,1", static_cast<unsigned>(ssl_context_id));
+        if (!send(cfg)) {
+            // Not all Quectel firmware builds support this key; continue without it.
+            printf("QSSLCFG contextid unsupported/failed, continuing without explicit context binding\n");
+            known.contextid_unsupported = true;
         }
+    }
 
-        if (written <= 0 || written >= static_cast<int>(sizeof(open_cmd))) {
+    SslOpenOutcome outcome = SslOpenOutcome::Rejected;
+    uint8_t variant = 0;
+
+    if (known.open_variant >= 1 && known.open_variant <= SSL_OPEN_VARIANTS) {
+        variant = known.open_variant;
+        outcome = openSSLVariant(variant, host, port, ssl_context_id, connect_id, timeout_ms);
+        if (outcome == SslOpenOutcome::Rejected) {
+            printf("Known QSSLOPEN format variant %u rejected, rescanning\n", static_cast<unsigned>(variant));
+        }
+    }
+
+    // Scan when nothing is known or the known form is no longer accepted
+    for (uint8_t next = 1; next <= SSL_OPEN_VARIANTS && outcome == SslOpenOutcome::Rejected; ++next) {
+        if (next == known.open_variant) {
             continue;
         }
 
-        if (!lockCmd()) {
-            return false;
+        variant = next;
+        outcome = openSSLVariant(variant, host, port, ssl_context_id, connect_id, timeout_ms);
+        if (outcome == SslOpenOutcome::Rejected) {
+            printf("QSSLOPEN format variant %u rejected, trying next\n", static_cast<unsigned>(variant));
+        } else if (outcome == SslOpenOutcome::Timeout) {
+            printf("QSSLOPEN timeout with format variant %u, trying next\n", static_cast<unsigned>(variant));
+            outcome = SslOpenOutcome::Rejected;
         }
+    }
 
-        m_modem_uart.writef("%s\r\n", open_cmd);
+    // A variant that got a +QSSLOPEN answer is the right syntax even if the connection failed
+    if (outcome == SslOpenOutcome::Opened || outcome == SslOpenOutcome::Failed) {
+        known.open_variant = variant;
+    } else {
+        known.open_variant = 0;
+    }
 
-        char line_buf[256] = {0};
-        size_t line_len = 0;
-        bool got_open_result = false;
-        bool syntax_error = false;
-        int target_err_code = -1;
+    if (profile != nullptr) {
+        *profile = known;
+    }
 
-        const TickType_t deadline = xTaskGetTickCount() + pdMS_TO_TICKS(timeout_ms);
-        while (xTaskGetTickCount() < deadline) {
-            uint8_t c = 0;
-            if (!m_modem_uart.readByte(c)) {
-                vTaskDelay(pdMS_TO_TICKS(1));
-                continue;
-            }
+    if (outcome == SslOpenOutcome::Opened) {
+        printf("SSL socket opened successfully (id=%u, variant %u)\n",
+               static_cast<unsigned>(connect_id),
+               static_cast<unsigned>(variant));
+        return true;
+    }
 
-            if (c == '\n') {
-                line_buf[line_len] = '\0';
-                if (line_len > 0 && line_buf[line_len - 1] == '\r') {
-                    line_buf[--line_len] = '\0';
-                }
+    if (outcome == SslOpenOutcome::Timeout) {
+        printf("QSSLOPEN timeout with format variant %u\n", static_cast<unsigned>(variant));
+    } else if (outcome == SslOpenOutcome::Rejected) {
+        printf("AT response error while opening SSL socket: all QSSLOPEN variants failed\n");
+    }
 
-                if (line_len > 0) {
-                    printSanitizedRx(line_buf);
+    return false;
+}
 
-                    if (strcmp(line_buf, "ERROR") == 0 || strstr(line_buf, "+CME ERROR") != nullptr) {
-                        syntax_error = true;
-                        break;
-                    }
+ATCommandHndlr::SslOpenOutcome ATCommandHndlr::openSSLVariant(uint8_t variant,
+                                                              const char* host,
+                                                              uint16_t port,
+                                                              uint8_t ssl_context_id,
+                                                              uint8_t connect_id,
+                                                              int timeout_ms) {
+    char open_cmd[160] = {0};
+    int written = 0;
+
+    if (variant == 1) {
+        written = snprintf(open_cmd,
+                           sizeof(open_cmd),
+                           "AT+QSSLOPEN=%u,%u,\"%s\",%u,0",
+                           static_cast<unsigned>(ssl_context_id),
+                           static_cast<unsigned>(connect_id),
+                           host,
+                           static_cast<unsigned>(port));
+    } else if (variant == 2) {
+        written = snprintf(open_cmd,
+                           sizeof(open_cmd),
+                           "AT+QSSLOPEN=%u,%u,\"%s\",%u",
+                           static_cast<unsigned>(ssl_context_id),
+                           static_cast<unsigned>(connect_id),
+                           host,
+                           static_cast<unsigned>(port));
+    } else if (variant == 3) {
+        written = snprintf(open_cmd,
+                           sizeof(open_cmd),
+                           "AT+QSSLOPEN=%u,\"%s\",%u,%u",
+                           static_cast<unsigned>(connect_id),
+                           host,
+                           static_cast<unsigned>(port),
+                           static_cast<unsigned>(ssl_context_id));
+    } else if (variant == 4) {
+        written = snprintf(open_cmd,
+                           sizeof(open_cmd),
+                           "AT+QSSLOPEN=%u,\"%s\",%u,0",
+                           static_cast<unsigned>(ssl_context_id),
+                           host,
+                           static_cast<unsigned>(port));
+    } else if (variant == 5) {
+        written = snprintf(open_cmd,
+                           sizeof(open_cmd),
+                           "AT+QSSLOPEN=%u,\"%s\",%u",
+                           static_cast<unsigned>(ssl_context_id),
+                           host,
+                           static_cast<unsigned>(port));
+    } else if (variant == 6) {
+        written = snprintf(open_cmd,
+                           sizeof(open_cmd),
+                           "AT+QSSLOPEN=%u,\"%s\",%u",
+                           static_cast<unsigned>(connect_id),
+                           host,
+                           static_cast<unsigned>(port));
+    } else {
+        written = snprintf(open_cmd,
+                           sizeof(open_cmd),
+                           "AT+QSSLOPEN=\"%s\",%u",
+                           host,
+                           static_cast<unsigned>(port));
+    }
 
-                    if (strncmp(line_buf, "+QSSLOPEN:", 10) == 0) {
-                        int resp_connect_id = -1;
-                        int err_code = -1;
-                        if (sscanf(line_buf, "+QSSLOPEN: %d,%d", &resp_connect_id, &err_code) == 2) {
-                            if (resp_connect_id == static_cast<int>(connect_id)) {
-                                got_open_result = true;
-                                target_err_code = err_code;
-                                break;
-                            }
-                        } else if (sscanf(line_buf, "+QSSLOPEN: %d", &err_code) == 1) {
-                            // Some modem variants return only an error code.
-                            got_open_result = true;
-                            target_err_code = err_code;
-                            break;
-                        }
-                    }
-                }
+    if (written <= 0 || written >= static_cast<int>(sizeof(open_cmd))) {
+        return SslOpenOutcome::Rejected;
+    }
 
-                line_len = 0;
-            } else if (c != '\r') {
-                if (line_len < sizeof(line_buf) - 1) {
-                    line_buf[line_len++] = static_cast<char>(c);
-                } else {
-                    line_len = 0;
-                }
-            }
+    if (!lockCmd()) {
+        return SslOpenOutcome::Timeout;
+    }
+
+    m_modem_uart.writef("%s\r\n", open_cmd);
+
+    char line_buf[256] = {0};
+    SslOpenOutcome outcome = SslOpenOutcome::Timeout;
+
+    const TickType_t deadline = xTaskGetTickCount() + pdMS_TO_TICKS(timeout_ms);
+    while (xTaskGetTickCount() < deadline) {
+        const int line_len = readModemLine(line_buf, sizeof(line_buf), deadline);
+        if (line_len <= 0) {
+            continue;
         }
 
-        unlockCmd();
+        printSanitizedRx(line_buf);
 
-        if (got_open_result) {
-            if (target_err_code != 0) {
-                printf("QSSLOPEN failed with modem error code: %d\n", target_err_code);
-                return false;
-            }
+        const AtResponse resp = parseAtResponse({line_buf, static_cast<size_t>(line_len)});
+        if (resp.isError()) {
+            outcome = SslOpenOutcome::Rejected;
+            break;
+        }
 
-            printf("SSL socket opened successfully (id=%u)\n", static_cast<unsigned>(connect_id));
-            return true;
+        if (!resp.is(AtResult::QsslOpen)) {
+            continue;
         }
 
-        if (syntax_error) {
-            printf("QSSLOPEN format variant %u rejected, trying next\n", static_cast<unsigned>(fmt_idx + 1));
+        int32_t resp_connect_id = -1;
+        int32_t err_code = -1;
+        if (resp.intField(0, resp_connect_id) && resp.intField(1, err_code)) {
+            if (resp_connect_id != static_cast<int32_t>(connect_id)) {
+                continue;
+            }
+        } else if (!resp.intField(0, err_code)) {
+            // Some modem variants return only an error code.
             continue;
         }
 
-        printf("QSSLOPEN timeout with format variant %u\n", static_cast<unsigned>(fmt_idx + 1));
+        if (err_code != 0) {
+            printf("QSSLOPEN failed with modem error code: %d\n", static_cast<int>(err_code));
+            outcome = SslOpenOutcome::Failed;
+        } else {
+            outcome = SslOpenOutcome::Opened;
+        }
+        break;
     }
 
-    printf("AT response error while opening SSL socket: all QSSLOPEN variants failed\n");
-    return false;
+    unlockCmd();
+    return outcome;
 }
 
 bool ATCommandHndlr::sendSocketData(uint8_t connect_id,
@@ -623,6 +739,36 @@ bool ATCommandHndlr::sendSocketData(uint8_t connect_id,
     return send(send_cmd);
 }
 
+bool ATCommandHndlr::sendSocketData(uint8_t connect_id,
+                                    std::span<const uint8_t> header,
+                                    std::span<const uint8_t> payload,
+                                    int timeout_ms) {
+    if (header.empty()) {
+        return false;
+    }
+
+    char cmd[48] = {0};
+    const int written = snprintf(cmd,
+                                 sizeof(cmd),
+                                 "AT+QISEND=%u,%u",
+                                 static_cast<unsigned>(connect_id),
+                                 static_cast<unsigned>(header.size() + payload.size()));
+    if (written <= 0 || written >= static_cast<int>(sizeof(cmd))) {
+        return false;
+    }
+
+    ATCommand_t send_cmd = {
+        cmd,
+        ">",
+        timeout_ms,
+        MsgType::DATA,
+        header.data(),
+        header.size()
+    };
+
+    return sendCommand(send_cmd, payload);
+}
+
 bool ATCommandHndlr::readSocketData(uint8_t connect_id,
                                     char* out_buf,
                                     size_t out_len,
@@ -652,86 +798,61 @@ bool ATCommandHndlr::readSocketData(uint8_t connect_id,
         return false;
     }
 
+    static constexpr ModemPayloadRule_t qird_payload[] = {{"+QIRD:", -1}};
+    g_modem_reader.expectPayload(qird_payload);
     m_modem_uart.writef("%s\r\n", cmd);
 
     char line_buf[128] = {0};
-    size_t line_len = 0;
-    int expected_data_len = -1;
-    size_t copied = 0;
-    int remaining_data_bytes = 0;
     bool got_ok = false;
 
     const TickType_t deadline = xTaskGetTickCount() + pdMS_TO_TICKS(timeout_ms);
     while (xTaskGetTickCount() < deadline) {
-        uint8_t c = 0;
-        if (!m_modem_uart.readByte(c)) {
-            vTaskDelay(pdMS_TO_TICKS(1));
+        const int line_len = readModemLine(line_buf, sizeof(line_buf), deadline);
+        if (line_len <= 0) {
             continue;
         }
 
-        if (expected_data_len >= 0 && remaining_data_bytes > 0) {
-            if (copied < (out_len - 1)) {
-                out_buf[copied++] = static_cast<char>(c);
-            }
+        const AtResponse resp = parseAtResponse({line_buf, static_cast<size_t>(line_len)});
+        if (resp.is(AtResult::Ok)) {
+            got_ok = true;
+            break;
+        }
 
-            remaining_data_bytes--;
-            if (remaining_data_bytes == 0) {
-                out_buf[copied] = '\0';
-                *out_read = copied;
-            }
-            continue;
+        if (resp.isError()) {
+            unlockCmd();
+            return false;
         }
 
-        if (c == '\n') {
-            line_buf[line_len] = '\0';
-            if (line_len > 0 && line_buf[line_len - 1] == '\r') {
-                line_buf[--line_len] = '\0';
+        if (resp.is(AtResult::QiUrc) && resp.textField(0) == "closed") {
+            int closed_id = -1;
+            if (!parseClosedSocketUrc(resp, &closed_id) || closed_id == static_cast<int>(connect_id)) {
+                unlockCmd();
+                return false;
             }
+        }
 
-            if (line_len > 0) {
-                if (strcmp(line_buf, "OK") == 0) {
-                    got_ok = true;
-                    break;
-                }
-
-                if (strcmp(line_buf, "ERROR") == 0 || strstr(line_buf, "+CME ERROR") != nullptr) {
-                    unlockCmd();
-                    return false;
-                }
-
-                if (strstr(line_buf, "+QIURC: \"closed\"") != nullptr) {
-                    int closed_id = -1;
-                    if (sscanf(line_buf, "+QIURC: \"closed\",%d", &closed_id) == 1) {
-                        if (closed_id == static_cast<int>(connect_id)) {
-                            unlockCmd();
-                            return false;
-                        }
-                    } else {
-                        unlockCmd();
-                        return false;
+        if (resp.is(AtResult::QiRd)) {
+            int32_t parsed_len = -1;
+            if (resp.intField(0, parsed_len) && parsed_len > 0) {
+                // The payload follows the header line as raw bytes; anything past out_buf is drained
+                const size_t data_len = static_cast<size_t>(parsed_len);
+                const size_t copied = g_modem_reader.readPayload({reinterpret_cast<uint8_t*>(out_buf), std::min(data_len, out_len - 1)}, deadline);
+                size_t consumed = copied;
+
+                while (consumed < data_len) {
+                    uint8_t discard[64];
+                    const size_t n = g_modem_reader.readPayload({discard, std::min(sizeof(discard), data_len - consumed)}, deadline);
+                    if (n == 0) {
+                        break;
                     }
+                    consumed += n;
                 }
 
-                if (strncmp(line_buf, "+QIRD:", 6) == 0) {
-                    int parsed_len = -1;
-                    if (sscanf(line_buf, "+QIRD: %d", &parsed_len) == 1) {
-                        if (parsed_len <= 0) {
-                            *out_read = 0;
-                        } else {
-                            expected_data_len = parsed_len;
-                            remaining_data_bytes = parsed_len;
-                        }
-                    }
+                out_buf[copied] = '\0';
+                if (consumed == data_len) {
+                    *out_read = copied;
                 }
             }
-
-            line_len = 0;
-        } else if (c != '\r') {
-            if (line_len < sizeof(line_buf) - 1) {
-                line_buf[line_len++] = static_cast<char>(c);
-            } else {
-                line_len = 0;
-            }
         }
     }
 
@@ -799,111 +920,91 @@ bool ATCommandHndlr::httpGetStream(const std::string& url,
         return false;
     }
 
-    int get_result = -1;
-    int status_code = -1;
-    int content_len = -1;
-    if (sscanf(get_resp, "+QHTTPGET: %d,%d,%d", &get_result, &status_code, &content_len) < 2) {
+    const AtResponse get = parseAtResponse(get_resp);
+    int32_t get_result = -1;
+    int32_t status_code = -1;
+    int32_t content_len = -1;
+    if (!get.is(AtResult::QhttpGet) || !get.intField(0, get_result) || !get.intField(1, status_code)) {
         printf("Unable to parse QHTTPGET response: %s\n", get_resp);
         return false;
     }
+    (void)get.intField(2, content_len);
 
     if (get_result != 0 || (status_code != 200 && status_code != 206)) {
-        printf("QHTTPGET returned result=%d status=%d\n", get_result, status_code);
+        printf("QHTTPGET returned result=%d status=%d\n", static_cast<int>(get_result), static_cast<int>(status_code));
         return false;
     }
 
-    printf("QHTTPGET success: status=%d, content_len=%d\n", status_code, content_len);
+    printf("QHTTPGET success: status=%d, content_len=%d\n", static_cast<int>(status_code), static_cast<int>(content_len));
     printf("Starting QHTTPREAD stream...\n");
 
     if (!lockCmd()) {
         return false;
     }
 
+    // The body follows CONNECT; some firmware announces it with +QHTTPREAD: <len> instead
+    const ModemPayloadRule_t read_payload[] = {{"CONNECT", content_len > 0 ? content_len : 0}, {"+QHTTPREAD:", -1}};
+    g_modem_reader.expectPayload(read_payload);
     m_modem_uart.writef("AT+QHTTPREAD=120\r\n");
 
     char line_buf[128] = {0};
-    size_t line_len = 0;
-    int expected_len = -1;
-    int remaining = 0;
     bool got_ok = false;
-    bool in_connect_data_phase = false;
     uint8_t chunk_buf[512];
-    size_t chunk_len = 0;
     size_t total_streamed = 0;
 
     const TickType_t deadline = xTaskGetTickCount() + pdMS_TO_TICKS(timeout_seconds * 1000);
     while (xTaskGetTickCount() < deadline) {
-        uint8_t c = 0;
-        if (!m_modem_uart.readByte(c)) {
-            vTaskDelay(pdMS_TO_TICKS(1));
+        const int line_len = readModemLine(line_buf, sizeof(line_buf), deadline);
+        if (line_len <= 0) {
             continue;
         }
 
-        if ((expected_len >= 0 || in_connect_data_phase) && remaining > 0) {
-            chunk_buf[chunk_len++] = c;
-            remaining--;
+        const AtResponse resp = parseAtResponse({line_buf, static_cast<size_t>(line_len)});
+        if (resp.isError()) {
+            unlockCmd();
+            return false;
+        }
 
-            if (chunk_len == sizeof(chunk_buf) || remaining == 0) {
-                if (!onChunk(chunk_buf, chunk_len)) {
-                    unlockCmd();
-                    return false;
-                }
-                total_streamed += chunk_len;
-                if ((total_streamed % (32 * 1024)) < chunk_len) {
-                    printf("QHTTPREAD progress: %u bytes\n", static_cast<unsigned>(total_streamed));
-                }
-                chunk_len = 0;
-            }
+        size_t remaining = 0;
 
-            if (remaining == 0 && in_connect_data_phase) {
-                in_connect_data_phase = false;
+        if (resp.is(AtResult::QhttpRead)) {
+            int32_t expected_len = -1;
+            if (resp.intField(0, expected_len) && expected_len >= 0) {
+                remaining = static_cast<size_t>(expected_len);
+                printf("QHTTPREAD payload announced: %d bytes\n", static_cast<int>(expected_len));
             }
-
-            continue;
         }
 
-        if (c == '\n') {
-            line_buf[line_len] = '\0';
-            if (line_len > 0 && line_buf[line_len - 1] == '\r') {
-                line_buf[--line_len] = '\0';
+        if (resp.is(AtResult::Connect)) {
+            if (content_len > 0) {
+                remaining = static_cast<size_t>(content_len);
+                printf("QHTTPREAD CONNECT mode: expecting %d bytes\n", static_cast<int>(content_len));
+            } else {
+                printf("QHTTPREAD CONNECT received without known content length\n");
             }
+        }
 
-            if (line_len > 0) {
-                if (strcmp(line_buf, "ERROR") == 0 || strstr(line_buf, "+CME ERROR") != nullptr) {
-                    unlockCmd();
-                    return false;
-                }
-
-                if (strncmp(line_buf, "+QHTTPREAD:", 11) == 0) {
-                    if (sscanf(line_buf, "+QHTTPREAD: %d", &expected_len) == 1 && expected_len >= 0) {
-                        remaining = expected_len;
-                        printf("QHTTPREAD payload announced: %d bytes\n", expected_len);
-                    }
-                }
+        if (resp.is(AtResult::Ok)) {
+            got_ok = true;
+            break;
+        }
 
-                if (strcmp(line_buf, "CONNECT") == 0) {
-                    if (content_len > 0) {
-                        expected_len = content_len;
-                        remaining = content_len;
-                        in_connect_data_phase = true;
-                        printf("QHTTPREAD CONNECT mode: expecting %d bytes\n", content_len);
-                    } else {
-                        printf("QHTTPREAD CONNECT received without known content length\n");
-                    }
-                }
+        // Announced payload bytes follow the line; stream them in chunk-sized bulk reads
+        while (remaining > 0) {
+            const size_t chunk_len = g_modem_reader.readPayload({chunk_buf, std::min(sizeof(chunk_buf), remaining)}, deadline);
+            if (chunk_len == 0) {
+                break;
+            }
 
-                if (strcmp(line_buf, "OK") == 0) {
-                    got_ok = true;
-                    break;
-                }
+            remaining -= chunk_len;
+            if (!onChunk(chunk_buf, chunk_len)) {
+                unlockCmd();
+                return false;
             }
 
-            line_len = 0;
-        } else if (c != '\r') {
-            if (line_len < sizeof(line_buf) - 1) {
-                line_buf[line_len++] = static_cast<char>(c);
-            } else {
-                line_len = 0;
+            total_streamed += chunk_len;
+            if ((total_streamed % (32 * 1024)) < chunk_len) {
+                printf("QHTTPREAD progress: %u bytes\n", static_cast<unsigned>(total_streamed));
             }
         }
     }
@@ -928,54 +1029,40 @@ bool ATCommandHndlr::httpGetStream(const std::string& url,
 bool ATCommandHndlr::waitForPrompt(int timeout_ms) {
     const TickType_t deadline = xTaskGetTickCount() + pdMS_TO_TICKS(timeout_ms);
     char line_buf[128] = {0};
-    size_t line_len = 0;
     
     while (xTaskGetTickCount() < deadline) {
-        uint8_t c;
-        if (m_modem_uart.readByte(c)) {
-            if (c == '>') {
-                printf("Got '>' prompt\n");
-                return true;
-            }
-
-            if (c == '\n') {
-                line_buf[line_len] = '\0';
-                if (line_len > 0 && line_buf[line_len - 1] == '\r') {
-                    line_buf[--line_len] = '\0';
-                }
+        const int line_len = readModemLine(line_buf, sizeof(line_buf), deadline);
+        if (line_len <= 0) {
+            continue;
+        }
 
-                if (line_len > 0) {
-                    if (strcmp(line_buf, "ERROR") == 0 || strstr(line_buf, "+CME ERROR") != nullptr) {
-                        printSanitizedMsg("Prompt wait failed due to modem error: ", line_buf);
-                        return false;
-                    }
+        const AtResponse resp = parseAtResponse({line_buf, static_cast<size_t>(line_len)});
+        if (resp.is(AtResult::Prompt)) {
+            printf("Got '>' prompt\n");
+            return true;
+        }
 
-                    if (strstr(line_buf, "+QIURC: \"closed\"") != nullptr) {
-                        printSanitizedMsg("Prompt wait saw socket close URC, continuing: ", line_buf);
-                    }
-                }
+        if (resp.isError()) {
+            printSanitizedMsg("Prompt wait failed due to modem error: ", line_buf);
+            return false;
+        }
 
-                line_len = 0;
-            } else if (c != '\r') {
-                if (line_len < sizeof(line_buf) - 1) {
-                    line_buf[line_len++] = static_cast<char>(c);
-                } else {
-                    line_len = 0;
-                }
-            }
+        if (resp.is(AtResult::QiUrc) && resp.textField(0) == "closed") {
+            printSanitizedMsg("Prompt wait saw socket close URC, continuing: ", line_buf);
         }
-        vTaskDelay(pdMS_TO_TICKS(1));
     }
     
     return false;
 }
-bool ATCommandHndlr::sendPayloadAndWaitResponse(const uint8_t* payload, size_t payload_len, int target_socket_id) {
+bool ATCommandHndlr::sendPayloadAndWaitResponse(const uint8_t* payload,
+                                                size_t payload_len,
+                                                std::span<const uint8_t> payload_tail,
+                                                int target_socket_id) {
     // Send binary payload
-    for (size_t i = 0; i < payload_len; i++) {
-        m_modem_uart.writeByte(payload[i]);
-    }
+    m_modem_uart.write({payload, payload_len});
+    m_modem_uart.write(payload_tail);
     
-    printf("Sent %zu bytes of payload\n", payload_len);
+    printf("Sent %zu bytes of payload\n", payload_len + payload_tail.size());
     
     // Small delay to ensure data is transmitted
     vTaskDelay(pdMS_TO_TICKS(100));
@@ -985,76 +1072,58 @@ bool ATCommandHndlr::sendPayloadAndWaitResponse(const uint8_t* payload, size_t p
     const TickType_t deadline = xTaskGetTickCount() + pdMS_TO_TICKS(10000);
 
     while (xTaskGetTickCount() < deadline) {
-        uint8_t c;
-        
-        if (!m_modem_uart.readByte(c)) {
-            vTaskDelay(pdMS_TO_TICKS(1));
+        const int line_len = readModemLine(state.line_buffer, sizeof(state.line_buffer), deadline);
+        if (line_len <= 0) {
             continue;
         }
 
-        // Handle line termination
-        if (c == '\n') {
-            state.line_buffer[state.line_len] = '\0';
-            if (state.line_len > 0 && state.line_buffer[state.line_len - 1] == '\r') {
-                state.line_buffer[--state.line_len] = '\0';
-            }
+        printSanitizedRx(state.line_buffer);
 
-            if (state.line_len > 0) {
-                printSanitizedRx(state.line_buffer);
+        const AtResponse resp = parseAtResponse({state.line_buffer, static_cast<size_t>(line_len)});
 
-                // Check for SEND OK (UDP/TCP socket send confirmation)
-                if (strcmp(state.line_buffer, "SEND OK") == 0) {
-                    printf("Payload sent successfully\n");
-                    return true;
-                }
-
-                // Check for +QCOAPSEND response (CoAP-specific)
-                if (strstr(state.line_buffer, "+QCOAPSEND:") != nullptr) {
-                    // Check for success response codes (65 = 2.01 Created, 69 = 2.05 Content)
-                    if (strstr(state.line_buffer, ",65") != nullptr || 
-                        strstr(state.line_buffer, ",69") != nullptr) {
-                        printf("CoAP server acknowledged packet\n");
-                    }
-                }
+        // Check for SEND OK (UDP/TCP socket send confirmation)
+        if (resp.is(AtResult::SendOk)) {
+            printf("Payload sent successfully\n");
+            return true;
+        }
 
-                // Check for OK (generic success)
-                if (strcmp(state.line_buffer, "OK") == 0) {
-                    printf("Payload send confirmed with OK\n");
-                    return true;
+        // Check for +QCOAPSEND response (CoAP-specific)
+        if (resp.is(AtResult::QcoapSend)) {
+            // Check for success response codes (65 = 2.01 Created, 69 = 2.05 Content)
+            for (size_t i = 1; i < resp.field_count; ++i) {
+                if (resp.fields[i].numeric && (resp.fields[i].value == 65 || resp.fields[i].value == 69)) {
+                    printf("CoAP server acknowledged packet\n");
+                    break;
                 }
+            }
+        }
 
-                // Check for SEND FAIL
-                if (strcmp(state.line_buffer, "SEND FAIL") == 0) {
-                    printf("Payload send failed\n");
-                    return false;
-                }
+        // Check for OK (generic success)
+        if (resp.is(AtResult::Ok)) {
+            printf("Payload send confirmed with OK\n");
+            return true;
+        }
 
-                // Check for ERROR
-                if (strcmp(state.line_buffer, "ERROR") == 0) {
-                    printf("Payload send error\n");
-                    return false;
-                }
+        // Check for SEND FAIL
+        if (resp.is(AtResult::SendFail)) {
+            printf("Payload send failed\n");
+            return false;
+        }
 
-                // Check for +QIURC: "closed",<id>
-                int closed_socket_id = -1;
-                if (parseClosedSocketUrc(state.line_buffer, &closed_socket_id)) {
-                    if (target_socket_id >= 0 && closed_socket_id != target_socket_id) {
-                        printSanitizedMsg("Ignoring unrelated socket close URC during payload confirmation: ", state.line_buffer);
-                    } else {
-                        printf("Target socket closed during send (id=%d)\n", closed_socket_id);
-                        return false;
-                    }
-                }
-            }
+        // Check for ERROR
+        if (resp.is(AtResult::Error)) {
+            printf("Payload send error\n");
+            return false;
+        }
 
-            state.line_len = 0;
-        } 
-        else if (c != '\r') {
-            if (state.line_len < sizeof(state.line_buffer) - 1) {
-                state.line_buffer[state.line_len++] = c;
+        // Check for +QIURC: "closed",<id>
+        int closed_socket_id = -1;
+        if (parseClosedSocketUrc(resp, &closed_socket_id)) {
+            if (target_socket_id >= 0 && closed_socket_id != target_socket_id) {
+                printSanitizedMsg("Ignoring unrelated socket close URC during payload confirmation: ", state.line_buffer);
             } else {
-                printf("RX buffer overflow\n");
-                state.line_len = 0;
+                printf("Target socket closed during send (id=%d)\n", closed_socket_id);
+                return false;
             }
         }
     }
@@ -1063,30 +1132,14 @@ bool ATCommandHndlr::sendPayloadAndWaitResponse(const uint8_t* payload, size_t p
     return false;
 }
 
-bool ATCommandHndlr::processResponse(ResponseState& state, const ATCommand_t& atCmd) {
-    uint8_t c;
-    
-    // Non-blocking read
-    if (!m_modem_uart.readByte(c)) {
-        return false;  // No data available
+bool ATCommandHndlr::processResponse(ResponseState& state, const ATCommand_t& atCmd, TickType_t deadline) {
+    const int line_len = readModemLine(state.line_buffer, sizeof(state.line_buffer), deadline);
+    if (line_len < 0) {
+        return false;  // No line before the deadline
     }
 
-    // Handle line termination
-    if (c == '\n') {
-        return handleCompleteLine(state, atCmd);
-    }
-
-    // Accumulate characters (ignore \r)
-    if (c != '\r') {
-        if (state.line_len < sizeof(state.line_buffer) - 1) {
-            state.line_buffer[state.line_len++] = c;
-        } else {
-            printf("RX buffer overflow, discarding line\n");
-            state.line_len = 0;
-        }
-    }
-
-    return false;  // Line not complete yet
+    state.line_len = static_cast<size_t>(line_len);
+    return handleCompleteLine(state, atCmd);
 }
 
 bool ATCommandHndlr::handleCompleteLine(ResponseState& state, const ATCommand_t& atCmd) {
@@ -1103,8 +1156,10 @@ bool ATCommandHndlr::handleCompleteLine(ResponseState& state, const ATCommand_t&
 
     // g_logger.info("RX: %s\n", state.line_buffer);
 
+    const AtResponse resp = parseAtResponse({state.line_buffer, state.line_len});
+
     // Check for ERROR response (both "ERROR" and "+CME ERROR")
-    if (strcmp(state.line_buffer, "ERROR") == 0 || strstr(state.line_buffer, "+CME ERROR") != nullptr) {
+    if (resp.isError()) {
         printSanitizedMsg("AT response error: ", state.line_buffer);
         printf("AT response error command: %s\n", atCmd.cmd);
         state.success = false;
@@ -1119,7 +1174,7 @@ bool ATCommandHndlr::handleCompleteLine(ResponseState& state, const ATCommand_t&
     }
 
     // Check for OK response
-    if (strcmp(state.line_buffer, "OK") == 0) {
+    if (resp.is(AtResult::Ok)) {
         if (state.got_expected || atCmd.msg_type == MsgType::SHUTDOWN) {
             printf("AT OK: %s\n", atCmd.cmd);
             state.success = true;
@@ -1135,4 +1190,74 @@ bool ATCommandHndlr::handleCompleteLine(ResponseState& state, const ATCommand_t&
     // Reset for next line
     state.line_len = 0;
     return false;  // Continue processing
-}
\ No newline at end of file
+}
+
+bool SocketRecvWatch::begin() {
+    if (m_queue != nullptr) {
+        return true;
+    }
+
+    m_queue = xQueueCreate(QUEUE_DEPTH, sizeof(ModemLine_t));
+    if (m_queue == nullptr) {
+        return false;
+    }
+
+    if (!g_modem_reader.subscribe("+QIURC:", m_queue)) {
+        vQueueDelete(m_queue);
+        m_queue = nullptr;
+        return false;
+    }
+
+    return true;
+}
+
+void SocketRecvWatch::end() {
+    if (m_queue == nullptr) {
+        return;
+    }
+
+    // The reader no longer touches the queue once unsubscribe returns
+    g_modem_reader.unsubscribe(m_queue);
+    vQueueDelete(m_queue);
+    m_queue = nullptr;
+}
+
+void SocketRecvWatch::clear() {
+    if (m_queue != nullptr) {
+        (void)xQueueReset(m_queue);
+    }
+}
+
+SocketRecvWatch::Event SocketRecvWatch::wait(TickType_t deadline) {
+    if (m_queue == nullptr) {
+        return Event::Timeout;
+    }
+
+    ModemLine_t urc;
+    while (true) {
+        // Signed difference, so a deadline just past the tick counter wrap is still in the future
+        const TickType_t now = xTaskGetTickCount();
+        const TickType_t remaining = (static_cast<int32_t>(deadline - now) > 0) ? (deadline - now) : 0;
+
+        if (xQueueReceive(m_queue, &urc, remaining) != pdTRUE) {
+            return Event::Timeout;
+        }
+
+        const AtResponse resp = parseAtResponse({urc.text, urc.len});
+        const std::string_view kind = resp.textField(0);
+        int32_t id = -1;
+
+        if (kind == "recv" && resp.intField(1, id) && id == m_connect_id) {
+            return Event::Data;
+        }
+
+        if (kind == "closed" && resp.intField(1, id) && id == m_connect_id) {
+            return Event::Closed;
+        }
+
+        // Deactivating the PDP context closes every socket on it
+        if (kind == "pdpdeact") {
+            return Event::Closed;
+        }
+    }
+}
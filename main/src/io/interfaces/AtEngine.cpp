@@ -0,0 +1,200 @@
+#include "AtEngine.hpp"
+
+#include <algorithm>
+#include <cstdio>
+
+/**
+ * @brief Outermost coroutine of a spawned job; reports the result and frees itself.
+ */
+struct AtEngine::RootTask {
+    struct promise_type {
+        RootTask get_return_object() { return {std::coroutine_handle<promise_type>::from_promise(*this)}; }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { abort(); }
+    };
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+static TickType_t ticksUntil(TickType_t deadline)
+{
+    const TickType_t now = xTaskGetTickCount();
+    return (static_cast<int32_t>(deadline - now) > 0) ? (deadline - now) : 0;
+}
+
+AtJob::State::~State() {
+    if (finished != nullptr) {
+        vSemaphoreDelete(finished);
+    }
+}
+
+bool AtJob::done() const {
+    return m_state != nullptr && m_state->done;
+}
+
+bool AtJob::wait(TickType_t deadline) const {
+    if (m_state == nullptr) {
+        return false;
+    }
+
+    if (!m_state->done) {
+        // portMAX_DELAY is "forever", not a tick count that may already have passed
+        const TickType_t wait_ticks = (deadline == portMAX_DELAY) ? portMAX_DELAY : ticksUntil(deadline);
+        if (xSemaphoreTake(m_state->finished, wait_ticks) != pdTRUE) {
+            return false;
+        }
+        // Leave it signalled for any other waiter
+        xSemaphoreGive(m_state->finished);
+    }
+
+    return m_state->result;
+}
+
+bool AtEngine::start() {
+    if (m_task != nullptr) {
+        return true;
+    }
+
+    if (m_spawned == nullptr) {
+        m_spawned = xQueueCreate(SPAWN_QUEUE_DEPTH, sizeof(void*));
+    }
+
+    if (m_spawned == nullptr) {
+        printf("Failed to allocate AT engine queue\n");
+        return false;
+    }
+
+    // Same priority as the application tasks; the modem reader stays above it
+    const BaseType_t created = xTaskCreate(engineTaskEntry, "modem_at", 6144, this, 5, &m_task);
+    if (created != pdPASS) {
+        m_task = nullptr;
+        printf("Failed to create AT engine task\n");
+        return false;
+    }
+
+    return true;
+}
+
+AtEngine::RootTask AtEngine::runRoot(AtTask<bool> task, std::shared_ptr<AtJob::State> state) {
+    const bool ok = co_await task;
+
+    state->result = ok;
+    state->done = true;
+    xSemaphoreGive(state->finished);
+}
+
+AtJob AtEngine::spawn(AtTask<bool> task) {
+    if (m_task == nullptr) {
+        printf("AT engine not running\n");
+        return {};
+    }
+
+    auto state = std::make_shared<AtJob::State>();
+    state->finished = xSemaphoreCreateBinary();
+    if (state->finished == nullptr) {
+        printf("Failed to allocate AT job\n");
+        return {};
+    }
+
+    const RootTask root = runRoot(std::move(task), state);
+
+    if (xTaskGetCurrentTaskHandle() == m_task) {
+        m_ready.push_back(root.handle);
+        return AtJob(state);
+    }
+
+    void* address = root.handle.address();
+    if (xQueueSend(m_spawned, &address, portMAX_DELAY) != pdTRUE) {
+        root.handle.destroy();
+        return {};
+    }
+
+    return AtJob(state);
+}
+
+void AtEngine::CommandAwaiter::await_suspend(std::coroutine_handle<> h) {
+    handle = h;
+    engine.m_commands.push_back(this);
+}
+
+void AtEngine::DelayAwaiter::await_suspend(std::coroutine_handle<> h) {
+    engine.m_timers.push_back({xTaskGetTickCount() + ticks, h});
+}
+
+void AtEngine::engineTaskEntry(void* arg) {
+    static_cast<AtEngine*>(arg)->engineLoop();
+}
+
+void AtEngine::engineLoop() {
+    void* address = nullptr;
+
+    while (true) {
+        while (xQueueReceive(m_spawned, &address, 0) == pdTRUE) {
+            m_ready.push_back(std::coroutine_handle<>::from_address(address));
+        }
+
+        wakeExpiredTimers();
+        runReady();
+
+        if (runNextCommand()) {
+            continue;
+        }
+
+        // Every job is waiting on a delay (or there are none): sleep until one is due or a job arrives
+        if (xQueueReceive(m_spawned, &address, nextWakeDelay()) == pdTRUE) {
+            m_ready.push_back(std::coroutine_handle<>::from_address(address));
+        }
+    }
+}
+
+void AtEngine::runReady() {
+    while (!m_ready.empty()) {
+        const std::coroutine_handle<> next = m_ready.front();
+        m_ready.pop_front();
+        next.resume();
+    }
+}
+
+bool AtEngine::runNextCommand() {
+    if (m_commands.empty()) {
+        return false;
+    }
+
+    CommandAwaiter* command = m_commands.front();
+    m_commands.pop_front();
+
+    command->result = (command->out_buf != nullptr)
+        ? m_hndlr.sendAndCapture(command->cmd, command->out_buf, command->out_len)
+        : m_hndlr.send(command->cmd);
+
+    m_ready.push_back(command->handle);
+    return true;
+}
+
+TickType_t AtEngine::nextWakeDelay() const {
+    if (m_timers.empty()) {
+        return portMAX_DELAY;
+    }
+
+    const auto earliest = std::min_element(m_timers.begin(), m_timers.end(), [](const Timer& a, const Timer& b) {
+        return static_cast<int32_t>(a.wake_tick - b.wake_tick) < 0;
+    });
+    return ticksUntil(earliest->wake_tick);
+}
+
+void AtEngine::wakeExpiredTimers() {
+    const TickType_t now = xTaskGetTickCount();
+
+    for (auto it = m_timers.begin(); it != m_timers.end();) {
+        if (static_cast<int32_t>(now - it->wake_tick) >= 0) {
+            m_ready.push_back(it->handle);
+            it = m_timers.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+AtEngine g_at_engine;
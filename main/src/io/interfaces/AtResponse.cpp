@@ -0,0 +1,104 @@
+#include "AtResponse.hpp"
+
+using namespace at_response_detail;
+
+/**
+ * @brief Fills in one unquoted field, trimming spaces and reading it as an integer if it is one.
+ */
+static void setPlainField(AtResponse::Field& field, std::string_view text)
+{
+    while (!text.empty() && text.front() == ' ') {
+        text.remove_prefix(1);
+    }
+    while (!text.empty() && text.back() == ' ') {
+        text.remove_suffix(1);
+    }
+
+    field.text = text;
+
+    const bool negative = !text.empty() && text[0] == '-';
+    size_t i = negative ? 1 : 0;
+    if (i == text.size()) {
+        return;
+    }
+
+    // Out-of-range numbers stay text-only rather than wrapping
+    const int64_t limit = negative ? -static_cast<int64_t>(INT32_MIN) : INT32_MAX;
+    int64_t value = 0;
+    for (; i < text.size(); ++i) {
+        if (text[i] < '0' || text[i] > '9') {
+            return;
+        }
+        value = value * 10 + (text[i] - '0');
+        if (value > limit) {
+            return;
+        }
+    }
+
+    field.value = static_cast<int32_t>(negative ? -value : value);
+    field.numeric = true;
+}
+
+/**
+ * @brief Splits `text` at commas outside quotes into the response's fields.
+ */
+static void splitFields(AtResponse& resp, std::string_view text)
+{
+    size_t pos = 0;
+
+    while (resp.field_count < AtResponse::MAX_FIELDS) {
+        AtResponse::Field& field = resp.fields[resp.field_count++];
+
+        while (pos < text.size() && text[pos] == ' ') {
+            ++pos;
+        }
+
+        if (pos < text.size() && text[pos] == '"') {
+            const size_t close = text.find('"', pos + 1);
+            const size_t end = (close == std::string_view::npos) ? text.size() : close;
+            field.text = text.substr(pos + 1, end - pos - 1);
+            pos = text.find(',', end);
+        } else {
+            const size_t comma = text.find(',', pos);
+            setPlainField(field, text.substr(pos, comma - pos));
+            pos = comma;
+        }
+
+        if (pos == std::string_view::npos) {
+            return;
+        }
+        ++pos;  // Past the comma; a trailing comma leaves one empty field
+    }
+}
+
+AtResponse parseAtResponse(std::string_view line)
+{
+    AtResponse resp;
+    if (line.empty()) {
+        return resp;
+    }
+
+    // Hash the head while looking for where it ends
+    uint32_t hash = 0;
+    size_t head_len = 0;
+    const bool prefixed = line[0] == '+';
+
+    for (; head_len < line.size(); ++head_len) {
+        if (prefixed && line[head_len] == ':') {
+            break;
+        }
+        hash = hashStep(hash, line[head_len]);
+    }
+
+    const int8_t index = SLOTS[hash % HASH_SLOTS];
+    if (index < 0 || AT_RESPONSE_PATTERNS[index].head != line.substr(0, head_len)) {
+        return resp;
+    }
+
+    resp.result = AT_RESPONSE_PATTERNS[index].result;
+    if (head_len < line.size()) {
+        splitFields(resp, line.substr(head_len + 1));
+    }
+
+    return resp;
+}
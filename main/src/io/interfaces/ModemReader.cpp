@@ -0,0 +1,257 @@
+#include "ModemReader.hpp"
+#include "UARTDriver.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static TickType_t ticksUntil(TickType_t deadline)
+{
+    // portMAX_DELAY is "forever", not a tick count that may already have passed
+    if (deadline == portMAX_DELAY)
+    {
+        return portMAX_DELAY;
+    }
+
+    // Signed difference, so a deadline just past the tick counter wrap is still in the future
+    const TickType_t now = xTaskGetTickCount();
+    return (static_cast<int32_t>(deadline - now) > 0) ? (deadline - now) : 0;
+}
+
+static void printUnrouted(const ModemLine_t& line)
+{
+    char sanitized[MODEM_LINE_MAX + 1] = {0};
+    for (size_t i = 0; i < line.len; ++i)
+    {
+        const unsigned char ch = static_cast<unsigned char>(line.text[i]);
+        sanitized[i] = (ch >= 32U && ch <= 126U) ? static_cast<char>(ch) : '.';
+    }
+    printf("RX (unsolicited): %s\n", sanitized);
+}
+
+bool ModemReader::start() {
+    if (m_task != nullptr) {
+        return true;
+    }
+
+    if (m_lock == nullptr) {
+        m_lock = xSemaphoreCreateMutex();
+    }
+    if (m_responses == nullptr) {
+        m_responses = xQueueCreate(RESPONSE_QUEUE_DEPTH, sizeof(ModemLine_t));
+    }
+    if (m_payload == nullptr) {
+        m_payload = xStreamBufferCreate(PAYLOAD_STREAM_SIZE, 1);
+    }
+
+    if (m_lock == nullptr || m_responses == nullptr || m_payload == nullptr) {
+        printf("Failed to allocate modem reader queues\n");
+        return false;
+    }
+
+    // Above the application tasks so the UART ring buffer is drained promptly
+    const BaseType_t created = xTaskCreate(readerTaskEntry, "modem_rx", 4096, this, 6, &m_task);
+    if (created != pdPASS) {
+        m_task = nullptr;
+        printf("Failed to create modem reader task\n");
+        return false;
+    }
+
+    return true;
+}
+
+bool ModemReader::subscribe(const char* prefix, QueueHandle_t queue) {
+    if (prefix == nullptr || queue == nullptr || m_lock == nullptr) {
+        return false;
+    }
+
+    bool added = false;
+    xSemaphoreTake(m_lock, portMAX_DELAY);
+    for (Subscription& sub : m_subs) {
+        if (sub.queue == nullptr) {
+            sub = {prefix, strlen(prefix), queue};
+            added = true;
+            break;
+        }
+    }
+    xSemaphoreGive(m_lock);
+
+    if (!added) {
+        printf("Modem URC subscription table full (%s)\n", prefix);
+    }
+    return added;
+}
+
+void ModemReader::unsubscribe(QueueHandle_t queue) {
+    if (m_lock == nullptr) {
+        return;
+    }
+
+    xSemaphoreTake(m_lock, portMAX_DELAY);
+    for (Subscription& sub : m_subs) {
+        if (sub.queue == queue) {
+            sub = {};
+        }
+    }
+    xSemaphoreGive(m_lock);
+}
+
+void ModemReader::beginCommand() {
+    xSemaphoreTake(m_lock, portMAX_DELAY);
+    // Late output of an earlier command must not be taken as this command's response
+    xQueueReset(m_responses);
+    (void)xStreamBufferReset(m_payload);
+    m_rule_count = 0;
+    m_cmd_active = true;
+    xSemaphoreGive(m_lock);
+}
+
+void ModemReader::endCommand() {
+    xSemaphoreTake(m_lock, portMAX_DELAY);
+    m_cmd_active = false;
+    m_rule_count = 0;
+    xSemaphoreGive(m_lock);
+}
+
+void ModemReader::expectPayload(std::span<const ModemPayloadRule_t> rules) {
+    xSemaphoreTake(m_lock, portMAX_DELAY);
+    m_rule_count = std::min(rules.size(), MAX_PAYLOAD_RULES);
+    std::copy_n(rules.begin(), m_rule_count, m_rules);
+    xSemaphoreGive(m_lock);
+}
+
+bool ModemReader::nextLine(ModemLine_t& line, TickType_t deadline) {
+    return xQueueReceive(m_responses, &line, ticksUntil(deadline)) == pdTRUE;
+}
+
+size_t ModemReader::readPayload(std::span<uint8_t> out, TickType_t deadline) {
+    size_t total = 0;
+
+    while (total < out.size()) {
+        const size_t got = xStreamBufferReceive(m_payload, out.data() + total, out.size() - total, ticksUntil(deadline));
+        if (got == 0) {
+            break;
+        }
+        total += got;
+    }
+
+    return total;
+}
+
+void ModemReader::readerTaskEntry(void* arg) {
+    static_cast<ModemReader*>(arg)->readerLoop();
+}
+
+void ModemReader::readerLoop() {
+    ModemLine_t line = {};
+
+    while (true) {
+        const TickType_t deadline = xTaskGetTickCount() + READ_SLICE;
+
+        // Blocks in the UART driver until something arrives
+        const int first = m_uart.peek(deadline);
+        if (first < 0) {
+            continue;
+        }
+
+        // The data prompt has no line terminator; it is always at the start of a line
+        if (first == '>') {
+            uint8_t prompt[2] = {};
+            (void)m_uart.read({prompt, 1}, deadline);
+            if (m_uart.peek(xTaskGetTickCount()) == ' ') {
+                (void)m_uart.read({prompt + 1, 1}, deadline);
+            }
+
+            line.text[0] = '>';
+            line.text[1] = '\0';
+            line.len = 1;
+            dispatch(line);
+            continue;
+        }
+
+        int len = m_uart.readUntil('\n', line.text, deadline);
+        while (len > 0 && line.text[len - 1] == '\r') {
+            line.text[--len] = '\0';
+        }
+
+        if (len <= 0) {
+            continue;
+        }
+
+        line.len = static_cast<uint16_t>(len);
+        dispatch(line);
+    }
+}
+
+int ModemReader::payloadLength(const ModemLine_t& line) const {
+    for (size_t i = 0; i < m_rule_count; ++i) {
+        const ModemPayloadRule_t& rule = m_rules[i];
+        const size_t prefix_len = strlen(rule.prefix);
+
+        if (strncmp(line.text, rule.prefix, prefix_len) != 0) {
+            continue;
+        }
+
+        if (rule.length >= 0) {
+            return rule.length;
+        }
+
+        return std::max(0, atoi(line.text + prefix_len));
+    }
+
+    return 0;
+}
+
+void ModemReader::dispatch(const ModemLine_t& line) {
+    bool routed = false;
+
+    xSemaphoreTake(m_lock, portMAX_DELAY);
+    for (const Subscription& sub : m_subs) {
+        if (sub.queue == nullptr || strncmp(line.text, sub.prefix, sub.prefix_len) != 0) {
+            continue;
+        }
+
+        routed = true;
+        if (xQueueSend(sub.queue, &line, 0) != pdTRUE) {
+            printf("Modem URC queue full, dropped: %.40s\n", line.text);
+        }
+    }
+
+    const bool to_command = m_cmd_active;
+    const int payload_len = to_command ? payloadLength(line) : 0;
+    xSemaphoreGive(m_lock);
+
+    if (to_command) {
+        if (xQueueSend(m_responses, &line, RESPONSE_SEND_TIMEOUT) != pdTRUE) {
+            printf("Modem response queue full, dropped: %.40s\n", line.text);
+        }
+    } else if (!routed) {
+        printUnrouted(line);
+    }
+
+    if (payload_len > 0) {
+        forwardPayload(static_cast<size_t>(payload_len));
+    }
+}
+
+void ModemReader::forwardPayload(size_t len) {
+    uint8_t chunk[128];
+
+    while (len > 0) {
+        const size_t n = m_uart.read({chunk, std::min(sizeof(chunk), len)}, xTaskGetTickCount() + PAYLOAD_BYTE_TIMEOUT);
+        if (n == 0) {
+            printf("Modem payload truncated, %u bytes missing\n", static_cast<unsigned>(len));
+            return;
+        }
+        len -= n;
+
+        // The caller drains the stream; once it gives up the rest is read and discarded
+        size_t sent = 0;
+        while (sent < n && m_cmd_active) {
+            sent += xStreamBufferSend(m_payload, chunk + sent, n - sent, pdMS_TO_TICKS(100));
+        }
+    }
+}
+
+ModemReader g_modem_reader(m_modem_uart);
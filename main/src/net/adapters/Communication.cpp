@@ -2,6 +2,41 @@
 #include "WiFiConnection.hpp"
 #include "SimConnection.hpp"
 #include "EthernetConnection.hpp"
+#include "EEPROMConfig.hpp"
+#include "RttEstimator.hpp"
+#include "CborSchema.hpp"
+
+#include <algorithm>
+#include <array>
+#include <stdio.h>
+
+extern "C" {
+    #include "freertos/task.h"
+}
+
+// Backlog record: pkt_type (1), priority (1), payload length (2, little-endian), payload
+#define SEND_BACKLOG_RECORD_HDR_LEN 4
+
+/**
+ * @brief Packet configuration for a packet type restored from the backlog.
+ * @return The matching entry, or nullptr if the type is not queueable.
+ */
+static const PktEntry_t* findPktEntry(uint8_t pkt_type)
+{
+    static const std::array<const PktEntry_t*, 4> entries = {
+        &activate_entry, &reading_entry, &gpsupdate_entry, &firmwareversion_entry
+    };
+
+    for (const PktEntry_t* entry : entries)
+    {
+        if (static_cast<uint8_t>(entry->pkt_type) == pkt_type)
+        {
+            return entry;
+        }
+    }
+
+    return nullptr;
+}
 
 Communication::Communication(ConnectionType selected_type)
     : connection_type(selected_type)
@@ -71,4 +106,238 @@ bool Communication::streamHttpsGet(const std::string& url,
                                    const PacketChunkCallback& onChunk)
 {
     return connection->streamHttpsGet(url, onChunk);
-}
\ No newline at end of file
+}
+
+size_t Communication::sendPacketBatch(std::span<PacketRequest_t> requests)
+{
+    return connection->sendPacketBatch(requests);
+}
+
+bool Communication::fetchBlock(const PktEntry_t pkt_config,
+                               const CoapBlockOpt_t& request_block,
+                               CoapBlockOpt_t& response_block,
+                               const PacketChunkCallback& onChunk)
+{
+    return connection->fetchBlock(pkt_config, request_block, response_block, onChunk);
+}
+
+uint8_t Communication::maxBlockSzx() const
+{
+    return connection->maxBlockSzx();
+}
+
+void Communication::enqueue(QueuedPacket_t& item)
+{
+    item.state = QueuedPktState::Pending;
+    item.request.success = false;
+    send_queue.push_back(&item);
+}
+
+size_t Communication::drainQueue(TickType_t awake_deadline, bool include_backlog)
+{
+    std::vector<std::unique_ptr<RestoredPacket>> restored;
+    std::vector<QueuedPacket_t*> queue;
+    std::vector<QueuedPacket_t*> admitted;
+    std::vector<PacketRequest_t> batch;
+
+    queue.swap(send_queue);
+
+    if (include_backlog)
+    {
+        restoreBacklog(restored);
+    }
+
+    // Restored packets go in after fresh ones so the stable sort keeps them behind fresh packets of equal priority
+    for (const std::unique_ptr<RestoredPacket>& packet : restored)
+    {
+        queue.push_back(&packet->item);
+    }
+
+    std::stable_sort(queue.begin(), queue.end(), [](const QueuedPacket_t* a, const QueuedPacket_t* b) {
+        if (a->priority != b->priority)
+        {
+            return a->priority < b->priority;
+        }
+
+        // Earliest deadline first; packets without a deadline go last
+        if ((a->deadline == 0) != (b->deadline == 0))
+        {
+            return a->deadline != 0;
+        }
+
+        return static_cast<int32_t>(a->deadline - b->deadline) < 0;
+    });
+
+    const TickType_t now = xTaskGetTickCount();
+    const int window_ms = worstCaseWindowMs(queue);
+
+    for (QueuedPacket_t* item : queue)
+    {
+        // Worst case, the packet completes at the end of the response window of its NSTART round
+        const uint32_t rounds = static_cast<uint32_t>(admitted.size() / COAP_NSTART) + 1;
+        const TickType_t batch_end = now + pdMS_TO_TICKS(rounds * static_cast<uint32_t>(window_ms));
+        const bool fits_budget = admitted.empty() || static_cast<int32_t>(awake_deadline - batch_end) >= 0;
+        const bool fits_deadline = (item->deadline == 0) || static_cast<int32_t>(item->deadline - batch_end) >= 0;
+
+        if (!fits_budget || !fits_deadline)
+        {
+            printf("Deferring %s packet: %s\n",
+                   std::string(CoapPktAssm::getUriPath(item->request.pkt_config.pkt_type)).c_str(),
+                   fits_deadline ? "outside awake budget" : "cannot meet its deadline");
+            item->state = QueuedPktState::Deferred;
+            continue;
+        }
+
+        admitted.push_back(item);
+        batch.push_back(item->request);
+    }
+
+    const size_t succeeded = batch.empty() ? 0 : connection->sendPacketBatch(batch);
+
+    for (size_t i = 0; i < admitted.size(); ++i)
+    {
+        admitted[i]->request.success = batch[i].success;
+        admitted[i]->state = batch[i].success ? QueuedPktState::Sent : QueuedPktState::Failed;
+    }
+
+    printf("Send queue: %zu/%zu packet(s) acknowledged, %zu deferred (%zu restored from backlog)\n",
+           succeeded, admitted.size(), queue.size() - admitted.size(), restored.size());
+
+    // Only the drain that restored the backlog may rewrite it, otherwise the restored records would be lost
+    if (include_backlog)
+    {
+        persistBacklog(queue);
+    }
+
+    return succeeded;
+}
+
+void Communication::restoreBacklog(std::vector<std::unique_ptr<RestoredPacket>>& restored)
+{
+    std::vector<uint8_t> backlog(SEND_BACKLOG_MAX_BYTES);
+    size_t backlog_len = backlog.size();
+
+    if (!eeprom.loadSendBacklog(backlog.data(), &backlog_len))
+    {
+        return;
+    }
+
+    size_t offset = 0;
+
+    while (offset + SEND_BACKLOG_RECORD_HDR_LEN <= backlog_len)
+    {
+        const uint8_t pkt_type = backlog[offset];
+        const uint8_t priority = backlog[offset + 1];
+        const size_t payload_len = static_cast<size_t>(backlog[offset + 2]) | (static_cast<size_t>(backlog[offset + 3]) << 8);
+        const PktEntry_t* entry = findPktEntry(pkt_type);
+
+        offset += SEND_BACKLOG_RECORD_HDR_LEN;
+
+        if (offset + payload_len > backlog_len)
+        {
+            printf("Send backlog is truncated, dropping the remainder\n");
+            break;
+        }
+
+        if (!entry || priority > static_cast<uint8_t>(PktPriority::Maintenance))
+        {
+            printf("Send backlog record has unknown type %u, skipping it\n", pkt_type);
+            offset += payload_len;
+            continue;
+        }
+
+        // The stored trailer belongs to the wake that encoded it, so the packet is re-signed with a fresh seq
+        std::unique_ptr<RestoredPacket> packet = std::make_unique<RestoredPacket>();
+        packet->payload.resize(payload_len + PacketSchema::TRAILER_GROWTH_MAX);
+
+        const size_t resigned_len = PacketSchema::refreshTrailer(
+            std::span<const uint8_t>(backlog.data() + offset, payload_len), packet->payload);
+
+        offset += payload_len;
+
+        if (resigned_len == 0)
+        {
+            printf("Send backlog record of type %u could not be re-signed, dropping it\n", pkt_type);
+            continue;
+        }
+
+        packet->payload.resize(resigned_len);
+        packet->item = {};
+        packet->item.request = {packet->payload.data(), packet->payload.size(), *entry, nullptr, false};
+        packet->item.priority = static_cast<PktPriority>(priority);
+        packet->item.persist = true;
+        packet->item.state = QueuedPktState::Pending;
+        restored.push_back(std::move(packet));
+    }
+}
+
+void Communication::persistBacklog(const std::vector<QueuedPacket_t*>& queue)
+{
+    std::vector<uint8_t> backlog;
+    size_t dropped = 0;
+
+    // The queue is in priority order, so when the backlog is full the lowest priority packets are dropped
+    for (const QueuedPacket_t* item : queue)
+    {
+        if (!item->persist || item->state == QueuedPktState::Sent || item->request.cbor_buffer_len == 0)
+        {
+            continue;
+        }
+
+        const size_t payload_len = item->request.cbor_buffer_len;
+
+        if (payload_len > UINT16_MAX || backlog.size() + SEND_BACKLOG_RECORD_HDR_LEN + payload_len > SEND_BACKLOG_MAX_BYTES)
+        {
+            dropped++;
+            continue;
+        }
+
+        backlog.push_back(static_cast<uint8_t>(item->request.pkt_config.pkt_type));
+        backlog.push_back(static_cast<uint8_t>(item->priority));
+        backlog.push_back(static_cast<uint8_t>(payload_len & 0xFF));
+        backlog.push_back(static_cast<uint8_t>(payload_len >> 8));
+        backlog.insert(backlog.end(), item->request.cbor_buffer, item->request.cbor_buffer + payload_len);
+    }
+
+    if (dropped > 0)
+    {
+        printf("Send backlog full, dropped %zu packet(s)\n", dropped);
+    }
+
+    if (backlog.empty())
+    {
+        if (!eeprom.clearSendBacklog())
+        {
+            printf("Failed to clear send backlog\n");
+        }
+        return;
+    }
+
+    if (eeprom.saveSendBacklog(backlog.data(), backlog.size()))
+    {
+        printf("Saved %zu byte(s) of unsent packets to the send backlog\n", backlog.size());
+    }
+    else
+    {
+        printf("Failed to save send backlog\n");
+    }
+}
+
+int Communication::worstCaseWindowMs(const std::vector<QueuedPacket_t*>& queue) const
+{
+    const RttEstimator::Transport transport = (connection_type == ConnectionType::SIM)
+                                                  ? RttEstimator::Transport::Sim
+                                                  : RttEstimator::Transport::Wifi;
+    int window_ms = 0;
+
+    for (const QueuedPacket_t* item : queue)
+    {
+        const int configured_ms = (item->request.pkt_config.response_win > 0)
+                                      ? item->request.pkt_config.response_win
+                                      : PKT_RESPONSE_WIN_DEFAULT_MS;
+
+        window_ms = std::max(window_ms, RttEstimator::responseWindowMs(transport, configured_ms));
+    }
+
+    return window_ms;
+}
@@ -3,14 +3,19 @@
 #include "driver/gpio.h"
 #include "Types.hpp"
 #include "ATCommandHndlr.hpp"
+#include "AtResponse.hpp"
 // #include "Logger.hpp"
 #include "CoapPktAssm.hpp"
+#include "CoapTransaction.hpp"
 #include "EEPROMConfig.hpp"
+#include "ModemReader.hpp"
 #include "Utils.hpp"
+#include <algorithm>
 #include <cctype>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <vector>
 
 extern "C"
 {
@@ -18,11 +23,24 @@ extern "C"
 #include "freertos/task.h"
 }
 
+#ifndef PSM_EN
+#define PSM_EN 0
+#endif
+
+#ifndef MODEM_WAKE_GPIO
+#define MODEM_WAKE_GPIO -1
+#endif
+
+#if (PSM_EN & 1) && (MODEM_WAKE_GPIO < 0)
+#error "PSM_EN with PSM needs MODEM_WAKE_GPIO: the modem's UART is off while it is in PSM"
+#endif
+
 /**
  * @brief CFUNCMD reset command
  * This command performs a full modem reset, which is necessary to recover from certain error states and ensure a clean start. The modem will reboot and reinitialize after this command, so it should be used with caution.
- * Expected response: "OK" after the modem restarts and is ready to accept commands again.
- * Timeout: 5000ms (to allow for modem reboot time)
+ * It is only sent when an attach from the modem's current state has failed (see SimConnection::resetModem).
+ * Expected response: "OK" before the modem restarts; it reports "RDY" once it is ready to accept commands again.
+ * Timeout: 5000ms
  * MsgType: INIT (used during initial connection setup)
  */
 ATCommand_t cfun_reset = {
@@ -34,6 +52,37 @@ ATCommand_t cfun_reset = {
     0
 };
 
+/**
+ * @brief CFUN query command
+ * This command reads the modem's functionality level. The expected response includes "+CFUN: <fun>", where 1 is full functionality and 0 or 4 means the radio is off (for example after the
+ * CFUN=0 sent on disconnect). It lets connect resume from the modem's current state instead of resetting it.
+ * Timeout: 2000ms
+ * MsgType: INIT (used during initial connection setup)
+ */
+ATCommand_t cfun_query = {
+    "AT+CFUN?",
+    "+CFUN:",
+    2000,
+    MsgType::INIT,
+    nullptr,
+    0
+};
+
+/**
+ * @brief CFUN command to enable full functionality
+ * This command turns the radio back on without rebooting the modem. The expected response is "OK". The modem may take several seconds to answer while the RF front end starts.
+ * Timeout: 15000ms (maximum response time of AT+CFUN on the EC25)
+ * MsgType: INIT (used during initial connection setup)
+ */
+ATCommand_t radio_on = {
+    "AT+CFUN=1",
+    "OK",
+    15000,
+    MsgType::INIT,
+    nullptr,
+    0
+};
+
 /**
  * @brief CEREG command to check network registration status
  * This command queries the modem for its current network registration status. The expected response includes "+C
@@ -50,6 +99,84 @@ ATCommand_t cereg_cmd = {
     0
 };
 
+/**
+ * @brief CPSMS command to request power saving mode
+ * Requests PSM with a periodic TAU (T3412 extended) of 1 hour ("00100001": unit 1 h, value 1) and an active time (T3324) of 30 seconds ("00001111": unit 2 s, value 15). The network may grant
+ * different values or refuse PSM; what it granted is read back with AT+CEREG=4. The modem keeps the request across reboots, so it is only sent on a fresh attach.
+ * Timeout: 2000ms
+ * MsgType: NETREG (used during network registration phase)
+ */
+ATCommand_t psm_request = {
+    "AT+CPSMS=1,,,\"00100001\",\"00001111\"",
+    "OK",
+    2000,
+    MsgType::NETREG,
+    nullptr,
+    0
+};
+
+/**
+ * @brief CEDRXS command to request eDRX
+ * Requests an LTE (access technology 4) eDRX cycle of 81.92 seconds ("0101"). Between paging occasions the modem stays registered at a fraction of its idle current. What the network granted is read back
+ * with AT+CEDRXRDP.
+ * Timeout: 2000ms
+ * MsgType: NETREG (used during network registration phase)
+ */
+ATCommand_t edrx_request = {
+    "AT+CEDRXS=1,4,\"0101\"",
+    "OK",
+    2000,
+    MsgType::NETREG,
+    nullptr,
+    0
+};
+
+/**
+ * @brief CEREG command to report PSM timers
+ * Sets the registration report to mode 4, which appends the network-assigned active time and periodic TAU to the "+CEREG:" response.
+ * Timeout: 2000ms
+ * MsgType: NETREG (used during network registration phase)
+ */
+ATCommand_t cereg_psm_report = {
+    "AT+CEREG=4",
+    "OK",
+    2000,
+    MsgType::NETREG,
+    nullptr,
+    0
+};
+
+/**
+ * @brief CEREG command to turn registration URCs back off
+ * Restores report mode 0, which the rest of the attach flow runs with, after the PSM timers have been read.
+ * In mode 4 the modem also sends unsolicited "+CEREG: <stat>,..." lines, which a later "AT+CEREG?" could capture in place of its own response.
+ * Timeout: 2000ms
+ * MsgType: NETREG (used during network registration phase)
+ */
+ATCommand_t cereg_report_off = {
+    "AT+CEREG=0",
+    "OK",
+    2000,
+    MsgType::NETREG,
+    nullptr,
+    0
+};
+
+/**
+ * @brief CEDRXRDP command to read the negotiated eDRX parameters
+ * The expected response is "+CEDRXRDP: <AcT>[,<requested>,<network>,<paging window>]"; an access technology of 0 means eDRX is not in use.
+ * Timeout: 2000ms
+ * MsgType: NETREG (used during network registration phase)
+ */
+ATCommand_t edrx_read = {
+    "AT+CEDRXRDP",
+    "+CEDRXRDP:",
+    2000,
+    MsgType::NETREG,
+    nullptr,
+    0
+};
+
 /**
  * @brief QICSGP command to define PDP context
  * This command sets up the PDP context for the cellular connection, specifying the APN and other parameters. The expected response is "OK" if the context was defined successfully. This is a critical
@@ -82,6 +209,22 @@ ATCommand_t enable_multi_socket = {
     0
 };
 
+/**
+ * @brief QURCCFG command to route URCs to the main UART
+ * Sockets are opened in buffer access mode, where the modem announces received data with a "+QIURC: \"recv\",<id>" URC. By default the EC25 may report URCs on its USB AT port only, so this
+ * command directs them to the UART the firmware listens on. Without it receivers fall back to polling with AT+QIRD. The expected response is "OK".
+ * Timeout: 3000ms
+ * MsgType: DATA (used during data connection setup)
+ */
+ATCommand_t route_urcs_to_uart = {
+    "AT+QURCCFG=\"urcport\",\"uart1\"",
+    "OK",
+    3000,
+    MsgType::DATA,
+    nullptr,
+    0
+};
+
 /**
  * @brief QIACT command to activate PDP context
  * This command activates the previously defined PDP context, allowing the modem to establish a data connection with the cellular network. The expected response is "OK" if the PDP context was activated successfully. Activ
@@ -114,22 +257,6 @@ ATCommand_t check_ip = {
     0
 };
 
-/**
- * @brief QIOPEN command to open a UDP socket
- * This command instructs the modem to open a UDP socket connection to a specified remote host and port. The expected response is "OK" followed by an asynchronous "+QIOPEN: <
- * id>,<err>" response indicating whether the socket was opened successfully (err=0) or if there was an error. This command is essential for establishing a communication channel over which data packets can be sent and received.
- * Timeout: 5000ms (to allow for socket opening process)
- * MsgType: DATA (used during data connection setup)
- */
-ATCommand_t open_socket = {
-    "AT+QIOPEN=1,0,\"UDP\",\"45.79.118.187\",5683,0,0",
-    "OK",
-    5000,
-    MsgType::DATA,
-    nullptr,
-    0
-};
-
 /**
  * @brief QIDEACT command to deactivate PDP context
  * This command deactivates the active PDP context, effectively disconnecting the modem from the cellular network. The expected response is "OK" if the context was deactivated successfully. This command is
@@ -177,6 +304,22 @@ ATCommand_t close_ssl_socket = {
         0
 };
 
+/**
+ * @brief GMR command to read the modem firmware revision
+ * The modem answers with its revision as bare text (e.g. "EC25EFAR06A06M4G") followed by "OK". The revision keys the QSSLOPEN
+ * syntax variant learned by openSSLSocket(), so a modem firmware update causes the variants to be probed again.
+ * Timeout: 300ms
+ * MsgType: DATA (used before opening the SSL socket)
+ */
+ATCommand_t firmware_revision = {
+    "AT+GMR",
+    "",
+    300,
+    MsgType::DATA,
+    nullptr,
+    0
+};
+
 /**
  * @brief QICLOSE command to close the UDP socket (alternative for SSL connections)
  * This command is used as an alternative to close_cmd for cases where the connection was established using
@@ -195,11 +338,305 @@ ATCommand_t close_tls_socket = {
 
 
 
+static uint32_t msSince(TickType_t start)
+{
+    return static_cast<uint32_t>(pdTICKS_TO_MS(xTaskGetTickCount() - start));
+}
+
+static bool deadlinePassed(TickType_t deadline)
+{
+    return static_cast<int32_t>(xTaskGetTickCount() - deadline) >= 0;
+}
+
+/**
+ * @brief Reads a response field written as exactly `width` binary digits, e.g. "00100010".
+ * @return false if the field is empty, the wrong length or not binary
+ */
+static bool parseBits(std::string_view bits, size_t width, uint32_t& out)
+{
+    if (bits.size() != width)
+    {
+        return false;
+    }
+
+    out = 0;
+    for (const char c : bits)
+    {
+        if (c != '0' && c != '1')
+        {
+            return false;
+        }
+        out = (out << 1) | static_cast<uint32_t>(c - '0');
+    }
+    return true;
+}
+
+/**
+ * @brief Decodes a GPRS Timer 3 value (T3412 extended) given as 8 bits, in seconds.
+ * @return 0 if the timer is deactivated or malformed
+ */
+static uint32_t decodeGprsTimer3(std::string_view bits)
+{
+    static constexpr uint32_t UNIT_S[8] = {600, 3600, 36000, 2, 30, 60, 1152000, 0};
+    uint32_t octet = 0;
+    if (!parseBits(bits, 8, octet))
+    {
+        return 0;
+    }
+
+    return UNIT_S[(octet >> 5) & 0x07U] * (octet & 0x1FU);
+}
+
+/**
+ * @brief Decodes a GPRS Timer 2 value (T3324) given as 8 bits, in seconds.
+ * @return 0 if the timer is deactivated or malformed
+ */
+static uint32_t decodeGprsTimer2(std::string_view bits)
+{
+    // Units 3 to 6 are reserved and read as minutes
+    static constexpr uint32_t UNIT_S[8] = {2, 60, 360, 60, 60, 60, 60, 0};
+    uint32_t octet = 0;
+    if (!parseBits(bits, 8, octet))
+    {
+        return 0;
+    }
+
+    return UNIT_S[(octet >> 5) & 0x07U] * (octet & 0x1FU);
+}
+
+/**
+ * @brief Decodes an LTE eDRX cycle given as 4 bits, in milliseconds.
+ */
+static uint32_t decodeEdrxCycleMs(std::string_view bits)
+{
+    static constexpr uint32_t CYCLE_MS[16] = {
+        5120, 10240, 20480, 40960, 61440, 81920, 102400, 122880,
+        143360, 163840, 327680, 655360, 1310720, 2621440, 5242880, 10485760};
+    uint32_t nibble = 0;
+    return parseBits(bits, 4, nibble) ? CYCLE_MS[nibble] : 0;
+}
+
+static bool samePowerSaving(const ModemPowerSaving_t& a, const ModemPowerSaving_t& b)
+{
+    return a.periodic_tau_s == b.periodic_tau_s && a.active_time_s == b.active_time_s &&
+           a.edrx_cycle_ms == b.edrx_cycle_ms && a.paging_window_ms == b.paging_window_ms &&
+           a.psm_granted == b.psm_granted && a.edrx_granted == b.edrx_granted &&
+           a.left_attached == b.left_attached;
+}
+
+void SimConnection::configurePowerSaving()
+{
+    ModemPowerSaving_t granted = {};
+    char resp[160] = {0};
+
+    if ((PSM_EN & 1) != 0)
+    {
+        // The modem keeps the request, so a modem left attached has it already
+        if (!power_saving.left_attached && !hndlr.send(psm_request))
+        {
+            printf("PSM request rejected by modem\n");
+        }
+
+        // +CEREG: 4,<stat>,"<tac>","<ci>",<AcT>,,,"<active time>","<periodic TAU>"
+        if (hndlr.send(cereg_psm_report))
+        {
+            if (hndlr.sendQuery(cereg_cmd, resp, sizeof(resp)))
+            {
+                // A URC (+CEREG: <stat>,"<tac>",...) has no <n>, so its fields sit one place earlier
+                const AtResponse cereg = parseAtResponse(resp);
+                int32_t mode = -1;
+                int32_t stat = -1;
+                if (cereg.is(AtResult::Cereg) && cereg.intField(0, mode) && mode == 4 && cereg.intField(1, stat))
+                {
+                    granted.active_time_s = decodeGprsTimer2(cereg.textField(7));
+                    granted.periodic_tau_s = decodeGprsTimer3(cereg.textField(8));
+                }
+                else
+                {
+                    printf("Unexpected CEREG PSM report: %s\n", resp);
+                }
+            }
+
+            if (!hndlr.send(cereg_report_off))
+            {
+                printf("Failed to turn CEREG reports back off\n");
+            }
+        }
+        granted.psm_granted = granted.active_time_s > 0 && granted.periodic_tau_s > 0;
+    }
+
+    if ((PSM_EN & 2) != 0)
+    {
+        if (!power_saving.left_attached && !hndlr.send(edrx_request))
+        {
+            printf("eDRX request rejected by modem\n");
+        }
+
+        // +CEDRXRDP: <AcT>,"<requested>","<network>","<paging window>"
+        memset(resp, 0, sizeof(resp));
+        if (hndlr.sendQuery(edrx_read, resp, sizeof(resp)))
+        {
+            const AtResponse edrx = parseAtResponse(resp);
+            int32_t act = 0;
+            uint32_t window = 0;
+            if (edrx.is(AtResult::CedrxRdp) && edrx.intField(0, act) && act != 0)
+            {
+                granted.edrx_cycle_ms = decodeEdrxCycleMs(edrx.textField(2));
+                if (parseBits(edrx.textField(3), 4, window))
+                {
+                    granted.paging_window_ms = (window + 1U) * 1280U;
+                }
+            }
+        }
+        granted.edrx_granted = granted.edrx_cycle_ms > 0;
+    }
+
+    printf("Power saving granted: PSM %s (TAU %lu s, active %lu s), eDRX %s (cycle %lu ms, window %lu ms)\n",
+           granted.psm_granted ? "yes" : "no",
+           static_cast<unsigned long>(granted.periodic_tau_s),
+           static_cast<unsigned long>(granted.active_time_s),
+           granted.edrx_granted ? "yes" : "no",
+           static_cast<unsigned long>(granted.edrx_cycle_ms),
+           static_cast<unsigned long>(granted.paging_window_ms));
+
+    // Written only when something changed, to spare the flash
+    granted.left_attached = power_saving.left_attached;
+    if (!samePowerSaving(granted, power_saving))
+    {
+        power_saving = granted;
+        if (!eeprom.saveModemPowerSaving(power_saving))
+        {
+            printf("Failed to persist power saving state\n");
+        }
+    }
+}
+
+bool SimConnection::keepAttachedAcrossSleep() const
+{
+    // After a failed attach the next wake should start from a clean modem
+    return PSM_EN != 0 && sim_stat == SimStatus::CONNECTED &&
+           (power_saving.psm_granted || power_saving.edrx_granted);
+}
+
+void SimConnection::setLeftAttached(bool left_attached)
+{
+    if (power_saving.left_attached == left_attached)
+    {
+        return;
+    }
+
+    power_saving.left_attached = left_attached;
+    if (!eeprom.saveModemPowerSaving(power_saving))
+    {
+        printf("Failed to persist power saving state\n");
+    }
+}
+
+void SimConnection::wakeModem()
+{
+#if MODEM_WAKE_GPIO >= 0
+    const gpio_num_t pin = static_cast<gpio_num_t>(MODEM_WAKE_GPIO);
+
+    gpio_set_level(pin, 1);
+    gpio_set_direction(pin, GPIO_MODE_OUTPUT);
+    gpio_set_level(pin, 0);
+    vTaskDelay(pdMS_TO_TICKS(MODEM_WAKE_PULSE_MS));
+    gpio_set_level(pin, 1);
+#endif
+}
+
+bool SimConnection::pdpContextActive()
+{
+    char qiact_resp[128] = {0};
+
+    // Only active contexts are listed; an idle modem answers with a bare OK
+    if (!hndlr.sendQuery(check_ip, qiact_resp, sizeof(qiact_resp)))
+    {
+        return false;
+    }
+
+    const AtResponse qiact = parseAtResponse(qiact_resp);
+    int32_t context_id = -1;
+    int32_t state = -1;
+    return qiact.is(AtResult::QiAct) && qiact.intField(0, context_id) && qiact.intField(1, state) &&
+           context_id == 1 && state == 1;
+}
+
+SslOpenProfile_t SimConnection::loadSslProfile()
+{
+    char revision[sizeof(ssl_cache.revision)] = {0};
+    if (!hndlr.sendAndCaptureInfo(firmware_revision, revision, sizeof(revision)))
+    {
+        // Nothing can be trusted or stored without knowing the firmware
+        printf("Modem revision unavailable, probing QSSLOPEN forms\n");
+        ssl_cache = {};
+        return {};
+    }
+
+    ModemSslCache_t stored = {};
+    if (eeprom.loadModemSslCache(stored) && strncmp(stored.revision, revision, sizeof(revision)) == 0)
+    {
+        ssl_cache = stored;
+        printf("Modem %s: QSSLOPEN variant %u\n", revision, static_cast<unsigned>(ssl_cache.open_variant));
+    }
+    else
+    {
+        ssl_cache = {};
+        memcpy(ssl_cache.revision, revision, sizeof(revision));
+        printf("Modem %s: no QSSLOPEN variant learned yet\n", revision);
+    }
+
+    return {ssl_cache.open_variant, ssl_cache.contextid_unsupported};
+}
+
+void SimConnection::storeSslProfile(const SslOpenProfile_t& profile)
+{
+    if (ssl_cache.revision[0] == '\0')
+    {
+        return;
+    }
+
+    // Written only when something changed, to spare the flash
+    if (profile.open_variant == ssl_cache.open_variant &&
+        profile.contextid_unsupported == ssl_cache.contextid_unsupported)
+    {
+        return;
+    }
+
+    ssl_cache.open_variant = profile.open_variant;
+    ssl_cache.contextid_unsupported = profile.contextid_unsupported;
+    if (!eeprom.saveModemSslCache(ssl_cache))
+    {
+        printf("Failed to persist QSSLOPEN profile\n");
+    }
+}
+
+bool SimConnection::openUdpSocket()
+{
+    for (int attempt = 1; attempt <= 2; ++attempt)
+    {
+        if (hndlr.openIPSocket("UDP", UDP_HOST, UDP_PORT, 1, 0, SOCKET_OPEN_TIMEOUT_MS))
+        {
+            return true;
+        }
+
+        // A socket left open by an earlier session holds the id; close it and try once more
+        printf("UDP socket open failed (attempt %d/2)\n", attempt);
+        closeUDPSocket();
+    }
+
+    return false;
+}
+
 bool SimConnection::estDataSession() 
 {
-    bool pdp_active = false;
+    bool pdp_active = pdpContextActive();
 
-    if (!hndlr.send(define_pdp))
+    if (pdp_active)
+    {
+        printf("PDP context 1 already active, reusing it\n");
+    }
+    else if (!hndlr.send(define_pdp))
     {
         printf("Failed to define PDP context\n");
         return false;
@@ -211,7 +648,13 @@ bool SimConnection::estDataSession()
         return false;
     }
 
-    for (int attempt = 1; attempt <= 3; ++attempt)
+    // Not fatal: without socket URCs the receive path polls instead
+    if (!hndlr.send(route_urcs_to_uart))
+    {
+        printf("Failed to route URCs to UART, socket receive will poll\n");
+    }
+
+    for (int attempt = 1; !pdp_active && attempt <= 3; ++attempt)
     {
         if (hndlr.send(activate_pdp))
         {
@@ -232,17 +675,27 @@ bool SimConnection::estDataSession()
         return false;
     }
 
-    // After PDP activation success
-    vTaskDelay(pdMS_TO_TICKS(4000));   // REQUIRED for EC25 stability
-
-    if (!hndlr.send(check_ip)) {
-        printf("PDP context not fully active\n");
-        return false;
+    // QIACT returns once the context is up, but the EC25 may take a moment to list it with an address
+    const TickType_t pdp_deadline = xTaskGetTickCount() + pdMS_TO_TICKS(PDP_READY_TIMEOUT_MS);
+    while (!pdpContextActive())
+    {
+        if (deadlinePassed(pdp_deadline))
+        {
+            printf("PDP context not fully active\n");
+            return false;
+        }
+        vTaskDelay(pdMS_TO_TICKS(READY_POLL_INTERVAL_MS));
     }
 
-    vTaskDelay(pdMS_TO_TICKS(5000));   // REQUIRED for EC25 stability
+    // Subscribe before the socket exists so the first "recv" URC is not missed
+    if (!udp_watch.begin())
+    {
+        printf("UDP socket URC subscription failed, socket receive will poll\n");
+    }
+    udp_watch.clear();
 
-    if (!hndlr.send(open_socket))
+    // Waits for the +QIOPEN result instead of assuming the socket is ready after a fixed delay
+    if (!openUdpSocket())
     {
         printf("Failed to open UDP socket\n");
         deactivatePDP();
@@ -252,20 +705,93 @@ bool SimConnection::estDataSession()
     return true;
 }
 
+void SimConnection::resetModem()
+{
+    ModemLine_t line = {};
+    QueueHandle_t rdy_queue = xQueueCreate(1, sizeof(ModemLine_t));
+    const bool watch_rdy = (rdy_queue != nullptr) && g_modem_reader.subscribe("RDY", rdy_queue);
+
+    printf("Resetting modem (AT+CFUN=1,1)\n");
+    hndlr.send(cfun_reset);
+
+    // The modem announces the end of its boot with "RDY"; fall back to polling AT if that is missed
+    bool ready = watch_rdy && xQueueReceive(rdy_queue, &line, pdMS_TO_TICKS(MODEM_BOOT_TIMEOUT_MS)) == pdTRUE;
+
+    if (watch_rdy)
+    {
+        g_modem_reader.unsubscribe(rdy_queue);
+    }
+    if (rdy_queue != nullptr)
+    {
+        vQueueDelete(rdy_queue);
+    }
+
+    if (!ready)
+    {
+        printf("No RDY from modem after reset, polling AT\n");
+    }
+
+    sim_stat = SimStatus::DISCONNECTED;
+}
+
 bool SimConnection::connect()
 {
-    uint8_t retry_counter = 0;
-    uint8_t retry_limit = static_cast<uint8_t>(RETRIES);
-    const char *retry_phase = "initialization";
-    
+    const TickType_t connect_start = xTaskGetTickCount();
+    attach_timings = {};
+
     #if 0
     printf("Starting Quectel Connection\n");
     printf("%s\n", g_device_config.manf_info.sim_mod_sn.value);
     printf("%s\n", g_device_config.manf_info.sim_card_sn.value);
     #endif
 
-    hndlr.send(cfun_reset);
-    vTaskDelay(pdMS_TO_TICKS(8000));  // EC25 reboot time
+#if PSM_EN != 0
+    if (eeprom.loadModemPowerSaving(power_saving) && power_saving.left_attached)
+    {
+        printf("Modem was left registered at last sleep, resuming\n");
+        if (power_saving.psm_granted)
+        {
+            wakeModem();
+        }
+    }
+#endif
+
+    // Resume from whatever state the modem is in; a full reset is only the escalation
+    bool attached = attachFromCurrentState();
+    if (!attached)
+    {
+        printf("Attach from current modem state failed, escalating to modem reset\n");
+        const TickType_t reset_start = xTaskGetTickCount();
+        attach_timings.reset_used = true;
+        resetModem();
+        attach_timings.reset_ms = msSince(reset_start);
+        attached = attachFromCurrentState();
+    }
+
+    attach_timings.total_ms = msSince(connect_start);
+    printf("Attach timings (ms): modem %lu, sim %lu, registration %lu, data session %lu, reset %lu, total %lu%s\n",
+           static_cast<unsigned long>(attach_timings.modem_ready_ms),
+           static_cast<unsigned long>(attach_timings.sim_ready_ms),
+           static_cast<unsigned long>(attach_timings.registration_ms),
+           static_cast<unsigned long>(attach_timings.data_session_ms),
+           static_cast<unsigned long>(attach_timings.reset_ms),
+           static_cast<unsigned long>(attach_timings.total_ms),
+           attached ? "" : " (failed)");
+
+    return attached;
+}
+
+bool SimConnection::attachFromCurrentState()
+{
+    const char *phase = "modem ready check";
+    TickType_t phase_start = xTaskGetTickCount();
+    TickType_t phase_deadline = phase_start + pdMS_TO_TICKS(MODEM_READY_TIMEOUT_MS);
+    uint32_t polls = 0;
+
+    // Until a phase shows otherwise, the modem is still registered as it was left at the last sleep
+    bool resumed = power_saving.left_attached && !attach_timings.reset_used;
+
+    sim_stat = SimStatus::DISCONNECTED;
 
     while (sim_stat != SimStatus::CONNECTED)
     {
@@ -277,8 +803,6 @@ bool SimConnection::connect()
 
         case SimStatus::INIT:
         {
-            retry_limit = static_cast<uint8_t>(RETRIES);
-            retry_phase = "modem initialization";
             bool init_success = true;
             for (auto &cmd : hndlr.at_command_table)
             {
@@ -288,35 +812,43 @@ bool SimConnection::connect()
                     init_success = false;
                     break;
                 }
-                vTaskDelay(pdMS_TO_TICKS(100));
+            }
+
+            // The radio is left off by the CFUN=0 of the previous disconnect; turn it on without a reboot
+            char cfun_resp[32] = {0};
+            int32_t fun = -1;
+            if (init_success && hndlr.sendQuery(cfun_query, cfun_resp, sizeof(cfun_resp)) &&
+                parseAtResponse(cfun_resp).intField(0, fun) && fun != 1)
+            {
+                printf("Modem radio off (CFUN=%d), enabling\n", static_cast<int>(fun));
+                init_success = hndlr.send(radio_on);
+                resumed = false;
             }
 
             if (init_success)
             {
-                retry_counter = 0;
-                printf("INIT complete, waiting for modem to settle...\n");
-                vTaskDelay(pdMS_TO_TICKS(3000)); // 3 second settling time
+                attach_timings.modem_ready_ms = msSince(phase_start);
+                printf("INIT complete after %lu poll(s)\n", static_cast<unsigned long>(polls + 1));
+                phase = "SIM ready check";
+                phase_start = xTaskGetTickCount();
+                phase_deadline = phase_start + pdMS_TO_TICKS(SIM_READY_TIMEOUT_MS);
+                polls = 0;
                 sim_stat = SimStatus::NOTREADY;
             }
+            else if (deadlinePassed(phase_deadline))
+            {
+                sim_stat = SimStatus::ERROR;
+            }
             else
             {
-                retry_counter++;
-                if (retry_counter >= retry_limit)
-                {
-                    sim_stat = SimStatus::ERROR;
-                }
-                else
-                {
-                    vTaskDelay(pdMS_TO_TICKS(5000)); // Increase retry delay for INIT
-                }
+                polls++;
+                vTaskDelay(pdMS_TO_TICKS(READY_POLL_INTERVAL_MS));
             }
         }
         break;
 
         case SimStatus::NOTREADY:
         {
-            retry_limit = static_cast<uint8_t>(RETRIES);
-            retry_phase = "SIM ready check";
             bool status_ok = false;
             for (auto &cmd : hndlr.at_command_table)
             {
@@ -330,38 +862,38 @@ bool SimConnection::connect()
 
             if (status_ok)
             {
-                retry_counter = 0;
+                attach_timings.sim_ready_ms = msSince(phase_start);
+                phase = "network registration";
+                phase_start = xTaskGetTickCount();
+                phase_deadline = phase_start + pdMS_TO_TICKS(REGISTRATION_TIMEOUT_MS);
+                polls = 0;
                 sim_stat = SimStatus::REGISTERING;
             }
+            else if (deadlinePassed(phase_deadline))
+            {
+                sim_stat = SimStatus::ERROR;
+            }
             else
             {
-                retry_counter++;
-                if (retry_counter >= retry_limit)
-                {
-                    sim_stat = SimStatus::ERROR;
-                }
-                else
-                {
-                    printf("STATUS check failed, retry %d/%d\n", retry_counter, retry_limit);
-                    vTaskDelay(pdMS_TO_TICKS(5000));
-                }
+                polls++;
+                resumed = false;
+                printf("STATUS check failed, poll %lu\n", static_cast<unsigned long>(polls));
+                vTaskDelay(pdMS_TO_TICKS(READY_POLL_INTERVAL_MS));
             }
         }
         break;
 
         case SimStatus::REGISTERING:
         {
-            retry_limit = static_cast<uint8_t>(REG_RETRIES);
-            retry_phase = "network registration";
             bool registered = false;
 
             char cereg_resp[128] = {0};
-            if (hndlr.sendAndCapture(cereg_cmd, cereg_resp, sizeof(cereg_resp)))
+            if (hndlr.sendQuery(cereg_cmd, cereg_resp, sizeof(cereg_resp)))
             {
-                int n = -1;
-                int stat = -1;
+                const AtResponse cereg = parseAtResponse(cereg_resp);
+                int32_t stat = -1;
 
-                if (sscanf(cereg_resp, "+CEREG: %d,%d", &n, &stat) == 2)
+                if (cereg.is(AtResult::Cereg) && cereg.intField(1, stat))
                 {
                     if (stat == 1 || stat == 5)
                     {
@@ -369,7 +901,7 @@ bool SimConnection::connect()
                     }
                     else
                     {
-                        printf("CEREG not registered yet (stat=%d)\n", stat);
+                        printf("CEREG not registered yet (stat=%d)\n", static_cast<int>(stat));
                     }
                 }
                 else
@@ -384,29 +916,38 @@ bool SimConnection::connect()
 
             if (registered)
             {
-                retry_counter = 0;
+                attach_timings.registration_ms = msSince(phase_start);
                 sim_stat = SimStatus::CONNECTED;
                 printf("Device connected to network\n");
-            }
-            else
-            {
-                retry_counter++;
-                if (retry_counter >= retry_limit)
+
+                // The modem keeps its PSM/eDRX request, and the timers granted with the registration are in NVS
+                if (resumed)
                 {
-                    sim_stat = SimStatus::ERROR;
+                    printf("Registration resumed, keeping stored power saving timers\n");
                 }
-                else
+                else if (PSM_EN != 0)
                 {
-                    printf("CEREG not ready, retry %d/%d\n", retry_counter, retry_limit);
-                    vTaskDelay(pdMS_TO_TICKS(3000));
+                    configurePowerSaving();
                 }
             }
+            else if (deadlinePassed(phase_deadline))
+            {
+                sim_stat = SimStatus::ERROR;
+            }
+            else
+            {
+                polls++;
+                resumed = false;
+                vTaskDelay(pdMS_TO_TICKS(REGISTRATION_POLL_INTERVAL_MS));
+            }
         }
         break;
 
         case SimStatus::ERROR:
-            printf("ERROR SIM STAT - Max retries exceeded\n");
-            printf("Failed during %s after %d/%d retries\n", retry_phase, retry_counter, retry_limit);
+            printf("ERROR SIM STAT - phase deadline exceeded\n");
+            printf("Failed during %s after %lu ms (%lu poll(s))\n", phase,
+                   static_cast<unsigned long>(msSince(phase_start)), static_cast<unsigned long>(polls));
+            sim_stat = SimStatus::DISCONNECTED;
             return false;
 
         case SimStatus::CONNECTED:
@@ -416,8 +957,13 @@ bool SimConnection::connect()
         }
     }
 
-    if (!estDataSession())
+    const TickType_t session_start = xTaskGetTickCount();
+    const bool session_ok = estDataSession();
+    attach_timings.data_session_ms = msSince(session_start);
+
+    if (!session_ok)
     {
+        sim_stat = SimStatus::DISCONNECTED;
         return false;
     }
 
@@ -466,6 +1012,22 @@ void SimConnection::disconnect()
 
     // Close UDP socket first
     closeUDPSocket();
+
+#if PSM_EN != 0
+    // Registration and the PDP context survive deep sleep, so the next wake skips the attach
+    if (keepAttachedAcrossSleep())
+    {
+        printf("Leaving modem registered (next wake in %lu s, PSM active time %lu s, TAU %lu s)\n",
+               static_cast<unsigned long>(g_device_config.main_app_delay),
+               static_cast<unsigned long>(power_saving.active_time_s),
+               static_cast<unsigned long>(power_saving.periodic_tau_s));
+        setLeftAttached(true);
+        sim_stat = SimStatus::DISCONNECTED;
+        printf("SIM disconnected\n");
+        return;
+    }
+    setLeftAttached(false);
+#endif
     
     // Deactivate PDP context
     deactivatePDP();
@@ -497,118 +1059,94 @@ bool SimConnection::sendPacket(const uint8_t * cbor_buffer,
                                const PktEntry_t pkt_config,
                                std::string* response)
 {
-    /**
-     * Storing the complete COAP packet to be sent.
-     * By the AT CMD Handlr.
-     * 
-     * ReadingArray -> CBOR data
-     * CBOR placed into COAP pkt
-     */
-    uint8_t coap_buffer[GEN_BUFFER_SIZE + 64];
-    size_t coap_buffer_len = 0;
-    char send_cmd[64];
-
-    if (cbor_buffer_len > 0 && !cbor_buffer)
+    if (!response)
     {
-        printf("Invalid packet parameters\n");
-        return false;
+        return sendPacketStream(cbor_buffer, cbor_buffer_len, pkt_config, nullptr);
     }
 
-    if (response)
-    {
-        response->clear();
-        return sendPacketStream(
-            cbor_buffer,
-            cbor_buffer_len,
-            pkt_config,
-            [response](const uint8_t* chunk, size_t chunk_len) -> bool {
-                if (!chunk || chunk_len == 0)
-                {
-                    return true;
-                }
-
-                response->append(reinterpret_cast<const char*>(chunk), chunk_len);
+    response->clear();
+    return sendPacketStream(
+        cbor_buffer,
+        cbor_buffer_len,
+        pkt_config,
+        [response](const uint8_t* chunk, size_t chunk_len) -> bool {
+            if (!chunk || chunk_len == 0)
+            {
                 return true;
-            });
-    }
+            }
 
-    auto ensure_connected = [this]() -> bool {
-        if (sim_stat == SimStatus::CONNECTED) {
+            response->append(reinterpret_cast<const char*>(chunk), chunk_len);
             return true;
-        }
-
-        printf("SIM not connected, attempting reconnect before send\n");
-        return connect();
-    };
-
-    if (!ensure_connected())
-    {
-        printf("Cannot send packet: reconnect failed\n");
-        return false;
-    }
-
-    coap_buffer_len = CoapPktAssm::buildCoapBuffer(coap_buffer, cbor_buffer, cbor_buffer_len, pkt_config);
+        });
+}
 
-    if (coap_buffer_len == 0) {
-        return false;
-    }
-    
+bool SimConnection::sendPacketStream(const uint8_t * cbor_buffer,
+                                     const size_t cbor_buffer_len,
+                                     const PktEntry_t pkt_config,
+                                     const PacketChunkCallback& onChunk)
+{
+    return exchangePacket(cbor_buffer, cbor_buffer_len, pkt_config, onChunk, nullptr, nullptr);
+}
 
-    auto send_udp_packet = [&]() -> bool {
-        snprintf(send_cmd, sizeof(send_cmd), "AT+QISEND=0,%zu", coap_buffer_len);
+bool SimConnection::fetchBlock(const PktEntry_t pkt_config,
+                               const CoapBlockOpt_t& request_block,
+                               CoapBlockOpt_t& response_block,
+                               const PacketChunkCallback& onChunk)
+{
+    response_block = request_block;
+    return exchangePacket(nullptr, 0, pkt_config, onChunk, &request_block, &response_block);
+}
 
-        ATCommand_t udp_send = {
-            send_cmd,
-            ">",
-            5000,
-            MsgType::DATA,
-            coap_buffer,
-            coap_buffer_len};
+uint8_t SimConnection::maxBlockSzx() const
+{
+    return MAX_BLOCK_SZX;
+}
 
-        return hndlr.send(udp_send);
-    };
+size_t SimConnection::sendPacketBatch(std::span<PacketRequest_t> requests)
+{
+    std::vector<CoapRequest_t> coap_requests(requests.size());
 
-    if (!send_udp_packet())
+    for (size_t i = 0; i < requests.size(); ++i)
     {
-        printf("Failed to send UDP packet, resetting SIM data link\n");
-        disconnect();
+        (void)CoapTransaction::prepare(coap_requests[i],
+                                       requests[i].cbor_buffer,
+                                       requests[i].cbor_buffer_len,
+                                       requests[i].pkt_config,
+                                       requests[i].onChunk);
+    }
 
-        if (!ensure_connected())
-        {
-            printf("SIM reconnect failed after send failure\n");
-            return false;
-        }
+    const size_t succeeded = runExchange(coap_requests);
 
-        if (!send_udp_packet())
-        {
-            printf("Failed to send UDP packet after reconnect\n");
-            disconnect();
-            return false;
-        }
+    for (size_t i = 0; i < requests.size(); ++i)
+    {
+        requests[i].success = coap_requests[i].success;
     }
 
-    // Wait for SEND OK
-    vTaskDelay(pdMS_TO_TICKS(1000));
-
-    printf("CoAP packet sent successfully via UDP\n");
-    return true;
+    return succeeded;
 }
 
-bool SimConnection::sendPacketStream(const uint8_t * cbor_buffer,
-                                     const size_t cbor_buffer_len,
-                                     const PktEntry_t pkt_config,
-                                     const PacketChunkCallback& onChunk)
+bool SimConnection::exchangePacket(const uint8_t * cbor_buffer,
+                                   const size_t cbor_buffer_len,
+                                   const PktEntry_t pkt_config,
+                                   const PacketChunkCallback& onChunk,
+                                   const CoapBlockOpt_t* request_block,
+                                   CoapBlockOpt_t* response_block)
 {
-    uint8_t coap_buffer[GEN_BUFFER_SIZE + 64];
-    size_t coap_buffer_len = 0;
-    char send_cmd[64];
+    CoapRequest_t request;
 
-    if (cbor_buffer_len > 0 && !cbor_buffer)
+    if (!CoapTransaction::prepare(request, cbor_buffer, cbor_buffer_len, pkt_config, onChunk, request_block, response_block))
     {
-        printf("Invalid packet parameters\n");
         return false;
     }
 
+    return runExchange(std::span<CoapRequest_t>(&request, 1)) == 1;
+}
+
+size_t SimConnection::runExchange(std::span<CoapRequest_t> requests)
+{
+    bool first_send = true;
+    int read_timeout_ms = PKT_SOCKET_READ_TIMEOUT_DEFAULT_MS;
+
     auto ensure_connected = [this]() -> bool {
         if (sim_stat == SimStatus::CONNECTED) {
             return true;
@@ -621,31 +1159,27 @@ bool SimConnection::sendPacketStream(const uint8_t * cbor_buffer,
     if (!ensure_connected())
     {
         printf("Cannot send packet: reconnect failed\n");
-        return false;
+        return 0;
     }
 
-    coap_buffer_len = CoapPktAssm::buildCoapBuffer(coap_buffer, cbor_buffer, cbor_buffer_len, pkt_config);
-
-    if (coap_buffer_len == 0) {
-        return false;
-    }
-
-    auto send_udp_packet = [&]() -> bool {
-        snprintf(send_cmd, sizeof(send_cmd), "AT+QISEND=0,%zu", coap_buffer_len);
+    auto send_udp_datagram = [this](std::span<const uint8_t> header, std::span<const uint8_t> payload) -> bool {
+        return hndlr.sendSocketData(0, header, payload, 5000);
+    };
 
-        ATCommand_t udp_send = {
-            send_cmd,
-            ">",
-            5000,
-            MsgType::DATA,
-            coap_buffer,
-            coap_buffer_len};
+    // Only the first transmission may trigger a link reset; retransmissions just report failure.
+    auto send_datagram = [&](std::span<const uint8_t> header, std::span<const uint8_t> payload) -> bool {
+        if (send_udp_datagram(header, payload))
+        {
+            first_send = false;
+            return true;
+        }
 
-        return hndlr.send(udp_send);
-    };
+        if (!first_send)
+        {
+            return false;
+        }
 
-    if (!send_udp_packet())
-    {
+        first_send = false;
         printf("Failed to send UDP packet, resetting SIM data link\n");
         disconnect();
 
@@ -655,85 +1189,76 @@ bool SimConnection::sendPacketStream(const uint8_t * cbor_buffer,
             return false;
         }
 
-        if (!send_udp_packet())
+        if (!send_udp_datagram(header, payload))
         {
             printf("Failed to send UDP packet after reconnect\n");
             disconnect();
             return false;
         }
-    }
 
-    vTaskDelay(pdMS_TO_TICKS(1000));
+        return true;
+    };
 
-    if (!onChunk)
+    // A single QIRD serves every request in flight, so use the most patient read timeout among them
+    for (const CoapRequest_t& request : requests)
     {
-        printf("CoAP packet sent successfully via UDP\n");
-        return true;
+        read_timeout_ms = std::max(read_timeout_ms, request.pkt_config.socket_read_timeout);
     }
 
-    char rx_buffer[GEN_BUFFER_SIZE + 64] = {0};
-    size_t rx_read = 0;
-    int empty_reads = 0;
-    bool got_any_payload = false;
-    static constexpr int EMPTY_READS_TO_FINISH = 5;
-    const int response_window_ms = (pkt_config.response_win > 0)
-                                       ? pkt_config.response_win
-                                       : PKT_RESPONSE_WIN_DEFAULT_MS;
-    const int read_timeout_ms = (pkt_config.socket_read_timeout > 0)
-                                    ? pkt_config.socket_read_timeout
-                                    : PKT_SOCKET_READ_TIMEOUT_DEFAULT_MS;
-    const TickType_t deadline = xTaskGetTickCount() + pdMS_TO_TICKS(response_window_ms);
-
-    auto has_time_remaining = [deadline]() -> bool {
-        return static_cast<int32_t>(deadline - xTaskGetTickCount()) > 0;
-    };
+    // Without socket URCs, poll faster on a link with short round trips, slower on a sluggish one
+    const int poll_interval_ms = RttEstimator::pollIntervalMs(RttEstimator::Transport::Sim, SOCKET_POLL_INTERVAL_MS);
 
-    while (has_time_remaining())
-    {
-        if (!hndlr.readSocketData(0, rx_buffer, sizeof(rx_buffer), &rx_read, read_timeout_ms, sizeof(rx_buffer) - 1))
-        {
-            vTaskDelay(pdMS_TO_TICKS(150));
-            continue;
-        }
+    // The modem only announces data when its buffer goes from empty to non-empty, so it is
+    // drained before sleeping on the URC. Datagrams left over from an earlier call are read first.
+    bool buffer_may_hold_data = true;
 
-        if (rx_read == 0)
+    // QIRD returns one datagram per read on a UDP socket; wait for the modem to report one or time to run out.
+    auto recv_datagram = [this, read_timeout_ms, poll_interval_ms, &buffer_may_hold_data](uint8_t* buf, size_t buf_len, size_t* out_len, int timeout_ms) -> bool {
+        const TickType_t deadline = xTaskGetTickCount() + pdMS_TO_TICKS(timeout_ms);
+
+        *out_len = 0;
+        do
         {
-            empty_reads++;
-            if (got_any_payload && empty_reads >= EMPTY_READS_TO_FINISH)
+            if (buffer_may_hold_data)
             {
-                printf("CoAP packet sent successfully via UDP\n");
-                return true;
+                if (hndlr.readSocketData(0, reinterpret_cast<char*>(buf), buf_len, out_len, read_timeout_ms, buf_len - 1) &&
+                    *out_len > 0)
+                {
+                    return true;
+                }
+                buffer_may_hold_data = false;
             }
 
-            vTaskDelay(pdMS_TO_TICKS(120));
-            continue;
-        }
+            if (!udp_watch.active())
+            {
+                vTaskDelay(pdMS_TO_TICKS(poll_interval_ms));
+                buffer_may_hold_data = true;
+                continue;
+            }
 
-        empty_reads = 0;
+            // Read anyway after the fallback interval in case a URC was lost
+            const TickType_t fallback = xTaskGetTickCount() + pdMS_TO_TICKS(SOCKET_URC_FALLBACK_POLL_MS);
+            const SocketRecvWatch::Event event =
+                udp_watch.wait(static_cast<int32_t>(deadline - fallback) < 0 ? deadline : fallback);
 
-        std::string payload_chunk;
-        if (Utils::extractCoapPayloadChunk(rx_buffer, rx_read, payload_chunk) > 0)
-        {
-            if (!onChunk(reinterpret_cast<const uint8_t*>(payload_chunk.data()), payload_chunk.size()))
+            if (event == SocketRecvWatch::Event::Closed)
             {
-                printf("Streaming callback aborted firmware receive\n");
+                printf("UDP socket closed by the modem\n");
+                *out_len = 0;
                 return false;
             }
 
-            got_any_payload = true;
-        }
-
-        vTaskDelay(pdMS_TO_TICKS(80));
-    }
+            buffer_may_hold_data = true;
+        } while (static_cast<int32_t>(deadline - xTaskGetTickCount()) > 0);
 
-    if (got_any_payload)
-    {
-        printf("CoAP packet sent successfully via UDP\n");
+        *out_len = 0;
         return true;
-    }
+    };
 
-    printf("Timed out waiting for response payload (%d ms)\n", response_window_ms);
-    return false;
+    const size_t succeeded = CoapTransaction::exchange(requests, send_datagram, recv_datagram, RttEstimator::Transport::Sim);
+
+    printf("CoAP exchange via UDP: %zu/%zu request(s) acknowledged\n", succeeded, requests.size());
+    return succeeded;
 }
 
 bool SimConnection::streamHttpsGet(const std::string& url, const PacketChunkCallback& onChunk)
@@ -783,7 +1308,11 @@ bool SimConnection::streamHttpsGet(const std::string& url, const PacketChunkCall
     // Best effort cleanup in case socket id 1 was left open by a previous attempt.
     close_https_socket();
 
-    if (!hndlr.openSSLSocket(host.c_str(), port, 1, 1, 45000))
+    SslOpenProfile_t ssl_profile = loadSslProfile();
+    const bool ssl_opened = hndlr.openSSLSocket(host.c_str(), port, 1, 1, 45000, &ssl_profile);
+    storeSslProfile(ssl_profile);
+
+    if (!ssl_opened)
     {
         printf("Failed to open SSL socket to %s:%u\n", host.c_str(), static_cast<unsigned>(port));
         return false;
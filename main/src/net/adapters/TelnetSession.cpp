@@ -16,6 +16,12 @@ bool TelnetSession::start(ATCommandHndlr& at_handler)
         return true;
     }
 
+    // Socket URCs reach the session even while another task is talking to the modem
+    if (!recv_watch.begin())
+    {
+        printf("Telnet CLI could not subscribe to socket URCs, polling instead\n");
+    }
+
     hndlr = &at_handler;
     keep_running = true;
 
@@ -32,6 +38,7 @@ bool TelnetSession::start(ATCommandHndlr& at_handler)
         session_task_handle = nullptr;
         keep_running = false;
         hndlr = nullptr;
+        recv_watch.end();
         printf("Failed to create telnet CLI task\n");
         return false;
     }
@@ -55,6 +62,7 @@ void TelnetSession::stop()
         closeSocket();
     }
 
+    recv_watch.end();
     hndlr = nullptr;
 }
 
@@ -85,6 +93,9 @@ void TelnetSession::sessionLoop()
                 continue;
             }
 
+            // Events of an earlier connection must not be taken for this one
+            recv_watch.clear();
+
             if (!openSocket())
             {
                 if (open_failures < 6)
@@ -116,6 +127,7 @@ void TelnetSession::sessionLoop()
             }
 
             socket_open = true;
+            data_pending = true;
             open_failures = 0;
             next_connect_tick = 0;
             command_len = 0;
@@ -133,7 +145,7 @@ void TelnetSession::sessionLoop()
         }
 
         size_t bytes_read = 0;
-        if (!readIncoming(rx_buf, sizeof(rx_buf), &bytes_read))
+        if (data_pending && !readIncoming(rx_buf, sizeof(rx_buf), &bytes_read))
         {
             printf("Telnet read failed, reconnecting socket\n");
             socket_open = false;
@@ -144,14 +156,33 @@ void TelnetSession::sessionLoop()
         if (bytes_read > 0) {
             processIncoming(rx_buf, bytes_read);
             last_activity_tick = xTaskGetTickCount();
-        } else {
-            TickType_t now = xTaskGetTickCount();
-            if ((now - last_activity_tick) >= KEEPALIVE_INTERVAL) {
-                (void)sendText("\r\n");
-                last_activity_tick = now;
-            }
+            continue;  // More may be buffered; read again before sleeping
+        }
+
+        data_pending = false;
+        TickType_t now = xTaskGetTickCount();
+        if ((now - last_activity_tick) >= KEEPALIVE_INTERVAL) {
+            (void)sendText("\r\n");
+            last_activity_tick = now;
+        }
+
+        if (!recv_watch.active()) {
             vTaskDelay(SESSION_POLL_INTERVAL);
+            data_pending = true;
+            continue;
         }
+
+        // Sleep until the modem reports data; the fallback read covers a lost URC
+        const SocketRecvWatch::Event event = recv_watch.wait(now + URC_FALLBACK_POLL_INTERVAL);
+        if (event == SocketRecvWatch::Event::Closed)
+        {
+            printf("Telnet socket closed by peer, reconnecting socket\n");
+            socket_open = false;
+            next_connect_tick = xTaskGetTickCount() + RECONNECT_DELAY;
+            continue;
+        }
+
+        data_pending = true;
     }
 
     if (socket_open)
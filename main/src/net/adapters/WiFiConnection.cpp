@@ -1,4 +1,6 @@
 #include "WiFiConnection.hpp"
+#include "CoapTransaction.hpp"
+#include "LibCoapClient.hpp"
 #include "esp_wifi.h"
 #include "esp_log.h"
 #include "freertos/event_groups.h"
@@ -10,11 +12,16 @@
 #include <netinet/in.h>
 #include <arpa/inet.h>
 #include <unistd.h>
+#include <cerrno>
 #include <cstring>
+#include <vector>
 
 #define WIFI_SSID "NETGEAR77"
 #define WIFI_PASS "aquaticcarrot628"
 
+#define COAP_SERVER_IP   "45.79.118.187"
+#define COAP_SERVER_PORT 5683
+
 void WifiConnection::wifi_event_handler(void * arg, esp_event_base_t event_base, int32_t event_id, void * event_data) 
 {
     WifiConnection * self = static_cast<WifiConnection*>(arg);
@@ -99,59 +106,141 @@ bool WifiConnection::sendPacket(const uint8_t * cbor_buffer,
                                 const size_t cbor_buffer_len,
                                 const PktEntry_t pkt_config,
                                 std::string* response) {
-    /**
-     * Build CBOR Packet with pkt from NPK readings
-     * Send packet using SOCKET
-     */
-
-    uint8_t coap_buffer[512];
-    size_t coap_buffer_len = 0;
-    int sock_fd = -1;
-    struct sockaddr_in dest_addr;
-
-    if (!cbor_buffer || cbor_buffer_len == 0)
-    {
-        printf("Invalid packet parameters\n");
-        return false;
-    }
+    PacketChunkCallback on_payload = nullptr;
 
     if (response)
     {
         response->clear();
+        on_payload = [response](const uint8_t* chunk, size_t chunk_len) -> bool {
+            response->append(reinterpret_cast<const char*>(chunk), chunk_len);
+            return true;
+        };
+    }
+
+    return exchangePacket(cbor_buffer, cbor_buffer_len, pkt_config, on_payload, nullptr, nullptr);
+}
+
+bool WifiConnection::fetchBlock(const PktEntry_t pkt_config,
+                                const CoapBlockOpt_t& request_block,
+                                CoapBlockOpt_t& response_block,
+                                const PacketChunkCallback& onChunk) {
+    response_block = request_block;
+    return exchangePacket(nullptr, 0, pkt_config, onChunk, &request_block, &response_block);
+}
+
+size_t WifiConnection::sendPacketBatch(std::span<PacketRequest_t> requests) {
+#if COAP_BACKEND == COAP_BACKEND_LIBCOAP
+    std::vector<LibCoapRequest_t> coap_requests(requests.size());
+
+    for (size_t i = 0; i < requests.size(); ++i) {
+        coap_requests[i] = {std::span<const uint8_t>(requests[i].cbor_buffer, requests[i].cbor_buffer_len),
+                            requests[i].pkt_config, requests[i].onChunk, nullptr, nullptr, false};
+    }
+
+    const size_t succeeded = LibCoapClient::exchange(coap_requests, COAP_SERVER_IP, COAP_SERVER_PORT);
+#else
+    std::vector<CoapRequest_t> coap_requests(requests.size());
+
+    for (size_t i = 0; i < requests.size(); ++i) {
+        (void)CoapTransaction::prepare(coap_requests[i],
+                                       requests[i].cbor_buffer,
+                                       requests[i].cbor_buffer_len,
+                                       requests[i].pkt_config,
+                                       requests[i].onChunk);
     }
 
-    coap_buffer_len = CoapPktAssm::buildCoapBuffer(coap_buffer, cbor_buffer, cbor_buffer_len, pkt_config);
+    const size_t succeeded = runExchange(coap_requests);
+#endif
 
+    for (size_t i = 0; i < requests.size(); ++i) {
+        requests[i].success = coap_requests[i].success;
+    }
+
+    return succeeded;
+}
 
-    if (coap_buffer_len == 0) {
+bool WifiConnection::exchangePacket(const uint8_t * cbor_buffer,
+                                    const size_t cbor_buffer_len,
+                                    const PktEntry_t pkt_config,
+                                    const PacketChunkCallback& onPayload,
+                                    const CoapBlockOpt_t* request_block,
+                                    CoapBlockOpt_t* response_block) {
+#if COAP_BACKEND == COAP_BACKEND_LIBCOAP
+    LibCoapRequest_t request = {std::span<const uint8_t>(cbor_buffer, cbor_buffer_len),
+                                pkt_config, onPayload, request_block, response_block, false};
+
+    return LibCoapClient::exchange(std::span<LibCoapRequest_t>(&request, 1), COAP_SERVER_IP, COAP_SERVER_PORT) == 1;
+#else
+    CoapRequest_t request;
+
+    if (!CoapTransaction::prepare(request, cbor_buffer, cbor_buffer_len, pkt_config, onPayload, request_block, response_block)) {
         return false;
     }
 
+    return runExchange(std::span<CoapRequest_t>(&request, 1)) == 1;
+#endif
+}
+
+size_t WifiConnection::runExchange(std::span<CoapRequest_t> requests) {
+    int sock_fd = -1;
+    struct sockaddr_in dest_addr;
+
     sock_fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
     if (sock_fd < 0) {
         printf("Failed to create socket\n");
-        return false;
+        return 0;
     }
 
     memset(&dest_addr, 0, sizeof(dest_addr));
     dest_addr.sin_family = AF_INET;
-    dest_addr.sin_port = htons(5683);
-    inet_pton(AF_INET, "45.79.118.187", &dest_addr.sin_addr);
+    dest_addr.sin_port = htons(COAP_SERVER_PORT);
+    inet_pton(AF_INET, COAP_SERVER_IP, &dest_addr.sin_addr);
+
+    // Gather write: header and CBOR payload leave in one datagram without an intermediate copy
+    auto send_datagram = [&](std::span<const uint8_t> header, std::span<const uint8_t> payload) -> bool {
+        struct iovec iov[2] = {
+            {const_cast<uint8_t*>(header.data()), header.size()},
+            {const_cast<uint8_t*>(payload.data()), payload.size()}
+        };
+        struct msghdr msg = {};
+        msg.msg_name = &dest_addr;
+        msg.msg_namelen = sizeof(dest_addr);
+        msg.msg_iov = iov;
+        msg.msg_iovlen = payload.empty() ? 1 : 2;
+
+        if (sendmsg(sock_fd, &msg, 0) < 0)
+        {
+            printf("Failed to send UDP packet: errno=%d\n", errno);
+            return false;
+        }
 
+        return true;
+    };
 
-    // --- Send the packet ---
-    int err = sendto(sock_fd, coap_buffer, coap_buffer_len, 0,
-                     (struct sockaddr*)&dest_addr, sizeof(dest_addr));
-    if (err < 0)
-    {
-        printf("Failed to send UDP packet: errno=%d\n", errno);
-        close(sock_fd);
-        return false;
-    }
+    auto recv_datagram = [sock_fd](uint8_t* buf, size_t buf_len, size_t* out_len, int timeout_ms) -> bool {
+        struct timeval tv = {};
+        const int wait_ms = (timeout_ms > 0) ? timeout_ms : 1;
+        tv.tv_sec = wait_ms / 1000;
+        tv.tv_usec = (wait_ms % 1000) * 1000;
+
+        *out_len = 0;
+        setsockopt(sock_fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+        const ssize_t n = recv(sock_fd, buf, buf_len, 0);
+        if (n < 0)
+        {
+            return (errno == EAGAIN || errno == EWOULDBLOCK);
+        }
+
+        *out_len = static_cast<size_t>(n);
+        return true;
+    };
+
+    const size_t succeeded = CoapTransaction::exchange(requests, send_datagram, recv_datagram, RttEstimator::Transport::Wifi);
 
-    printf("Sent %zu bytes to 45.79.118.187\n", coap_buffer_len);
+    printf("Sent %zu request(s) to %s, %zu acknowledged\n", requests.size(), COAP_SERVER_IP, succeeded);
 
     close(sock_fd);
 
-    return true;
+    return succeeded;
 }
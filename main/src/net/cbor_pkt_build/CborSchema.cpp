@@ -0,0 +1,457 @@
+#include "CborSchema.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#include "esp_attr.h"
+#include "Key.hpp"
+#include "ReadingPkt.hpp"
+
+void CborWriter::text(std::string_view value)
+{
+    head(MAJOR_TEXT, value.size());
+    raw(std::span<const uint8_t>(reinterpret_cast<const uint8_t *>(value.data()), value.size()));
+}
+
+void CborWriter::bytes(std::span<const uint8_t> value)
+{
+    head(MAJOR_BYTES, value.size());
+    raw(value);
+}
+
+void CborWriter::float32(float value)
+{
+    uint32_t bits = 0;
+    uint8_t encoded[5];
+
+    memcpy(&bits, &value, sizeof(bits));
+    encoded[0] = 0xFA;
+    encoded[1] = static_cast<uint8_t>(bits >> 24);
+    encoded[2] = static_cast<uint8_t>(bits >> 16);
+    encoded[3] = static_cast<uint8_t>(bits >> 8);
+    encoded[4] = static_cast<uint8_t>(bits);
+    raw(encoded);
+}
+
+void CborWriter::raw(std::span<const uint8_t> encoded)
+{
+    if (!m_ok || encoded.size() > m_capacity - m_len)
+    {
+        m_ok = false;
+        return;
+    }
+
+    memcpy(m_buffer + m_len, encoded.data(), encoded.size());
+    m_len += encoded.size();
+}
+
+void CborWriter::head(uint8_t major, uint64_t value)
+{
+    uint8_t encoded[9];
+    size_t len = 0;
+    const uint8_t type = static_cast<uint8_t>(major << 5);
+
+    // Shortest form: immediate, then 1, 2, 4 or 8 argument bytes (RFC 8949 Section 3)
+    if (value < 24)
+    {
+        encoded[len++] = static_cast<uint8_t>(type | value);
+    }
+    else
+    {
+        size_t arg_len = 8;
+        uint8_t info = 27;
+
+        if (value <= UINT8_MAX)
+        {
+            arg_len = 1;
+            info = 24;
+        }
+        else if (value <= UINT16_MAX)
+        {
+            arg_len = 2;
+            info = 25;
+        }
+        else if (value <= UINT32_MAX)
+        {
+            arg_len = 4;
+            info = 26;
+        }
+
+        encoded[len++] = static_cast<uint8_t>(type | info);
+        for (size_t i = arg_len; i > 0; --i)
+        {
+            encoded[len++] = static_cast<uint8_t>(value >> (8 * (i - 1)));
+        }
+    }
+
+    raw(std::span<const uint8_t>(encoded, len));
+}
+
+namespace {
+
+/*
+ * Layouts. Identity fields come first; the per-packet fields follow in wire order and the
+ * authentication trailer closes the map.
+ */
+constexpr SchemaEntry ACTIVATE_FIELDS[] = {
+    {textKey("node_id"), SchemaField::NodeId},
+    {textKey("fw_ver"), SchemaField::FwVer},
+    {textKey("secretkey"), SchemaField::SecretKey},
+    {textKey("gps"), SchemaField::Gps},
+    {textKey("hw_ver"), SchemaField::HwVer},
+    {textKey("sim_mod_sn"), SchemaField::SimModSn},
+    {textKey("sim_card_sn"), SchemaField::SimCardSn},
+    {textKey("chassis_ver"), SchemaField::ChassisVer},
+    {textKey("session"), SchemaField::Session},
+    {textKey("seq"), SchemaField::Seq},
+    {textKey("mac"), SchemaField::Mac},
+};
+
+constexpr SchemaEntry GPS_UPDATE_FIELDS[] = {
+    {textKey("node_id"), SchemaField::NodeId},
+    {textKey("fw_ver"), SchemaField::FwVer},
+    {textKey("gps"), SchemaField::Gps},
+    {textKey("session"), SchemaField::Session},
+    {textKey("seq"), SchemaField::Seq},
+    {textKey("mac"), SchemaField::Mac},
+};
+
+constexpr SchemaEntry READING_LEGACY_FIELDS[] = {
+    {textKey("node_id"), SchemaField::NodeId},
+    {textKey("m_type"), SchemaField::MType},
+    {textKey("readings"), SchemaField::Samples},
+    {textKey("session"), SchemaField::Session},
+    {textKey("seq"), SchemaField::Seq},
+    {textKey("mac"), SchemaField::Mac},
+};
+
+// Integer keys as documented on ReadingEncoding
+constexpr SchemaEntry READING_COMPACT_FIELDS[] = {
+    {uintKey(0), SchemaField::Encoding},
+    {uintKey(1), SchemaField::NodeId},
+    {uintKey(2), SchemaField::MType},
+    {uintKey(4), SchemaField::Samples},
+    {uintKey(5), SchemaField::Session},
+    {uintKey(6), SchemaField::Seq},
+    {uintKey(7), SchemaField::Mac},
+};
+
+struct LayoutDef
+{
+    std::span<const SchemaEntry> entries;
+    size_t identity_count;
+};
+
+constexpr LayoutDef LAYOUTS[] = {
+    {ACTIVATE_FIELDS, 2},
+    {GPS_UPDATE_FIELDS, 2},
+    {READING_LEGACY_FIELDS, 1},
+    {READING_COMPACT_FIELDS, 2},
+};
+
+static_assert(std::size(LAYOUTS) == static_cast<size_t>(PacketLayout::Count), "one layout per PacketLayout");
+
+constexpr bool isIdentityField(SchemaField field)
+{
+    return field <= SchemaField::FwVer;
+}
+
+constexpr SchemaField TRAILER[PacketSchema::TRAILER_FIELDS] = {SchemaField::Session, SchemaField::Seq, SchemaField::Mac};
+
+static_assert([]() {
+    for (const LayoutDef &layout : LAYOUTS)
+    {
+        const size_t trailer_start = layout.entries.size() - PacketSchema::TRAILER_FIELDS;
+
+        for (size_t i = 0; i < layout.entries.size(); ++i)
+        {
+            const SchemaField field = layout.entries[i].field;
+
+            if (layout.entries[i].key.len == 0 || isIdentityField(field) != (i < layout.identity_count) ||
+                (i >= trailer_start && field != TRAILER[i - trailer_start]) || (i < trailer_start && field >= SchemaField::Session))
+            {
+                return false;
+            }
+        }
+    }
+    return true;
+}(), "schema keys must fit SchemaKey, identity fields must lead and the trailer must close each layout");
+
+/**
+ * @brief Pre-encoded identity run of one layout.
+ */
+struct IdentityPrefix
+{
+    uint8_t bytes[PacketSchema::IDENTITY_PREFIX_MAX];
+    size_t len;
+};
+
+/**
+ * @brief Sequence numbering of the current session, tagged with a magic to detect cold boots.
+ */
+struct SeqState
+{
+    uint32_t magic;
+    uint64_t session;
+    uint32_t next_seq;
+};
+
+constexpr uint32_t SEQ_STATE_MAGIC = 0x5E0C0040;
+
+constexpr uint8_t CBOR_MAJOR_MAP = 5;
+constexpr size_t SKIP_MAX_DEPTH = 8;
+
+/**
+ * @brief Read the head of the item at offset and advance past it.
+ * @return false if the head is truncated or uses an indefinite length, which CborWriter never writes
+ */
+bool readHead(std::span<const uint8_t> data, size_t &offset, uint8_t &major, uint64_t &arg)
+{
+    if (offset >= data.size())
+    {
+        return false;
+    }
+
+    const uint8_t info = data[offset] & 0x1F;
+    major = static_cast<uint8_t>(data[offset] >> 5);
+    arg = info;
+    offset++;
+
+    if (info < 24)
+    {
+        return true;
+    }
+
+    if (info > 27)
+    {
+        return false;
+    }
+
+    const size_t arg_len = size_t{1} << (info - 24);
+
+    if (arg_len > data.size() - offset)
+    {
+        return false;
+    }
+
+    arg = 0;
+    for (size_t i = 0; i < arg_len; ++i)
+    {
+        arg = (arg << 8) | data[offset++];
+    }
+
+    return true;
+}
+
+/**
+ * @brief Offset just past the item starting at offset.
+ * @return The offset, or 0 if the item is malformed, truncated or nested too deeply
+ */
+size_t skipItem(std::span<const uint8_t> data, size_t offset, size_t depth)
+{
+    uint8_t major = 0;
+    uint64_t arg = 0;
+
+    if (depth > SKIP_MAX_DEPTH || !readHead(data, offset, major, arg))
+    {
+        return 0;
+    }
+
+    switch (major)
+    {
+    case 2: // Byte string
+    case 3: // Text string
+        return (arg <= data.size() - offset) ? offset + static_cast<size_t>(arg) : 0;
+
+    case 4: // Array
+    case 5: // Map
+    {
+        const uint64_t items = (major == CBOR_MAJOR_MAP) ? 2 * arg : arg;
+
+        for (uint64_t i = 0; i < items && offset != 0; ++i)
+        {
+            offset = skipItem(data, offset, depth + 1);
+        }
+        return offset;
+    }
+
+    case 6: // Tag: the tagged item follows
+        return skipItem(data, offset, depth + 1);
+
+    default: // Integers, simple values and floats are all head
+        return offset;
+    }
+}
+
+IdentityPrefix s_prefixes[static_cast<size_t>(PacketLayout::Count)];
+char s_node_id[MANF_MAX_LEN];
+RTC_DATA_ATTR SeqState s_seq_state;
+
+} // namespace
+
+bool PacketSchema::cacheIdentity(const DeviceConfig &config)
+{
+    const std::string_view node_id(config.manf_info.nodeId.value, strnlen(config.manf_info.nodeId.value, MANF_MAX_LEN));
+    const std::string_view fw_ver(config.manf_info.fw_ver.value, strnlen(config.manf_info.fw_ver.value, MANF_MAX_LEN));
+    bool ok = true;
+    bool mac_ok = true;
+
+    memset(s_node_id, 0, sizeof(s_node_id));
+    memcpy(s_node_id, node_id.data(), std::min(node_id.size(), sizeof(s_node_id) - 1));
+
+    // A wake that sent packets but failed before saving the session count continues its numbering
+    if (s_seq_state.magic != SEQ_STATE_MAGIC || s_seq_state.session != config.session_count)
+    {
+        s_seq_state = {SEQ_STATE_MAGIC, config.session_count, 0};
+    }
+
+    if (std::any_of(std::begin(config.secretKey), std::end(config.secretKey), [](uint8_t b) { return b != 0; }))
+    {
+        mac_ok = Key::loadMacKey(config.secretKey);
+    }
+
+    for (size_t i = 0; i < std::size(LAYOUTS); ++i)
+    {
+        IdentityPrefix &prefix = s_prefixes[i];
+        CborWriter writer(prefix.bytes, sizeof(prefix.bytes));
+
+        for (const SchemaEntry &entry : LAYOUTS[i].entries.first(LAYOUTS[i].identity_count))
+        {
+            writer.raw(entry.key.span());
+
+            switch (entry.field)
+            {
+            case SchemaField::Encoding:
+                writer.uint(static_cast<uint64_t>(READING_ENCODING));
+                break;
+            case SchemaField::NodeId:
+                writer.text(node_id);
+                break;
+            case SchemaField::FwVer:
+                writer.text(fw_ver);
+                break;
+            default:
+                break;
+            }
+        }
+
+        prefix.len = writer.ok() ? writer.size() : 0;
+        ok = ok && writer.ok();
+    }
+
+    if (!ok)
+    {
+        printf("Failed to pre-encode packet identity prefix\n");
+    }
+
+    return ok && mac_ok;
+}
+
+std::span<const SchemaEntry> PacketSchema::fields(PacketLayout layout)
+{
+    return LAYOUTS[static_cast<size_t>(layout)].entries;
+}
+
+size_t PacketSchema::identityCount(PacketLayout layout)
+{
+    return LAYOUTS[static_cast<size_t>(layout)].identity_count;
+}
+
+std::span<const uint8_t> PacketSchema::identityPrefix(PacketLayout layout, std::string_view node_id)
+{
+    const IdentityPrefix &prefix = s_prefixes[static_cast<size_t>(layout)];
+
+    if (prefix.len == 0)
+    {
+        printf("Packet identity prefix not cached\n");
+        return {};
+    }
+
+    if (!Key::macReady())
+    {
+        printf("No packet MAC key loaded\n");
+        return {};
+    }
+
+    if (node_id != std::string_view(s_node_id))
+    {
+        printf("Packet node ID does not match the cached identity\n");
+        return {};
+    }
+
+    return std::span<const uint8_t>(prefix.bytes, prefix.len);
+}
+
+bool PacketSchema::writeTrailer(const TrailerKeys &keys, CborWriter &writer, const uint8_t *start)
+{
+    uint8_t tag[Key::TAG_SIZE];
+
+    writer.raw(keys[0]);
+    writer.uint(s_seq_state.session);
+    writer.raw(keys[1]);
+    writer.uint(s_seq_state.next_seq++);
+
+    // The tag covers every byte before its key, so the server strips the fixed-size entry to verify
+    if (!writer.ok() || !Key::computeTag(std::span<const uint8_t>(start, writer.size()), tag))
+    {
+        printf("Failed to compute packet MAC\n");
+        return false;
+    }
+
+    writer.raw(keys[2]);
+    writer.bytes(tag);
+    return writer.ok();
+}
+
+size_t PacketSchema::refreshTrailer(std::span<const uint8_t> payload, std::span<uint8_t> out)
+{
+    size_t offset = 0;
+    uint8_t major = 0;
+    uint64_t count = 0;
+
+    if (!readHead(payload, offset, major, count) || major != CBOR_MAJOR_MAP || count < TRAILER_FIELDS)
+    {
+        return 0;
+    }
+
+    // Identity and per-packet pairs are kept as they are
+    for (uint64_t i = 0; i < 2 * (count - TRAILER_FIELDS) && offset != 0; ++i)
+    {
+        offset = skipItem(payload, offset, 0);
+    }
+
+    const size_t body_len = offset;
+    TrailerKeys keys;
+
+    for (size_t i = 0; i < TRAILER_FIELDS && offset != 0; ++i)
+    {
+        const size_t key_end = skipItem(payload, offset, 0);
+
+        keys[i] = payload.subspan(offset, key_end - offset);
+        offset = (key_end != 0) ? skipItem(payload, key_end, 0) : 0;
+    }
+
+    if (body_len == 0 || offset != payload.size())
+    {
+        return 0;
+    }
+
+    CborWriter writer(out.data(), out.size());
+    writer.raw(payload.first(body_len));
+
+    return writeTrailer(keys, writer, out.data()) ? writer.size() : 0;
+}
+
+void PacketSchema::writeGps(CborWriter &writer, const GpsFix_t &fix)
+{
+    writer.array(fix.has_quality ? 4 : 2);
+    writer.sint(fix.lat_e7);
+    writer.sint(fix.lon_e7);
+
+    if (fix.has_quality)
+    {
+        writer.uint(fix.hdop_x10);
+        writer.sint(fix.alt_dm);
+    }
+}
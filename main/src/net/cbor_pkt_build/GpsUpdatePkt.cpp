@@ -5,46 +5,26 @@
 
 const uint8_t * GpsUpdatePkt::toBuffer()
 {
-    CborEncoder encoder, mapEncoder;
-    cbor_encoder_init(&encoder, buffer, GEN_BUFFER_SIZE, 0);
-    
-    // Root map with 3 elements: node_id, gps, key
-    if (cbor_encoder_create_map(&encoder, &mapEncoder, 4) != CborNoError)
-    {
-        ESP_LOGI("OK", "Failed to create root map");
+    uint8_t *buffer = payloadBuffer();
+    if (!buffer)
         return nullptr;
-    }
-
-    if (strlen((const char*)g_device_config.secretKey) == 0) {
-        ESP_LOGI("OK", "Secret key is empty, cannot encode GpsUpdatePkt");
-        return nullptr;
-    }
-
-    // node_id
-    cbor_encode_text_stringz(&mapEncoder, NODE_ID_KEY);
-    cbor_encode_text_stringz(&mapEncoder, node_id.c_str());
-
-    // gps
-    cbor_encode_text_stringz(&mapEncoder, GPS_KEY);
-    cbor_encode_text_stringz(&mapEncoder, GPSCoord.c_str());
-
-    // key as raw bytes
-    cbor_encode_text_stringz(&mapEncoder, KEY_KEY);
-    cbor_encode_byte_string(&mapEncoder, g_device_config.secretKey, sizeof(g_device_config.secretKey));
-
-    cbor_encode_text_stringz(&mapEncoder, FW_VER_KEY);
-    cbor_encode_text_stringz(&mapEncoder, g_device_config.manf_info.fw_ver.value);
 
+    // node_id and fw_ver come from the cached identity prefix; the session, seq and MAC close the map
+    bufferLength = PacketSchema::encode(PacketLayout::GpsUpdate, node_id,
+                                        std::span<uint8_t>(buffer, FramePool::PAYLOAD_CAPACITY),
+                                        [this](CborWriter &writer, SchemaField field) -> bool {
+        if (field != SchemaField::Gps)
+            return false;
 
-    // Close map
-    cbor_encoder_close_container(&encoder, &mapEncoder);
+        PacketSchema::writeGps(writer, GPSFix);
+        return true;
+    });
 
-    bufferLength = cbor_encoder_get_buffer_size(&encoder, buffer);
-    if (bufferLength > GEN_BUFFER_SIZE)
+    if (bufferLength == 0)
     {
-        ESP_LOGI("OK", "CBOR OVERFLOW Failed to create root map");
+        printf("Failed to encode GPS update packet\n");
         return nullptr;
     }
 
     return buffer;
-}
\ No newline at end of file
+}
@@ -1,28 +1,98 @@
 #include "Key.hpp"
 #include "psa/crypto.h"
 
+#include <cstdio>
+
 // Required for static constexpr array with external linkage in C++14/17
 constexpr uint8_t Key::secretKey[Key::HMAC_KEY_SIZE];
 
-void Key::computeKey(uint8_t* out_hmac, size_t out_len) {
+bool Key::computeKey(uint8_t* out_hmac, size_t out_len) {
     psa_key_attributes_t attributes = PSA_KEY_ATTRIBUTES_INIT;
     psa_key_id_t key_id = 0;
     size_t mac_length = 0;
 
+    // Activation runs before the first loadMacKey(), so PSA may not be up yet
+    if (psa_crypto_init() != PSA_SUCCESS) {
+        printf("PSA crypto init failed\n");
+        return false;
+    }
+
     psa_set_key_usage_flags(&attributes, PSA_KEY_USAGE_SIGN_HASH);
     psa_set_key_algorithm(&attributes, PSA_ALG_HMAC(PSA_ALG_SHA_256));
     psa_set_key_type(&attributes, PSA_KEY_TYPE_HMAC);
     psa_set_key_bits(&attributes, HMAC_KEY_SIZE * 8);
 
-    if (psa_import_key(&attributes, secretKey, HMAC_KEY_SIZE, &key_id) != PSA_SUCCESS) {
-        psa_reset_key_attributes(&attributes);
-        return;
-    }
+    psa_status_t status = psa_import_key(&attributes, secretKey, HMAC_KEY_SIZE, &key_id);
+    psa_reset_key_attributes(&attributes);
 
-    psa_mac_compute(key_id, PSA_ALG_HMAC(PSA_ALG_SHA_256),
-                    NULL, 0,
-                    out_hmac, out_len, &mac_length);
+    if (status != PSA_SUCCESS) {
+        printf("Failed to import device secret (%d)\n", static_cast<int>(status));
+        return false;
+    }
 
+    status = psa_mac_compute(key_id, PSA_ALG_HMAC(PSA_ALG_SHA_256),
+                             NULL, 0,
+                             out_hmac, out_len, &mac_length);
     psa_destroy_key(key_id);
+
+    if (status != PSA_SUCCESS || mac_length != HMAC_SIZE) {
+        printf("Failed to derive device key (%d)\n", static_cast<int>(status));
+        return false;
+    }
+
+    return true;
+}
+
+namespace {
+
+constexpr psa_algorithm_t TAG_ALG = PSA_ALG_TRUNCATED_MAC(PSA_ALG_HMAC(PSA_ALG_SHA_256), Key::TAG_SIZE);
+
+psa_key_id_t s_mac_key = 0;
+
+} // namespace
+
+bool Key::loadMacKey(std::span<const uint8_t, HMAC_SIZE> device_key) {
+    psa_key_attributes_t attributes = PSA_KEY_ATTRIBUTES_INIT;
+
+    if (s_mac_key != 0) {
+        psa_destroy_key(s_mac_key);
+        s_mac_key = 0;
+    }
+
+    if (psa_crypto_init() != PSA_SUCCESS) {
+        printf("PSA crypto init failed\n");
+        return false;
+    }
+
+    psa_set_key_usage_flags(&attributes, PSA_KEY_USAGE_SIGN_MESSAGE);
+    psa_set_key_algorithm(&attributes, TAG_ALG);
+    psa_set_key_type(&attributes, PSA_KEY_TYPE_HMAC);
+    psa_set_key_bits(&attributes, HMAC_SIZE * 8);
+
+    const psa_status_t status = psa_import_key(&attributes, device_key.data(), device_key.size(), &s_mac_key);
     psa_reset_key_attributes(&attributes);
-}
\ No newline at end of file
+
+    if (status != PSA_SUCCESS) {
+        printf("Failed to import packet MAC key (%d)\n", static_cast<int>(status));
+        s_mac_key = 0;
+        return false;
+    }
+
+    return true;
+}
+
+bool Key::macReady() {
+    return s_mac_key != 0;
+}
+
+bool Key::computeTag(std::span<const uint8_t> message, std::span<uint8_t, TAG_SIZE> tag) {
+    size_t tag_length = 0;
+
+    if (s_mac_key == 0) {
+        return false;
+    }
+
+    return psa_mac_compute(s_mac_key, TAG_ALG, message.data(), message.size(),
+                           tag.data(), tag.size(), &tag_length) == PSA_SUCCESS &&
+           tag_length == TAG_SIZE;
+}
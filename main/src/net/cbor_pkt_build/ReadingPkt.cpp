@@ -5,56 +5,100 @@
 
 const uint8_t * ReadingPkt::toBuffer()
 {
-    CborEncoder encoder, mapEncoder, arrayEncoder;
-    cbor_encoder_init(&encoder, buffer, GEN_BUFFER_SIZE, 0);
-
-    if (cbor_encoder_create_map(&encoder, &mapEncoder, 5) != CborNoError)
+    uint8_t *buffer = payloadBuffer();
+    if (!buffer)
         return nullptr;
 
-    // node_id
-    if (cbor_encode_text_stringz(&mapEncoder, NODE_ID_KEY) != CborNoError ||
-        cbor_encode_text_stringz(&mapEncoder, this->node_id.c_str()) != CborNoError)
-        return nullptr;
+    // node_id (and the encoding marker for compact layouts) come from the cached identity prefix;
+    // PacketSchema::encode appends the session, sequence number and MAC
+    bufferLength = PacketSchema::encode(LAYOUT, this->node_id,
+                                        std::span<uint8_t>(buffer, FramePool::PAYLOAD_CAPACITY),
+                                        [this](CborWriter &writer, SchemaField field) -> bool {
+                                            return writeField(writer, field);
+                                        });
 
-    // m_type
-    if (cbor_encode_text_stringz(&mapEncoder, M_TYPE) != CborNoError ||
-        cbor_encode_text_stringz(&mapEncoder, mTypeToString()) != CborNoError)
+    if (bufferLength == 0)
         return nullptr;
 
-    cbor_encode_text_stringz(&mapEncoder, KEY_KEY);
-    cbor_encode_byte_string(&mapEncoder, g_device_config.secretKey, sizeof(g_device_config.secretKey));
+    return buffer;
+}
 
-    // readings array
-    if (cbor_encode_text_stringz(&mapEncoder, READINGS_ARR) != CborNoError)
-        return nullptr;
+bool ReadingPkt::writeField(CborWriter &writer, SchemaField field) const
+{
+    switch (field)
+    {
+        case SchemaField::MType:
+            if constexpr (READING_ENCODING == ReadingEncoding::Legacy)
+                writer.text(mTypeToString());
+            else
+                writer.uint(static_cast<uint64_t>(m_type));
+            return true;
 
-    if (cbor_encoder_create_array(&mapEncoder, &arrayEncoder, NPK_COLLECT_SIZE) != CborNoError)
-        return nullptr;
+        case SchemaField::Samples:
+        {
+            if constexpr (READING_ENCODING == ReadingEncoding::Legacy)
+            {
+                writer.array(NPK_COLLECT_SIZE);
+                for (size_t i = 0; i < NPK_COLLECT_SIZE; i++)
+                    writer.float32(this->reading[i]);
+                return true;
+            }
+
+            uint8_t samples[NPK_COLLECT_SIZE * DELTA_VARINT_MAX];
+            size_t samples_len = 0;
+
+            if constexpr (READING_ENCODING == ReadingEncoding::TypedArray)
+            {
+                samples_len = packSamplesBigEndian(samples);
+                writer.tag(TAG_UINT16_BE_ARRAY);
+            }
+            else
+            {
+                samples_len = packSamplesDeltaZigzag(samples);
+            }
+
+            writer.bytes(std::span<const uint8_t>(samples, samples_len));
+            return true;
+        }
 
+        default:
+            return false;
+    }
+}
+
+size_t ReadingPkt::packSamplesBigEndian(uint8_t *out) const
+{
     for (size_t i = 0; i < NPK_COLLECT_SIZE; i++)
     {
-        if (cbor_encode_float(&arrayEncoder, this->reading[i]) != CborNoError)
-            return nullptr;
+        out[2 * i] = static_cast<uint8_t>(this->reading[i] >> 8);
+        out[2 * i + 1] = static_cast<uint8_t>(this->reading[i] & 0xFF);
     }
 
-    // Close readings array before writing any more map entries
-    if (cbor_encoder_close_container(&mapEncoder, &arrayEncoder) != CborNoError)
-        return nullptr;
+    return NPK_COLLECT_SIZE * sizeof(uint16_t);
+}
 
-    // session
-    if (cbor_encode_text_stringz(&mapEncoder, SESSION) != CborNoError ||
-        cbor_encode_int(&mapEncoder, this->session_count) != CborNoError)
-        return nullptr;
+size_t ReadingPkt::packSamplesDeltaZigzag(uint8_t *out) const
+{
+    size_t len = 0;
+    int32_t previous = 0;
 
-    // Close root map
-    if (cbor_encoder_close_container(&encoder, &mapEncoder) != CborNoError)
-        return nullptr;
+    // The first sample is a delta from zero; consecutive samples usually differ by a few units
+    for (size_t i = 0; i < NPK_COLLECT_SIZE; i++)
+    {
+        const int32_t delta = static_cast<int32_t>(this->reading[i]) - previous;
+        uint32_t zigzag = (static_cast<uint32_t>(delta) << 1) ^ static_cast<uint32_t>(delta >> 31);
 
-    bufferLength = cbor_encoder_get_buffer_size(&encoder, buffer);
-    if (bufferLength > GEN_BUFFER_SIZE)
-        return nullptr;
+        previous = this->reading[i];
 
-    return buffer;
+        while (zigzag >= 0x80U)
+        {
+            out[len++] = static_cast<uint8_t>((zigzag & 0x7FU) | 0x80U);
+            zigzag >>= 7;
+        }
+        out[len++] = static_cast<uint8_t>(zigzag);
+    }
+
+    return len;
 }
 
 const char* ReadingPkt::mTypeToString() const
@@ -1,79 +1,145 @@
 #include "CoapPktAssm.hpp"
 #include <unistd.h>
+#include <array>
+#include <cstdio>
 #include <cstring>
 // #include "Logger.hpp"
 
+extern "C" {
+	#include "esp_random.h"
+}
+
 PktEntry_t firmwareversion_entry = {PktType::FirmwareVersion, CoapMethod::GET, PKT_RESPONSE_WIN_FW_VERSION_MS, PKT_SOCKET_READ_TIMEOUT_DEFAULT_MS};
 PktEntry_t activate_entry = {PktType::Activate, CoapMethod::POST, PKT_RESPONSE_WIN_DEFAULT_MS, PKT_SOCKET_READ_TIMEOUT_DEFAULT_MS};
 PktEntry_t reading_entry = {PktType::Reading, CoapMethod::POST, PKT_RESPONSE_WIN_DEFAULT_MS, PKT_SOCKET_READ_TIMEOUT_DEFAULT_MS};
 PktEntry_t gpsupdate_entry = {PktType::GpsUpdate, CoapMethod::PUT, PKT_RESPONSE_WIN_DEFAULT_MS, PKT_SOCKET_READ_TIMEOUT_DEFAULT_MS};
 PktEntry_t firmwaredownload_entry = {PktType::FirmwareDownload, CoapMethod::GET, PKT_RESPONSE_WIN_FW_DOWNLOAD_MS, PKT_SOCKET_READ_TIMEOUT_FW_DOWNLOAD_MS};
+PktEntry_t firmwareimage_entry = {PktType::FirmwareImage, CoapMethod::GET, PKT_RESPONSE_WIN_DEFAULT_MS, PKT_SOCKET_READ_TIMEOUT_DEFAULT_MS};
+
+namespace {
+
+/**
+ * @brief Fixed prefix of a request: header with zeroed message ID and token, Uri-Path and
+ * Content-Format options.
+ */
+struct CoapHeaderTemplate
+{
+	uint8_t bytes[COAP_FRAME_HEADER_MAX];
+	size_t len;
+};
 
-size_t CoapPktAssm::buildCoapBuffer(uint8_t coap_buffer[], const uint8_t *buffer, const size_t buffer_len, PktEntry_t pkt_config) 
+constexpr CoapHeaderTemplate makeHeaderTemplate(PktType pkt_type, CoapMethod method)
 {
+	CoapHeaderTemplate tpl = {};
+	const std::string_view uri_path = CoapPktAssm::getUriPath(pkt_type);
 	size_t offset = 0;
-	uint8_t code_detail = 0;
-	uint16_t msg_id = 0;
-	std::string uri_path;
 
-	if (buffer_len > 0 && !buffer)
-    {
-		printf("Invalid packet parameters\n");
-        return 0;
-    }
-	
-	printf("Building CoAP packet from CBOR payload (%zu bytes)\n", buffer_len);
+	// Byte 0: Ver(2 bits) | Type(2 bits) | TKL(4 bits), byte 1: Class(3 bits) | Detail(5 bits)
+	tpl.bytes[offset++] = static_cast<uint8_t>((COAP_VERSION << COAP_VERSION_SHIFT) |
+	                                           (COAP_TYPE_CON << COAP_TYPE_SHIFT) |
+	                                           COAP_DEFAULT_TOKEN_LEN);
+	tpl.bytes[offset++] = static_cast<uint8_t>((COAP_CODE_CLASS_REQUEST << COAP_CODE_CLASS_SHIFT) |
+	                                           CoapPktAssm::getMethodCode(method));
+
+	// Message ID and token are patched per request
+	offset += 2 + COAP_DEFAULT_TOKEN_LEN;
+
+	// Uri-Path option, with the 8-bit extended length when the path exceeds 12 bytes
+	if (uri_path.size() > COAP_OPTION_MAX_STANDARD)
+	{
+		tpl.bytes[offset++] = static_cast<uint8_t>((COAP_DELTA_URI_PATH << COAP_OPTION_DELTA_SHIFT) | COAP_OPTION_EXTENDED_LEN);
+		tpl.bytes[offset++] = static_cast<uint8_t>(uri_path.size() - COAP_OPTION_EXTENDED_LEN);
+	}
+	else
+	{
+		tpl.bytes[offset++] = static_cast<uint8_t>((COAP_DELTA_URI_PATH << COAP_OPTION_DELTA_SHIFT) | uri_path.size());
+	}
+
+	for (const char c : uri_path)
+	{
+		tpl.bytes[offset++] = static_cast<uint8_t>(c);
+	}
 
-	// CoAP Header
-	offset += setHeader(&coap_buffer[offset], COAP_VERSION, COAP_TYPE_CON, COAP_DEFAULT_TOKEN_LEN);
-	
-	// Method Code: POST (0.02) or PUT (0.03)
-	switch (pkt_config.method)
-	{
-	case CoapMethod::PUT:
-		code_detail = COAP_CODE_DETAIL_PUT;
-		break;
-	case CoapMethod::POST:
-		code_detail = COAP_CODE_DETAIL_POST;
-		break;
-	case CoapMethod::GET:
-		code_detail = COAP_CODE_DETAIL_GET;
-		break;
-	default:
-		break;
-	}
-
-	offset += setCode(&coap_buffer[offset], COAP_CODE_CLASS_REQUEST, code_detail);
-	
-	// Message ID
-	msg_id = getNextMessageId();
-	offset += setMessageId(&coap_buffer[offset], msg_id);
-	
-	// Token (4 bytes)
-	const uint8_t token[COAP_DEFAULT_TOKEN_LEN] = {
-		COAP_TOKEN_BYTE_0, 
-		COAP_TOKEN_BYTE_1, 
-		COAP_TOKEN_BYTE_2, 
-		COAP_TOKEN_BYTE_3
-	};
-	offset += setToken(&coap_buffer[offset], token, COAP_DEFAULT_TOKEN_LEN);
-	
-	// Uri-Path option
-	uri_path = getUriPath(pkt_config.pkt_type);
-	offset += setUriPathOption(&coap_buffer[offset], uri_path, COAP_DELTA_URI_PATH);
-	
 	// Content-Format option (CBOR)
-	offset += setContentFormatOption(&coap_buffer[offset], COAP_CONTENT_FORMAT_CBOR, COAP_DELTA_CONTENT_FORMAT);
-	
-	if (buffer_len > 0)
+	tpl.bytes[offset++] = static_cast<uint8_t>((COAP_DELTA_CONTENT_FORMAT << COAP_OPTION_DELTA_SHIFT) | 1);
+	tpl.bytes[offset++] = COAP_CONTENT_FORMAT_CBOR;
+
+	tpl.len = offset;
+	return tpl;
+}
+
+constexpr auto HEADER_TEMPLATES = []() {
+	std::array<std::array<CoapHeaderTemplate, CoapPktAssm::METHOD_COUNT>, CoapPktAssm::PKT_TYPE_COUNT> table = {};
+
+	for (size_t type = 0; type < CoapPktAssm::PKT_TYPE_COUNT; ++type)
 	{
-		// Payload marker
-		offset += setPayloadMarker(&coap_buffer[offset]);
+		for (size_t method = 0; method < CoapPktAssm::METHOD_COUNT; ++method)
+		{
+			table[type][method] = makeHeaderTemplate(static_cast<PktType>(type), static_cast<CoapMethod>(method));
+		}
+	}
 
-		// CBOR payload
-		offset += setPayload(&coap_buffer[offset], buffer, buffer_len);
+	return table;
+}();
+
+// Block2 (up to 4 bytes) and the payload marker are appended after the template
+constexpr size_t COAP_RUNTIME_SUFFIX_MAX = 5;
+
+static_assert([]() {
+	for (const auto &row : HEADER_TEMPLATES)
+	{
+		for (const CoapHeaderTemplate &tpl : row)
+		{
+			if (tpl.len + COAP_RUNTIME_SUFFIX_MAX > COAP_FRAME_HEADER_MAX)
+			{
+				return false;
+			}
+		}
 	}
-	
+	return true;
+}(), "COAP_FRAME_HEADER_MAX too small for the longest Uri-Path");
+
+}
+
+size_t CoapPktAssm::buildHeader(CoapFrameHeader_t &header, PktEntry_t pkt_config, bool has_payload,
+                                const CoapBlockOpt_t *block2)
+{
+	const size_t type_index = static_cast<size_t>(pkt_config.pkt_type);
+	const size_t method_index = static_cast<size_t>(pkt_config.method);
+
+	header.len = 0;
+
+	if (type_index >= PKT_TYPE_COUNT || method_index >= METHOD_COUNT)
+	{
+		printf("Invalid packet parameters\n");
+		return 0;
+	}
+
+	const CoapHeaderTemplate &tpl = HEADER_TEMPLATES[type_index][method_index];
+	size_t offset = tpl.len;
+
+	memcpy(header.bytes, tpl.bytes, tpl.len);
+
+	// Message ID (bytes 2-3)
+	setMessageId(&header.bytes[2], getNextMessageId());
+
+	// Token (4 random bytes) so concurrent responses and stale ones from earlier cycles can be told apart
+	uint8_t token[COAP_DEFAULT_TOKEN_LEN];
+	esp_fill_random(token, sizeof(token));
+	setToken(&header.bytes[COAP_HEADER_SIZE], token, COAP_DEFAULT_TOKEN_LEN);
+
+	// Block2 option (block-wise GET)
+	if (block2)
+	{
+		offset += setBlockOption(&header.bytes[offset], *block2, COAP_OPTION_BLOCK2 - COAP_OPTION_CONTENT_FORMAT);
+	}
+
+	if (has_payload)
+	{
+		offset += setPayloadMarker(&header.bytes[offset]);
+	}
+
+	header.len = offset;
 	return offset;
 }
 
@@ -86,14 +152,6 @@ size_t CoapPktAssm::setHeader(uint8_t *buffer, uint8_t version, uint8_t type, ui
 	return 1;
 }
 
-size_t CoapPktAssm::setCode(uint8_t *buffer, uint8_t code_class, uint8_t code_detail)
-{
-	// Byte 1: Class(3 bits) | Detail(5 bits)
-	buffer[0] = ((code_class & COAP_CODE_CLASS_MASK) << COAP_CODE_CLASS_SHIFT) | 
-	            (code_detail & COAP_CODE_DETAIL_MASK);
-	return 1;
-}
-
 size_t CoapPktAssm::setMessageId(uint8_t *buffer, uint16_t msg_id)
 {
 	// Bytes 2-3: Message ID (big-endian)
@@ -114,35 +172,27 @@ size_t CoapPktAssm::setToken(uint8_t *buffer, const uint8_t *token, uint8_t toke
 	return token_len;
 }
 
-size_t CoapPktAssm::setUriPathOption(uint8_t *buffer, const std::string &uri_path, uint8_t delta)
+size_t CoapPktAssm::setBlockOption(uint8_t *buffer, const CoapBlockOpt_t &block, uint8_t delta)
 {
-	size_t uri_len = uri_path.length();
-	
-	if (uri_len > COAP_OPTION_MAX_STANDARD)
+	const uint32_t value = (block.num << 4) | (block.more ? 0x08U : 0x00U) | (block.szx & 0x07U);
+	uint8_t value_bytes[3];
+	uint8_t length = 0;
+
+	// Zero encodes as an empty option value
+	if (value > 0xFFFFU)
 	{
-		// Extended length encoding needed
-		printf("Uri-Path length > %d, using extended encoding\n", COAP_OPTION_MAX_STANDARD);
-		buffer[0] = ((delta & COAP_OPTION_DELTA_MASK) << COAP_OPTION_DELTA_SHIFT) | COAP_OPTION_EXTENDED_LEN;
-		buffer[1] = static_cast<uint8_t>(uri_len - COAP_OPTION_EXTENDED_LEN);
-		memcpy(&buffer[2], uri_path.c_str(), uri_len);
-		return 2 + uri_len;
+		value_bytes[length++] = static_cast<uint8_t>((value >> 16) & 0xFF);
 	}
-	else
+	if (value > 0xFFU)
 	{
-		// Standard encoding: delta(4 bits) | length(4 bits)
-		buffer[0] = ((delta & COAP_OPTION_DELTA_MASK) << COAP_OPTION_DELTA_SHIFT) | 
-		            (uri_len & COAP_OPTION_LENGTH_MASK);
-		memcpy(&buffer[1], uri_path.c_str(), uri_len);
-		return 1 + uri_len;
+		value_bytes[length++] = static_cast<uint8_t>((value >> 8) & 0xFF);
+	}
+	if (value > 0)
+	{
+		value_bytes[length++] = static_cast<uint8_t>(value & 0xFF);
 	}
-}
 
-size_t CoapPktAssm::setContentFormatOption(uint8_t *buffer, uint8_t content_format, uint8_t delta)
-{
-	// Option header: delta(4 bits) | length(4 bits)
-	buffer[0] = ((delta & COAP_OPTION_DELTA_MASK) << COAP_OPTION_DELTA_SHIFT) | 0x01; // length = 1
-	buffer[1] = content_format;
-	return 2;
+	return setOption(buffer, delta, length, value_bytes);
 }
 
 size_t CoapPktAssm::setPayloadMarker(uint8_t *buffer)
@@ -151,15 +201,6 @@ size_t CoapPktAssm::setPayloadMarker(uint8_t *buffer)
 	return 1;
 }
 
-size_t CoapPktAssm::setPayload(uint8_t *buffer, const uint8_t *payload, size_t payload_len)
-{
-	if (payload_len > 0)
-	{
-		memcpy(buffer, payload, payload_len);
-	}
-	return payload_len;
-}
-
 size_t CoapPktAssm::setOption(uint8_t *buffer, uint8_t delta, uint8_t length, const uint8_t *value)
 {
 	size_t offset = 0;
@@ -180,25 +221,192 @@ size_t CoapPktAssm::setOption(uint8_t *buffer, uint8_t delta, uint8_t length, co
 
 uint16_t CoapPktAssm::getNextMessageId()
 {
-	static uint16_t msg_id = COAP_INITIAL_MSG_ID;
+	// Randomised start so IDs from consecutive wake cycles do not look like duplicates to the server
+	static uint16_t msg_id = static_cast<uint16_t>(esp_random());
 	return msg_id++;
 }
 
-std::string CoapPktAssm::getUriPath(PktType pkt_type)
+bool CoapPktAssm::parseMessage(std::span<const uint8_t> datagram, CoapMessage_t &msg)
+{
+	size_t offset = COAP_HEADER_SIZE;
+
+	msg = {};
+	msg.max_age = COAP_DEFAULT_MAX_AGE_S;
+
+	if (datagram.size() < COAP_HEADER_SIZE)
+	{
+		return false;
+	}
+
+	if (((datagram[0] >> COAP_VERSION_SHIFT) & COAP_VERSION_MASK) != COAP_VERSION)
+	{
+		return false;
+	}
+
+	const size_t token_len = datagram[0] & COAP_TOKEN_LEN_MASK;
+	msg.type = (datagram[0] >> COAP_TYPE_SHIFT) & COAP_TYPE_MASK;
+	msg.code = datagram[1];
+	msg.msg_id = static_cast<uint16_t>((datagram[2] << 8) | datagram[3]);
+
+	if (token_len > COAP_MAX_TOKEN_LEN || (offset + token_len) > datagram.size())
+	{
+		return false;
+	}
+
+	// An Empty message is the bare header (RFC 7252 Section 4.1)
+	if (msg.code == COAP_CODE_EMPTY)
+	{
+		return (datagram.size() == COAP_HEADER_SIZE);
+	}
+
+	msg.token = datagram.subspan(offset, token_len);
+	offset += token_len;
+
+	// Walk options until the payload marker or the end of the datagram
+	uint32_t option_number = 0;
+	while (offset < datagram.size())
+	{
+		const uint8_t opt_byte = datagram[offset++];
+
+		if (opt_byte == COAP_PAYLOAD_MARKER)
+		{
+			// A marker followed by a zero-length payload is a format error
+			if (offset >= datagram.size())
+			{
+				return false;
+			}
+
+			msg.payload = datagram.subspan(offset);
+			return true;
+		}
+
+		uint32_t delta = 0;
+		uint32_t opt_len = 0;
+		if (!readOptionField(datagram, offset, (opt_byte >> COAP_OPTION_DELTA_SHIFT) & COAP_OPTION_DELTA_MASK, delta) ||
+		    !readOptionField(datagram, offset, opt_byte & COAP_OPTION_LENGTH_MASK, opt_len) ||
+		    opt_len > (datagram.size() - offset))
+		{
+			return false;
+		}
+
+		option_number += delta;
+		const std::span<const uint8_t> value = datagram.subspan(offset, opt_len);
+		offset += opt_len;
+
+		switch (option_number)
+		{
+		case COAP_OPTION_URI_PATH:
+			// Only present in requests; understood, but nothing to extract
+			break;
+		case COAP_OPTION_CONTENT_FORMAT:
+		{
+			uint32_t content_format = 0;
+			if (decodeUintOption(value, 2, content_format))
+			{
+				msg.has_content_format = true;
+				msg.content_format = static_cast<uint16_t>(content_format);
+			}
+			break;
+		}
+		case COAP_OPTION_MAX_AGE:
+			if (!decodeUintOption(value, 4, msg.max_age))
+			{
+				msg.max_age = COAP_DEFAULT_MAX_AGE_S;
+			}
+			break;
+		case COAP_OPTION_BLOCK1:
+			if (!decodeBlockOption(value, msg.block1))
+			{
+				return false;
+			}
+			msg.has_block1 = true;
+			break;
+		case COAP_OPTION_BLOCK2:
+			if (!decodeBlockOption(value, msg.block2))
+			{
+				return false;
+			}
+			msg.has_block2 = true;
+			break;
+		default:
+			// Odd option numbers are critical and must not be silently ignored
+			if (option_number & 0x01U)
+			{
+				printf("CoAP MID 0x%04x: unrecognised critical option %lu\n", msg.msg_id,
+				       static_cast<unsigned long>(option_number));
+				return false;
+			}
+			break;
+		}
+	}
+
+	return true;
+}
+
+bool CoapPktAssm::readOptionField(std::span<const uint8_t> datagram, size_t &offset, uint8_t nibble, uint32_t &value)
+{
+	if (nibble < COAP_OPTION_EXT_8BIT)
+	{
+		value = nibble;
+		return true;
+	}
+
+	if (nibble == COAP_OPTION_EXT_8BIT && offset < datagram.size())
+	{
+		value = static_cast<uint32_t>(datagram[offset]) + COAP_OPTION_EXT_8BIT;
+		offset += 1;
+		return true;
+	}
+
+	if (nibble == COAP_OPTION_EXT_16BIT && (offset + 1) < datagram.size())
+	{
+		value = static_cast<uint32_t>((datagram[offset] << 8) | datagram[offset + 1]) + COAP_OPTION_EXT_16BIT_BASE;
+		offset += 2;
+		return true;
+	}
+
+	// Nibble 15 is reserved outside the payload marker
+	return false;
+}
+
+bool CoapPktAssm::decodeUintOption(std::span<const uint8_t> value, size_t max_len, uint32_t &out)
+{
+	if (value.size() > max_len)
+	{
+		return false;
+	}
+
+	out = 0;
+	for (const uint8_t byte : value)
+	{
+		out = (out << 8) | byte;
+	}
+
+	return true;
+}
+
+bool CoapPktAssm::decodeBlockOption(std::span<const uint8_t> value, CoapBlockOpt_t &block)
 {
-	switch (pkt_type)
-	{
-	case PktType::Activate:
-		return "activate";
-	case PktType::Reading:
-		return "reading";
-	case PktType::GpsUpdate:
-		return "gps-update";
-	case PktType::FirmwareVersion:
-		return "firmware-version";
-	case PktType::FirmwareDownload:
-		return "firmware-bin";
-	default:
-		return "";
+	uint32_t raw = 0;
+
+	if (!decodeUintOption(value, 3, raw) || (raw & 0x07U) == 0x07U)
+	{
+		return false;
 	}
+
+	block.num = raw >> 4;
+	block.more = (raw & 0x08U) != 0;
+	block.szx = static_cast<uint8_t>(raw & 0x07U);
+	return true;
+}
+
+size_t CoapPktAssm::buildEmptyAck(uint8_t *buffer, uint16_t msg_id)
+{
+	size_t offset = 0;
+
+	offset += setHeader(&buffer[offset], COAP_VERSION, COAP_TYPE_ACK, 0);
+	buffer[offset++] = COAP_CODE_EMPTY;
+	offset += setMessageId(&buffer[offset], msg_id);
+
+	return offset;
 }
\ No newline at end of file
@@ -0,0 +1,408 @@
+#include "CoapTransaction.hpp"
+
+#include <algorithm>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+
+#include "FramePool.hpp"
+
+extern "C" {
+	#include "esp_random.h"
+	#include "freertos/FreeRTOS.h"
+	#include "freertos/task.h"
+}
+
+size_t CoapTransaction::exchange(std::span<CoapRequest_t> requests,
+                                 const CoapDatagramSend& send,
+                                 const CoapDatagramRecv& recv,
+                                 RttEstimator::Transport transport)
+{
+	FrameBuffer rx_frame;
+	PendingRequest_t table[COAP_NSTART] = {};
+	CoapMessage_t rx_msg;
+	size_t next_request = 0;
+	size_t in_flight = 0;
+	size_t succeeded = 0;
+
+	for (CoapRequest_t& request : requests)
+	{
+		request.success = false;
+	}
+
+	if (!send || !recv)
+	{
+		printf("Invalid CoAP transaction parameters\n");
+		return 0;
+	}
+
+	// Received datagrams land in a pooled frame rather than on the caller's stack
+	if (!rx_frame.acquire())
+	{
+		printf("CoAP: no frame available to receive responses\n");
+		return 0;
+	}
+
+	auto ticks_until = [](TickType_t deadline) -> int32_t {
+		return static_cast<int32_t>(deadline - xTaskGetTickCount());
+	};
+
+	// Karn's algorithm: only a request acknowledged on its first transmission gives an unambiguous RTT
+	auto sample_rtt = [&](const PendingRequest_t& pending) {
+		if (!pending.acked && pending.retransmits == 0)
+		{
+			RttEstimator::addSample(transport, static_cast<uint32_t>(pdTICKS_TO_MS(xTaskGetTickCount() - pending.sent_at)));
+		}
+	};
+
+	auto complete = [&](PendingRequest_t& pending, bool ok) {
+		pending.request->success = ok;
+		pending.request = nullptr;
+		in_flight--;
+
+		if (ok)
+		{
+			succeeded++;
+		}
+	};
+
+	// Fill free table slots with requests that have not been sent yet
+	auto start_requests = [&]() {
+		for (PendingRequest_t& pending : table)
+		{
+			while (!pending.request && next_request < requests.size())
+			{
+				CoapRequest_t& request = requests[next_request++];
+
+				if (!readRequestIdentity(request.header, pending.identity))
+				{
+					printf("Refusing to send malformed CoAP header\n");
+					continue;
+				}
+
+				if (!sendRequest(request, send))
+				{
+					printf("CoAP MID 0x%04x: transport rejected request\n", pending.identity.msg_id);
+					continue;
+				}
+
+				const int response_window_ms = RttEstimator::responseWindowMs(transport,
+				                                   (request.pkt_config.response_win > 0)
+				                                       ? request.pkt_config.response_win
+				                                       : PKT_RESPONSE_WIN_DEFAULT_MS);
+
+				pending.request = &request;
+				pending.acked = false;
+				pending.retransmits = 0;
+				pending.timeout_ms = initialTimeoutMs(transport);
+				pending.sent_at = xTaskGetTickCount();
+				pending.exchange_deadline = xTaskGetTickCount() + pdMS_TO_TICKS(response_window_ms);
+				pending.retransmit_deadline = xTaskGetTickCount() + pdMS_TO_TICKS(pending.timeout_ms);
+				in_flight++;
+			}
+		}
+	};
+
+	start_requests();
+
+	while (in_flight > 0)
+	{
+		int32_t wait_ticks = INT32_MAX;
+
+		for (PendingRequest_t& pending : table)
+		{
+			if (!pending.request)
+			{
+				continue;
+			}
+
+			if (ticks_until(pending.exchange_deadline) <= 0)
+			{
+				printf("CoAP MID 0x%04x: %s within response window\n", pending.identity.msg_id,
+				       pending.acked ? "no separate response" : "no ACK");
+				complete(pending, false);
+				continue;
+			}
+
+			if (!pending.acked && ticks_until(pending.retransmit_deadline) <= 0)
+			{
+				if (pending.retransmits >= COAP_MAX_RETRANSMIT)
+				{
+					printf("CoAP MID 0x%04x: no ACK after %d retransmissions\n", pending.identity.msg_id, pending.retransmits);
+					complete(pending, false);
+					continue;
+				}
+
+				pending.retransmits++;
+				pending.timeout_ms *= 2;
+				printf("CoAP MID 0x%04x: ACK timeout, retransmission %d/%d\n",
+				       pending.identity.msg_id, pending.retransmits, COAP_MAX_RETRANSMIT);
+
+				if (!sendRequest(*pending.request, send))
+				{
+					printf("CoAP MID 0x%04x: transport rejected retransmission\n", pending.identity.msg_id);
+					complete(pending, false);
+					continue;
+				}
+
+				pending.retransmit_deadline = xTaskGetTickCount() + pdMS_TO_TICKS(pending.timeout_ms);
+			}
+
+			wait_ticks = std::min(wait_ticks, ticks_until(pending.exchange_deadline));
+			if (!pending.acked)
+			{
+				wait_ticks = std::min(wait_ticks, ticks_until(pending.retransmit_deadline));
+			}
+		}
+
+		// Requests that just completed free their slots for queued ones
+		if (next_request < requests.size() && in_flight < COAP_NSTART)
+		{
+			start_requests();
+			continue;
+		}
+
+		if (in_flight == 0)
+		{
+			break;
+		}
+
+		const int wait_ms = (wait_ticks > 0) ? static_cast<int>(pdTICKS_TO_MS(wait_ticks)) : 0;
+		size_t rx_len = 0;
+
+		if (!recv(rx_frame.frame(), FramePool::FRAME_SIZE, &rx_len, wait_ms))
+		{
+			printf("CoAP: transport receive failed, abandoning %zu in-flight request(s)\n", in_flight);
+			for (PendingRequest_t& pending : table)
+			{
+				if (pending.request)
+				{
+					complete(pending, false);
+				}
+			}
+			break;
+		}
+
+		if (rx_len == 0 || !CoapPktAssm::parseMessage(std::span<const uint8_t>(rx_frame.frame(), rx_len), rx_msg))
+		{
+			continue;
+		}
+
+		bool matched = false;
+
+		for (PendingRequest_t& pending : table)
+		{
+			if (!pending.request)
+			{
+				continue;
+			}
+
+			const bool mid_match = (rx_msg.msg_id == pending.identity.msg_id);
+			const bool token_match = tokenMatches(rx_msg, pending.identity);
+
+			if (rx_msg.type == COAP_TYPE_RST && mid_match)
+			{
+				printf("CoAP MID 0x%04x: reset by server\n", pending.identity.msg_id);
+				complete(pending, false);
+				matched = true;
+				break;
+			}
+
+			if (rx_msg.type == COAP_TYPE_ACK && mid_match)
+			{
+				matched = true;
+
+				sample_rtt(pending);
+
+				if (rx_msg.code == COAP_CODE_EMPTY)
+				{
+					pending.acked = true;
+
+					// Without a payload callback the ACK completes the request; otherwise a separate response follows
+					if (!pending.request->onPayload)
+					{
+						complete(pending, true);
+					}
+					break;
+				}
+
+				if (token_match)
+				{
+					reportBlock2(rx_msg, pending.request->block2_out);
+					complete(pending, deliverResponse(rx_msg, pending.request->onPayload));
+				}
+				else
+				{
+					// The ACK ends retransmission of this MID, but its piggybacked response belongs to
+					// another request, so no response to this one will follow (RFC 7252 Section 5.3.2)
+					printf("CoAP MID 0x%04x: ACK carries a foreign token, failing request\n", pending.identity.msg_id);
+					complete(pending, false);
+				}
+				break;
+			}
+
+			if ((rx_msg.type == COAP_TYPE_CON || rx_msg.type == COAP_TYPE_NON) && token_match &&
+			    rx_msg.code != COAP_CODE_EMPTY)
+			{
+				sample_rtt(pending);
+				reportBlock2(rx_msg, pending.request->block2_out);
+				complete(pending, deliverResponse(rx_msg, pending.request->onPayload));
+				matched = true;
+				break;
+			}
+		}
+
+		// Separate responses are acknowledged even when they repeat one already delivered,
+		// so the server stops retransmitting it
+		if (rx_msg.type == COAP_TYPE_CON && rx_msg.code != COAP_CODE_EMPTY)
+		{
+			bool known_token = matched;
+
+			for (size_t i = 0; i < next_request && !known_token; ++i)
+			{
+				CoapMessage_t identity;
+				known_token = readRequestIdentity(requests[i].header, identity) && tokenMatches(rx_msg, identity);
+			}
+
+			if (known_token)
+			{
+				uint8_t ack[COAP_HEADER_SIZE];
+				const size_t ack_len = CoapPktAssm::buildEmptyAck(ack, rx_msg.msg_id);
+				if (!send(std::span<const uint8_t>(ack, ack_len), {}))
+				{
+					printf("CoAP MID 0x%04x: failed to acknowledge separate response\n", rx_msg.msg_id);
+				}
+				continue;
+			}
+		}
+
+		if (!matched)
+		{
+			printf("CoAP: discarding unmatched message (type %u, MID 0x%04x)\n", rx_msg.type, rx_msg.msg_id);
+		}
+	}
+
+	return succeeded;
+}
+
+bool CoapTransaction::prepare(CoapRequest_t& request,
+                              const uint8_t* cbor_buffer,
+                              size_t cbor_buffer_len,
+                              const PktEntry_t pkt_config,
+                              const PacketChunkCallback& onPayload,
+                              const CoapBlockOpt_t* request_block,
+                              CoapBlockOpt_t* response_block)
+{
+	request.header.len = 0;
+	request.payload = {};
+	request.frame = {};
+	request.pkt_config = pkt_config;
+	request.onPayload = onPayload;
+	request.block2_out = response_block;
+	request.success = false;
+
+	if (cbor_buffer_len > 0 && !cbor_buffer)
+	{
+		printf("Invalid packet parameters\n");
+		return false;
+	}
+
+	if (CoapPktAssm::buildHeader(request.header, pkt_config, cbor_buffer_len > 0, request_block) == 0)
+	{
+		return false;
+	}
+
+	request.payload = std::span<const uint8_t>(cbor_buffer, cbor_buffer_len);
+
+	// Payloads encoded into a pooled frame have headroom right before them for the header
+	uint8_t* frame = (cbor_buffer_len > 0) ? FramePool::frameOf(cbor_buffer) : nullptr;
+	if (frame && cbor_buffer_len <= FramePool::PAYLOAD_CAPACITY)
+	{
+		uint8_t* start = frame + FramePool::HEADROOM - request.header.len;
+		memcpy(start, request.header.bytes, request.header.len);
+		request.frame = std::span<const uint8_t>(start, request.header.len + cbor_buffer_len);
+	}
+
+	return true;
+}
+
+bool CoapTransaction::sendRequest(const CoapRequest_t& request, const CoapDatagramSend& send)
+{
+	if (!request.frame.empty())
+	{
+		return send(request.frame, {});
+	}
+
+	return send(std::span<const uint8_t>(request.header.bytes, request.header.len), request.payload);
+}
+
+bool CoapTransaction::readRequestIdentity(const CoapFrameHeader_t& header, CoapMessage_t& request)
+{
+	request = {};
+
+	if (header.len < COAP_HEADER_SIZE || header.len > COAP_FRAME_HEADER_MAX)
+	{
+		return false;
+	}
+
+	const size_t token_len = header.bytes[0] & COAP_TOKEN_LEN_MASK;
+	request.type = (header.bytes[0] >> COAP_TYPE_SHIFT) & COAP_TYPE_MASK;
+	request.code = header.bytes[1];
+	request.msg_id = static_cast<uint16_t>((header.bytes[2] << 8) | header.bytes[3]);
+
+	if (token_len > COAP_MAX_TOKEN_LEN || (COAP_HEADER_SIZE + token_len) > header.len)
+	{
+		return false;
+	}
+
+	request.token = std::span<const uint8_t>(&header.bytes[COAP_HEADER_SIZE], token_len);
+	return true;
+}
+
+bool CoapTransaction::tokenMatches(const CoapMessage_t& msg, const CoapMessage_t& request)
+{
+	return std::ranges::equal(msg.token, request.token);
+}
+
+int CoapTransaction::initialTimeoutMs(RttEstimator::Transport transport)
+{
+	const uint32_t ack_timeout_ms = RttEstimator::ackTimeoutMs(transport);
+	const uint32_t spread_ms = (ack_timeout_ms * (COAP_ACK_RANDOM_FACTOR_PCT - 100)) / 100;
+	return static_cast<int>(ack_timeout_ms + esp_random() % (spread_ms + 1));
+}
+
+void CoapTransaction::reportBlock2(const CoapMessage_t& msg, CoapBlockOpt_t* block2_out)
+{
+	if (!block2_out)
+	{
+		return;
+	}
+
+	if (msg.has_block2)
+	{
+		*block2_out = msg.block2;
+		return;
+	}
+
+	block2_out->num = 0;
+	block2_out->more = false;
+}
+
+bool CoapTransaction::deliverResponse(const CoapMessage_t& msg, const PacketChunkCallback& onPayload)
+{
+	const uint8_t code_class = (msg.code >> COAP_CODE_CLASS_SHIFT) & COAP_CODE_CLASS_MASK;
+	const uint8_t code_detail = msg.code & COAP_CODE_DETAIL_MASK;
+
+	if (code_class != COAP_CODE_CLASS_SUCCESS)
+	{
+		printf("CoAP MID 0x%04x: server responded %u.%02u\n", msg.msg_id, code_class, code_detail);
+		return false;
+	}
+
+	if (!onPayload || msg.payload.empty())
+	{
+		return true;
+	}
+
+	return onPayload(msg.payload.data(), msg.payload.size());
+}
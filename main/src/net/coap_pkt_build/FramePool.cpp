@@ -0,0 +1,57 @@
+#include "FramePool.hpp"
+
+#include <atomic>
+#include <cstdio>
+
+namespace {
+
+alignas(4) uint8_t s_frames[FramePool::FRAME_COUNT][FramePool::FRAME_SIZE];
+std::atomic<bool> s_in_use[FramePool::FRAME_COUNT];
+
+} // namespace
+
+uint8_t* FramePool::take()
+{
+	for (size_t i = 0; i < FRAME_COUNT; ++i)
+	{
+		bool expected = false;
+
+		if (s_in_use[i].compare_exchange_strong(expected, true, std::memory_order_acquire))
+		{
+			return s_frames[i];
+		}
+	}
+
+	printf("Frame pool exhausted (%zu frames in use)\n", FRAME_COUNT);
+	return nullptr;
+}
+
+void FramePool::give(uint8_t* frame)
+{
+	if (!frame)
+	{
+		return;
+	}
+
+	for (size_t i = 0; i < FRAME_COUNT; ++i)
+	{
+		if (s_frames[i] == frame)
+		{
+			s_in_use[i].store(false, std::memory_order_release);
+			return;
+		}
+	}
+}
+
+uint8_t* FramePool::frameOf(const uint8_t* payload)
+{
+	for (size_t i = 0; i < FRAME_COUNT; ++i)
+	{
+		if (payload == s_frames[i] + HEADROOM && s_in_use[i].load(std::memory_order_relaxed))
+		{
+			return s_frames[i];
+		}
+	}
+
+	return nullptr;
+}
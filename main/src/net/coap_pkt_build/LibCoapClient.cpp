@@ -0,0 +1,339 @@
+#include "LibCoapClient.hpp"
+
+#include <algorithm>
+#include <arpa/inet.h>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "RttEstimator.hpp"
+#include "coap3/coap.h"
+
+extern "C" {
+	#include "freertos/FreeRTOS.h"
+	#include "freertos/task.h"
+}
+
+namespace {
+
+/**
+ * @brief libcoap bookkeeping for one request of an exchange.
+ */
+struct PendingRequest
+{
+	LibCoapRequest_t* request;
+	uint8_t token[COAP_MAX_TOKEN_LEN];
+	size_t token_len;
+	coap_mid_t mid;
+	TickType_t sent_at;
+	TickType_t deadline;
+	bool done;
+};
+
+/**
+ * @brief Exchange state reachable from the libcoap handlers through the session app data.
+ */
+struct ExchangeState
+{
+	std::vector<PendingRequest> pending;
+	size_t outstanding;
+	size_t succeeded;
+	uint32_t ack_timeout_ms;  ///< Session ACK timeout, before randomisation
+};
+
+void complete(ExchangeState& state, PendingRequest& pending, bool ok)
+{
+	if (pending.done)
+	{
+		return;
+	}
+
+	pending.done = true;
+	pending.request->success = ok;
+	state.outstanding--;
+
+	if (ok)
+	{
+		state.succeeded++;
+	}
+}
+
+coap_pdu_code_t methodCode(CoapMethod method)
+{
+	switch (method)
+	{
+	case CoapMethod::PUT:
+		return COAP_REQUEST_CODE_PUT;
+	case CoapMethod::POST:
+		return COAP_REQUEST_CODE_POST;
+	case CoapMethod::GET:
+	default:
+		return COAP_REQUEST_CODE_GET;
+	}
+}
+
+coap_response_t onResponse(coap_session_t* session, const coap_pdu_t* sent, const coap_pdu_t* received, const coap_mid_t mid)
+{
+	(void)sent;
+	(void)mid;
+
+	ExchangeState* state = static_cast<ExchangeState*>(coap_session_get_app_data(session));
+	const coap_bin_const_t token = coap_pdu_get_token(received);
+
+	if (!state)
+	{
+		return COAP_RESPONSE_OK;
+	}
+
+	for (PendingRequest& pending : state->pending)
+	{
+		if (pending.done || pending.token_len != token.length ||
+		    memcmp(pending.token, token.s, token.length) != 0)
+		{
+			continue;
+		}
+
+		// libcoap retransmits internally, so only a response inside the first ACK timeout is an unambiguous RTT
+		const uint32_t elapsed_ms = static_cast<uint32_t>(pdTICKS_TO_MS(xTaskGetTickCount() - pending.sent_at));
+		if (elapsed_ms < state->ack_timeout_ms)
+		{
+			RttEstimator::addSample(RttEstimator::Transport::Wifi, elapsed_ms);
+		}
+
+		const coap_pdu_code_t code = coap_pdu_get_code(received);
+		if (COAP_RESPONSE_CLASS(code) != COAP_CODE_CLASS_SUCCESS)
+		{
+			printf("libcoap: server responded %d.%02d\n", COAP_RESPONSE_CLASS(code), code & COAP_CODE_DETAIL_MASK);
+			complete(*state, pending, false);
+			return COAP_RESPONSE_OK;
+		}
+
+		if (pending.request->block2_out)
+		{
+			coap_block_t block = {};
+			if (coap_get_block(received, COAP_OPTION_BLOCK2, &block))
+			{
+				pending.request->block2_out->num = block.num;
+				pending.request->block2_out->more = block.m;
+				pending.request->block2_out->szx = static_cast<uint8_t>(block.szx);
+			}
+			else
+			{
+				pending.request->block2_out->num = 0;
+				pending.request->block2_out->more = false;
+			}
+		}
+
+		size_t data_len = 0;
+		const uint8_t* data = nullptr;
+		bool ok = true;
+
+		if (pending.request->onPayload && coap_get_data(received, &data_len, &data) && data_len > 0)
+		{
+			ok = pending.request->onPayload(data, data_len);
+		}
+
+		complete(*state, pending, ok);
+		return COAP_RESPONSE_OK;
+	}
+
+	// Unknown token: let libcoap reject it (RST for a confirmable message)
+	return COAP_RESPONSE_FAIL;
+}
+
+void onNack(coap_session_t* session, const coap_pdu_t* sent, const coap_nack_reason_t reason, const coap_mid_t mid)
+{
+	(void)sent;
+
+	ExchangeState* state = static_cast<ExchangeState*>(coap_session_get_app_data(session));
+	if (!state)
+	{
+		return;
+	}
+
+	for (PendingRequest& pending : state->pending)
+	{
+		if (!pending.done && pending.mid == mid)
+		{
+			printf("libcoap MID 0x%04x: request failed (reason %d)\n", static_cast<unsigned>(mid), static_cast<int>(reason));
+			complete(*state, pending, false);
+			return;
+		}
+	}
+}
+
+bool addRequest(coap_session_t* session, PendingRequest& pending)
+{
+	const LibCoapRequest_t& request = *pending.request;
+	const std::string_view uri_path = CoapPktAssm::getUriPath(request.pkt_config.pkt_type);
+	uint8_t option_buf[4];
+
+	coap_pdu_t* pdu = coap_new_pdu(COAP_MESSAGE_CON, methodCode(request.pkt_config.method), session);
+	if (!pdu)
+	{
+		return false;
+	}
+
+	coap_session_new_token(session, &pending.token_len, pending.token);
+
+	// Options must be added in ascending order: Uri-Path, Content-Format, Block2
+	if (!coap_add_token(pdu, pending.token_len, pending.token) ||
+	    !coap_add_option(pdu, COAP_OPTION_URI_PATH, uri_path.size(), reinterpret_cast<const uint8_t*>(uri_path.data())) ||
+	    !coap_add_option(pdu, COAP_OPTION_CONTENT_FORMAT,
+	                     coap_encode_var_safe(option_buf, sizeof(option_buf), COAP_MEDIATYPE_APPLICATION_CBOR), option_buf))
+	{
+		coap_delete_pdu(pdu);
+		return false;
+	}
+
+	if (request.request_block)
+	{
+		const uint32_t value = (request.request_block->num << 4) |
+		                       (request.request_block->more ? 0x08U : 0x00U) |
+		                       (request.request_block->szx & 0x07U);
+
+		if (!coap_add_option(pdu, COAP_OPTION_BLOCK2, coap_encode_var_safe(option_buf, sizeof(option_buf), value), option_buf))
+		{
+			coap_delete_pdu(pdu);
+			return false;
+		}
+	}
+
+	if (!request.payload.empty() && !coap_add_data(pdu, request.payload.size(), request.payload.data()))
+	{
+		coap_delete_pdu(pdu);
+		return false;
+	}
+
+	// coap_send takes ownership of the PDU, including on failure
+	pending.mid = coap_send(session, pdu);
+	return pending.mid != COAP_INVALID_MID;
+}
+
+} // namespace
+
+size_t LibCoapClient::exchange(std::span<LibCoapRequest_t> requests, const char* host, uint16_t port)
+{
+	static bool s_started = false;
+	ExchangeState state = {};
+	coap_address_t dst;
+
+	for (LibCoapRequest_t& request : requests)
+	{
+		request.success = false;
+	}
+
+	if (!host || requests.empty())
+	{
+		return 0;
+	}
+
+	if (!s_started)
+	{
+		coap_startup();
+		s_started = true;
+	}
+
+	coap_address_init(&dst);
+	dst.addr.sin.sin_family = AF_INET;
+	dst.addr.sin.sin_port = htons(port);
+	if (inet_pton(AF_INET, host, &dst.addr.sin.sin_addr) != 1)
+	{
+		printf("libcoap: invalid server address %s\n", host);
+		return 0;
+	}
+
+	coap_context_t* ctx = coap_new_context(nullptr);
+	if (!ctx)
+	{
+		printf("libcoap: failed to create context\n");
+		return 0;
+	}
+
+	coap_register_response_handler(ctx, onResponse);
+	coap_register_nack_handler(ctx, onNack);
+
+	coap_session_t* session = coap_new_client_session(ctx, nullptr, &dst, COAP_PROTO_UDP);
+	if (!session)
+	{
+		printf("libcoap: failed to create client session\n");
+		coap_free_context(ctx);
+		return 0;
+	}
+
+	// Same transmission parameters as the built-in backend (RFC 7252 Section 4.8), so the
+	// response windows from RttEstimator cover libcoap's retransmissions too
+	state.ack_timeout_ms = RttEstimator::ackTimeoutMs(RttEstimator::Transport::Wifi);
+	const coap_fixed_point_t ack_timeout = {static_cast<uint16_t>(state.ack_timeout_ms / 1000),
+	                                        static_cast<uint16_t>(state.ack_timeout_ms % 1000)};
+	coap_session_set_ack_timeout(session, ack_timeout);
+	coap_session_set_ack_random_factor(session, coap_fixed_point_t{COAP_ACK_RANDOM_FACTOR_PCT / 100, (COAP_ACK_RANDOM_FACTOR_PCT % 100) * 10});
+	coap_session_set_max_retransmit(session, COAP_MAX_RETRANSMIT);
+	coap_session_set_nstart(session, COAP_NSTART);
+	coap_session_set_app_data(session, &state);
+
+	state.pending.resize(requests.size());
+
+	for (size_t i = 0; i < requests.size(); ++i)
+	{
+		PendingRequest& pending = state.pending[i];
+		const int response_window_ms = RttEstimator::responseWindowMs(RttEstimator::Transport::Wifi,
+		                                   (requests[i].pkt_config.response_win > 0)
+		                                       ? requests[i].pkt_config.response_win
+		                                       : PKT_RESPONSE_WIN_DEFAULT_MS);
+
+		pending.request = &requests[i];
+		pending.sent_at = xTaskGetTickCount();
+		pending.deadline = xTaskGetTickCount() + pdMS_TO_TICKS(response_window_ms);
+		state.outstanding++;
+
+		if (!addRequest(session, pending))
+		{
+			printf("libcoap: failed to queue request for %s\n",
+			       std::string(CoapPktAssm::getUriPath(requests[i].pkt_config.pkt_type)).c_str());
+			complete(state, pending, false);
+		}
+	}
+
+	while (state.outstanding > 0)
+	{
+		int32_t wait_ticks = INT32_MAX;
+
+		for (PendingRequest& pending : state.pending)
+		{
+			if (pending.done)
+			{
+				continue;
+			}
+
+			const int32_t remaining = static_cast<int32_t>(pending.deadline - xTaskGetTickCount());
+			if (remaining <= 0)
+			{
+				printf("libcoap MID 0x%04x: no response within response window\n", static_cast<unsigned>(pending.mid));
+				complete(state, pending, false);
+				continue;
+			}
+
+			wait_ticks = std::min(wait_ticks, remaining);
+		}
+
+		if (state.outstanding == 0)
+		{
+			break;
+		}
+
+		if (coap_io_process(ctx, static_cast<uint32_t>(pdTICKS_TO_MS(wait_ticks))) < 0)
+		{
+			printf("libcoap: I/O processing failed, abandoning %zu request(s)\n", state.outstanding);
+			break;
+		}
+	}
+
+	coap_session_set_app_data(session, nullptr);
+	coap_session_release(session);
+	coap_free_context(ctx);
+
+	return state.succeeded;
+}
@@ -0,0 +1,145 @@
+#include "RttEstimator.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+extern "C" {
+	#include "esp_attr.h"
+}
+
+/**
+ * @brief Estimates retained across deep sleep. Zeroed by the loader on power-on reset.
+ */
+RTC_DATA_ATTR RttEstimator::RtcState RttEstimator::s_rtc_state;
+
+void RttEstimator::addSample(Transport transport, uint32_t rtt_ms)
+{
+	const size_t index = static_cast<size_t>(transport);
+
+	if (index >= TRANSPORT_COUNT || rtt_ms > MAX_SAMPLE_MS)
+	{
+		return;
+	}
+
+	if (s_rtc_state.magic != RTC_STATE_MAGIC)
+	{
+		memset(&s_rtc_state, 0, sizeof(s_rtc_state));
+		s_rtc_state.magic = RTC_STATE_MAGIC;
+	}
+
+	Estimate& est = s_rtc_state.estimates[index];
+
+	if (est.samples == 0)
+	{
+		est.srtt_ms = rtt_ms;
+		est.rttvar_ms = rtt_ms / 2;
+	}
+	else
+	{
+		// RTTVAR uses the SRTT from before this sample (RFC 6298 Section 2.3)
+		const uint32_t deviation = (est.srtt_ms > rtt_ms) ? (est.srtt_ms - rtt_ms) : (rtt_ms - est.srtt_ms);
+		est.rttvar_ms = (3 * est.rttvar_ms + deviation) / 4;
+		est.srtt_ms = (7 * est.srtt_ms + rtt_ms) / 8;
+	}
+
+	if (est.samples < UINT32_MAX)
+	{
+		est.samples++;
+	}
+
+	printf("RTT sample %lu ms (srtt %lu ms, rttvar %lu ms)\n", static_cast<unsigned long>(rtt_ms),
+	       static_cast<unsigned long>(est.srtt_ms), static_cast<unsigned long>(est.rttvar_ms));
+}
+
+uint32_t RttEstimator::rtoMs(Transport transport)
+{
+	const Estimate* est = findEstimate(transport);
+
+	if (!est)
+	{
+		return 0;
+	}
+
+	return est->srtt_ms + std::max(CLOCK_GRANULARITY_MS, 4 * est->rttvar_ms);
+}
+
+uint32_t RttEstimator::ackTimeoutMs(Transport transport)
+{
+	const uint32_t rto_ms = rtoMs(transport);
+
+	if (rto_ms == 0)
+	{
+		return COAP_ACK_TIMEOUT_MS;
+	}
+
+	return std::clamp<uint32_t>(rto_ms, MIN_ACK_TIMEOUT_MS, COAP_ACK_TIMEOUT_MS);
+}
+
+uint32_t RttEstimator::retransmitSpanMs(uint32_t ack_timeout_ms, uint32_t retransmits)
+{
+	// Timeouts double with each retransmission: 1 + 2 + ... + 2^retransmits initial timeouts
+	const uint32_t max_initial_ms = (ack_timeout_ms * COAP_ACK_RANDOM_FACTOR_PCT) / 100;
+	return max_initial_ms * ((1U << (retransmits + 1)) - 1);
+}
+
+int RttEstimator::responseWindowMs(Transport transport, int configured_ms)
+{
+	const uint32_t rto_ms = rtoMs(transport);
+
+	if (rto_ms == 0 || configured_ms <= 0)
+	{
+		return configured_ms;
+	}
+
+	const uint32_t ack_timeout_ms = ackTimeoutMs(transport);
+
+	// Retransmissions are not sped up on a link at least as slow as the RFC default, so neither is the window
+	if (ack_timeout_ms >= COAP_ACK_TIMEOUT_MS)
+	{
+		return configured_ms;
+	}
+
+	// Never close the window on a retransmission that would have timed out inside the configured one
+	uint32_t floor_ms = 0;
+
+	for (uint32_t retransmits = 0; retransmits <= COAP_MAX_RETRANSMIT; ++retransmits)
+	{
+		const uint32_t span_ms = retransmitSpanMs(ack_timeout_ms, retransmits);
+
+		if (span_ms > static_cast<uint32_t>(configured_ms))
+		{
+			break;
+		}
+		floor_ms = span_ms;
+	}
+
+	const uint32_t window_ms = std::max<uint32_t>(rto_ms * RESPONSE_WIN_RTO_FACTOR, floor_ms);
+	return static_cast<int>(std::min<uint32_t>(window_ms, static_cast<uint32_t>(configured_ms)));
+}
+
+int RttEstimator::pollIntervalMs(Transport transport, int default_ms)
+{
+	const Estimate* est = findEstimate(transport);
+
+	if (!est)
+	{
+		return default_ms;
+	}
+
+	// A handful of polls per round trip keeps latency low without flooding the UART
+	return std::clamp(static_cast<int>(est->srtt_ms / 8), MIN_POLL_INTERVAL_MS, MAX_POLL_INTERVAL_MS);
+}
+
+const RttEstimator::Estimate* RttEstimator::findEstimate(Transport transport)
+{
+	const size_t index = static_cast<size_t>(transport);
+
+	if (s_rtc_state.magic != RTC_STATE_MAGIC || index >= TRANSPORT_COUNT ||
+	    s_rtc_state.estimates[index].samples == 0)
+	{
+		return nullptr;
+	}
+
+	return &s_rtc_state.estimates[index];
+}
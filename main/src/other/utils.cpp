@@ -1,5 +1,4 @@
 #include "Utils.hpp"
-#include "CoapPktAssm.hpp"
 
 #include <algorithm>
 #include <cmath>
@@ -7,6 +6,7 @@
 #include <limits>
 #include <cstdlib>
 #include <cstdio>
+#include <iterator>
 
 void Utils::printMotd() {
     printf("**********************************************************\n");
@@ -38,35 +38,6 @@ std::string Utils::bytesToHexString(unsigned char high, unsigned char low)
 	return ss.str();
 }
 
-size_t Utils::extractCoapPayloadChunk(const char *src, size_t src_len, std::string &out)
-{
-	out.clear();
-
-	if (!src || src_len == 0)
-	{
-		return 0;
-	}
-
-	size_t payload_start = src_len;
-	for (size_t i = 0; i < src_len; ++i)
-	{
-		if (static_cast<uint8_t>(src[i]) == COAP_PAYLOAD_MARKER)
-		{
-			payload_start = i + 1;
-			break;
-		}
-	}
-
-	if (payload_start >= src_len)
-	{
-		return 0;
-	}
-
-	out.assign(src + payload_start, src_len - payload_start);
-
-	return out.size();
-}
-
 std::string Utils::toLowerAscii(std::string value)
 {
 	std::transform(value.begin(), value.end(), value.begin(), [](unsigned char ch) {
@@ -157,100 +128,165 @@ void Utils::trimTrailingWhitespace(std::string &value)
 	}
 }
 
-std::string Utils::parseGPSLine(const std::string &line)
+namespace
 {
-	// Expecting line like: +QGPSLOC: 051127.0,3752.4632S,14504.0347E,2.2,22.0,2,...
-	size_t start = line.find(':');
-	if (start == std::string::npos)
-		return "";
-	start++;
-	while (start < line.size() && line[start] == ' ')
-		start++;
-
-	size_t c1 = line.find(',', start);
-	if (c1 == std::string::npos)
-		return "";
-	size_t c2 = line.find(',', c1 + 1);
-	if (c2 == std::string::npos)
-		return "";
-	size_t c3 = line.find(',', c2 + 1);
-	if (c3 == std::string::npos)
-		return "";
-
-	std::string lat = line.substr(c1 + 1, c2 - c1 - 1);
-	std::string lon = line.substr(c2 + 1, c3 - c2 - 1);
-
-	while (!lat.empty() && lat.front() == ' ')
-		lat.erase(0, 1);
-	while (!lon.empty() && lon.front() == ' ')
-		lon.erase(0, 1);
-
-	auto convertDMM = [](const std::string &dmm) -> double
-	{
-		if (dmm.empty())
-			return std::numeric_limits<double>::quiet_NaN();
 
-		char hemi = dmm.back();
-		std::string core = dmm;
-		if (hemi == 'N' || hemi == 'S' || hemi == 'E' || hemi == 'W')
+std::string_view trimSpaces(std::string_view text)
+{
+	while (!text.empty() && text.front() == ' ')
+		text.remove_prefix(1);
+	while (!text.empty() && text.back() == ' ')
+		text.remove_suffix(1);
+	return text;
+}
+
+/**
+ * @brief Parse an unsigned decimal ("52.4632") into a fixed-point value with @p scale fractional digits.
+ * Digits beyond the scale are truncated.
+ */
+bool parseFixed(std::string_view text, int scale, int64_t &out)
+{
+	int64_t value = 0;
+	int frac = -1;
+	bool digits = false;
+
+	for (const char c : text)
+	{
+		if (c == '.')
 		{
-			core = dmm.substr(0, dmm.size() - 1);
+			if (frac >= 0)
+				return false;
+			frac = 0;
+			continue;
 		}
-		else
+		if (c < '0' || c > '9')
+			return false;
+		if (frac >= scale)
+			continue;
+		if (value > (std::numeric_limits<int64_t>::max() - 9) / 10)
+			return false;
+
+		value = value * 10 + (c - '0');
+		digits = true;
+		if (frac >= 0)
+			frac++;
+	}
+
+	if (!digits)
+		return false;
+
+	for (int f = (frac < 0) ? 0 : frac; f < scale; f++)
+		value *= 10;
+
+	out = value;
+	return true;
+}
+
+/**
+ * @brief Convert a modem (d)ddmm.mmmm[NSEW] coordinate to 1e-7 degrees.
+ */
+bool parseDmm(std::string_view dmm, int32_t &out_e7)
+{
+	dmm = trimSpaces(dmm);
+	if (dmm.empty())
+		return false;
+
+	const char hemi = dmm.back();
+	if (hemi == 'N' || hemi == 'S' || hemi == 'E' || hemi == 'W')
+		dmm = trimSpaces(dmm.substr(0, dmm.size() - 1));
+
+	const size_t dot = dmm.find('.');
+	if (dot == std::string_view::npos || dot < 3)
+		return false;
+
+	const size_t deg_digits = (dot > 4) ? 3 : 2;
+	int64_t deg = 0;
+	int64_t minutes_e7 = 0;
+	if (!parseFixed(dmm.substr(0, deg_digits), 0, deg) || !parseFixed(dmm.substr(deg_digits), 7, minutes_e7))
+		return false;
+
+	// Minutes to degrees, rounded to the nearest 1e-7 degree
+	int64_t value = deg * 10000000 + (minutes_e7 + 30) / 60;
+	if (value > 1800000000)
+		return false;
+	if (hemi == 'S' || hemi == 'W')
+		value = -value;
+
+	out_e7 = static_cast<int32_t>(value);
+	return true;
+}
+
+} // namespace
+
+bool Utils::parseGPSLine(std::string_view line, GpsFix_t &fix)
+{
+	// Expecting line like: +QGPSLOC: 051127.0,3752.4632S,14504.0347E,2.2,22.0,2,...
+	// Fields after the time: latitude, longitude, HDOP, altitude
+	const size_t start = line.find(':');
+	if (start == std::string_view::npos)
+		return false;
+
+	std::string_view fields[5];
+	size_t count = 0;
+	std::string_view rest = line.substr(start + 1);
+
+	while (count < std::size(fields))
+	{
+		const size_t comma = rest.find(',');
+		fields[count++] = trimSpaces(rest.substr(0, comma));
+		if (comma == std::string_view::npos)
+			break;
+		rest.remove_prefix(comma + 1);
+	}
+
+	GpsFix_t parsed = {};
+	if (count < 3 || !parseDmm(fields[1], parsed.lat_e7) || !parseDmm(fields[2], parsed.lon_e7))
+		return false;
+
+	if (count == std::size(fields))
+	{
+		int64_t hdop_x10 = 0;
+		int64_t alt_dm = 0;
+		std::string_view alt = fields[4];
+		const bool below_sea = !alt.empty() && alt.front() == '-';
+
+		if (below_sea)
+			alt.remove_prefix(1);
+
+		if (parseFixed(fields[3], 1, hdop_x10) && hdop_x10 <= UINT16_MAX &&
+			parseFixed(alt, 1, alt_dm) && alt_dm <= INT32_MAX)
 		{
-			hemi = '\0';
+			parsed.hdop_x10 = static_cast<uint16_t>(hdop_x10);
+			parsed.alt_dm = static_cast<int32_t>(below_sea ? -alt_dm : alt_dm);
+			parsed.has_quality = true;
 		}
+	}
+
+	fix = parsed;
+	return true;
+}
+
+int Utils::formatGpsFix(const GpsFix_t &fix, char *buf, size_t len)
+{
+	const auto sign = [](int32_t e7) { return (e7 < 0) ? "-" : ""; };
+	const auto whole = [](int32_t e7) { return static_cast<unsigned long>(std::abs(static_cast<int64_t>(e7)) / 10000000); };
+	const auto frac = [](int32_t e7) { return static_cast<unsigned long>(std::abs(static_cast<int64_t>(e7)) % 10000000); };
 
-		size_t s = 0;
-		while (s < core.size() && core[s] == ' ')
-			s++;
-		size_t e = core.size();
-		while (e > s && core[e - 1] == ' ')
-			e--;
-		core = core.substr(s, e - s);
-
-		size_t dot = core.find('.');
-		if (dot == std::string::npos || dot < 3)
-			return std::numeric_limits<double>::quiet_NaN();
-
-		int deg_digits = (dot > 4) ? 3 : 2;
-		if (core.size() <= (size_t)deg_digits)
-			return std::numeric_limits<double>::quiet_NaN();
-
-		std::string deg_str = core.substr(0, deg_digits);
-		std::string min_str = core.substr(deg_digits);
-
-		char *endptr = nullptr;
-		double deg = std::strtod(deg_str.c_str(), &endptr);
-		if (endptr == deg_str.c_str())
-			return std::numeric_limits<double>::quiet_NaN();
-		double minutes = std::strtod(min_str.c_str(), &endptr);
-		if (endptr == min_str.c_str())
-			return std::numeric_limits<double>::quiet_NaN();
-
-		double dec = deg + (minutes / 60.0);
-		if (hemi == 'S' || hemi == 'W')
-			dec = -dec;
-		return dec;
-	};
-
-	double lat_dec = convertDMM(lat);
-	double lon_dec = convertDMM(lon);
-	if (std::isnan(lat_dec) || std::isnan(lon_dec))
-		return "";
-
-	char buf[64];
-	snprintf(buf, sizeof(buf), "%.7f, %.7f", lat_dec, lon_dec);
-	return std::string(buf);
+	return snprintf(buf, len, "%s%lu.%07lu, %s%lu.%07lu",
+					sign(fix.lat_e7), whole(fix.lat_e7), frac(fix.lat_e7),
+					sign(fix.lon_e7), whole(fix.lon_e7), frac(fix.lon_e7));
 }
 
 void Utils::printDeviceConfig(const DeviceConfig &cfg, const char *source)
 {
 	printf("Device config (%s):\n", (source != nullptr) ? source : "unknown");
 	printf("  activated=%s\n", cfg.has_activated ? "Yes" : "No");
-	printf("  gps_coord=%s\n", cfg.gps_coord.c_str());
+	char gps[48];
+	formatGpsFix(cfg.gps, gps, sizeof(gps));
+	printf("  gps=%s\n", gps);
 	printf("  main_app_delay=%llu\n", static_cast<unsigned long long>(cfg.main_app_delay));
 	printf("  session_count=%llu\n", static_cast<unsigned long long>(cfg.session_count));
+	printf("  cmd_ver=%lu\n", static_cast<unsigned long>(cfg.cmd_ver));
 	printf("  secretKey=%s\n", cfg.secretKey);
 	printf("  manf.hw_ver=%s\n", cfg.manf_info.hw_ver.value);
 	printf("  manf.hw_var=%s\n", cfg.manf_info.hw_var.value);
@@ -0,0 +1,120 @@
+#include "DeadbandPolicy.hpp"
+
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+
+extern "C" {
+    #include "esp_attr.h"
+}
+
+/**
+ * @brief Policy state retained across deep sleep. Zeroed by the loader on power-on reset.
+ */
+RTC_DATA_ATTR DeadbandPolicy::RtcState DeadbandPolicy::s_rtc_state;
+
+void DeadbandPolicy::begin()
+{
+    if (s_rtc_state.magic == RTC_STATE_MAGIC)
+    {
+        return;
+    }
+
+    printf("Deadband state not present in RTC memory, next upload will re-seed it\n");
+    memset(&s_rtc_state, 0, sizeof(s_rtc_state));
+    s_rtc_state.magic = RTC_STATE_MAGIC;
+}
+
+uint16_t DeadbandPolicy::summarize(const uint16_t reading[NPK_COLLECT_SIZE])
+{
+    uint16_t sorted[NPK_COLLECT_SIZE];
+    memcpy(sorted, reading, sizeof(sorted));
+
+    uint16_t* mid = sorted + (NPK_COLLECT_SIZE / 2);
+    std::nth_element(sorted, mid, sorted + NPK_COLLECT_SIZE);
+
+    return *mid;
+}
+
+bool DeadbandPolicy::isSignificant(MeasurementType type, uint16_t value)
+{
+    const PolicyEntry* policy = findPolicy(type);
+    SentState* state = findState(type);
+
+    if (!policy || !state || !state->has_value)
+    {
+        return true;
+    }
+
+    const int64_t silent_sec = nowSec() - state->last_sent_sec;
+    if (silent_sec < 0 || silent_sec >= static_cast<int64_t>(policy->max_silence_sec))
+    {
+        printf("Deadband: type %d silent for %lld s, heartbeat due\n",
+               static_cast<int>(type), static_cast<long long>(silent_sec));
+        return true;
+    }
+
+    const uint32_t delta = (value > state->last_value)
+        ? static_cast<uint32_t>(value - state->last_value)
+        : static_cast<uint32_t>(state->last_value - value);
+    const uint32_t rel_band = (static_cast<uint32_t>(state->last_value) * policy->rel_threshold_pm) / 1000U;
+    const uint32_t band = std::max(static_cast<uint32_t>(policy->abs_threshold), rel_band);
+
+    if (delta > band)
+    {
+        printf("Deadband: type %d moved %u -> %u (band %lu), reporting\n",
+               static_cast<int>(type), state->last_value, value, static_cast<unsigned long>(band));
+        return true;
+    }
+
+    return false;
+}
+
+void DeadbandPolicy::markSent(MeasurementType type, uint16_t value)
+{
+    SentState* state = findState(type);
+    if (!state)
+    {
+        return;
+    }
+
+    state->last_value = value;
+    state->has_value = true;
+    state->last_sent_sec = nowSec();
+}
+
+const DeadbandPolicy::PolicyEntry* DeadbandPolicy::findPolicy(MeasurementType type)
+{
+    for (const PolicyEntry& entry : POLICY_TABLE)
+    {
+        if (entry.type == type)
+        {
+            return &entry;
+        }
+    }
+
+    return nullptr;
+}
+
+DeadbandPolicy::SentState* DeadbandPolicy::findState(MeasurementType type)
+{
+    for (size_t i = 0; i < MEASUREMENT_COUNT; ++i)
+    {
+        if (POLICY_TABLE[i].type == type)
+        {
+            return &s_rtc_state.sent[i];
+        }
+    }
+
+    return nullptr;
+}
+
+int64_t DeadbandPolicy::nowSec()
+{
+    // The RTC timer keeps system time running through deep sleep, so this is monotonic
+    // across wake cycles until the next power-on reset.
+    struct timeval tv = {};
+    gettimeofday(&tv, nullptr);
+    return static_cast<int64_t>(tv.tv_sec);
+}
@@ -46,23 +46,28 @@ GPS::GPS()
 {
 }
 
-bool GPS::getCoordinates(std::string &out)
+bool GPS::getCoordinates(GpsFix_t &out)
+{
+    return g_at_engine.spawn(acquireFix(g_at_engine, out)).wait(portMAX_DELAY);
+}
+
+AtTask<bool> GPS::acquireFix(AtEngine& engine, GpsFix_t& out)
 {
     // First, ensure GPS is enabled before querying
     char resp[256] = {0};
     const int max_retries = 5;
 
     printf("GPS: Enabling GNSS receiver...\n");
-    if (!m_hndlr.send(cmd_enable))
+    if (!co_await engine.send(cmd_enable))
     {
         printf("Failed to enable GPS\n");
         // Don't return - still try to query in case GPS is already on
     }
 
     // GPS Cold Start acquisition can take 30-60+ seconds depending on signal and location
-    // Wait substantial time before querying for fix
+    // Wait substantial time before querying for fix; the modem stays free for other jobs meanwhile
     printf("GPS: Waiting for satellite acquisition (this may take 30-60 seconds)...\n");
-    vTaskDelay(pdMS_TO_TICKS(30000)); // 30 second initial wait for satellite search
+    co_await engine.delay(pdMS_TO_TICKS(30000)); // 30 second initial wait for satellite search
 
     // Retry GPS query up to 5 times with 5-second delays between attempts
     // GPS module may take additional time to lock satellites
@@ -70,14 +75,14 @@ bool GPS::getCoordinates(std::string &out)
     {
         memset(resp, 0, sizeof(resp));
 
-        if (m_hndlr.sendAndCapture(cmd, resp, sizeof(resp)))
+        if (co_await engine.sendAndCapture(cmd, resp, sizeof(resp)))
         {
-            std::string parsed = Utils::parseGPSLine(std::string(resp));
-            if (!parsed.empty())
+            if (Utils::parseGPSLine(resp, out))
             {
-                printf("GPS: fix acquired on attempt %d: %s\n", attempt, parsed.c_str());
-                out = parsed;
-                return true;
+                char coords[48];
+                Utils::formatGpsFix(out, coords, sizeof(coords));
+                printf("GPS: fix acquired on attempt %d: %s\n", attempt, coords);
+                co_return true;
             }
             else
             {
@@ -91,10 +96,10 @@ bool GPS::getCoordinates(std::string &out)
 
         if (attempt < max_retries)
         {
-            vTaskDelay(pdMS_TO_TICKS(45000)); // 5-second delay between retries
+            co_await engine.delay(pdMS_TO_TICKS(45000)); // 5-second delay between retries
         }
     }
 
     printf("GPS: failed to acquire fix after %d attempts (total wait: ~55 seconds)\n", max_retries);
-    return false;
+    co_return false;
 }
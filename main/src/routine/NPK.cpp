@@ -15,34 +15,26 @@ NPK::NPK()
 
 void NPK::sendModbusRequest(const uint8_t *packet, size_t packet_size)
 {
-    for (size_t i = 0; i < packet_size; i++)
-    {
-        rs485_uart.writeByte(packet[i]);
-    }
+    rs485_uart.write({packet, packet_size});
     printf("%d Bytes written to UART NPK.\n", packet_size);
 }
 
 size_t NPK::readModbusResponse(uint8_t *rx_buffer, size_t buffer_size, uint32_t timeout_ms)
 {
     size_t len = 0;
-    uint32_t start_time = xTaskGetTickCount();
-    uint32_t timeout_ticks = pdMS_TO_TICKS(timeout_ms);
+    TickType_t deadline = xTaskGetTickCount() + pdMS_TO_TICKS(timeout_ms);
 
+    // The frame ends when the line stays quiet for timeout_ms
     while (len < buffer_size)
     {
-        if (!rs485_uart.readByte(rx_buffer[len]))
+        const size_t got = rs485_uart.readSome({rx_buffer + len, buffer_size - len}, deadline);
+        if (got == 0)
         {
-            if ((xTaskGetTickCount() - start_time) > timeout_ticks)
-            {
-                break;
-            }
-            vTaskDelay(pdMS_TO_TICKS(1)); // Small delay to avoid busy-waiting
-        }
-        else
-        {
-            len++;
-            start_time = xTaskGetTickCount();
+            break;
         }
+
+        len += got;
+        deadline = xTaskGetTickCount() + pdMS_TO_TICKS(timeout_ms);
     }
 
     return len;
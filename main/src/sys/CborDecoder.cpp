@@ -1,98 +1,418 @@
 #include "CborDecoder.hpp"
 
-#include <cbor.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
 
-bool CborDecoder::decodeText(CborStringTransform& transform)
+namespace {
+
+constexpr uint8_t MAJOR_UINT = 0;
+constexpr uint8_t MAJOR_NINT = 1;
+constexpr uint8_t MAJOR_BYTES = 2;
+constexpr uint8_t MAJOR_TEXT = 3;
+constexpr uint8_t MAJOR_ARRAY = 4;
+constexpr uint8_t MAJOR_MAP = 5;
+constexpr uint8_t MAJOR_TAG = 6;
+constexpr uint8_t MAJOR_SIMPLE = 7;
+
+constexpr uint8_t INFO_FALSE = 20;
+constexpr uint8_t INFO_TRUE = 21;
+constexpr uint8_t INFO_INDEFINITE = 31;
+
+/**
+ * @brief Head length in bytes for an initial byte, or 0 for a reserved additional-info value.
+ */
+size_t headLength(uint8_t initial)
 {
-    transform.outgoing.clear();
+    const uint8_t info = initial & 0x1F;
 
-    if (transform.incoming.empty())
+    if (info < 24 || info == INFO_INDEFINITE)
     {
-        return false;
+        return 1;
     }
 
-    CborParser parser;
-    CborValue root;
-    if (cbor_parser_init(reinterpret_cast<const uint8_t*>(transform.incoming.data()), transform.incoming.size(), 0, &parser, &root) != CborNoError)
+    if (info <= 27)
     {
-        return false;
+        return 1 + (size_t{1} << (info - 24));
     }
 
-    if (cbor_value_is_text_string(&root))
+    return 0;
+}
+
+bool accepts(CborFieldKind kind, uint8_t major, uint8_t info)
+{
+    switch (kind)
     {
-        size_t str_len = 0;
-        if (cbor_value_calculate_string_length(&root, &str_len) != CborNoError)
+    case CborFieldKind::Uint:
+        return major == MAJOR_UINT;
+    case CborFieldKind::Int:
+        return major == MAJOR_UINT || major == MAJOR_NINT;
+    case CborFieldKind::Bool:
+        return major == MAJOR_SIMPLE && (info == INFO_FALSE || info == INFO_TRUE);
+    case CborFieldKind::Text:
+        return major == MAJOR_TEXT;
+    case CborFieldKind::Bytes:
+        return major == MAJOR_BYTES;
+    case CborFieldKind::String:
+        return major == MAJOR_TEXT || major == MAJOR_BYTES;
+    }
+
+    return false;
+}
+
+} // namespace
+
+void CborDecoder::reset()
+{
+    m_state = State::Head;
+    m_head_len = 0;
+    m_head_need = 0;
+    m_depth = 0;
+    m_expect_key = true;
+    m_field = NO_FIELD;
+    m_string_role = Role::Skip;
+    m_string_len = 0;
+    m_string_pos = 0;
+    m_key_len = 0;
+    m_key_truncated = false;
+}
+
+bool CborDecoder::feed(std::span<const uint8_t> chunk)
+{
+    size_t pos = 0;
+
+    while (pos < chunk.size() && m_state != State::Error)
+    {
+        switch (m_state)
         {
-            return false;
+        case State::Head:
+        {
+            if (m_head_len == 0)
+            {
+                m_head_need = headLength(chunk[pos]);
+
+                if (m_head_need == 0)
+                {
+                    printf("Malformed CBOR item head 0x%02X\n", chunk[pos]);
+                    m_state = State::Error;
+                    break;
+                }
+            }
+
+            const size_t n = std::min(m_head_need - m_head_len, chunk.size() - pos);
+            memcpy(m_head + m_head_len, chunk.data() + pos, n);
+            m_head_len += n;
+            pos += n;
+
+            // A head split across chunks completes on the next feed
+            if (m_head_len == m_head_need)
+            {
+                m_head_len = 0;
+                if (!processHead())
+                {
+                    m_state = State::Error;
+                }
+            }
+            break;
         }
 
-        transform.outgoing.resize(str_len);
-        if (cbor_value_copy_text_string(&root, transform.outgoing.data(), &str_len, nullptr) != CborNoError)
+        case State::StringBody:
         {
-            transform.outgoing.clear();
+            const size_t n = static_cast<size_t>(std::min<uint64_t>(m_string_len - m_string_pos, chunk.size() - pos));
+
+            if (!consumeString(chunk.subspan(pos, n)))
+            {
+                m_state = State::Error;
+            }
+            pos += n;
+            break;
+        }
+
+        case State::Done:
+            printf("Unexpected data after CBOR reply\n");
+            m_state = State::Error;
+            break;
+
+        case State::Error:
+            break;
+        }
+    }
+
+    return m_state != State::Error;
+}
+
+CborDecoder::Role CborDecoder::currentRole() const
+{
+    if (m_depth == 0)
+    {
+        return Role::Root;
+    }
+
+    if (m_depth == 1)
+    {
+        return m_expect_key ? Role::Key : Role::Value;
+    }
+
+    return Role::Skip;
+}
+
+bool CborDecoder::processHead()
+{
+    const uint8_t major = m_head[0] >> 5;
+    const uint8_t info = m_head[0] & 0x1F;
+    const bool indefinite = info == INFO_INDEFINITE;
+    uint64_t arg = info;
+
+    if (m_head_need > 1)
+    {
+        arg = 0;
+        for (size_t i = 1; i < m_head_need; ++i)
+        {
+            arg = (arg << 8) | m_head[i];
+        }
+    }
+
+    if (indefinite)
+    {
+        if (major == MAJOR_SIMPLE)
+        {
+            // Break: closes the innermost indefinite-length container
+            if (m_depth == 0 || m_levels[m_depth - 1].remaining != INDEFINITE || (m_depth == 1 && !m_expect_key))
+            {
+                printf("Unexpected CBOR break\n");
+                return false;
+            }
+
+            --m_depth;
+            return itemDone();
+        }
+
+        if (major != MAJOR_ARRAY && major != MAJOR_MAP)
+        {
+            printf("Indefinite-length CBOR item (major %u) not supported\n", major);
             return false;
         }
+    }
 
-        transform.outgoing.resize(str_len);
+    // Tags are transparent: the tagged item follows with the same role
+    if (major == MAJOR_TAG)
+    {
         return true;
     }
 
-    if (cbor_value_is_byte_string(&root))
+    const Role role = currentRole();
+
+    if (role == Role::Root)
     {
-        size_t bytes_len = 0;
-        if (cbor_value_calculate_string_length(&root, &bytes_len) != CborNoError)
+        if (major == MAJOR_MAP)
         {
-            return false;
+            m_expect_key = true;
+            return pushLevel(indefinite ? INDEFINITE : arg * 2);
+        }
+
+        if (major == MAJOR_TEXT || major == MAJOR_BYTES)
+        {
+            m_field = findField({}, -1, true);
+            return startString(m_field != NO_FIELD && accepts(fieldKind(m_field), major, info) ? Role::Root : Role::Skip, major, arg);
+        }
+
+        printf("Unexpected top-level CBOR item (major %u)\n", major);
+        return false;
+    }
+
+    if (role == Role::Key)
+    {
+        if (major == MAJOR_TEXT)
+        {
+            return startString(Role::Key, major, arg);
         }
 
-        std::string tmp(bytes_len, '\0');
-        if (cbor_value_copy_byte_string(&root, reinterpret_cast<uint8_t*>(tmp.data()), &bytes_len, nullptr) != CborNoError)
+        if (major == MAJOR_UINT)
+        {
+            m_field = findField({}, static_cast<int64_t>(std::min<uint64_t>(arg, INT64_MAX)), false);
+            return itemDone();
+        }
+
+        // Any other key type matches no field; skip it like a value
+        m_field = NO_FIELD;
+    }
+
+    if (role == Role::Value && m_field != NO_FIELD)
+    {
+        if (accepts(fieldKind(m_field), major, info))
+        {
+            if (major == MAJOR_TEXT || major == MAJOR_BYTES)
+            {
+                return startString(Role::Value, major, arg);
+            }
+
+            return deliverScalar(major, info, arg) && itemDone();
+        }
+
+        printf("CBOR field has unexpected type (major %u), skipped\n", major);
+    }
+
+    switch (major)
+    {
+    case MAJOR_TEXT:
+    case MAJOR_BYTES:
+        return startString(Role::Skip, major, arg);
+    case MAJOR_ARRAY:
+        return pushLevel(indefinite ? INDEFINITE : arg);
+    case MAJOR_MAP:
+        return pushLevel(indefinite ? INDEFINITE : arg * 2);
+    default:
+        return itemDone();
+    }
+}
+
+bool CborDecoder::startString(Role role, uint8_t major, uint64_t len)
+{
+    if (len > SIZE_MAX)
+    {
+        printf("CBOR string too long\n");
+        return false;
+    }
+
+    m_string_role = role;
+    m_string_major = major;
+    m_string_len = len;
+    m_string_pos = 0;
+    m_key_len = 0;
+    m_key_truncated = false;
+    m_state = State::StringBody;
+
+    // Empty strings complete here, so they are still delivered
+    return len > 0 || consumeString({});
+}
+
+bool CborDecoder::consumeString(std::span<const uint8_t> bytes)
+{
+    const uint64_t offset = m_string_pos;
+    m_string_pos += bytes.size();
+    const bool last = m_string_pos == m_string_len;
+
+    if (m_string_role == Role::Root || m_string_role == Role::Value)
+    {
+        CborFieldValue_t value = {};
+        value.kind = m_string_major == MAJOR_TEXT ? CborFieldKind::Text : CborFieldKind::Bytes;
+        value.fragment = bytes;
+        value.offset = static_cast<size_t>(offset);
+        value.total_len = static_cast<size_t>(m_string_len);
+        value.last = last;
+
+        if (!deliver(m_field, value))
         {
+            printf("CBOR field value rejected\n");
             return false;
         }
+    }
+    else if (m_string_role == Role::Key)
+    {
+        const size_t n = std::min(bytes.size(), KEY_MAX - m_key_len);
+        memcpy(m_key + m_key_len, bytes.data(), n);
+        m_key_len += n;
+        m_key_truncated = m_key_truncated || n < bytes.size();
+    }
 
-        tmp.resize(bytes_len);
-        transform.outgoing = tmp;
+    if (!last)
+    {
         return true;
     }
 
-    return false;
+    m_state = State::Head;
+
+    if (m_string_role == Role::Key)
+    {
+        // A key longer than KEY_MAX cannot be in the field table
+        return finishKey(m_key_truncated ? std::string_view() : std::string_view(m_key, m_key_len), -1);
+    }
+
+    return itemDone();
+}
+
+bool CborDecoder::finishKey(std::string_view text_key, int64_t number_key)
+{
+    m_field = text_key.empty() ? NO_FIELD : findField(text_key, number_key, false);
+    return itemDone();
 }
 
-bool CborDecoder::decodeBytes(CborStringTransform& transform)
+bool CborDecoder::deliverScalar(uint8_t major, uint8_t info, uint64_t arg)
 {
-    transform.outgoing.clear();
+    CborFieldValue_t value = {};
+    value.kind = fieldKind(m_field);
 
-    if (transform.incoming.empty())
+    switch (value.kind)
     {
+    case CborFieldKind::Uint:
+        value.uint_value = arg;
+        break;
+    case CborFieldKind::Int:
+        if (arg > static_cast<uint64_t>(INT64_MAX))
+        {
+            printf("CBOR integer out of range\n");
+            return false;
+        }
+        value.int_value = major == MAJOR_NINT ? -1 - static_cast<int64_t>(arg) : static_cast<int64_t>(arg);
+        break;
+    case CborFieldKind::Bool:
+        value.bool_value = info == INFO_TRUE;
+        break;
+    default:
         return false;
     }
 
-    CborParser parser;
-    CborValue root;
-    if (cbor_parser_init(reinterpret_cast<const uint8_t*>(transform.incoming.data()), transform.incoming.size(), 0, &parser, &root) != CborNoError)
+    if (!deliver(m_field, value))
     {
+        printf("CBOR field value rejected\n");
         return false;
     }
 
-    if (!cbor_value_is_byte_string(&root))
+    return true;
+}
+
+bool CborDecoder::pushLevel(uint64_t items)
+{
+    if (items == 0)
     {
-        return false;
+        // Empty container: complete as soon as it opens
+        return itemDone();
     }
 
-    size_t bytes_len = 0;
-    if (cbor_value_calculate_string_length(&root, &bytes_len) != CborNoError)
+    if (m_depth == MAX_DEPTH)
     {
+        printf("CBOR nesting deeper than %zu\n", MAX_DEPTH);
         return false;
     }
 
-    transform.outgoing.resize(bytes_len);
-    if (cbor_value_copy_byte_string(&root, reinterpret_cast<uint8_t*>(transform.outgoing.data()), &bytes_len, nullptr) != CborNoError)
+    m_levels[m_depth++].remaining = items;
+    return true;
+}
+
+bool CborDecoder::itemDone()
+{
+    while (m_depth > 0)
     {
-        transform.outgoing.clear();
-        return false;
+        Level& level = m_levels[m_depth - 1];
+
+        if (m_depth == 1)
+        {
+            m_expect_key = !m_expect_key;
+            if (m_expect_key)
+            {
+                m_field = NO_FIELD;
+            }
+        }
+
+        if (level.remaining == INDEFINITE || --level.remaining > 0)
+        {
+            return true;
+        }
+
+        // The container is complete: it counts as one item of its parent
+        --m_depth;
     }
 
-    transform.outgoing.resize(bytes_len);
+    m_state = State::Done;
     return true;
 }
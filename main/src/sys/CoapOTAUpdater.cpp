@@ -2,6 +2,7 @@
 
 extern "C" {
 #include "esp_http_client.h"
+#include "esp_idf_version.h"
 #include "esp_ota_ops.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -15,9 +16,47 @@ extern "C" {
 #include "EEPROMConfig.hpp"
 #include "Utils.hpp"
 
+namespace {
+
+/**
+ * @brief Appends a string fragment to a reply field, starting over at the first fragment.
+ */
+bool appendFragment(std::string& out, const CborFieldValue_t& value, size_t max_len)
+{
+    if (value.total_len > max_len)
+    {
+        printf("Reply field too long (%zu bytes, max %zu)\n", value.total_len, max_len);
+        return false;
+    }
+
+    if (value.offset == 0)
+    {
+        out.clear();
+        out.reserve(value.total_len);
+    }
+
+    out.append(reinterpret_cast<const char*>(value.fragment.data()), value.fragment.size());
+    return true;
+}
+
+} // namespace
+
+const CborMapDecoder<CoapOTAUpdater>::Field CoapOTAUpdater::VERSION_RESPONSE_FIELDS[3] = {
+    {cborRootKey(), CborFieldKind::String, &CoapOTAUpdater::onVersionField},
+    {cborTextKey("version"), CborFieldKind::String, &CoapOTAUpdater::onVersionField},
+    {cborTextKey("url"), CborFieldKind::String, &CoapOTAUpdater::onUrlField},
+};
+
+const CborMapDecoder<CoapOTAUpdater>::Field CoapOTAUpdater::URL_RESPONSE_FIELDS[2] = {
+    {cborRootKey(), CborFieldKind::String, &CoapOTAUpdater::onUrlField},
+    {cborTextKey("url"), CborFieldKind::String, &CoapOTAUpdater::onUrlField},
+};
+
 CoapOTAUpdater::CoapOTAUpdater(Communication& communication, const char* current_firmware_version)
     : comm(communication),
-            current_version(current_firmware_version ? current_firmware_version : "")
+            current_version(current_firmware_version ? current_firmware_version : ""),
+            version_decoder(VERSION_RESPONSE_FIELDS, *this),
+            url_decoder(URL_RESPONSE_FIELDS, *this)
 {
         std::memset(&http_config, 0, sizeof(http_config));
         http_config.timeout_ms = 60000;
@@ -193,17 +232,57 @@ int CoapOTAUpdater::compareVersions(const std::string& v1, const std::string& v2
 }
 
 
+bool CoapOTAUpdater::onVersionField(CoapOTAUpdater& ota, const CborFieldValue_t& value)
+{
+    return appendFragment(ota.available_version, value, VERSION_MAX_LEN);
+}
+
+bool CoapOTAUpdater::onUrlField(CoapOTAUpdater& ota, const CborFieldValue_t& value)
+{
+    return appendFragment(ota.reply_url, value, URL_MAX_LEN);
+}
+
+PacketChunkCallback CoapOTAUpdater::versionResponseSink()
+{
+    available_version.clear();
+    reply_url.clear();
+    version_decoder.reset();
+
+    return [this](const uint8_t* chunk, size_t chunk_len) -> bool {
+        return version_decoder.feed(std::span<const uint8_t>(chunk, chunk_len));
+    };
+}
+
+bool CoapOTAUpdater::finishVersionResponse()
+{
+    if (!version_decoder.complete())
+    {
+        printf("Failed to decode firmware version response\n");
+        available_version.clear();
+        reply_url.clear();
+        return false;
+    }
+
+    Utils::trimTrailingWhitespace(available_version);
+    Utils::trimTrailingWhitespace(reply_url);
+
+    if (available_version.empty())
+    {
+        printf("Firmware version response is empty\n");
+        return false;
+    }
+
+    return true;
+}
+
 bool CoapOTAUpdater::isFirmwareAvailable()
 {
-    std::string firmware_version_cbor;
-    CborStringTransform version_transform;
     static constexpr int MAX_VERSION_CHECK_ATTEMPTS = 2;
 
     bool got_response = false;
     for (int attempt = 1; attempt <= MAX_VERSION_CHECK_ATTEMPTS; ++attempt)
     {
-        firmware_version_cbor.clear();
-        if (comm.sendPacket(nullptr, 0, firmwareversion_entry, firmware_version_cbor))
+        if (comm.sendPacketStream(nullptr, 0, firmwareversion_entry, versionResponseSink()))
         {
             got_response = true;
             break;
@@ -221,23 +300,16 @@ bool CoapOTAUpdater::isFirmwareAvailable()
         return false;
     }
 
-    version_transform.incoming = firmware_version_cbor;
-    if (!CborDecoder::decodeText(version_transform))
-    {
-        printf("Failed to decode firmware version CBOR (payload size: %zu bytes)\n", firmware_version_cbor.size());
-        return false;
-    }
-
-    std::string firmware_version = version_transform.outgoing;
-    Utils::trimTrailingWhitespace(firmware_version);
+    return evaluateVersionResponse();
+}
 
-    if (firmware_version.empty())
+bool CoapOTAUpdater::evaluateVersionResponse()
+{
+    if (!finishVersionResponse())
     {
-        printf("Firmware version response is empty\n");
         return false;
     }
 
-    available_version = firmware_version;
     const bool update_available = compareVersions(available_version, current_version) > 0;
 
     printf("OTA version check: current='%s', available='%s', update=%s\n",
@@ -250,12 +322,8 @@ bool CoapOTAUpdater::isFirmwareAvailable()
 
 bool CoapOTAUpdater::executeUpdate()
 {
-    CborStringTransform firmware_transform;
-    std::string firmware_version_to_store = available_version;
     const esp_partition_t *update_partition = esp_ota_get_next_update_partition(nullptr);
     esp_ota_handle_t ota_handle = 0;
-    std::string firmware_cbor;
-    std::string firmware_url;
     size_t total_written = 0;
     
     if (!update_partition)
@@ -264,73 +332,33 @@ bool CoapOTAUpdater::executeUpdate()
         return false;
     }
     
-    if (firmware_version_to_store.empty())
+    if (available_version.empty())
     {
-        std::string firmware_version_cbor;
-        CborStringTransform version_transform;
-        
-        if (!comm.sendPacket(nullptr, 0, firmwareversion_entry, firmware_version_cbor))
+        if (!comm.sendPacketStream(nullptr, 0, firmwareversion_entry, versionResponseSink()) || !finishVersionResponse())
         {
             printf("Failed to read firmware version before OTA write\n");
             return false;
         }
-
-        version_transform.incoming = firmware_version_cbor;
-        if (!CborDecoder::decodeText(version_transform))
-        {
-            printf("Failed to decode firmware version CBOR before OTA write\n");
-            return false;
-        }
-
-        firmware_version_to_store = version_transform.outgoing;
-
-        Utils::trimTrailingWhitespace(firmware_version_to_store);
     }
 
-    if (firmware_version_to_store.empty())
-    {
-        printf("Firmware version to store is empty\n");
-        return false;
-    }
-    
-    esp_err_t err = esp_ota_begin(update_partition, OTA_SIZE_UNKNOWN, &ota_handle);
+    const std::string firmware_version_to_store = available_version;
     
-    if (err != ESP_OK)
-    {
-        printf("esp_ota_begin failed: %s\n", esp_err_to_name(err));
-        return false;
-    }
+    const BlockwiseResult blockwise = streamFirmwareBlockwise(update_partition, firmware_version_to_store, ota_handle, total_written);
 
-    if (!comm.sendPacket(nullptr, 0, firmwaredownload_entry, firmware_cbor))
+    if (blockwise == BlockwiseResult::Failed)
     {
-        esp_ota_abort(ota_handle);
-        printf("Firmware URL request failed\n");
+        printf("Block-wise firmware download interrupted at %zu bytes, will resume next cycle\n", total_written);
         return false;
     }
 
-    firmware_transform.incoming = firmware_cbor;
-    if (!CborDecoder::decodeText(firmware_transform))
+    if (blockwise == BlockwiseResult::Unsupported)
     {
-        esp_ota_abort(ota_handle);
-        printf("Failed to decode firmware URL CBOR\n");
-        return false;
-    }
-
-    firmware_url = firmware_transform.outgoing;
-    Utils::trimTrailingWhitespace(firmware_url);
+        printf("Block-wise firmware image not served, falling back to URL download\n");
 
-    if (firmware_url.empty())
-    {
-        esp_ota_abort(ota_handle);
-        printf("Firmware URL is empty\n");
-        return false;
-    }
-
-    if (!streamFirmwareFromHttpsToOta(firmware_url, ota_handle, total_written))
-    {
-        esp_ota_abort(ota_handle);
-        printf("Firmware HTTPS streaming failed\n");
-        return false;
+        if (!downloadFirmwareViaUrl(update_partition, ota_handle, total_written))
+        {
+            return false;
+        }
     }
 
     if (total_written == 0)
@@ -340,7 +368,10 @@ bool CoapOTAUpdater::executeUpdate()
         return false;
     }
 
-    err = esp_ota_end(ota_handle);
+    // Whatever the outcome, the partition no longer holds a resumable partial image
+    eeprom.clearOtaProgress();
+
+    esp_err_t err = esp_ota_end(ota_handle);
     if (err != ESP_OK)
     {
         printf("esp_ota_end failed: %s\n", esp_err_to_name(err));
@@ -371,3 +402,188 @@ bool CoapOTAUpdater::executeUpdate()
     printf("Firmware streamed and written successfully (%zu bytes)\n", total_written);
     return true;
 }
+
+CoapOTAUpdater::BlockwiseResult CoapOTAUpdater::streamFirmwareBlockwise(const esp_partition_t* partition,
+                                                                        const std::string& version,
+                                                                        esp_ota_handle_t& ota_handle,
+                                                                        size_t& total_written)
+{
+    OtaProgress_t progress = {};
+    uint8_t szx = comm.maxBlockSzx();
+    bool resumed = false;
+    int block_failures = 0;
+    bool more = true;
+
+    total_written = 0;
+
+    if (eeprom.loadOtaProgress(progress) &&
+        version == progress.version &&
+        progress.bytes_written > 0 &&
+        (progress.bytes_written % OTA_PROGRESS_FLUSH_BYTES) == 0 &&
+        progress.szx <= szx)
+    {
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 4, 0)
+        const esp_err_t resume_err = esp_ota_resume(partition, OTA_WITH_SEQUENTIAL_WRITES, progress.bytes_written, &ota_handle);
+        if (resume_err == ESP_OK)
+        {
+            resumed = true;
+            szx = progress.szx;
+            total_written = progress.bytes_written;
+            printf("Resuming firmware %s download at %lu bytes\n", progress.version, static_cast<unsigned long>(progress.bytes_written));
+        }
+        else
+        {
+            printf("esp_ota_resume failed (%s), restarting download\n", esp_err_to_name(resume_err));
+        }
+#else
+        printf("OTA resume not supported by this IDF version, restarting download\n");
+#endif
+    }
+
+    if (!resumed)
+    {
+        const esp_err_t begin_err = esp_ota_begin(partition, OTA_WITH_SEQUENTIAL_WRITES, &ota_handle);
+        if (begin_err != ESP_OK)
+        {
+            printf("esp_ota_begin failed: %s\n", esp_err_to_name(begin_err));
+            return BlockwiseResult::Failed;
+        }
+
+        std::memset(&progress, 0, sizeof(progress));
+        std::strncpy(progress.version, version.c_str(), MANF_MAX_LEN - 1);
+    }
+
+    while (more)
+    {
+        const CoapBlockOpt_t request = {static_cast<uint32_t>(total_written / COAP_BLOCK_SIZE(szx)), false, szx};
+        CoapBlockOpt_t response = {};
+
+        const bool got_block = comm.fetchBlock(
+            firmwareimage_entry,
+            request,
+            response,
+            [&](const uint8_t* chunk, size_t chunk_len) -> bool {
+                const uint32_t block_size = COAP_BLOCK_SIZE(response.szx);
+                const size_t offset = static_cast<size_t>(response.num) * block_size;
+
+                if (response.szx > szx || offset != total_written)
+                {
+                    printf("Unexpected block %lu (SZX %u) at offset %zu\n",
+                           static_cast<unsigned long>(response.num), response.szx, total_written);
+                    return false;
+                }
+
+                if (chunk_len > block_size || (response.more && chunk_len != block_size))
+                {
+                    printf("Block %lu has invalid length %zu\n", static_cast<unsigned long>(response.num), chunk_len);
+                    return false;
+                }
+
+                const esp_err_t write_err = esp_ota_write(ota_handle, chunk, chunk_len);
+                if (write_err != ESP_OK)
+                {
+                    printf("esp_ota_write failed during block transfer: %s\n", esp_err_to_name(write_err));
+                    return false;
+                }
+
+                total_written += chunk_len;
+                return true;
+            });
+
+        if (!got_block)
+        {
+            if (total_written == 0 && !resumed)
+            {
+                esp_ota_abort(ota_handle);
+                return BlockwiseResult::Unsupported;
+            }
+
+            if (++block_failures < OTA_BLOCK_MAX_FAILURES)
+            {
+                printf("Block %lu failed (%d/%d), retrying\n",
+                       static_cast<unsigned long>(request.num), block_failures, OTA_BLOCK_MAX_FAILURES);
+                continue;
+            }
+
+            progress.bytes_written = static_cast<uint32_t>(total_written - (total_written % OTA_PROGRESS_FLUSH_BYTES));
+            progress.szx = szx;
+            eeprom.saveOtaProgress(progress);
+            esp_ota_abort(ota_handle);
+            return BlockwiseResult::Failed;
+        }
+
+        block_failures = 0;
+        more = response.more;
+
+        if (response.szx < szx)
+        {
+            printf("Server reduced block size to %u bytes\n", COAP_BLOCK_SIZE(response.szx));
+            szx = response.szx;
+        }
+
+        if (more && (total_written % OTA_PROGRESS_FLUSH_BYTES) == 0)
+        {
+            progress.bytes_written = static_cast<uint32_t>(total_written);
+            progress.szx = szx;
+            if (!eeprom.saveOtaProgress(progress))
+            {
+                printf("Warning: failed to persist OTA progress\n");
+            }
+        }
+    }
+
+    printf("Block-wise firmware download complete (%zu bytes)\n", total_written);
+    return BlockwiseResult::Complete;
+}
+
+bool CoapOTAUpdater::downloadFirmwareViaUrl(const esp_partition_t* partition, esp_ota_handle_t& ota_handle, size_t& total_written)
+{
+    esp_err_t err = esp_ota_begin(partition, OTA_SIZE_UNKNOWN, &ota_handle);
+    
+    if (err != ESP_OK)
+    {
+        printf("esp_ota_begin failed: %s\n", esp_err_to_name(err));
+        return false;
+    }
+
+    // The version response may already carry the URL; only ask for it when it did not
+    if (reply_url.empty())
+    {
+        url_decoder.reset();
+
+        if (!comm.sendPacketStream(nullptr, 0, firmwaredownload_entry,
+                                   [this](const uint8_t* chunk, size_t chunk_len) -> bool {
+                                       return url_decoder.feed(std::span<const uint8_t>(chunk, chunk_len));
+                                   }))
+        {
+            esp_ota_abort(ota_handle);
+            printf("Firmware URL request failed\n");
+            return false;
+        }
+
+        if (!url_decoder.complete())
+        {
+            esp_ota_abort(ota_handle);
+            printf("Failed to decode firmware URL response\n");
+            return false;
+        }
+
+        Utils::trimTrailingWhitespace(reply_url);
+    }
+
+    if (reply_url.empty())
+    {
+        esp_ota_abort(ota_handle);
+        printf("Firmware URL is empty\n");
+        return false;
+    }
+
+    if (!streamFirmwareFromHttpsToOta(reply_url, ota_handle, total_written))
+    {
+        esp_ota_abort(ota_handle);
+        printf("Firmware HTTPS streaming failed\n");
+        return false;
+    }
+
+    return true;
+}
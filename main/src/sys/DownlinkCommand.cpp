@@ -0,0 +1,287 @@
+#include "DownlinkCommand.hpp"
+
+#include <cbor.h>
+#include <cmath>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+extern "C" {
+    #include "esp_attr.h"
+}
+
+/**
+ * @brief Trigger state retained across deep sleep. Zeroed by the loader on power-on reset.
+ */
+RTC_DATA_ATTR DownlinkCommand::RtcState DownlinkCommand::s_rtc_state;
+
+void DownlinkCommand::begin()
+{
+    if (s_rtc_state.magic == RTC_STATE_MAGIC)
+    {
+        return;
+    }
+
+    memset(&s_rtc_state, 0, sizeof(s_rtc_state));
+    s_rtc_state.magic = RTC_STATE_MAGIC;
+}
+
+bool DownlinkCommand::apply(const uint8_t* payload, size_t len, DeviceConfig& config)
+{
+    CommandSet commands;
+
+    if (!payload || len == 0)
+    {
+        return false;
+    }
+
+    if (!parse(payload, len, commands))
+    {
+        return false;
+    }
+
+    if (commands.version <= config.cmd_ver)
+    {
+        printf("Downlink command v%lu already applied (current v%lu)\n",
+               static_cast<unsigned long>(commands.version), static_cast<unsigned long>(config.cmd_ver));
+        return false;
+    }
+
+    if (commands.has_app_delay)
+    {
+        printf("Downlink: main_app_delay %lu -> %lu s\n",
+               static_cast<unsigned long>(config.main_app_delay), static_cast<unsigned long>(commands.app_delay));
+        config.main_app_delay = commands.app_delay;
+    }
+
+    for (size_t i = 0; i < commands.calib_count; ++i)
+    {
+        const DataCalib_t& staged = commands.calib[i];
+
+        for (DataCalib_t& entry : config.calib.calib_list)
+        {
+            if (entry.m_type == staged.m_type)
+            {
+                entry.offset = staged.offset;
+                entry.gain = staged.gain;
+                printf("Downlink: calibration type %d offset=%.3f gain=%.3f\n", static_cast<int>(entry.m_type),
+                       static_cast<double>(entry.offset), static_cast<double>(entry.gain));
+                break;
+            }
+        }
+    }
+
+    if (commands.calib_count > 0)
+    {
+        config.calib.last_cal_ts = static_cast<uint32_t>(time(nullptr));
+    }
+
+    if (commands.actions & DOWNLINK_ACTION_OTA)
+    {
+        printf("Downlink: OTA check requested on next wake\n");
+    }
+
+    if (commands.actions & DOWNLINK_ACTION_GPS)
+    {
+        printf("Downlink: GPS refresh requested on next wake\n");
+    }
+
+    s_rtc_state.pending_actions = static_cast<uint8_t>(s_rtc_state.pending_actions | commands.actions);
+    config.cmd_ver = commands.version;
+
+    printf("Downlink command v%lu applied\n", static_cast<unsigned long>(commands.version));
+    return true;
+}
+
+uint8_t DownlinkCommand::pendingActions()
+{
+    return s_rtc_state.pending_actions;
+}
+
+void DownlinkCommand::clearPending(uint8_t actions)
+{
+    s_rtc_state.pending_actions = static_cast<uint8_t>(s_rtc_state.pending_actions & ~actions);
+}
+
+bool DownlinkCommand::parse(const uint8_t* payload, size_t len, CommandSet& commands)
+{
+    CborParser parser;
+    CborValue root;
+    CborValue it;
+
+    memset(&commands, 0, sizeof(commands));
+
+    if (cbor_parser_init(payload, len, 0, &parser, &root) != CborNoError || !cbor_value_is_map(&root))
+    {
+        printf("Downlink payload is not a command map\n");
+        return false;
+    }
+
+    if (cbor_value_enter_container(&root, &it) != CborNoError)
+    {
+        return false;
+    }
+
+    while (!cbor_value_at_end(&it))
+    {
+        uint32_t key = 0;
+        bool ok = false;
+
+        if (!readU32(&it, &key))
+        {
+            printf("Downlink command map has a non-integer key\n");
+            return false;
+        }
+
+        switch (key)
+        {
+        case KEY_VERSION:
+            ok = readU32(&it, &commands.version);
+            commands.has_version = ok;
+            break;
+        case KEY_APP_DELAY:
+            ok = readU32(&it, &commands.app_delay) &&
+                 commands.app_delay >= MIN_APP_DELAY_SEC && commands.app_delay <= MAX_APP_DELAY_SEC;
+            commands.has_app_delay = ok;
+            break;
+        case KEY_OTA:
+            ok = readTrigger(&it, DOWNLINK_ACTION_OTA, commands);
+            break;
+        case KEY_GPS:
+            ok = readTrigger(&it, DOWNLINK_ACTION_GPS, commands);
+            break;
+        case KEY_CALIB:
+            ok = parseCalib(&it, commands);
+            break;
+        default:
+            printf("Downlink: skipping unknown command %lu\n", static_cast<unsigned long>(key));
+            ok = (cbor_value_advance(&it) == CborNoError);
+            break;
+        }
+
+        if (!ok)
+        {
+            printf("Downlink command %lu is malformed or out of range, ignoring map\n", static_cast<unsigned long>(key));
+            return false;
+        }
+    }
+
+    if (cbor_value_leave_container(&root, &it) != CborNoError)
+    {
+        return false;
+    }
+
+    if (!commands.has_version)
+    {
+        printf("Downlink command map has no version, ignoring it\n");
+        return false;
+    }
+
+    return true;
+}
+
+bool DownlinkCommand::parseCalib(CborValue* array, CommandSet& commands)
+{
+    CborValue entries;
+
+    if (!cbor_value_is_array(array) || cbor_value_enter_container(array, &entries) != CborNoError)
+    {
+        return false;
+    }
+
+    while (!cbor_value_at_end(&entries))
+    {
+        CborValue fields;
+        size_t field_count = 0;
+        uint32_t type = 0;
+        DataCalib_t staged = {};
+
+        if (commands.calib_count >= CALIB_COUNT || !cbor_value_is_array(&entries) ||
+            cbor_value_get_array_length(&entries, &field_count) != CborNoError || field_count != 3 ||
+            cbor_value_enter_container(&entries, &fields) != CborNoError)
+        {
+            return false;
+        }
+
+        if (!readU32(&fields, &type) || type >= CALIB_COUNT ||
+            !readFloat(&fields, &staged.offset) || !readFloat(&fields, &staged.gain) ||
+            staged.gain == 0.0f)
+        {
+            return false;
+        }
+
+        if (cbor_value_leave_container(&entries, &fields) != CborNoError)
+        {
+            return false;
+        }
+
+        staged.m_type = static_cast<MeasurementType>(type);
+        commands.calib[commands.calib_count++] = staged;
+    }
+
+    return (cbor_value_leave_container(array, &entries) == CborNoError);
+}
+
+bool DownlinkCommand::readU32(CborValue* value, uint32_t* dest)
+{
+    uint64_t raw = 0;
+
+    if (!cbor_value_is_unsigned_integer(value) || cbor_value_get_uint64(value, &raw) != CborNoError ||
+        raw > UINT32_MAX)
+    {
+        return false;
+    }
+
+    *dest = static_cast<uint32_t>(raw);
+    return (cbor_value_advance_fixed(value) == CborNoError);
+}
+
+bool DownlinkCommand::readFloat(CborValue* value, float* dest)
+{
+    CborError err = CborErrorIllegalType;
+
+    if (cbor_value_is_half_float(value))
+    {
+        err = cbor_value_get_half_float_as_float(value, dest);
+    }
+    else if (cbor_value_is_float(value))
+    {
+        err = cbor_value_get_float(value, dest);
+    }
+    else if (cbor_value_is_double(value))
+    {
+        double raw = 0.0;
+        err = cbor_value_get_double(value, &raw);
+        *dest = static_cast<float>(raw);
+    }
+    else if (cbor_value_is_integer(value))
+    {
+        int64_t raw = 0;
+        err = cbor_value_get_int64_checked(value, &raw);
+        *dest = static_cast<float>(raw);
+    }
+
+    if (err != CborNoError || !std::isfinite(*dest))
+    {
+        return false;
+    }
+
+    return (cbor_value_advance_fixed(value) == CborNoError);
+}
+
+bool DownlinkCommand::readTrigger(CborValue* value, uint8_t action, CommandSet& commands)
+{
+    bool enabled = false;
+
+    if (!cbor_value_is_boolean(value) || cbor_value_get_boolean(value, &enabled) != CborNoError)
+    {
+        return false;
+    }
+
+    if (enabled)
+    {
+        commands.actions = static_cast<uint8_t>(commands.actions | action);
+    }
+
+    return (cbor_value_advance_fixed(value) == CborNoError);
+}
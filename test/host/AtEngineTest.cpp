@@ -0,0 +1,105 @@
+// Runs AtEngine jobs against a scripted modem: interleaving, nested tasks, captures,
+// command timeouts and AtJob wait semantics, including waiting with portMAX_DELAY.
+
+#include "AtEngine.hpp"
+#include "HostTest.hpp"
+#include "ModemReader.hpp"
+#include "SimModem.hpp"
+#include "UARTDriver.hpp"
+
+#include <cstring>
+#include <mutex>
+#include <string>
+
+namespace {
+
+const ATCommand_t cmd_a = {"AT+A", "OK", 1000, MsgType::STATUS, nullptr, 0};
+const ATCommand_t cmd_b = {"AT+B", "OK", 1000, MsgType::STATUS, nullptr, 0};
+const ATCommand_t cmd_c = {"AT+C", "OK", 1000, MsgType::STATUS, nullptr, 0};
+const ATCommand_t cmd_d = {"AT+D", "+D:", 1000, MsgType::STATUS, nullptr, 0};
+const ATCommand_t cmd_silent = {"AT+E", "OK", 200, MsgType::STATUS, nullptr, 0};
+
+std::mutex s_sent_mutex;
+std::string s_sent;  ///< Command names in the order the modem saw them
+char s_captured[64];
+
+AtTask<bool> captureD(char* buf, size_t len) {
+    co_return co_await g_at_engine.sendAndCapture(cmd_d, buf, len);
+}
+
+/** A then B, with a long delay between them. */
+AtTask<bool> slowJob() {
+    const bool a = co_await g_at_engine.send(cmd_a);
+    co_await g_at_engine.delay(pdMS_TO_TICKS(300));
+    const bool b = co_await g_at_engine.send(cmd_b);
+    co_return a && b;
+}
+
+/** C, a short delay, D through a nested task, then a command the modem never answers. */
+AtTask<bool> fastJob() {
+    const bool c = co_await g_at_engine.send(cmd_c);
+    co_await g_at_engine.delay(pdMS_TO_TICKS(50));
+    const bool d = co_await captureD(s_captured, sizeof(s_captured));
+    const bool silent = co_await g_at_engine.send(cmd_silent);
+    co_return c && d && !silent;
+}
+
+/** A delay long enough that a wait which does not block would return before it ends. */
+AtTask<bool> delayedJob() {
+    co_await g_at_engine.delay(pdMS_TO_TICKS(200));
+    co_return co_await g_at_engine.send(cmd_a);
+}
+
+void scriptModem() {
+    sim_modem::onTransmit([](const std::string& bytes) {
+        {
+            std::lock_guard lock(s_sent_mutex);
+            s_sent += bytes.substr(0, 4) + " ";
+        }
+
+        if (bytes.starts_with("AT+D")) {
+            sim_modem::reply("\r\n+D: 42\r\n\r\nOK\r\n", 5);
+        } else if (!bytes.starts_with("AT+E")) {
+            sim_modem::reply("\r\nOK\r\n", 5);
+        }
+    });
+}
+
+}  // namespace
+
+int main() {
+    m_modem_uart.enablePatternDetect('\n', 32);
+    CHECK(g_modem_reader.start());
+    CHECK(g_at_engine.start());
+    scriptModem();
+
+    const AtJob slow = g_at_engine.spawn(slowJob());
+    const AtJob fast = g_at_engine.spawn(fastJob());
+    CHECK(slow.valid() && fast.valid());
+    CHECK(!slow.done());
+
+    // The fast job runs its commands while the slow one is parked on its delay
+    CHECK(fast.wait(xTaskGetTickCount() + pdMS_TO_TICKS(3000)));
+    CHECK(slow.wait(xTaskGetTickCount() + pdMS_TO_TICKS(3000)));
+    CHECK(slow.done() && fast.done());
+
+    {
+        std::lock_guard lock(s_sent_mutex);
+        printf("modem saw: %s\n", s_sent.c_str());
+        CHECK(s_sent == "AT+A AT+C AT+D AT+E AT+B ");
+    }
+    CHECK(strstr(s_captured, "+D: 42") != nullptr);
+
+    // A finished job stays signalled for later waiters; an empty handle never succeeds
+    CHECK(slow.wait(0));
+    CHECK(!AtJob{}.wait(0));
+
+    // portMAX_DELAY blocks until the job finishes instead of being read as a past deadline
+    const TickType_t started = xTaskGetTickCount();
+    const AtJob delayed = g_at_engine.spawn(delayedJob());
+    CHECK(delayed.wait(portMAX_DELAY));
+    CHECK(delayed.done());
+    CHECK(xTaskGetTickCount() - started >= pdMS_TO_TICKS(200));
+
+    host_test::finish("at_engine_test");
+}
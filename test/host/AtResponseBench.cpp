@@ -0,0 +1,145 @@
+// Time per modem line: parseAtResponse() against the strcmp/strstr/sscanf chains it
+// replaced in ATCommandHndlr and SimConnection. Both sides classify the same lines and
+// pull out the same fields; the results are compared before timing.
+//
+//   at_response_bench [iterations]
+
+#include "AtResponse.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace {
+
+const char* const LINES[] = {
+    "OK",
+    "ERROR",
+    "+CME ERROR: 10",
+    "+QIOPEN: 0,0",
+    "+QSSLOPEN: 1,0",
+    "+QIRD: 128",
+    "+QIURC: \"recv\",0",
+    "+QIURC: \"closed\",1",
+    "+QHTTPGET: 0,200,4096",
+    "+QHTTPREAD: 0",
+    "CONNECT",
+    "SEND OK",
+    "+CEREG: 2,1,\"1A2B\",\"01ABCDEF\",7",
+    "+CEREG: 4,1,\"1A2B\",\"01ABCDEF\",7,,,\"00100010\",\"00101010\"",
+    "AT+QIRD=0,1024",
+    "Quectel",
+    "EC25",
+    "+QIACT: 1,1,1,\"10.0.0.1\"",
+    "RDY",
+    "+CFUN: 1",
+};
+
+volatile int g_sink;
+
+/** One pass of the previous per-call-site matching, in the order the sites tried it. */
+int chainMatch(const char* line) {
+    int a = -1;
+    int b = -1;
+    int c = -1;
+
+    if (strcmp(line, "ERROR") == 0 || strstr(line, "+CME ERROR") != nullptr) return 1;
+    if (strcmp(line, "OK") == 0) return 2;
+    if (strcmp(line, ">") == 0) return 3;
+    if (strcmp(line, "SEND OK") == 0) return 4;
+    if (strcmp(line, "CONNECT") == 0) return 5;
+    if (strncmp(line, "+QIOPEN:", 8) == 0 && sscanf(line, "+QIOPEN: %d,%d", &a, &b) == 2) return 6 + a + b;
+    if (strncmp(line, "+QSSLOPEN:", 10) == 0 && sscanf(line, "+QSSLOPEN: %d,%d", &a, &b) == 2) return 7 + a + b;
+    if (strncmp(line, "+QIRD:", 6) == 0 && sscanf(line, "+QIRD: %d", &a) == 1) return 8 + a;
+    if (strstr(line, "+QIURC: \"closed\"") != nullptr && sscanf(line, "+QIURC: \"closed\",%d", &a) == 1) return 9 + a;
+    if (sscanf(line, "+QIURC: \"recv\",%d", &a) == 1) return 10 + a;
+    if (sscanf(line, "+QHTTPGET: %d,%d,%d", &a, &b, &c) >= 2) return 11 + b;
+    if (strncmp(line, "+QHTTPREAD:", 11) == 0 && sscanf(line, "+QHTTPREAD: %d", &a) == 1) return 12;
+    if (sscanf(line, "+CEREG: %d,%d", &a, &b) == 2) return 13 + b;
+    if (sscanf(line, "+QIACT: %d,%d", &a, &b) == 2) return 14;
+    if (sscanf(line, "+CFUN: %d", &a) == 1) return 15;
+    return 0;
+}
+
+int tableMatch(const char* line) {
+    const AtResponse resp = parseAtResponse(line);
+    int32_t a = -1;
+    int32_t b = -1;
+
+    switch (resp.result) {
+    case AtResult::Error:
+    case AtResult::CmeError:
+        return 1;
+    case AtResult::Ok:
+        return 2;
+    case AtResult::Prompt:
+        return 3;
+    case AtResult::SendOk:
+        return 4;
+    case AtResult::Connect:
+        return 5;
+    case AtResult::QiOpen:
+        resp.intField(0, a);
+        resp.intField(1, b);
+        return 6 + a + b;
+    case AtResult::QsslOpen:
+        resp.intField(0, a);
+        resp.intField(1, b);
+        return 7 + a + b;
+    case AtResult::QiRd:
+        resp.intField(0, a);
+        return 8 + a;
+    case AtResult::QiUrc:
+        resp.intField(1, a);
+        return (resp.textField(0) == "closed" ? 9 : 10) + a;
+    case AtResult::QhttpGet:
+        resp.intField(1, b);
+        return 11 + b;
+    case AtResult::QhttpRead:
+        return 12;
+    case AtResult::Cereg:
+        resp.intField(1, b);
+        return 13 + b;
+    case AtResult::QiAct:
+        return 14;
+    case AtResult::Cfun:
+        return 15;
+    default:
+        return 0;
+    }
+}
+
+template <typename Match>
+double nsPerLine(Match match, int iterations) {
+    int sum = 0;
+    const auto started = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < iterations; ++i) {
+        for (const char* line : LINES) {
+            sum += match(line);
+        }
+    }
+
+    g_sink = sum;
+    const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - started).count();
+    return ns / (static_cast<double>(iterations) * static_cast<double>(std::size(LINES)));
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const int iterations = (argc > 1) ? atoi(argv[1]) : 200000;
+    int mismatches = 0;
+
+    for (const char* line : LINES) {
+        if (chainMatch(line) != tableMatch(line)) {
+            printf("mismatch on \"%s\": chain %d, table %d\n", line, chainMatch(line), tableMatch(line));
+            ++mismatches;
+        }
+    }
+
+    printf("strcmp/sscanf chain: %6.1f ns/line\n", nsPerLine(chainMatch, iterations));
+    printf("parseAtResponse:     %6.1f ns/line\n", nsPerLine(tableMatch, iterations));
+    return mismatches == 0 ? 0 : 1;
+}
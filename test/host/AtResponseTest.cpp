@@ -0,0 +1,56 @@
+// Classification and field extraction of parseAtResponse().
+
+#include "AtResponse.hpp"
+#include "HostTest.hpp"
+
+int main() {
+    int32_t value = 0;
+
+    AtResponse resp = parseAtResponse("OK");
+    CHECK(resp.is(AtResult::Ok) && resp.field_count == 0);
+
+    CHECK(parseAtResponse("OKAY").is(AtResult::Other));
+    CHECK(parseAtResponse("+QIURCX: 1").is(AtResult::Other));
+    CHECK(parseAtResponse("").is(AtResult::Other));
+
+    resp = parseAtResponse("+CME ERROR: 10");
+    CHECK(resp.isError() && resp.is(AtResult::CmeError));
+    CHECK(resp.intField(0, value) && value == 10);
+    CHECK(parseAtResponse("+CMS ERROR: 500").is(AtResult::CmsError));
+
+    resp = parseAtResponse("+QIURC: \"closed\",1");
+    CHECK(resp.is(AtResult::QiUrc) && resp.textField(0) == "closed");
+    CHECK(!resp.intField(0, value));
+    CHECK(resp.intField(1, value) && value == 1);
+
+    // Empty fields are kept in place, so later fields keep their index
+    resp = parseAtResponse("+CEREG: 4,1,\"1A2B\",\"01ABCDEF\",7,,,\"00100010\",\"00101010\"");
+    CHECK(resp.is(AtResult::Cereg) && resp.field_count == 9);
+    CHECK(resp.textField(5).empty() && !resp.intField(5, value));
+    CHECK(resp.textField(7) == "00100010" && resp.textField(8) == "00101010");
+    CHECK(resp.textField(9).empty());
+
+    resp = parseAtResponse("+CEDRXRDP: 4,\"0101\",\"0010\",\"0011\"");
+    CHECK(resp.is(AtResult::CedrxRdp) && resp.textField(2) == "0010" && resp.textField(3) == "0011");
+
+    resp = parseAtResponse("+QIRD: -1");
+    CHECK(resp.intField(0, value) && value == -1);
+
+    resp = parseAtResponse("+QHTTPGET: 0, 200 ,4096");
+    CHECK(resp.intField(1, value) && value == 200);
+
+    // The int32_t range is accepted in full; anything past it is text only
+    resp = parseAtResponse("+QIRD: 2147483647,-2147483648");
+    CHECK(resp.intField(0, value) && value == INT32_MAX);
+    CHECK(resp.intField(1, value) && value == INT32_MIN);
+
+    resp = parseAtResponse("+QIRD: 2147483648,-2147483649,99999999999999999999");
+    CHECK(!resp.intField(0, value) && resp.textField(0) == "2147483648");
+    CHECK(!resp.intField(1, value));
+    CHECK(!resp.intField(2, value));
+
+    resp = parseAtResponse("+QIRD: -,12a");
+    CHECK(!resp.intField(0, value) && !resp.intField(1, value));
+
+    host_test::finish("at_response_test");
+}
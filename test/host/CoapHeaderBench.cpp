@@ -0,0 +1,235 @@
+// Time per request: CoapPktAssm::buildHeader() with a gathered payload against the
+// per-field frame builder it replaced, which assembled header, options and a copy of the
+// payload into one frame buffer. Both must produce the same datagram, and the SIM gather
+// send must put exactly that datagram on the UART; both are checked before timing.
+//
+//   coap_header_bench [iterations]
+
+#include "ATCommandHndlr.hpp"
+#include "CoapPktAssm.hpp"
+#include "HostTest.hpp"
+#include "ModemReader.hpp"
+#include "SimModem.hpp"
+#include "UARTDriver.hpp"
+#include "esp_random.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <span>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr size_t LEGACY_FRAME_SIZE = 1088;  // The SIM transport's old frame buffer
+constexpr size_t READING_PAYLOAD_SIZE = 217;  // Full-key CBOR reading
+
+struct Request {
+    const char* name;
+    PktEntry_t config;
+    size_t payload_len;
+    bool block2;
+};
+
+const Request REQUESTS[] = {
+    {"reading POST", {PktType::Reading, CoapMethod::POST, 0, 0}, READING_PAYLOAD_SIZE, false},
+    {"gps-update PUT", {PktType::GpsUpdate, CoapMethod::PUT, 0, 0}, 24, false},
+    {"firmware-bin GET block", {PktType::FirmwareDownload, CoapMethod::GET, 0, 0}, 0, true},
+};
+
+const CoapBlockOpt_t BLOCK2 = {37, false, 6};
+
+uint8_t s_payload[READING_PAYLOAD_SIZE];
+volatile size_t g_sink;
+
+size_t legacySetOption(uint8_t* buffer, uint8_t delta, uint8_t length, const uint8_t* value) {
+    buffer[0] = static_cast<uint8_t>(((delta & COAP_OPTION_DELTA_MASK) << COAP_OPTION_DELTA_SHIFT) |
+                                     (length & COAP_OPTION_LENGTH_MASK));
+    if (value != nullptr && length > 0) {
+        memcpy(&buffer[1], value, length);
+    }
+    return 1 + length;
+}
+
+/**
+ * @brief The removed buildCoapBuffer(), without its log line: every field written at run
+ * time, the Uri-Path built as a std::string and the payload copied in after the marker.
+ */
+size_t legacyBuildFrame(uint8_t* frame, const uint8_t* payload, size_t payload_len, PktEntry_t config,
+                        const CoapBlockOpt_t* block2, uint16_t msg_id, const uint8_t* token) {
+    size_t offset = 0;
+    uint8_t code_detail = 0;
+
+    frame[offset++] = static_cast<uint8_t>(((COAP_VERSION & COAP_VERSION_MASK) << COAP_VERSION_SHIFT) |
+                                           ((COAP_TYPE_CON & COAP_TYPE_MASK) << COAP_TYPE_SHIFT) |
+                                           (COAP_DEFAULT_TOKEN_LEN & COAP_TOKEN_LEN_MASK));
+
+    switch (config.method) {
+    case CoapMethod::PUT:
+        code_detail = COAP_CODE_DETAIL_PUT;
+        break;
+    case CoapMethod::POST:
+        code_detail = COAP_CODE_DETAIL_POST;
+        break;
+    case CoapMethod::GET:
+        code_detail = COAP_CODE_DETAIL_GET;
+        break;
+    default:
+        break;
+    }
+    frame[offset++] = static_cast<uint8_t>(((COAP_CODE_CLASS_REQUEST & COAP_CODE_CLASS_MASK) << COAP_CODE_CLASS_SHIFT) |
+                                           (code_detail & COAP_CODE_DETAIL_MASK));
+
+    frame[offset++] = static_cast<uint8_t>(msg_id >> 8);
+    frame[offset++] = static_cast<uint8_t>(msg_id);
+    memcpy(&frame[offset], token, COAP_DEFAULT_TOKEN_LEN);
+    offset += COAP_DEFAULT_TOKEN_LEN;
+
+    const std::string uri_path(CoapPktAssm::getUriPath(config.pkt_type));
+    if (uri_path.length() > COAP_OPTION_MAX_STANDARD) {
+        frame[offset++] = static_cast<uint8_t>((COAP_DELTA_URI_PATH << COAP_OPTION_DELTA_SHIFT) | COAP_OPTION_EXTENDED_LEN);
+        frame[offset++] = static_cast<uint8_t>(uri_path.length() - COAP_OPTION_EXTENDED_LEN);
+    } else {
+        frame[offset++] = static_cast<uint8_t>((COAP_DELTA_URI_PATH << COAP_OPTION_DELTA_SHIFT) | uri_path.length());
+    }
+    memcpy(&frame[offset], uri_path.c_str(), uri_path.length());
+    offset += uri_path.length();
+
+    frame[offset++] = static_cast<uint8_t>((COAP_DELTA_CONTENT_FORMAT << COAP_OPTION_DELTA_SHIFT) | 0x01);
+    frame[offset++] = COAP_CONTENT_FORMAT_CBOR;
+
+    if (block2 != nullptr) {
+        const uint32_t value = (block2->num << 4) | (block2->more ? 0x08U : 0x00U) | (block2->szx & 0x07U);
+        uint8_t value_bytes[3];
+        uint8_t length = 0;
+        if (value > 0xFFFFU) value_bytes[length++] = static_cast<uint8_t>(value >> 16);
+        if (value > 0xFFU) value_bytes[length++] = static_cast<uint8_t>(value >> 8);
+        if (value > 0) value_bytes[length++] = static_cast<uint8_t>(value);
+        offset += legacySetOption(&frame[offset], COAP_OPTION_BLOCK2 - COAP_OPTION_CONTENT_FORMAT, length, value_bytes);
+    }
+
+    if (payload_len > 0) {
+        frame[offset++] = COAP_PAYLOAD_MARKER;
+        memcpy(&frame[offset], payload, payload_len);
+        offset += payload_len;
+    }
+
+    return offset;
+}
+
+/** The datagram buildHeader() describes: its header followed by the payload. */
+std::vector<uint8_t> gathered(const CoapFrameHeader_t& header, std::span<const uint8_t> payload) {
+    std::vector<uint8_t> datagram(header.bytes, header.bytes + header.len);
+    datagram.insert(datagram.end(), payload.begin(), payload.end());
+    return datagram;
+}
+
+void checkSameDatagram(const Request& request) {
+    const std::span<const uint8_t> payload(s_payload, request.payload_len);
+    const CoapBlockOpt_t* block2 = request.block2 ? &BLOCK2 : nullptr;
+    CoapFrameHeader_t header = {};
+    uint8_t frame[LEGACY_FRAME_SIZE];
+
+    CHECK(CoapPktAssm::buildHeader(header, request.config, !payload.empty(), block2) > 0);
+
+    // Message ID and token change per request; the legacy frame takes the same ones
+    const uint16_t msg_id = static_cast<uint16_t>((header.bytes[2] << 8) | header.bytes[3]);
+    const size_t len = legacyBuildFrame(frame, payload.data(), payload.size(), request.config, block2, msg_id,
+                                        &header.bytes[COAP_HEADER_SIZE]);
+
+    const std::vector<uint8_t> datagram = gathered(header, payload);
+    if (datagram.size() != len || memcmp(datagram.data(), frame, len) != 0) {
+        printf("%s: header builder and legacy frame differ\n", request.name);
+        CHECK(false);
+    }
+}
+
+/**
+ * @brief Sends one reading through the SIM gather path and checks the modem received the
+ * header and payload back to back after a single prompt.
+ */
+void checkGatherSend(ATCommandHndlr& handler) {
+    std::mutex mutex;
+    std::string commands;
+    std::string data;
+
+    sim_modem::onTransmit([&](const std::string& bytes) {
+        std::lock_guard lock(mutex);
+        if (bytes.starts_with("AT+QISEND")) {
+            commands += bytes;
+            sim_modem::reply("\r\n> ", 5);
+        } else if (!bytes.starts_with("AT")) {
+            data += bytes;
+            sim_modem::reply("\r\nSEND OK\r\n", 5);
+        }
+    });
+
+    CoapFrameHeader_t header = {};
+    CHECK(CoapPktAssm::buildHeader(header, REQUESTS[0].config, true) > 0);
+    CHECK(handler.sendSocketData(0, std::span<const uint8_t>(header.bytes, header.len), s_payload, 2000));
+    sim_modem::reset();
+
+    std::lock_guard lock(mutex);
+    const std::vector<uint8_t> expected = gathered(header, s_payload);
+    CHECK(commands == "AT+QISEND=0," + std::to_string(expected.size()) + "\r\n");
+    CHECK(data.size() == expected.size() && memcmp(data.data(), expected.data(), data.size()) == 0);
+}
+
+template <typename Build>
+double nsPerRequest(Build build, int iterations) {
+    size_t sum = 0;
+    const auto started = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < iterations; ++i) {
+        for (const Request& request : REQUESTS) {
+            sum += build(request);
+        }
+    }
+
+    g_sink = sum;
+    const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - started).count();
+    return ns / (static_cast<double>(iterations) * static_cast<double>(std::size(REQUESTS)));
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const int iterations = (argc > 1) ? atoi(argv[1]) : 200000;
+
+    for (size_t i = 0; i < sizeof(s_payload); ++i) {
+        s_payload[i] = static_cast<uint8_t>(i * 7);
+    }
+
+    for (const Request& request : REQUESTS) {
+        checkSameDatagram(request);
+    }
+
+    m_modem_uart.enablePatternDetect('\n', 32);
+    CHECK(g_modem_reader.start());
+    ATCommandHndlr handler;
+    checkGatherSend(handler);
+
+    // Both sides draw a random token per request, as the firmware does now
+    static uint8_t frame[LEGACY_FRAME_SIZE];
+    uint16_t msg_id = 0;
+
+    const double legacy_ns = nsPerRequest([&](const Request& request) {
+        uint8_t token[COAP_DEFAULT_TOKEN_LEN];
+        esp_fill_random(token, sizeof(token));
+        return legacyBuildFrame(frame, s_payload, request.payload_len, request.config,
+                                request.block2 ? &BLOCK2 : nullptr, msg_id++, token);
+    }, iterations);
+
+    const double header_ns = nsPerRequest([](const Request& request) {
+        CoapFrameHeader_t header;
+        return CoapPktAssm::buildHeader(header, request.config, request.payload_len > 0,
+                                        request.block2 ? &BLOCK2 : nullptr);
+    }, iterations);
+
+    printf("legacy frame build + payload copy: %6.1f ns/request\n", legacy_ns);
+    printf("template header, gathered payload: %6.1f ns/request\n", header_ns);
+    host_test::finish("coap_header_bench");
+}
@@ -0,0 +1,105 @@
+// Runs CoapTransaction::exchange over an in-memory server: each reply is built from the last
+// request sent, so the tests can answer with the request's message ID and a chosen token.
+
+#include "CoapPktAssm.hpp"
+#include "CoapTransaction.hpp"
+#include "HostTest.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <deque>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr uint8_t CODE_CHANGED = 0x44;  // 2.04
+
+const PktEntry_t READING_PKT = {PktType::Reading, CoapMethod::POST, 15000, 2000};
+
+enum class Reply { PiggybackedAck, ForeignTokenAck };
+
+/**
+ * @brief Answers every request with `reply` and records what the client sent.
+ */
+struct Server {
+    Reply reply;
+    std::vector<std::vector<uint8_t>> sent;
+    std::deque<std::vector<uint8_t>> pending;
+
+    bool send(std::span<const uint8_t> header, std::span<const uint8_t> payload) {
+        std::vector<uint8_t> datagram(header.begin(), header.end());
+        datagram.insert(datagram.end(), payload.begin(), payload.end());
+        sent.push_back(datagram);
+
+        const size_t tkl = datagram[0] & COAP_TOKEN_LEN_MASK;
+        std::vector<uint8_t> ack = {static_cast<uint8_t>(0x60 | tkl), CODE_CHANGED, datagram[2], datagram[3]};
+        ack.insert(ack.end(), datagram.begin() + COAP_HEADER_SIZE, datagram.begin() + COAP_HEADER_SIZE + tkl);
+        if (reply == Reply::ForeignTokenAck && tkl > 0) {
+            ack[COAP_HEADER_SIZE] ^= 0xFF;
+        }
+        pending.push_back(ack);
+        return true;
+    }
+
+    bool recv(uint8_t* buf, size_t buf_len, size_t* out_len, int) {
+        *out_len = 0;
+        if (pending.empty() || pending.front().size() > buf_len) {
+            return true;
+        }
+
+        std::copy(pending.front().begin(), pending.front().end(), buf);
+        *out_len = pending.front().size();
+        pending.pop_front();
+        return true;
+    }
+};
+
+/**
+ * @brief Runs one request against `server`.
+ * @return whether it succeeded; `ms` is how long the exchange took
+ */
+bool runOne(Server& server, double& ms) {
+    static const uint8_t cbor[] = {0xA1, 0x01, 0x02};
+    CoapRequest_t request;
+    CHECK(CoapTransaction::prepare(request, cbor, sizeof(cbor), READING_PKT, nullptr));
+
+    const auto started = Clock::now();
+    CoapTransaction::exchange(
+        std::span<CoapRequest_t>(&request, 1),
+        [&server](std::span<const uint8_t> header, std::span<const uint8_t> payload) { return server.send(header, payload); },
+        [&server](uint8_t* buf, size_t len, size_t* out_len, int timeout_ms) { return server.recv(buf, len, out_len, timeout_ms); },
+        RttEstimator::Transport::Sim);
+    ms = std::chrono::duration<double, std::milli>(Clock::now() - started).count();
+    return request.success;
+}
+
+void testPiggybackedAck() {
+    Server server{Reply::PiggybackedAck};
+    double ms = 0;
+    CHECK(runOne(server, ms));
+    CHECK(server.sent.size() == 1);
+}
+
+/**
+ * @brief An ACK for the request's MID with another token fails the request at once, instead of
+ * leaving it in flight until its response window ends.
+ */
+void testForeignTokenAckFails() {
+    Server server{Reply::ForeignTokenAck};
+    double ms = 0;
+    CHECK(!runOne(server, ms));
+    printf("foreign token ACK: failed after %.0f ms, %zu transmission(s)\n", ms, server.sent.size());
+    CHECK(server.sent.size() == 1);
+    CHECK(ms < 500);
+}
+
+}  // namespace
+
+int main() {
+    testPiggybackedAck();
+    testForeignTokenAckFails();
+
+    host_test::finish("coap_transaction_test");
+}
@@ -0,0 +1,99 @@
+// MAC cost per reading packet: the truncated HMAC-SHA256 tag (Key::computeTag) on its own
+// and as part of a full ReadingPkt::toBuffer(), which writes the trailer through
+// PacketSchema. The tag in the packet is checked against an HMAC over the bytes before
+// its key before timing. CMakeLists.txt builds it once per READING_ENC.
+//
+//   mac_cost_bench_<enc> [iterations]
+
+#include "CborSchema.hpp"
+#include "DeviceConfig.hpp"
+#include "HostTest.hpp"
+#include "Key.hpp"
+#include "ReadingPkt.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+
+DeviceConfig g_device_config;
+
+namespace {
+
+constexpr const char* NODE_ID = "GG-00A1B2C3D";
+
+// Encoded "mac" key, the byte string head and the tag close every packet
+constexpr size_t MAC_KEY_LEN = (READING_ENC == 0) ? 4 : 1;
+constexpr size_t MAC_ENTRY_LEN = MAC_KEY_LEN + 1 + Key::TAG_SIZE;
+
+volatile size_t g_sink;
+
+template <typename Run>
+double nsPerPacket(Run run, int iterations) {
+    size_t sum = 0;
+    const auto started = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < iterations; ++i) {
+        sum += run();
+    }
+
+    g_sink = sum;
+    const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - started).count();
+    return ns / static_cast<double>(iterations);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const int iterations = (argc > 1) ? atoi(argv[1]) : 200000;
+
+    strcpy(g_device_config.manf_info.nodeId.value, NODE_ID);
+    strcpy(g_device_config.manf_info.fw_ver.value, "1.4.2");
+    memset(g_device_config.secretKey, 0x5A, sizeof(g_device_config.secretKey));
+    g_device_config.session_count = 312;
+    CHECK(PacketSchema::cacheIdentity(g_device_config));
+
+    uint16_t samples[NPK_COLLECT_SIZE];
+    for (int i = 0; i < NPK_COLLECT_SIZE; ++i) {
+        samples[i] = static_cast<uint16_t>(231 + i % 3);
+    }
+
+    ReadingPkt packet(PktType::Reading, NODE_ID, "reading", samples, MeasurementType::Nitrogen);
+    const uint8_t* encoded = packet.toBuffer();
+    const size_t size = packet.getBufferLength();
+    CHECK(encoded != nullptr && size > MAC_ENTRY_LEN);
+
+    if (encoded == nullptr || size <= MAC_ENTRY_LEN) {
+        host_test::finish("mac_cost_bench");
+    }
+
+    // The tag covers everything before the "mac" key, session and seq included
+    const size_t covered = size - MAC_ENTRY_LEN;
+    uint8_t expected[EVP_MAX_MD_SIZE];
+    unsigned int expected_len = 0;
+
+    CHECK(HMAC(EVP_sha256(), g_device_config.secretKey, sizeof(g_device_config.secretKey), encoded, covered, expected,
+               &expected_len) != nullptr);
+    CHECK(memcmp(encoded + size - Key::TAG_SIZE, expected, Key::TAG_SIZE) == 0);
+
+    const std::span<const uint8_t> message(encoded, covered);
+    uint8_t tag[Key::TAG_SIZE];
+
+    const double tag_ns = nsPerPacket([&] {
+        return Key::computeTag(message, tag) ? size_t{tag[0]} : 0;
+    }, iterations);
+
+    const double packet_ns = nsPerPacket([&] {
+        packet.toBuffer();
+        return packet.getBufferLength();
+    }, iterations);
+
+    printf("READING_ENC=%d, %zu bytes, tag over %zu, %d iteration(s)\n", READING_ENC, size, covered, iterations);
+    printf("truncated HMAC-SHA256 tag:      %7.1f ns/packet\n", tag_ns);
+    printf("full encode including the tag:  %7.1f ns/packet (tag is %.0f%%)\n", packet_ns,
+           packet_ns > 0 ? 100.0 * tag_ns / packet_ns : 0.0);
+
+    host_test::finish("mac_cost_bench");
+}
@@ -0,0 +1,159 @@
+// Runs ModemReader against the simulated modem UART: response lines and the raw payload
+// a line announces are split apart, URCs reach their subscriber, and response deadlines
+// hold across portMAX_DELAY and the tick counter wrap.
+
+#include "HostTest.hpp"
+#include "ModemReader.hpp"
+#include "SimModem.hpp"
+#include "UARTDriver.hpp"
+
+#include <chrono>
+#include <cstring>
+#include <string>
+#include <string_view>
+
+namespace {
+
+std::string_view text(const ModemLine_t& line) {
+    return {line.text, line.len};
+}
+
+bool nextLineIs(std::string_view expected, TickType_t timeout = pdMS_TO_TICKS(500)) {
+    ModemLine_t line = {};
+    return g_modem_reader.nextLine(line, xTaskGetTickCount() + timeout) && text(line) == expected;
+}
+
+bool noMoreLines() {
+    ModemLine_t line = {};
+    return !g_modem_reader.nextLine(line, xTaskGetTickCount() + pdMS_TO_TICKS(100));
+}
+
+/** +QIRD announces its length; the payload holds line ends and "OK" that must not be framed. */
+void testCountedPayload() {
+    static const ModemPayloadRule_t rules[] = {{"+QIRD:", -1}};
+    const std::string payload = "AB\r\nOK\r\n\n>\x00\xFF" "CD";
+    uint8_t out[32] = {};
+
+    g_modem_reader.beginCommand();
+    g_modem_reader.expectPayload(rules);
+    sim_modem::reply("\r\n+QIRD: " + std::to_string(payload.size()) + "\r\n" + payload + "\r\n\r\nOK\r\n", 20);
+
+    CHECK(nextLineIs("+QIRD: " + std::to_string(payload.size())));
+    CHECK(g_modem_reader.readPayload({out, payload.size()}, xTaskGetTickCount() + pdMS_TO_TICKS(500)) == payload.size());
+    CHECK(memcmp(out, payload.data(), payload.size()) == 0);
+    CHECK(nextLineIs("OK"));
+    CHECK(noMoreLines());
+    g_modem_reader.endCommand();
+}
+
+/** QHTTPREAD's CONNECT rule has a fixed length; lines after the body frame normally. */
+void testFixedPayload() {
+    static const ModemPayloadRule_t rules[] = {{"+QIRD:", -1}, {"CONNECT", 6}};
+    uint8_t out[6] = {};
+
+    g_modem_reader.beginCommand();
+    g_modem_reader.expectPayload(rules);
+    sim_modem::reply("\r\nCONNECT\r\n", 10);
+    sim_modem::reply("{\"a\":1", 40);  // The body arrives after a gap
+    sim_modem::reply("\r\nOK\r\n\r\n+QHTTPREAD: 0\r\n", 60);
+
+    CHECK(nextLineIs("CONNECT"));
+    CHECK(g_modem_reader.readPayload(out, xTaskGetTickCount() + pdMS_TO_TICKS(500)) == sizeof(out));
+    CHECK(memcmp(out, "{\"a\":1", sizeof(out)) == 0);
+    CHECK(nextLineIs("OK"));
+    CHECK(nextLineIs("+QHTTPREAD: 0"));
+    g_modem_reader.endCommand();
+}
+
+/** Without a rule the same bytes are lines; a stale payload never leaks into the next command. */
+void testNoRuleNoPayload() {
+    uint8_t out[4] = {};
+
+    g_modem_reader.beginCommand();
+    sim_modem::reply("\r\n+QIRD: 4\r\nAB\r\n", 10);
+    CHECK(nextLineIs("+QIRD: 4"));
+    CHECK(nextLineIs("AB"));
+    CHECK(g_modem_reader.readPayload(out, xTaskGetTickCount() + pdMS_TO_TICKS(100)) == 0);
+    g_modem_reader.endCommand();
+}
+
+/** URCs go to their subscriber whether or not a command is active, and to the command too. */
+void testUrcRouting() {
+    QueueHandle_t urcs = xQueueCreate(4, sizeof(ModemLine_t));
+    ModemLine_t line = {};
+
+    CHECK(g_modem_reader.subscribe("+QIURC:", urcs));
+
+    sim_modem::reply("\r\n+QIURC: \"recv\",0\r\n", 10);
+    CHECK(xQueueReceive(urcs, &line, pdMS_TO_TICKS(500)) == pdTRUE && text(line) == "+QIURC: \"recv\",0");
+
+    g_modem_reader.beginCommand();
+    sim_modem::reply("\r\n+QIURC: \"closed\",1\r\n\r\nOK\r\n", 10);
+    CHECK(xQueueReceive(urcs, &line, pdMS_TO_TICKS(500)) == pdTRUE && text(line) == "+QIURC: \"closed\",1");
+    CHECK(nextLineIs("+QIURC: \"closed\",1"));
+    CHECK(nextLineIs("OK"));
+    g_modem_reader.endCommand();
+
+    g_modem_reader.unsubscribe(urcs);
+    vQueueDelete(urcs);
+}
+
+/** portMAX_DELAY waits for the line instead of being taken as a tick that has passed. */
+void testWaitForever() {
+    ModemLine_t line = {};
+    const auto started = std::chrono::steady_clock::now();
+
+    g_modem_reader.beginCommand();
+    sim_modem::reply("\r\nOK\r\n", 150);
+    CHECK(g_modem_reader.nextLine(line, portMAX_DELAY) && text(line) == "OK");
+    CHECK(std::chrono::steady_clock::now() - started >= std::chrono::milliseconds(140));
+    g_modem_reader.endCommand();
+}
+
+/**
+ * A deadline computed just before the tick counter wraps is numerically smaller than the
+ * tick count, but still in the future. Runs last: the tick count stays near the wrap.
+ */
+void testDeadlineAcrossWrap() {
+    ModemLine_t line = {};
+    uint8_t out[3] = {};
+    static const ModemPayloadRule_t rules[] = {{"+QIRD:", -1}};
+
+    xTaskCatchUpTicks(static_cast<TickType_t>(0) - xTaskGetTickCount() - pdMS_TO_TICKS(50));
+
+    const TickType_t deadline = xTaskGetTickCount() + pdMS_TO_TICKS(1000);
+    CHECK(deadline < xTaskGetTickCount());
+
+    g_modem_reader.beginCommand();
+    g_modem_reader.expectPayload(rules);
+    sim_modem::reply("\r\n+QIRD: 3\r\n", 200);
+    sim_modem::reply("xyz\r\n", 300);
+    CHECK(g_modem_reader.nextLine(line, deadline) && text(line) == "+QIRD: 3");
+    CHECK(g_modem_reader.readPayload(out, deadline) == sizeof(out));
+    CHECK(memcmp(out, "xyz", sizeof(out)) == 0);
+
+    // A deadline that has passed does not wait
+    const auto started = std::chrono::steady_clock::now();
+    CHECK(!g_modem_reader.nextLine(line, xTaskGetTickCount() - 1));
+    CHECK(std::chrono::steady_clock::now() - started < std::chrono::milliseconds(50));
+    g_modem_reader.endCommand();
+}
+
+}  // namespace
+
+int main() {
+    m_modem_uart.enablePatternDetect('\n', 32);
+    if (!g_modem_reader.start()) {
+        printf("modem reader did not start\n");
+        return 1;
+    }
+
+    testCountedPayload();
+    testFixedPayload();
+    testNoRuleNoPayload();
+    testUrcRouting();
+    testWaitForever();
+    testDeadlineAcrossWrap();
+
+    host_test::finish("modem_reader_test");
+}
@@ -0,0 +1,187 @@
+// Records a modem session with ModemTranscript and replays recordings as the modem.
+//
+//   modem_transcript_test <transcripts dir>        run the tests
+//   modem_transcript_test --record <file>          write the scripted session to <file>
+
+#include "ATCommandHndlr.hpp"
+#include "HostTest.hpp"
+#include "ModemReader.hpp"
+#include "ModemTranscript.hpp"
+#include "SimModem.hpp"
+#include "TranscriptReplay.hpp"
+#include "UARTDriver.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr size_t MAX_FILE_BYTES = 512 * 1024;  // ModemTranscript's limit
+
+/**
+ * @brief The session every recording holds: SIM check, registration, UDP socket, one datagram.
+ */
+bool runSession(ATCommandHndlr& handler) {
+    static const ATCommand_t cpin = {"AT+CPIN?", "READY", 2000, MsgType::DATA, nullptr, 0};
+    static const ATCommand_t cereg = {"AT+CEREG?", "+CEREG:", 2000, MsgType::DATA, nullptr, 0};
+    static const uint8_t payload[] = {0x40, 0x01, 0x12, 0x34, 0xB4, 't', 'e', 's', 't'};
+    char reg[64] = {0};
+
+    const bool ok = handler.send(cpin) &&
+                    handler.sendAndCapture(cereg, reg, sizeof(reg)) &&
+                    handler.openIPSocket("UDP", "203.0.113.7", 5683, 1, 0, 3000) &&
+                    handler.sendSocketData(0, payload, sizeof(payload), 2000);
+
+    return ok && strstr(reg, "+CEREG: 0,1") != nullptr;
+}
+
+/**
+ * @brief Answers the session the way an EC25 does, with its typical delays.
+ */
+void scriptModem() {
+    sim_modem::onTransmit([](const std::string& bytes) {
+        if (bytes.starts_with("AT+CPIN?")) {
+            sim_modem::reply("\r\n+CPIN: READY\r\n\r\nOK\r\n", 40);
+        } else if (bytes.starts_with("AT+CEREG?")) {
+            sim_modem::reply("\r\n+CEREG: 0,1\r\n\r\nOK\r\n", 25);
+        } else if (bytes.starts_with("AT+QIOPEN")) {
+            sim_modem::reply("\r\nOK\r\n", 10);
+            sim_modem::reply("\r\n+QIOPEN: 0,0\r\n", 300);
+        } else if (bytes.starts_with("AT+QISEND")) {
+            sim_modem::reply("\r\n> ", 15);
+        } else if (!bytes.starts_with("AT")) {
+            sim_modem::reply("\r\nSEND OK\r\n", 60);
+        }
+    });
+}
+
+double elapsedMs(std::chrono::steady_clock::time_point since) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+}
+
+/**
+ * @brief Records the scripted session to `path`.
+ * @return how long the session took, or a negative value if it failed
+ */
+double recordSession(ATCommandHndlr& handler, const char* path) {
+    scriptModem();
+    if (!g_modem_transcript.start(path)) {
+        return -1;
+    }
+
+    m_modem_uart.setTranscript(&g_modem_transcript);
+    const auto started = std::chrono::steady_clock::now();
+    const bool ok = runSession(handler);
+    const double ms = elapsedMs(started);
+    m_modem_uart.setTranscript(nullptr);
+    g_modem_transcript.stop();
+    sim_modem::reset();
+
+    return ok ? ms : -1;
+}
+
+/**
+ * @brief Replays `path` as the modem and runs the session against it.
+ * @return how long the session took, or a negative value if it failed
+ */
+double replaySession(ATCommandHndlr& handler, const char* path) {
+    std::vector<TranscriptReplay::Record> records;
+    CHECK(TranscriptReplay::load(path, records));
+
+    TranscriptReplay replay;
+    replay.start(records);
+
+    const auto started = std::chrono::steady_clock::now();
+    const bool ok = runSession(handler);
+    const double ms = elapsedMs(started);
+
+    CHECK(replay.mismatches() == 0);
+    CHECK(replay.pendingTx() == 0);
+    sim_modem::reset();
+
+    return ok ? ms : -1;
+}
+
+void testCommittedTranscript(ATCommandHndlr& handler, const std::filesystem::path& dir) {
+    const std::string path = (dir / "udp_send.trc").string();
+    CHECK(replaySession(handler, path.c_str()) >= 0);
+}
+
+void testRecordAndReplay(ATCommandHndlr& handler, const std::filesystem::path& tmp) {
+    const std::string path = (tmp / "session.trc").string();
+
+    const double recorded_ms = recordSession(handler, path.c_str());
+    CHECK(recorded_ms >= 0);
+
+    std::vector<TranscriptReplay::Record> records;
+    CHECK(TranscriptReplay::load(path.c_str(), records));
+
+    size_t tx = 0;
+    size_t rx = 0;
+    for (const TranscriptReplay::Record& record : records) {
+        (record.dir == ModemTranscript::Direction::Tx ? tx : rx)++;
+        CHECK(!record.dropped);
+    }
+    CHECK(tx == 5);
+    CHECK(rx >= 5);
+
+    // Replies come back with the recorded delays, so the replay takes about as long
+    const double replayed_ms = replaySession(handler, path.c_str());
+    printf("recorded %zu records in %.0f ms, replayed in %.0f ms\n", records.size(), recorded_ms, replayed_ms);
+    CHECK(replayed_ms > recorded_ms * 0.8 && replayed_ms < recorded_ms * 1.3);
+}
+
+void testSizeLimitEndsOnRecord(const std::filesystem::path& tmp) {
+    const std::string path = (tmp / "full.trc").string();
+    const std::vector<uint8_t> chunk(500, 'x');
+
+    CHECK(g_modem_transcript.start(path.c_str()));
+    for (size_t sent = 0; sent < 2 * MAX_FILE_BYTES; sent += chunk.size()) {
+        g_modem_transcript.record(ModemTranscript::Direction::Rx, chunk);
+        if ((sent / chunk.size()) % 4 == 0) {
+            vTaskDelay(1);  // Let the writer keep up so the file actually fills
+        }
+    }
+    g_modem_transcript.stop();
+
+    std::vector<TranscriptReplay::Record> records;
+    const size_t size = std::filesystem::file_size(path);
+    CHECK(size <= MAX_FILE_BYTES);
+    CHECK(size > MAX_FILE_BYTES - (8 + chunk.size()));
+    CHECK(TranscriptReplay::load(path.c_str(), records));
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    m_modem_uart.enablePatternDetect('\n', 32);
+    if (!g_modem_reader.start()) {
+        printf("modem reader did not start\n");
+        return 1;
+    }
+
+    ATCommandHndlr handler;
+
+    if (argc == 3 && strcmp(argv[1], "--record") == 0) {
+        CHECK(recordSession(handler, argv[2]) >= 0);
+        host_test::finish("modem_transcript_test --record");
+    }
+
+    if (argc != 2) {
+        printf("usage: %s <transcripts dir> | --record <file>\n", argv[0]);
+        return 2;
+    }
+
+    const std::filesystem::path tmp = std::filesystem::temp_directory_path() / "modem_transcript_test";
+    std::filesystem::create_directories(tmp);
+
+    testCommittedTranscript(handler, argv[1]);
+    testRecordAndReplay(handler, tmp);
+    testSizeLimitEndsOnRecord(tmp);
+
+    host_test::finish("modem_transcript_test");
+}
@@ -0,0 +1,85 @@
+// Re-signing of packets restored from the send backlog. CMakeLists.txt builds it once per
+// READING_ENC so both the text-keyed and the integer-keyed trailer are covered.
+
+#include "CborSchema.hpp"
+#include "DeviceConfig.hpp"
+#include "HostTest.hpp"
+#include "Key.hpp"
+#include "ReadingPkt.hpp"
+
+#include <cstring>
+#include <vector>
+
+DeviceConfig g_device_config;
+
+namespace {
+
+constexpr const char* NODE_ID = "GG-00A1B2C3D";
+
+// Encoded "mac" key: text key for the legacy layout, uint key 7 for the compact one
+constexpr size_t MAC_KEY_LEN = (READING_ENC == 0) ? 4 : 1;
+constexpr size_t MAC_ENTRY_LEN = MAC_KEY_LEN + 1 + Key::TAG_SIZE;
+
+bool tagMatches(std::span<const uint8_t> packet) {
+    uint8_t tag[Key::TAG_SIZE];
+
+    if (packet.size() < MAC_ENTRY_LEN || !Key::computeTag(packet.first(packet.size() - MAC_ENTRY_LEN), tag)) {
+        return false;
+    }
+    return memcmp(tag, packet.data() + packet.size() - Key::TAG_SIZE, Key::TAG_SIZE) == 0;
+}
+
+}  // namespace
+
+int main() {
+    strcpy(g_device_config.manf_info.nodeId.value, NODE_ID);
+    strcpy(g_device_config.manf_info.fw_ver.value, "1.4.2");
+    memset(g_device_config.secretKey, 0x5A, sizeof(g_device_config.secretKey));
+    g_device_config.session_count = 312;
+    CHECK(PacketSchema::cacheIdentity(g_device_config));
+
+    uint16_t samples[NPK_COLLECT_SIZE];
+    for (int i = 0; i < NPK_COLLECT_SIZE; ++i) {
+        samples[i] = static_cast<uint16_t>(231 + i % 3);
+    }
+
+    ReadingPkt packet(PktType::Reading, NODE_ID, "reading", samples, MeasurementType::Nitrogen);
+    CHECK(packet.toBuffer() != nullptr);
+
+    const std::vector<uint8_t> stored(packet.toBuffer(), packet.toBuffer() + packet.getBufferLength());
+    CHECK(tagMatches(stored));
+
+    // The re-signed packet keeps the body, takes the next seq and carries a tag over the new bytes
+    std::vector<uint8_t> resigned(stored.size() + PacketSchema::TRAILER_GROWTH_MAX);
+    const size_t resigned_len = PacketSchema::refreshTrailer(stored, resigned);
+    resigned.resize(resigned_len);
+
+    CHECK(resigned_len == stored.size());
+    CHECK(tagMatches(resigned));
+
+    size_t first_diff = 0;
+    while (first_diff < resigned_len && resigned[first_diff] == stored[first_diff]) {
+        ++first_diff;
+    }
+    CHECK(first_diff < resigned_len - MAC_ENTRY_LEN);
+    CHECK(resigned[first_diff] == stored[first_diff] + 1);
+    CHECK(memcmp(resigned.data() + first_diff + 1, stored.data() + first_diff + 1,
+                 resigned_len - first_diff - 1 - Key::TAG_SIZE) == 0);
+
+    // Re-signing twice never reuses a seq
+    std::vector<uint8_t> again(stored.size() + PacketSchema::TRAILER_GROWTH_MAX);
+    again.resize(PacketSchema::refreshTrailer(stored, again));
+    CHECK(again.size() == stored.size());
+    CHECK(again[first_diff] == resigned[first_diff] + 1);
+
+    // Corrupt records are refused rather than signed
+    std::vector<uint8_t> out(stored.size() + PacketSchema::TRAILER_GROWTH_MAX);
+    CHECK(PacketSchema::refreshTrailer(std::span<const uint8_t>(stored).first(stored.size() - 1), out) == 0);
+    const uint8_t not_a_map[] = {0x83, 0x01, 0x02, 0x03};
+    CHECK(PacketSchema::refreshTrailer(not_a_map, out) == 0);
+    const uint8_t too_few_pairs[] = {0xA2, 0x01, 0x02, 0x03, 0x04};
+    CHECK(PacketSchema::refreshTrailer(too_few_pairs, out) == 0);
+    CHECK(PacketSchema::refreshTrailer(stored, std::span<uint8_t>(out).first(stored.size() / 2)) == 0);
+
+    host_test::finish("packet_schema");
+}
@@ -0,0 +1,173 @@
+// Time per reading packet: the schema encoder behind ReadingPkt::toBuffer() against the
+// per-field tinycbor encoding it replaced, which re-encoded every key and the node ID on
+// each call. Both build the same map with a MAC trailer; the bodies are compared before
+// timing. CMakeLists.txt builds it once per READING_ENC.
+//
+//   reading_encode_bench_<enc> [iterations]
+
+#include "CborSchema.hpp"
+#include "DeviceConfig.hpp"
+#include "HostTest.hpp"
+#include "Key.hpp"
+#include "ReadingPkt.hpp"
+
+#include <cbor.h>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+DeviceConfig g_device_config;
+
+namespace {
+
+constexpr const char* NODE_ID = "GG-00A1B2C3D";
+constexpr uint64_t SESSION_COUNT = 312;
+constexpr size_t LEGACY_FIELDS = 6;   // node_id, m_type, readings, session, seq, mac
+constexpr size_t COMPACT_FIELDS = 7;  // encoding, node_id, m_type, samples, session, seq, mac
+
+volatile size_t g_sink;
+
+/**
+ * @brief The replaced encoder: every key and value through tinycbor, tag over the body.
+ * @param body_len Set to the length before the session key
+ * @return Encoded length, or 0 on error
+ */
+size_t tinycborEncode(const uint16_t samples[NPK_COLLECT_SIZE], uint32_t seq, uint8_t* out, size_t capacity,
+                      size_t& body_len) {
+    CborEncoder encoder;
+    CborEncoder map;
+    CborError err = CborNoError;
+
+    cbor_encoder_init(&encoder, out, capacity, 0);
+
+    if constexpr (READING_ENCODING == ReadingEncoding::Legacy) {
+        CborEncoder array;
+
+        err = cbor_encoder_create_map(&encoder, &map, LEGACY_FIELDS);
+        err = err ? err : cbor_encode_text_stringz(&map, "node_id");
+        err = err ? err : cbor_encode_text_stringz(&map, NODE_ID);
+        err = err ? err : cbor_encode_text_stringz(&map, "m_type");
+        err = err ? err : cbor_encode_text_stringz(&map, NITROGEN);
+        err = err ? err : cbor_encode_text_stringz(&map, "readings");
+        err = err ? err : cbor_encoder_create_array(&map, &array, NPK_COLLECT_SIZE);
+        for (int i = 0; i < NPK_COLLECT_SIZE; ++i) {
+            err = err ? err : cbor_encode_float(&array, samples[i]);
+        }
+        err = err ? err : cbor_encoder_close_container(&map, &array);
+    } else {
+        uint8_t packed[NPK_COLLECT_SIZE * 3];
+        size_t packed_len = 0;
+
+        err = cbor_encoder_create_map(&encoder, &map, COMPACT_FIELDS);
+        err = err ? err : cbor_encode_uint(&map, 0);
+        err = err ? err : cbor_encode_uint(&map, READING_ENC);
+        err = err ? err : cbor_encode_uint(&map, 1);
+        err = err ? err : cbor_encode_text_stringz(&map, NODE_ID);
+        err = err ? err : cbor_encode_uint(&map, 2);
+        err = err ? err : cbor_encode_uint(&map, static_cast<uint64_t>(MeasurementType::Nitrogen));
+        err = err ? err : cbor_encode_uint(&map, 4);
+
+        if constexpr (READING_ENCODING == ReadingEncoding::TypedArray) {
+            for (int i = 0; i < NPK_COLLECT_SIZE; ++i) {
+                packed[packed_len++] = static_cast<uint8_t>(samples[i] >> 8);
+                packed[packed_len++] = static_cast<uint8_t>(samples[i]);
+            }
+            err = err ? err : cbor_encode_tag(&map, 65);
+        } else {
+            int32_t previous = 0;
+            for (int i = 0; i < NPK_COLLECT_SIZE; ++i) {
+                const int32_t delta = static_cast<int32_t>(samples[i]) - previous;
+                uint32_t zigzag = (static_cast<uint32_t>(delta) << 1) ^ static_cast<uint32_t>(delta >> 31);
+                previous = samples[i];
+                while (zigzag >= 0x80U) {
+                    packed[packed_len++] = static_cast<uint8_t>((zigzag & 0x7FU) | 0x80U);
+                    zigzag >>= 7;
+                }
+                packed[packed_len++] = static_cast<uint8_t>(zigzag);
+            }
+        }
+        err = err ? err : cbor_encode_byte_string(&map, packed, packed_len);
+    }
+
+    body_len = cbor_encoder_get_buffer_size(&map, out);
+
+    uint8_t tag[Key::TAG_SIZE];
+    const bool compact = READING_ENCODING != ReadingEncoding::Legacy;
+
+    err = err ? err : (compact ? cbor_encode_uint(&map, 5) : cbor_encode_text_stringz(&map, "session"));
+    err = err ? err : cbor_encode_uint(&map, SESSION_COUNT);
+    err = err ? err : (compact ? cbor_encode_uint(&map, 6) : cbor_encode_text_stringz(&map, "seq"));
+    err = err ? err : cbor_encode_uint(&map, seq);
+
+    if (err || !Key::computeTag(std::span<const uint8_t>(out, cbor_encoder_get_buffer_size(&map, out)), tag)) {
+        return 0;
+    }
+
+    err = compact ? cbor_encode_uint(&map, 7) : cbor_encode_text_stringz(&map, "mac");
+    err = err ? err : cbor_encode_byte_string(&map, tag, sizeof(tag));
+    err = err ? err : cbor_encoder_close_container(&encoder, &map);
+
+    return err ? 0 : cbor_encoder_get_buffer_size(&encoder, out);
+}
+
+template <typename Encode>
+double nsPerPacket(Encode encode, int iterations) {
+    size_t sum = 0;
+    const auto started = std::chrono::steady_clock::now();
+
+    for (int i = 0; i < iterations; ++i) {
+        sum += encode();
+    }
+
+    g_sink = sum;
+    const double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - started).count();
+    return ns / static_cast<double>(iterations);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const int iterations = (argc > 1) ? atoi(argv[1]) : 200000;
+
+    strcpy(g_device_config.manf_info.nodeId.value, NODE_ID);
+    strcpy(g_device_config.manf_info.fw_ver.value, "1.4.2");
+    memset(g_device_config.secretKey, 0x5A, sizeof(g_device_config.secretKey));
+    g_device_config.session_count = SESSION_COUNT;
+    CHECK(PacketSchema::cacheIdentity(g_device_config));
+
+    uint16_t samples[NPK_COLLECT_SIZE];
+    for (int i = 0; i < NPK_COLLECT_SIZE; ++i) {
+        samples[i] = static_cast<uint16_t>(231 + i % 3);
+    }
+
+    // The schema encoder numbers its first packet 0, so both trailers match byte for byte
+    ReadingPkt packet(PktType::Reading, NODE_ID, "reading", samples, MeasurementType::Nitrogen);
+    uint8_t baseline[FramePool::PAYLOAD_CAPACITY];
+    size_t body_len = 0;
+
+    const uint8_t* encoded = packet.toBuffer();
+    const size_t baseline_len = tinycborEncode(samples, 0, baseline, sizeof(baseline), body_len);
+
+    CHECK(encoded != nullptr);
+    CHECK(baseline_len != 0);
+    CHECK(packet.getBufferLength() == baseline_len);
+    CHECK(encoded != nullptr && memcmp(encoded, baseline, baseline_len) == 0);
+
+    const double tinycbor_ns = nsPerPacket([&] {
+        size_t len = 0;
+        return tinycborEncode(samples, 0, baseline, sizeof(baseline), len);
+    }, iterations);
+
+    const double schema_ns = nsPerPacket([&] {
+        packet.toBuffer();
+        return packet.getBufferLength();
+    }, iterations);
+
+    printf("READING_ENC=%d, %zu bytes (%zu before the trailer), %d iteration(s)\n", READING_ENC, baseline_len, body_len,
+           iterations);
+    printf("tinycbor per field:     %6.1f ns/packet\n", tinycbor_ns);
+    printf("schema, cached prefix:  %6.1f ns/packet\n", schema_ns);
+
+    host_test::finish("reading_encode_bench");
+}
@@ -0,0 +1,56 @@
+// Encoded size of one reading packet in the READING_ENC encoding this binary is built with.
+// CMakeLists.txt builds it once per encoding from the firmware's ReadingPkt and CborSchema.
+//
+//   reading_size_bench_<enc> [expected bytes]
+
+#include "CborSchema.hpp"
+#include "DeviceConfig.hpp"
+#include "HostTest.hpp"
+#include "ReadingPkt.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+DeviceConfig g_device_config;
+
+namespace {
+
+// Typical of a deployed node: 12-character ID, a few hundred sessions in
+constexpr const char* NODE_ID = "GG-00A1B2C3D";
+constexpr const char* FW_VER = "1.4.2";
+constexpr uint64_t SESSION_COUNT = 312;
+
+/**
+ * @brief Nitrogen samples from a settled probe: around 231 mg/kg, moving a unit or two.
+ */
+void fillSamples(uint16_t samples[NPK_COLLECT_SIZE]) {
+    for (int i = 0; i < NPK_COLLECT_SIZE; ++i) {
+        samples[i] = static_cast<uint16_t>(231 + (i % 3) - 1);
+    }
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    strcpy(g_device_config.manf_info.nodeId.value, NODE_ID);
+    strcpy(g_device_config.manf_info.fw_ver.value, FW_VER);
+    memset(g_device_config.secretKey, 0x5A, sizeof(g_device_config.secretKey));
+    g_device_config.session_count = SESSION_COUNT;
+    CHECK(PacketSchema::cacheIdentity(g_device_config));
+
+    uint16_t samples[NPK_COLLECT_SIZE];
+    fillSamples(samples);
+
+    ReadingPkt packet(PktType::Reading, NODE_ID, "reading", samples, MeasurementType::Nitrogen);
+    CHECK(packet.toBuffer() != nullptr);
+
+    const size_t size = packet.getBufferLength();
+    printf("READING_ENC=%d: %zu bytes for %d samples\n", READING_ENC, size, NPK_COLLECT_SIZE);
+
+    if (argc > 1) {
+        CHECK(size == static_cast<size_t>(atoi(argv[1])));
+    }
+
+    host_test::finish("reading_size_bench");
+}
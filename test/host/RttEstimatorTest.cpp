@@ -0,0 +1,70 @@
+// Checks that RTT-derived response windows shrink on a fast link without cutting off a
+// retransmission the configured window would have waited for.
+
+#include "CoapPktAssm.hpp"
+#include "HostTest.hpp"
+#include "RttEstimator.hpp"
+
+namespace {
+
+using Transport = RttEstimator::Transport;
+
+void feed(Transport transport, uint32_t rtt_ms, int count) {
+    for (int i = 0; i < count; ++i) {
+        RttEstimator::addSample(transport, rtt_ms);
+    }
+}
+
+}  // namespace
+
+int main() {
+    // Without samples the configured values apply
+    CHECK(RttEstimator::ackTimeoutMs(Transport::Sim) == COAP_ACK_TIMEOUT_MS);
+    CHECK(RttEstimator::responseWindowMs(Transport::Sim, PKT_RESPONSE_WIN_DEFAULT_MS) == PKT_RESPONSE_WIN_DEFAULT_MS);
+
+    // MAX_TRANSMIT_WAIT of RFC 7252 for the default parameters: 2 s * 1.5 * (2^5 - 1)
+    CHECK(RttEstimator::retransmitSpanMs(COAP_ACK_TIMEOUT_MS) == 93000);
+
+    // A fast link shortens the ACK timeout, and the window still spans all retransmissions
+    feed(Transport::Wifi, 80, 8);
+    const uint32_t wifi_ack_ms = RttEstimator::ackTimeoutMs(Transport::Wifi);
+    const int wifi_window_ms = RttEstimator::responseWindowMs(Transport::Wifi, PKT_RESPONSE_WIN_FW_DOWNLOAD_MS);
+    printf("wifi: rto %lu ms, ack timeout %lu ms, window %d ms\n",
+           static_cast<unsigned long>(RttEstimator::rtoMs(Transport::Wifi)),
+           static_cast<unsigned long>(wifi_ack_ms), wifi_window_ms);
+    CHECK(wifi_ack_ms == RttEstimator::MIN_ACK_TIMEOUT_MS);
+    CHECK(wifi_window_ms == static_cast<int>(RttEstimator::retransmitSpanMs(wifi_ack_ms)));
+    CHECK(wifi_window_ms < PKT_RESPONSE_WIN_FW_DOWNLOAD_MS);
+
+    // The default window shrinks too: it keeps the three retransmissions that time out within
+    // 15 s (0.75 + 1.5 + 3 + 6 s) and drops the fourth, which would end past it
+    const int default_window_ms = RttEstimator::responseWindowMs(Transport::Wifi, PKT_RESPONSE_WIN_DEFAULT_MS);
+    printf("wifi: default window %d ms of %d ms\n", default_window_ms, PKT_RESPONSE_WIN_DEFAULT_MS);
+    CHECK(default_window_ms == static_cast<int>(RttEstimator::retransmitSpanMs(wifi_ack_ms, 3)));
+    CHECK(default_window_ms == 11250);
+    CHECK(RttEstimator::responseWindowMs(Transport::Wifi, PKT_RESPONSE_WIN_FW_VERSION_MS) < PKT_RESPONSE_WIN_FW_VERSION_MS);
+
+    // A slow cell keeps the RFC ACK timeout and so the configured windows
+    feed(Transport::Sim, 2600, 8);
+    CHECK(RttEstimator::ackTimeoutMs(Transport::Sim) == COAP_ACK_TIMEOUT_MS);
+    CHECK(RttEstimator::responseWindowMs(Transport::Sim, PKT_RESPONSE_WIN_FW_DOWNLOAD_MS) == PKT_RESPONSE_WIN_FW_DOWNLOAD_MS);
+
+    // Whatever the estimate, a window never ends before a retransmission that times out within
+    // the configured window has timed out
+    for (uint32_t rtt_ms : {30u, 200u, 450u, 900u, 1500u, 4000u}) {
+        feed(Transport::Wifi, rtt_ms, 16);
+        const uint32_t ack_ms = RttEstimator::ackTimeoutMs(Transport::Wifi);
+
+        for (int configured_ms : {PKT_RESPONSE_WIN_FW_VERSION_MS, PKT_RESPONSE_WIN_DEFAULT_MS, PKT_RESPONSE_WIN_FW_DOWNLOAD_MS}) {
+            const int window_ms = RttEstimator::responseWindowMs(Transport::Wifi, configured_ms);
+            CHECK(window_ms <= configured_ms);
+
+            for (uint32_t retransmits = 0; retransmits <= COAP_MAX_RETRANSMIT; ++retransmits) {
+                const uint32_t span_ms = RttEstimator::retransmitSpanMs(ack_ms, retransmits);
+                CHECK(span_ms > static_cast<uint32_t>(configured_ms) || static_cast<uint32_t>(window_ms) >= span_ms);
+            }
+        }
+    }
+
+    host_test::finish("rtt_estimator_test");
+}
@@ -0,0 +1,603 @@
+// Runs SimConnection against a scripted EC25 on the simulated UART: the modem keeps its radio,
+// registration, PDP context and socket buffers between commands, so the same fake serves every
+// attach path, the CoAP receive loop and the HTTPS download over an SSL socket. The attach from
+// each modem state is also replayed from a recording, as the modem transcripts are.
+//
+//   sim_connection_test <transcripts dir>          run the tests
+//   sim_connection_test --record <dir>             record the attach transcripts into <dir>
+
+#include "EEPROMConfig.hpp"
+#include "HostTest.hpp"
+#include "ModemReader.hpp"
+#include "ModemTranscript.hpp"
+#include "NvsShim.hpp"
+#include "SimConnection.hpp"
+#include "SimModem.hpp"
+#include "TranscriptReplay.hpp"
+#include "UARTDriver.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <mutex>
+#include <string>
+#include <vector>
+
+DeviceConfig g_device_config;
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+constexpr uint32_t REPLY_DELAY_MS = 5;
+
+/**
+ * @brief An EC25 that answers the commands SimConnection sends, with the state they change.
+ */
+class FakeEc25 {
+public:
+    int cfun = 1;
+    int polls_until_registered = 0;  ///< CEREG? answers "searching" this many times first
+    bool pdp_active = false;
+    bool socket_urcs = true;         ///< Announce received datagrams with +QIURC "recv"
+    uint32_t ack_delay_ms = 200;     ///< From SEND OK until the server's ACK is in the modem buffer
+    std::string revision = "EC25EFAR06A06M4G";
+    std::string ssl_open_accepted;   ///< The one QSSLOPEN form this firmware takes; others get ERROR
+    bool ssl_contextid = true;       ///< QSSLCFG "contextid" is supported
+    std::string https_body = "hello";
+
+    void install() {
+        sim_modem::onTransmit([this](const std::string& bytes) { onTransmit(bytes); });
+    }
+
+    /**
+     * @brief Commands received so far, without their line ending.
+     */
+    std::vector<std::string> commands() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_commands;
+    }
+
+    void clearCommands() {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_commands.clear();
+    }
+
+    size_t count(const std::string& prefix) {
+        size_t n = 0;
+        for (const std::string& cmd : commands()) {
+            n += cmd.starts_with(prefix) ? 1 : 0;
+        }
+        return n;
+    }
+
+private:
+    struct Datagram {
+        Clock::time_point ready_at;
+        std::string bytes;
+    };
+
+    void onTransmit(const std::string& bytes) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+
+        if (m_payload_left > 0) {
+            m_payload += bytes;
+            m_payload_left -= std::min(m_payload_left, bytes.size());
+            if (m_payload_left == 0) {
+                sim_modem::reply("\r\nSEND OK\r\n", REPLY_DELAY_MS);
+                onDatagramSent();
+            }
+            return;
+        }
+
+        std::string cmd = bytes;
+        while (!cmd.empty() && (cmd.back() == '\n' || cmd.back() == '\r')) {
+            cmd.pop_back();
+        }
+        m_commands.push_back(cmd);
+        answer(cmd);
+    }
+
+    void ok(const std::string& info = {}) {
+        sim_modem::reply(info.empty() ? "\r\nOK\r\n" : "\r\n" + info + "\r\n\r\nOK\r\n", REPLY_DELAY_MS);
+    }
+
+    void answer(const std::string& cmd) {
+        unsigned id = 0;
+        unsigned len = 0;
+
+        if (cmd.starts_with("AT+QSSLCFG=\"contextid\"")) {
+            sim_modem::reply(ssl_contextid ? "\r\nOK\r\n" : "\r\nERROR\r\n", REPLY_DELAY_MS);
+        } else if (cmd == "AT" || cmd == "ATE0" || cmd.starts_with("AT+QICSGP") || cmd == "AT+QIMUX=1" ||
+            cmd.starts_with("AT+QURCCFG") || cmd.starts_with("AT+QICLOSE") || cmd.starts_with("AT+QSSLCLOSE") ||
+            cmd.starts_with("AT+CPSMS=") || cmd.starts_with("AT+CEDRXS=") || cmd.starts_with("AT+QSSLCFG=")) {
+            ok();
+        } else if (cmd == "AT+GMR") {
+            ok(revision);
+        } else if (cmd.starts_with("AT+QSSLOPEN=")) {
+            if (cmd == ssl_open_accepted) {
+                ok();
+                sim_modem::reply("\r\n+QSSLOPEN: 1,0\r\n", 30);
+            } else {
+                sim_modem::reply("\r\nERROR\r\n", REPLY_DELAY_MS);
+            }
+        } else if (cmd == "AT+CFUN?") {
+            ok("+CFUN: " + std::to_string(cfun));
+        } else if (cmd == "AT+CFUN=1") {
+            cfun = 1;
+            ok();
+        } else if (cmd == "AT+CFUN=0") {
+            cfun = 0;
+            pdp_active = false;
+            ok();
+        } else if (cmd == "AT+CPIN?") {
+            ok("+CPIN: READY");
+        } else if (cmd == "AT+CEREG=4" || cmd == "AT+CEREG=0") {
+            m_cereg_mode = cmd.back() - '0';
+            ok();
+        } else if (cmd == "AT+CEREG?") {
+            answerCereg();
+        } else if (cmd == "AT+CEDRXRDP") {
+            ok("+CEDRXRDP: 4,\"0101\",\"0101\",\"0011\"");
+        } else if (cmd == "AT+QIACT?") {
+            ok(pdp_active ? "+QIACT: 1,1,1,\"10.64.0.2\"" : "");
+        } else if (cmd == "AT+QIACT=1") {
+            pdp_active = cfun == 1;
+            sim_modem::reply(pdp_active ? "\r\nOK\r\n" : "\r\nERROR\r\n", 50);
+        } else if (cmd == "AT+QIDEACT=1") {
+            pdp_active = false;
+            ok();
+        } else if (cmd.starts_with("AT+QIOPEN=1,0,\"UDP\"")) {
+            ok();
+            sim_modem::reply("\r\n+QIOPEN: 0,0\r\n", 30);
+        } else if (sscanf(cmd.c_str(), "AT+QISEND=%u,%u", &id, &len) == 2) {
+            m_payload_socket = id;
+            m_payload_left = len;
+            m_payload.clear();
+            sim_modem::reply("\r\n> ", REPLY_DELAY_MS);
+        } else if (sscanf(cmd.c_str(), "AT+QIRD=%u,%u", &id, &len) == 2) {
+            answerRead(id);
+        } else {
+            sim_modem::reply("\r\nERROR\r\n", REPLY_DELAY_MS);
+        }
+    }
+
+    void answerCereg() {
+        const bool registered = cfun == 1 && polls_until_registered == 0;
+        if (!registered && polls_until_registered > 0) {
+            polls_until_registered--;
+        }
+
+        if (m_cereg_mode == 4 && registered) {
+            // Active time 30 s (unit 2 s, 15), periodic TAU 1 h (unit 1 h, 1)
+            ok("+CEREG: 4,1,\"1A2B\",\"01ABCDEF\",7,,,\"00001111\",\"00100001\"");
+        } else {
+            ok("+CEREG: " + std::to_string(m_cereg_mode) + "," + (registered ? "1" : "2"));
+        }
+    }
+
+    /**
+     * @brief The server acknowledges every confirmable request with a piggybacked 2.04 carrying its token,
+     * and answers an HTTP request on the SSL socket with https_body.
+     */
+    void onDatagramSent() {
+        if (m_payload_socket == 1) {
+            m_https_response = "HTTP/1.1 200 OK\r\nContent-Length: " + std::to_string(https_body.size()) +
+                               "\r\n\r\n" + https_body;
+            return;
+        }
+
+        if (m_payload_socket != 0 || m_payload.size() < 4) {
+            return;
+        }
+
+        const uint8_t b0 = static_cast<uint8_t>(m_payload[0]);
+        const size_t tkl = b0 & 0x0F;
+        if (((b0 >> 4) & 0x03) != 0 || m_payload.size() < 4 + tkl) {
+            return;  // Only CON requests are answered
+        }
+
+        std::string ack;
+        ack += static_cast<char>(0x60 | tkl);
+        ack += static_cast<char>(0x44);
+        ack += m_payload.substr(2, 2 + tkl);
+        m_datagrams.push_back({Clock::now() + std::chrono::milliseconds(ack_delay_ms), ack});
+
+        if (socket_urcs) {
+            sim_modem::reply("\r\n+QIURC: \"recv\",0\r\n", ack_delay_ms);
+        }
+    }
+
+    void answerRead(unsigned id) {
+        if (id == 1 && !m_https_response.empty()) {
+            sim_modem::reply("\r\n+QIRD: " + std::to_string(m_https_response.size()) + "\r\n" + m_https_response +
+                             "\r\n\r\nOK\r\n", REPLY_DELAY_MS);
+            m_https_response.clear();
+            return;
+        }
+
+        if (id != 0 || m_datagrams.empty() || m_datagrams.front().ready_at > Clock::now()) {
+            ok("+QIRD: 0");
+            return;
+        }
+
+        const std::string bytes = m_datagrams.front().bytes;
+        m_datagrams.pop_front();
+        sim_modem::reply("\r\n+QIRD: " + std::to_string(bytes.size()) + "\r\n" + bytes + "\r\n\r\nOK\r\n", REPLY_DELAY_MS);
+    }
+
+    std::mutex m_mutex;
+    std::vector<std::string> m_commands;
+    int m_cereg_mode = 0;
+    unsigned m_payload_socket = 0;
+    size_t m_payload_left = 0;
+    std::string m_payload;
+    std::deque<Datagram> m_datagrams;
+    std::string m_https_response;
+};
+
+constexpr const char* HTTPS_URL = "https://example.com/fw.bin";
+constexpr const char* SSL_OPEN_VARIANT_3 = "AT+QSSLOPEN=1,\"example.com\",443,1";
+constexpr const char* SSL_OPEN_VARIANT_4 = "AT+QSSLOPEN=1,\"example.com\",443,0";
+
+const PktEntry_t READING_PKT = {PktType::Reading, CoapMethod::POST, 15000, 2000};
+
+double elapsedMs(Clock::time_point since) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - since).count();
+}
+
+/**
+ * @brief Sends one reading and reports how many socket reads and how long it took to get the ACK.
+ */
+bool sendReading(SimConnection& connection, FakeEc25& modem, size_t& reads, double& ms) {
+    static const uint8_t cbor[] = {0xA1, 0x01, 0x02};
+
+    modem.clearCommands();
+    const auto started = Clock::now();
+    const bool ok = connection.sendPacket(cbor, sizeof(cbor), READING_PKT);
+    ms = elapsedMs(started);
+    reads = modem.count("AT+QIRD=0,");
+    return ok;
+}
+
+/**
+ * @brief Without a "recv" URC the receive loop reads again after SOCKET_URC_FALLBACK_POLL_MS.
+ * Runs first: the ACK timeout is still COAP_ACK_TIMEOUT_MS, so no retransmission comes before the poll.
+ */
+void testRecvFallbackPoll() {
+    FakeEc25 modem;
+    modem.socket_urcs = false;
+    modem.install();
+
+    SimConnection connection;
+    CHECK(connection.connect());
+
+    size_t reads = 0;
+    double ms = 0;
+    CHECK(sendReading(connection, modem, reads, ms));
+    printf("fallback poll: %zu read(s), ACK after %.0f ms\n", reads, ms);
+    CHECK(reads == 2);   // The drain before waiting, then the fallback read
+    CHECK(ms >= 950);
+    CHECK(modem.count("AT+QISEND=0,") == 1);
+
+    sim_modem::reset();
+}
+
+/**
+ * @brief The "recv" URC wakes the receive loop as soon as the ACK is in the modem buffer.
+ */
+void testRecvOnUrc() {
+    FakeEc25 modem;
+    modem.install();
+
+    SimConnection connection;
+    CHECK(connection.connect());
+
+    size_t reads = 0;
+    double ms = 0;
+    CHECK(sendReading(connection, modem, reads, ms));
+    printf("recv URC: %zu read(s), ACK after %.0f ms\n", reads, ms);
+    CHECK(reads == 2);   // The drain before waiting, then the read the URC triggered
+    CHECK(ms >= modem.ack_delay_ms && ms < 900);
+    CHECK(modem.count("AT+QISEND=0,") == 1);
+
+    sim_modem::reset();
+}
+
+size_t powerSavingCommands(FakeEc25& modem) {
+    return modem.count("AT+CPSMS=") + modem.count("AT+CEDRXS=") + modem.count("AT+CEREG=4") +
+           modem.count("AT+CEDRXRDP");
+}
+
+/**
+ * @brief PSM and eDRX are requested and read back on a fresh attach only. A modem left registered at
+ * sleep keeps them on the next wake, unless it had to register again.
+ */
+void testPowerSavingOnFreshAttachOnly() {
+    nvs::reset();
+    FakeEc25 modem;
+    modem.install();
+
+    {
+        SimConnection connection;
+        CHECK(connection.connect());
+        CHECK(modem.count("AT+CPSMS=") == 1 && modem.count("AT+CEDRXS=") == 1);
+        CHECK(modem.count("AT+CEREG=4") == 1 && modem.count("AT+CEDRXRDP") == 1);
+        connection.disconnect();
+    }
+
+    ModemPowerSaving_t stored = {};
+    CHECK(eeprom.loadModemPowerSaving(stored));
+    CHECK(stored.psm_granted && stored.periodic_tau_s == 3600 && stored.active_time_s == 30);
+    CHECK(stored.edrx_granted && stored.edrx_cycle_ms == 81920);
+    CHECK(stored.left_attached);
+
+    // Next wake: still registered, so the stored timers stand
+    modem.clearCommands();
+    {
+        SimConnection connection;
+        CHECK(connection.connect());
+        CHECK(powerSavingCommands(modem) == 0);
+        connection.disconnect();
+    }
+
+    ModemPowerSaving_t resumed = {};
+    CHECK(eeprom.loadModemPowerSaving(resumed));
+    CHECK(resumed.psm_granted && resumed.periodic_tau_s == stored.periodic_tau_s && resumed.left_attached);
+
+    // The network dropped the registration while asleep: the timers are negotiated again
+    modem.clearCommands();
+    modem.polls_until_registered = 1;
+    {
+        SimConnection connection;
+        CHECK(connection.connect());
+        CHECK(modem.count("AT+CEREG=4") == 1 && modem.count("AT+CEDRXRDP") == 1);
+    }
+
+    sim_modem::reset();
+}
+
+/**
+ * @brief Downloads HTTPS_URL on a fresh SimConnection, as after a wake, and returns the QSSLOPEN forms it tried.
+ */
+std::vector<std::string> downloadOnWake(FakeEc25& modem) {
+    SimConnection connection;
+    std::string body;
+
+    modem.clearCommands();
+    CHECK(connection.streamHttpsGet(HTTPS_URL, [&body](const uint8_t* data, size_t len) {
+        body.append(reinterpret_cast<const char*>(data), len);
+        return true;
+    }));
+    CHECK(body == modem.https_body);
+
+    std::vector<std::string> opens;
+    for (const std::string& cmd : modem.commands()) {
+        if (cmd.starts_with("AT+QSSLOPEN=")) {
+            opens.push_back(cmd);
+        }
+    }
+    return opens;
+}
+
+/**
+ * @brief The first download probes the QSSLOPEN forms; the next wake goes straight to the learned one.
+ */
+void testSslProfileLearnedAndResumed() {
+    nvs::reset();
+    FakeEc25 modem;
+    modem.ssl_open_accepted = SSL_OPEN_VARIANT_3;
+    modem.ssl_contextid = false;
+    modem.install();
+
+    std::vector<std::string> opens = downloadOnWake(modem);
+    CHECK(opens.size() == 3);  // Variants 1 and 2 rejected, 3 opened
+    CHECK(!opens.empty() && opens.back() == SSL_OPEN_VARIANT_3);
+    CHECK(modem.count("AT+QSSLCFG=\"contextid\"") == 1);
+
+    ModemSslCache_t stored = {};
+    CHECK(eeprom.loadModemSslCache(stored));
+    CHECK(stored.open_variant == 3);
+    CHECK(stored.contextid_unsupported);
+    CHECK(modem.revision == stored.revision);
+
+    opens = downloadOnWake(modem);
+    CHECK(opens.size() == 1);
+    CHECK(!opens.empty() && opens.front() == SSL_OPEN_VARIANT_3);
+    CHECK(modem.count("AT+QSSLCFG=\"contextid\"") == 0);
+
+    sim_modem::reset();
+}
+
+/**
+ * @brief A learned form the modem no longer takes is tried once, then the others are scanned and the new one stored.
+ */
+void testSslProfileRejectedRescans() {
+    nvs::reset();
+    FakeEc25 modem;
+    ModemSslCache_t cache = {};
+    strncpy(cache.revision, modem.revision.c_str(), sizeof(cache.revision) - 1);
+    cache.open_variant = 3;
+    CHECK(eeprom.saveModemSslCache(cache));
+
+    modem.ssl_open_accepted = SSL_OPEN_VARIANT_4;
+    modem.install();
+
+    const std::vector<std::string> opens = downloadOnWake(modem);
+    CHECK(opens.size() == 4);  // Variant 3 first, then 1, 2 and 4
+    CHECK(!opens.empty() && opens.front() == SSL_OPEN_VARIANT_3 && opens.back() == SSL_OPEN_VARIANT_4);
+
+    ModemSslCache_t stored = {};
+    CHECK(eeprom.loadModemSslCache(stored));
+    CHECK(stored.open_variant == 4);
+
+    sim_modem::reset();
+}
+
+/**
+ * @brief A profile learned on other modem firmware is ignored and replaced.
+ */
+void testSslProfileOtherRevisionIgnored() {
+    nvs::reset();
+    FakeEc25 modem;
+    ModemSslCache_t cache = {};
+    strncpy(cache.revision, "EC25EFAR06A03M4G", sizeof(cache.revision) - 1);
+    cache.open_variant = 4;
+    CHECK(eeprom.saveModemSslCache(cache));
+
+    modem.ssl_open_accepted = SSL_OPEN_VARIANT_3;
+    modem.install();
+
+    const std::vector<std::string> opens = downloadOnWake(modem);
+    CHECK(opens.size() == 3);
+    CHECK(!opens.empty() && opens.front() != SSL_OPEN_VARIANT_4);
+
+    ModemSslCache_t stored = {};
+    CHECK(eeprom.loadModemSslCache(stored));
+    CHECK(stored.open_variant == 3);
+    CHECK(modem.revision == stored.revision);
+
+    sim_modem::reset();
+}
+
+/**
+ * @brief The modem states connect() resumes from, each with a committed transcript.
+ */
+enum class AttachCase { Cold, Registered, Resumed };
+
+struct AttachCaseInfo {
+    AttachCase attach;
+    const char* file;
+};
+
+constexpr AttachCaseInfo ATTACH_CASES[] = {
+    {AttachCase::Cold, "attach_cold.trc"},              // Radio off after CFUN=0, registers on the third poll
+    {AttachCase::Registered, "attach_registered.trc"},  // Radio on and registered, no PDP context
+    {AttachCase::Resumed, "attach_resumed.trc"},        // Left registered at sleep with PSM, context still up
+};
+
+/**
+ * @brief Puts the NVS state of `attach` in place, and the modem state when recording.
+ */
+void prepareAttach(AttachCase attach, FakeEc25* modem) {
+    nvs::reset();
+
+    if (attach == AttachCase::Resumed) {
+        const ModemPowerSaving_t left = {3600, 30, 81920, 5120, true, true, true};
+        CHECK(eeprom.saveModemPowerSaving(left));
+    }
+
+    if (modem == nullptr) {
+        return;
+    }
+
+    modem->cfun = (attach == AttachCase::Cold) ? 0 : 1;
+    modem->polls_until_registered = (attach == AttachCase::Cold) ? 2 : 0;
+    modem->pdp_active = (attach == AttachCase::Resumed);
+}
+
+void recordAttach(const AttachCaseInfo& info, const std::filesystem::path& dir) {
+    const std::string path = (dir / info.file).string();
+    FakeEc25 modem;
+    prepareAttach(info.attach, &modem);
+    modem.install();
+
+    CHECK(g_modem_transcript.start(path.c_str()));
+    m_modem_uart.setTranscript(&g_modem_transcript);
+    {
+        SimConnection connection;
+        CHECK(connection.connect());
+    }
+    m_modem_uart.setTranscript(nullptr);
+    g_modem_transcript.stop();
+    sim_modem::reset();
+}
+
+/**
+ * @brief Replays the attach recorded in `info.file` and checks connect() sends exactly the recorded commands.
+ */
+void testAttachReplay(const AttachCaseInfo& info, const std::filesystem::path& dir) {
+    const std::string path = (dir / info.file).string();
+    std::vector<TranscriptReplay::Record> records;
+    CHECK(TranscriptReplay::load(path.c_str(), records));
+
+    size_t radio_on = 0;
+    size_t cereg_polls = 0;
+    size_t psm_requests = 0;
+    size_t pdp_activations = 0;
+    for (const TranscriptReplay::Record& record : records) {
+        if (record.dir == ModemTranscript::Direction::Tx) {
+            radio_on += record.bytes.starts_with("AT+CFUN=1\r") ? 1 : 0;
+            cereg_polls += record.bytes.starts_with("AT+CEREG?") ? 1 : 0;
+            psm_requests += record.bytes.starts_with("AT+CPSMS=") ? 1 : 0;
+            pdp_activations += record.bytes.starts_with("AT+QIACT=1") ? 1 : 0;
+        }
+    }
+
+    // What each starting state may skip; the PSM read-back adds one CEREG? to a fresh attach
+    switch (info.attach) {
+    case AttachCase::Cold:
+        CHECK(radio_on == 1 && cereg_polls == 4 && psm_requests == 1 && pdp_activations == 1);
+        break;
+    case AttachCase::Registered:
+        CHECK(radio_on == 0 && cereg_polls == 2 && psm_requests == 1 && pdp_activations == 1);
+        break;
+    case AttachCase::Resumed:
+        CHECK(radio_on == 0 && cereg_polls == 1 && psm_requests == 0 && pdp_activations == 0);
+        break;
+    }
+
+    prepareAttach(info.attach, nullptr);
+    TranscriptReplay replay;
+    replay.start(records);
+
+    SimConnection connection;
+    const auto started = Clock::now();
+    CHECK(connection.connect());
+    const double ms = elapsedMs(started);
+
+    const AttachTimings_t& timings = connection.lastAttachTimings();
+    printf("%s: attached in %.0f ms (registration %lu ms, data session %lu ms)\n", info.file, ms,
+           static_cast<unsigned long>(timings.registration_ms), static_cast<unsigned long>(timings.data_session_ms));
+    CHECK(!timings.reset_used);
+    CHECK(replay.mismatches() == 0);
+    CHECK(replay.pendingTx() == 0);
+    sim_modem::reset();
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    m_modem_uart.enablePatternDetect('\n', 32);
+    if (!g_modem_reader.start() || !eeprom.begin()) {
+        printf("modem reader or NVS did not start\n");
+        return 1;
+    }
+
+    if (argc == 3 && strcmp(argv[1], "--record") == 0) {
+        for (const AttachCaseInfo& info : ATTACH_CASES) {
+            recordAttach(info, argv[2]);
+        }
+        host_test::finish("sim_connection_test --record");
+    }
+
+    if (argc != 2) {
+        printf("usage: %s <transcripts dir> | --record <dir>\n", argv[0]);
+        return 2;
+    }
+
+    for (const AttachCaseInfo& info : ATTACH_CASES) {
+        testAttachReplay(info, argv[1]);
+    }
+
+    testRecvFallbackPoll();
+    testRecvOnUrc();
+    testPowerSavingOnFreshAttachOnly();
+    testSslProfileLearnedAndResumed();
+    testSslProfileRejectedRescans();
+    testSslProfileOtherRevisionIgnored();
+
+    host_test::finish("sim_connection_test");
+}
@@ -0,0 +1,147 @@
+// CPU time, wall time and driver calls per KB of modem output: UARTDriver's staged bulk
+// reads against the one-byte uart_read_bytes() calls the old readByte() made. Modem lines
+// are read with readUntil() and a binary payload with read() in 512-byte chunks; each is
+// also read byte by byte and the results compared before the figures are printed.
+//
+//   uart_read_bench [KB per run]
+
+#include "HostTest.hpp"
+#include "SimModem.hpp"
+#include "UARTDriver.hpp"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+
+namespace {
+
+// What the modem sends during a typical SIM exchange
+const char* const LINES[] = {
+    "AT+QIRD=0,1024\r\n",
+    "+QIRD: 128\r\n",
+    "OK\r\n",
+    "+QIURC: \"recv\",0\r\n",
+    "+CEREG: 2,1,\"1A2B\",\"01ABCDEF\",7\r\n",
+    "SEND OK\r\n",
+    "+QIOPEN: 0,0\r\n",
+    "\r\n",
+};
+
+constexpr size_t CHUNK_SIZE = 512;
+constexpr TickType_t READ_TIMEOUT_MS = 50;
+
+UARTDriver s_uart(UART_NUM_1);
+
+struct Cost {
+    double cpu_us = 0;
+    double wall_us = 0;
+    size_t calls = 0;
+};
+
+double cpuNow() {
+    timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return static_cast<double>(ts.tv_sec) * 1e6 + static_cast<double>(ts.tv_nsec) / 1e3;
+}
+
+/**
+ * @brief Queue the input, then drain it with read; the input is fully buffered, so wall
+ * time is how long the reader takes to hand it over.
+ */
+template <typename Read>
+Cost measure(const std::string& input, std::string& output, Read read) {
+    sim_modem::reset();
+    sim_modem::reply(input);
+    output.clear();
+
+    const size_t calls = sim_modem::readCalls();
+    const double cpu = cpuNow();
+    const auto started = std::chrono::steady_clock::now();
+
+    read(output);
+
+    const double wall = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - started).count();
+    const double kb = static_cast<double>(input.size()) / 1024.0;
+    return {(cpuNow() - cpu) / kb, wall / kb, static_cast<size_t>(static_cast<double>(sim_modem::readCalls() - calls) / kb)};
+}
+
+/** The removed readByte(): one driver call, and one lock, per byte. */
+void readBytewise(std::string& output, size_t len) {
+    uint8_t byte = 0;
+    while (output.size() < len && uart_read_bytes(UART_NUM_1, &byte, 1, pdMS_TO_TICKS(READ_TIMEOUT_MS)) == 1) {
+        output.push_back(static_cast<char>(byte));
+    }
+}
+
+void readLines(std::string& output, size_t len) {
+    char line[128];
+    while (output.size() < len) {
+        const int got = s_uart.readUntil('\n', line, xTaskGetTickCount() + pdMS_TO_TICKS(READ_TIMEOUT_MS));
+        if (got < 0) {
+            break;
+        }
+        output.append(line, static_cast<size_t>(got));
+        output.push_back('\n');
+    }
+}
+
+void readChunks(std::string& output, size_t len) {
+    uint8_t chunk[CHUNK_SIZE];
+    while (output.size() < len) {
+        const size_t want = std::min(sizeof(chunk), len - output.size());
+        const size_t got = s_uart.read({chunk, want}, xTaskGetTickCount() + pdMS_TO_TICKS(READ_TIMEOUT_MS));
+        if (got == 0) {
+            break;
+        }
+        output.append(reinterpret_cast<const char*>(chunk), got);
+    }
+}
+
+void report(const char* name, const Cost& cost) {
+    printf("%-28s %7.2f us CPU/KB %7.2f us/KB %6zu driver calls/KB\n", name, cost.cpu_us, cost.wall_us, cost.calls);
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    const size_t kb = (argc > 1) ? static_cast<size_t>(atoi(argv[1])) : 256;
+    std::string lines;
+    std::string binary;
+
+    for (size_t i = 0; lines.size() < kb * 1024; ++i) {
+        lines += LINES[i % std::size(LINES)];
+    }
+    for (size_t i = 0; i < kb * 1024; ++i) {
+        binary.push_back(static_cast<char>(i * 7));
+    }
+
+    s_uart.init(BAUD_115200);
+
+    std::string output;
+
+    const Cost lines_bytewise = measure(lines, output, [&](std::string& out) { readBytewise(out, lines.size()); });
+    CHECK(output == lines);
+
+    const Cost lines_staged = measure(lines, output, [&](std::string& out) { readLines(out, lines.size()); });
+    // readUntil drops only the '\n', which readLines puts back
+    CHECK(output == lines);
+
+    const Cost binary_bytewise = measure(binary, output, [&](std::string& out) { readBytewise(out, binary.size()); });
+    CHECK(output == binary);
+
+    const Cost binary_chunks = measure(binary, output, [&](std::string& out) { readChunks(out, binary.size()); });
+    CHECK(output == binary);
+
+    printf("%zu KB per run\n", kb);
+    report("lines, byte per call:", lines_bytewise);
+    report("lines, readUntil:", lines_staged);
+    report("payload, byte per call:", binary_bytewise);
+    report("payload, read() 512 B:", binary_chunks);
+
+    host_test::finish("uart_read_bench");
+}
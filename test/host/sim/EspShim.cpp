@@ -0,0 +1,66 @@
+// ESP-IDF system calls the modem stack uses, on the host. LittleFS is the host
+// filesystem, so transcript paths are ordinary files; GPIO writes go nowhere.
+
+#include "driver/gpio.h"
+#include "esp_app_desc.h"
+#include "esp_err.h"
+#include "esp_littlefs.h"
+#include "esp_random.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+
+extern "C" {
+
+int64_t esp_timer_get_time(void) {
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+const char* esp_err_to_name(esp_err_t code) {
+    return code == ESP_OK ? "ESP_OK" : "ESP_FAIL";
+}
+
+esp_err_t esp_vfs_littlefs_register(const esp_vfs_littlefs_conf_t*) {
+    return ESP_OK;
+}
+
+bool esp_littlefs_mounted(const char*) {
+    return true;
+}
+
+uint32_t esp_random(void) {
+    static thread_local std::mt19937 generator{std::random_device{}()};
+    return static_cast<uint32_t>(generator());
+}
+
+void esp_fill_random(void* buf, size_t len) {
+    uint8_t* bytes = static_cast<uint8_t*>(buf);
+    for (size_t i = 0; i < len; ++i) {
+        bytes[i] = static_cast<uint8_t>(esp_random());
+    }
+}
+
+esp_err_t gpio_set_level(gpio_num_t, uint32_t) {
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_direction(gpio_num_t, gpio_mode_t) {
+    return ESP_OK;
+}
+
+const esp_app_desc_t* esp_app_get_description(void) {
+    static const esp_app_desc_t desc = {"host", "green_gauge", "00:00:00", "Jan  1 2026", "host"};
+    return &desc;
+}
+
+void esp_restart(void) {
+    std::fprintf(stderr, "esp_restart() called\n");
+    std::abort();
+}
+
+}  // extern "C"
@@ -0,0 +1,286 @@
+// FreeRTOS primitives on std::thread for the host tests. One tick is one millisecond;
+// priorities and stack sizes are ignored.
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/stream_buffer.h"
+#include "freertos/task.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const Clock::time_point s_boot = Clock::now();
+std::atomic<TickType_t> s_caught_up{0};  ///< Ticks added by xTaskCatchUpTicks, e.g. to test the counter wrap
+
+Clock::time_point deadlineAfter(TickType_t ticks) {
+    // portMAX_DELAY must not overflow the time_point
+    const TickType_t capped = std::min<TickType_t>(ticks, 24u * 3600u * 1000u);
+    return Clock::now() + std::chrono::milliseconds(capped);
+}
+
+struct Queue {
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<std::vector<uint8_t>> items;
+    size_t item_size;
+    size_t length;
+};
+
+struct Semaphore {
+    std::mutex mutex;
+    std::condition_variable changed;
+    bool binary = false;
+    bool available = true;  ///< Binary: given; mutex: unlocked
+    std::thread::id owner;
+    int depth = 0;
+};
+
+struct StreamBuffer {
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::deque<uint8_t> bytes;
+    size_t capacity;
+};
+
+struct Task {
+    TaskFunction_t entry;
+    void* arg;
+};
+
+thread_local Task* t_current = nullptr;
+
+}  // namespace
+
+extern "C" {
+
+TickType_t xTaskGetTickCount(void) {
+    return s_caught_up + static_cast<TickType_t>(
+        std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - s_boot).count());
+}
+
+BaseType_t xTaskCatchUpTicks(TickType_t ticks) {
+    s_caught_up += ticks;
+    return pdFALSE;
+}
+
+void vTaskDelay(TickType_t ticks) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(ticks));
+}
+
+BaseType_t xTaskCreate(TaskFunction_t entry, const char*, uint32_t, void* arg, UBaseType_t, TaskHandle_t* handle) {
+    Task* task = new Task{entry, arg};
+    if (handle != nullptr) {
+        *handle = task;
+    }
+
+    // Tasks run until the test process exits, as they do until deep sleep on the device
+    std::thread([task] {
+        t_current = task;
+        task->entry(task->arg);
+    }).detach();
+    return pdPASS;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t entry, const char* name, uint32_t stack, void* arg,
+                                   UBaseType_t priority, TaskHandle_t* handle, int) {
+    return xTaskCreate(entry, name, stack, arg, priority, handle);
+}
+
+void vTaskDelete(TaskHandle_t) {
+    // The thread finishes when its entry function returns
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void) {
+    return t_current;
+}
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) {
+    Queue* queue = new Queue;
+    queue->item_size = item_size;
+    queue->length = length;
+    return queue;
+}
+
+void vQueueDelete(QueueHandle_t handle) {
+    delete static_cast<Queue*>(handle);
+}
+
+BaseType_t xQueueSend(QueueHandle_t handle, const void* item, TickType_t wait) {
+    Queue* queue = static_cast<Queue*>(handle);
+    std::unique_lock lock(queue->mutex);
+
+    if (!queue->changed.wait_until(lock, deadlineAfter(wait), [queue] { return queue->items.size() < queue->length; })) {
+        return pdFALSE;
+    }
+
+    const uint8_t* bytes = static_cast<const uint8_t*>(item);
+    queue->items.emplace_back(bytes, bytes + queue->item_size);
+    queue->changed.notify_all();
+    return pdTRUE;
+}
+
+BaseType_t xQueueSendToBack(QueueHandle_t handle, const void* item, TickType_t wait) {
+    return xQueueSend(handle, item, wait);
+}
+
+BaseType_t xQueueOverwrite(QueueHandle_t handle, const void* item) {
+    Queue* queue = static_cast<Queue*>(handle);
+    std::lock_guard lock(queue->mutex);
+
+    const uint8_t* bytes = static_cast<const uint8_t*>(item);
+    queue->items.clear();
+    queue->items.emplace_back(bytes, bytes + queue->item_size);
+    queue->changed.notify_all();
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t handle, void* item, TickType_t wait) {
+    Queue* queue = static_cast<Queue*>(handle);
+    std::unique_lock lock(queue->mutex);
+
+    if (!queue->changed.wait_until(lock, deadlineAfter(wait), [queue] { return !queue->items.empty(); })) {
+        return pdFALSE;
+    }
+
+    memcpy(item, queue->items.front().data(), queue->item_size);
+    queue->items.pop_front();
+    queue->changed.notify_all();
+    return pdTRUE;
+}
+
+BaseType_t xQueueReset(QueueHandle_t handle) {
+    Queue* queue = static_cast<Queue*>(handle);
+    std::lock_guard lock(queue->mutex);
+
+    queue->items.clear();
+    queue->changed.notify_all();
+    return pdPASS;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t handle) {
+    Queue* queue = static_cast<Queue*>(handle);
+    std::lock_guard lock(queue->mutex);
+    return static_cast<UBaseType_t>(queue->items.size());
+}
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void) {
+    return new Semaphore;
+}
+
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex(void) {
+    return new Semaphore;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void) {
+    Semaphore* sem = new Semaphore;
+    sem->binary = true;
+    sem->available = false;  // Created empty, as in FreeRTOS
+    return sem;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t handle) {
+    delete static_cast<Semaphore*>(handle);
+}
+
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t handle, TickType_t wait) {
+    Semaphore* sem = static_cast<Semaphore*>(handle);
+    std::unique_lock lock(sem->mutex);
+    const std::thread::id self = std::this_thread::get_id();
+
+    if (!sem->binary && sem->depth > 0 && sem->owner == self) {
+        ++sem->depth;
+        return pdTRUE;
+    }
+
+    if (!sem->changed.wait_until(lock, deadlineAfter(wait), [sem] { return sem->available; })) {
+        return pdFALSE;
+    }
+
+    sem->available = false;
+    if (!sem->binary) {
+        sem->owner = self;
+        sem->depth = 1;
+    }
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t handle) {
+    Semaphore* sem = static_cast<Semaphore*>(handle);
+    std::lock_guard lock(sem->mutex);
+
+    if (!sem->binary && --sem->depth > 0) {
+        return pdTRUE;
+    }
+
+    sem->depth = 0;
+    sem->available = true;
+    sem->changed.notify_all();
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t handle, TickType_t wait) {
+    return xSemaphoreTakeRecursive(handle, wait);
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t handle) {
+    return xSemaphoreGiveRecursive(handle);
+}
+
+StreamBufferHandle_t xStreamBufferCreate(size_t size, size_t) {
+    StreamBuffer* stream = new StreamBuffer;
+    stream->capacity = size;
+    return stream;
+}
+
+size_t xStreamBufferSend(StreamBufferHandle_t handle, const void* data, size_t len, TickType_t wait) {
+    StreamBuffer* stream = static_cast<StreamBuffer*>(handle);
+    std::unique_lock lock(stream->mutex);
+
+    stream->changed.wait_until(lock, deadlineAfter(wait), [stream] { return stream->bytes.size() < stream->capacity; });
+
+    const size_t count = std::min(len, stream->capacity - stream->bytes.size());
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    stream->bytes.insert(stream->bytes.end(), bytes, bytes + count);
+    stream->changed.notify_all();
+    return count;
+}
+
+size_t xStreamBufferReceive(StreamBufferHandle_t handle, void* data, size_t len, TickType_t wait) {
+    StreamBuffer* stream = static_cast<StreamBuffer*>(handle);
+    std::unique_lock lock(stream->mutex);
+
+    stream->changed.wait_until(lock, deadlineAfter(wait), [stream] { return !stream->bytes.empty(); });
+
+    const size_t count = std::min(len, stream->bytes.size());
+    std::copy_n(stream->bytes.begin(), count, static_cast<uint8_t*>(data));
+    stream->bytes.erase(stream->bytes.begin(), stream->bytes.begin() + static_cast<std::ptrdiff_t>(count));
+    stream->changed.notify_all();
+    return count;
+}
+
+size_t xStreamBufferSpacesAvailable(StreamBufferHandle_t handle) {
+    StreamBuffer* stream = static_cast<StreamBuffer*>(handle);
+    std::lock_guard lock(stream->mutex);
+    return stream->capacity - stream->bytes.size();
+}
+
+BaseType_t xStreamBufferReset(StreamBufferHandle_t handle) {
+    StreamBuffer* stream = static_cast<StreamBuffer*>(handle);
+    std::lock_guard lock(stream->mutex);
+    stream->bytes.clear();
+    return pdPASS;
+}
+
+}  // extern "C"
@@ -0,0 +1,43 @@
+// Packet MAC key on the host with the real tag: HMAC-SHA256 truncated to Key::TAG_SIZE,
+// as Key.cpp computes it through PSA on the device. Backed by OpenSSL; used by the MAC
+// cost benchmark in place of HostKey.cpp.
+
+#include "Key.hpp"
+
+#include <algorithm>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+
+namespace {
+
+bool s_loaded = false;
+uint8_t s_key[Key::HMAC_SIZE];
+
+}  // namespace
+
+bool Key::computeKey(uint8_t*, size_t) {
+    return false;
+}
+
+bool Key::loadMacKey(std::span<const uint8_t, HMAC_SIZE> device_key) {
+    std::copy(device_key.begin(), device_key.end(), s_key);
+    s_loaded = true;
+    return true;
+}
+
+bool Key::macReady() {
+    return s_loaded;
+}
+
+bool Key::computeTag(std::span<const uint8_t> message, std::span<uint8_t, TAG_SIZE> tag) {
+    uint8_t mac[EVP_MAX_MD_SIZE];
+    unsigned int mac_len = 0;
+
+    if (!s_loaded || !HMAC(EVP_sha256(), s_key, sizeof(s_key), message.data(), message.size(), mac, &mac_len) ||
+        mac_len != HMAC_SIZE) {
+        return false;
+    }
+
+    std::copy_n(mac, TAG_SIZE, tag.begin());
+    return true;
+}
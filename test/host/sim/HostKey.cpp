@@ -0,0 +1,47 @@
+// Packet MAC key on the host. PSA is not available here; the tag is a keyed checksum of
+// the right size, so encoders produce packets of their real length.
+
+#include "Key.hpp"
+
+#include <algorithm>
+
+namespace {
+
+bool s_loaded = false;
+uint8_t s_key[Key::HMAC_SIZE];
+
+}  // namespace
+
+bool Key::computeKey(uint8_t*, size_t) {
+    return false;
+}
+
+bool Key::loadMacKey(std::span<const uint8_t, HMAC_SIZE> device_key) {
+    std::copy(device_key.begin(), device_key.end(), s_key);
+    s_loaded = true;
+    return true;
+}
+
+bool Key::macReady() {
+    return s_loaded;
+}
+
+bool Key::computeTag(std::span<const uint8_t> message, std::span<uint8_t, TAG_SIZE> tag) {
+    if (!s_loaded) {
+        return false;
+    }
+
+    // FNV-1a over key and message, spread across the tag
+    uint64_t hash = 1469598103934665603ULL;
+    for (const uint8_t byte : s_key) {
+        hash = (hash ^ byte) * 1099511628211ULL;
+    }
+    for (const uint8_t byte : message) {
+        hash = (hash ^ byte) * 1099511628211ULL;
+    }
+
+    for (size_t i = 0; i < TAG_SIZE; ++i) {
+        tag[i] = static_cast<uint8_t>(hash >> (8 * i));
+    }
+    return true;
+}
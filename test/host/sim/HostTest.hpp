@@ -0,0 +1,31 @@
+#pragma once
+
+#include <cstdio>
+#include <unistd.h>
+
+/**
+ * @brief Minimal check helpers for the host tests; each test is one executable.
+ */
+namespace host_test {
+
+inline int g_failures = 0;
+
+/**
+ * @brief Reports the result and exits without running destructors: the modem tasks
+ * are still running, as they are until deep sleep on the device.
+ */
+[[noreturn]] inline void finish(const char* name) {
+    printf("%s: %s (%d failures)\n", name, g_failures == 0 ? "PASS" : "FAIL", g_failures);
+    fflush(stdout);
+    _exit(g_failures == 0 ? 0 : 1);
+}
+
+}  // namespace host_test
+
+#define CHECK(cond)                                                          \
+    do {                                                                     \
+        if (!(cond)) {                                                       \
+            printf("%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            ++host_test::g_failures;                                         \
+        }                                                                    \
+    } while (0)
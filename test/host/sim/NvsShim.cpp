@@ -0,0 +1,148 @@
+// NVS in memory for the host tests: one namespace, values kept as bytes until the process
+// exits. nvs::reset() gives a test a blank flash.
+
+#include "NvsShim.hpp"
+
+#include "nvs.h"
+#include "nvs_flash.h"
+
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace {
+
+std::mutex s_mutex;
+std::map<std::string, std::vector<uint8_t>> s_values;
+
+esp_err_t setBytes(const char* key, const void* value, size_t length) {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    const uint8_t* bytes = static_cast<const uint8_t*>(value);
+    s_values[key].assign(bytes, bytes + length);
+    return ESP_OK;
+}
+
+/**
+ * @brief Copies a stored value of exactly `length` bytes, as the typed getters require.
+ */
+esp_err_t getFixed(const char* key, void* out, size_t length) {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    const auto it = s_values.find(key);
+    if (it == s_values.end()) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    if (it->second.size() != length) {
+        return ESP_ERR_NVS_INVALID_LENGTH;
+    }
+    std::memcpy(out, it->second.data(), length);
+    return ESP_OK;
+}
+
+/**
+ * @brief Blob/string read: a null `out` only reports the length, a short buffer fails.
+ */
+esp_err_t getSized(const char* key, void* out, size_t* length) {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    const auto it = s_values.find(key);
+    if (it == s_values.end()) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    if (out == nullptr) {
+        *length = it->second.size();
+        return ESP_OK;
+    }
+    if (*length < it->second.size()) {
+        *length = it->second.size();
+        return ESP_ERR_NVS_INVALID_LENGTH;
+    }
+    std::memcpy(out, it->second.data(), it->second.size());
+    *length = it->second.size();
+    return ESP_OK;
+}
+
+}  // namespace
+
+namespace nvs {
+
+void reset() {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    s_values.clear();
+}
+
+}  // namespace nvs
+
+extern "C" {
+
+esp_err_t nvs_flash_init(void) {
+    return ESP_OK;
+}
+
+esp_err_t nvs_flash_erase(void) {
+    nvs::reset();
+    return ESP_OK;
+}
+
+esp_err_t nvs_open(const char*, nvs_open_mode_t, nvs_handle_t* out_handle) {
+    *out_handle = 1;
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t) {}
+
+esp_err_t nvs_commit(nvs_handle_t) {
+    return ESP_OK;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t, const char* key) {
+    std::lock_guard<std::mutex> lock(s_mutex);
+    return s_values.erase(key) != 0 ? ESP_OK : ESP_ERR_NVS_NOT_FOUND;
+}
+
+esp_err_t nvs_erase_all(nvs_handle_t) {
+    nvs::reset();
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_u8(nvs_handle_t, const char* key, uint8_t value) {
+    return setBytes(key, &value, sizeof(value));
+}
+
+esp_err_t nvs_set_u32(nvs_handle_t, const char* key, uint32_t value) {
+    return setBytes(key, &value, sizeof(value));
+}
+
+esp_err_t nvs_set_u64(nvs_handle_t, const char* key, uint64_t value) {
+    return setBytes(key, &value, sizeof(value));
+}
+
+esp_err_t nvs_set_str(nvs_handle_t, const char* key, const char* value) {
+    return setBytes(key, value, std::strlen(value) + 1);
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t, const char* key, const void* value, size_t length) {
+    return setBytes(key, value, length);
+}
+
+esp_err_t nvs_get_u8(nvs_handle_t, const char* key, uint8_t* out_value) {
+    return getFixed(key, out_value, sizeof(*out_value));
+}
+
+esp_err_t nvs_get_u32(nvs_handle_t, const char* key, uint32_t* out_value) {
+    return getFixed(key, out_value, sizeof(*out_value));
+}
+
+esp_err_t nvs_get_u64(nvs_handle_t, const char* key, uint64_t* out_value) {
+    return getFixed(key, out_value, sizeof(*out_value));
+}
+
+esp_err_t nvs_get_str(nvs_handle_t, const char* key, char* out_value, size_t* length) {
+    return getSized(key, out_value, length);
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t, const char* key, void* out_value, size_t* length) {
+    return getSized(key, out_value, length);
+}
+
+}  // extern "C"
@@ -0,0 +1,13 @@
+#pragma once
+
+/**
+ * @brief The in-memory NVS behind the host build of EEPROMConfig.
+ */
+namespace nvs {
+
+/**
+ * @brief Erases every stored value.
+ */
+void reset();
+
+}  // namespace nvs
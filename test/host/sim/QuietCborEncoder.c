@@ -0,0 +1,7 @@
+// tinycbor's encoder as the firmware vendors it, minus the port's debug print in
+// cbor_encoder_init, so the encode benchmark's baseline times encoding only.
+
+#include <stdio.h>
+
+#define printf(...) ((void)0)
+#include "cborencoder.c"
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+/**
+ * @brief The far end of the host UART: what the firmware writes to the modem port and
+ * what the "modem" sends back. Replies are delivered to uart_read_bytes() once their
+ * delay has passed, so response timing is simulated without extra threads.
+ */
+namespace sim_modem {
+
+using TransmitHook = std::function<void(const std::string& bytes)>;
+
+/**
+ * @brief Called with the bytes of every uart_write_bytes() call, outside the UART lock,
+ * so the hook may schedule replies.
+ */
+void onTransmit(TransmitHook hook);
+
+/**
+ * @brief Queues bytes from the modem, readable `delay_ms` from now.
+ */
+void reply(const std::string& bytes, uint32_t delay_ms = 0);
+
+/**
+ * @brief Drops pending replies and the hook.
+ */
+void reset();
+
+/**
+ * @brief Number of uart_read_bytes() calls made so far.
+ */
+size_t readCalls();
+
+}  // namespace sim_modem
@@ -0,0 +1,124 @@
+// UART driver calls on the host, backed by the simulated modem in SimModem.hpp.
+
+#include "SimModem.hpp"
+
+#include "driver/uart.h"
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+std::mutex s_mutex;
+std::condition_variable s_changed;
+std::deque<uint8_t> s_rx;
+std::multimap<Clock::time_point, std::string> s_scheduled;  ///< Equal times keep their order
+sim_modem::TransmitHook s_hook;
+size_t s_read_calls = 0;
+
+/** Moves replies that are due into the RX FIFO; caller holds s_mutex. */
+void releaseDue() {
+    const Clock::time_point now = Clock::now();
+    while (!s_scheduled.empty() && s_scheduled.begin()->first <= now) {
+        const std::string& bytes = s_scheduled.begin()->second;
+        s_rx.insert(s_rx.end(), bytes.begin(), bytes.end());
+        s_scheduled.erase(s_scheduled.begin());
+    }
+}
+
+}  // namespace
+
+namespace sim_modem {
+
+void onTransmit(TransmitHook hook) {
+    std::lock_guard lock(s_mutex);
+    s_hook = std::move(hook);
+}
+
+void reply(const std::string& bytes, uint32_t delay_ms) {
+    std::lock_guard lock(s_mutex);
+    s_scheduled.emplace(Clock::now() + std::chrono::milliseconds(delay_ms), bytes);
+    s_changed.notify_all();
+}
+
+void reset() {
+    std::lock_guard lock(s_mutex);
+    s_rx.clear();
+    s_scheduled.clear();
+    s_hook = nullptr;
+}
+
+size_t readCalls() {
+    std::lock_guard lock(s_mutex);
+    return s_read_calls;
+}
+
+}  // namespace sim_modem
+
+extern "C" {
+
+int uart_write_bytes(uart_port_t, const void* data, size_t len) {
+    sim_modem::TransmitHook hook;
+    {
+        std::lock_guard lock(s_mutex);
+        hook = s_hook;
+    }
+
+    if (hook) {
+        hook(std::string(static_cast<const char*>(data), len));
+    }
+    return static_cast<int>(len);
+}
+
+int uart_read_bytes(uart_port_t, void* buf, uint32_t len, TickType_t wait) {
+    std::unique_lock lock(s_mutex);
+    const Clock::time_point deadline = Clock::now() + std::chrono::milliseconds(std::min<TickType_t>(wait, 60000));
+
+    ++s_read_calls;
+
+    while (true) {
+        releaseDue();
+        if (!s_rx.empty() || Clock::now() >= deadline) {
+            break;
+        }
+
+        const Clock::time_point next = s_scheduled.empty() ? deadline : std::min(deadline, s_scheduled.begin()->first);
+        s_changed.wait_until(lock, next);
+    }
+
+    const size_t count = std::min<size_t>(len, s_rx.size());
+    std::copy_n(s_rx.begin(), count, static_cast<uint8_t*>(buf));
+    s_rx.erase(s_rx.begin(), s_rx.begin() + static_cast<std::ptrdiff_t>(count));
+    return static_cast<int>(count);
+}
+
+esp_err_t uart_get_buffered_data_len(uart_port_t, size_t* len) {
+    std::lock_guard lock(s_mutex);
+    releaseDue();
+    *len = s_rx.size();
+    return ESP_OK;
+}
+
+esp_err_t uart_flush_input(uart_port_t) {
+    std::lock_guard lock(s_mutex);
+    s_rx.clear();
+    return ESP_OK;
+}
+
+// No pattern interrupt on the host: the reader falls back to scanning for line ends
+int uart_pattern_get_pos(uart_port_t) { return -1; }
+int uart_pattern_pop_pos(uart_port_t) { return -1; }
+esp_err_t uart_enable_pattern_det_baud_intr(uart_port_t, char, uint8_t, int, int, int) { return ESP_OK; }
+esp_err_t uart_pattern_queue_reset(uart_port_t, int) { return ESP_OK; }
+esp_err_t uart_disable_pattern_det_intr(uart_port_t) { return ESP_OK; }
+esp_err_t uart_param_config(uart_port_t, const uart_config_t*) { return ESP_OK; }
+esp_err_t uart_set_pin(uart_port_t, int, int, int, int) { return ESP_OK; }
+esp_err_t uart_driver_install(uart_port_t, int, int, int, QueueHandle_t*, int) { return ESP_OK; }
+
+}  // extern "C"
@@ -0,0 +1,100 @@
+#include "TranscriptReplay.hpp"
+
+#include "SimModem.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+
+static uint32_t readLe(const std::string& data, size_t pos, size_t bytes) {
+    uint32_t value = 0;
+    for (size_t i = 0; i < bytes; ++i) {
+        value |= static_cast<uint32_t>(static_cast<uint8_t>(data[pos + i])) << (8 * i);
+    }
+    return value;
+}
+
+bool TranscriptReplay::load(const char* path, std::vector<Record>& records) {
+    static constexpr size_t FILE_HEADER_SIZE = 8;
+    static constexpr size_t RECORD_HEADER_SIZE = 8;
+
+    std::ifstream file(path, std::ios::binary);
+    const std::string data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    records.clear();
+    if (data.size() < FILE_HEADER_SIZE || data.compare(0, 4, "MTRC") != 0 || data[4] != 1) {
+        printf("%s: not a version 1 modem transcript\n", path);
+        return false;
+    }
+
+    size_t pos = FILE_HEADER_SIZE;
+    while (pos < data.size()) {
+        if (data.size() - pos < RECORD_HEADER_SIZE) {
+            printf("%s: record header cut short at offset %zu\n", path, pos);
+            return false;
+        }
+
+        const size_t len = readLe(data, pos + 6, 2);
+        if (data.size() - pos - RECORD_HEADER_SIZE < len) {
+            printf("%s: record body cut short at offset %zu\n", path, pos);
+            return false;
+        }
+
+        records.push_back({readLe(data, pos, 4),
+                           static_cast<ModemTranscript::Direction>(data[pos + 4]),
+                           (static_cast<uint8_t>(data[pos + 5]) & 0x01U) != 0,
+                           data.substr(pos + RECORD_HEADER_SIZE, len)});
+        pos += RECORD_HEADER_SIZE + len;
+    }
+
+    return true;
+}
+
+void TranscriptReplay::start(std::vector<Record> records) {
+    {
+        std::lock_guard lock(m_mutex);
+        m_records = std::move(records);
+        m_cursor = 0;
+        m_mismatches = 0;
+        releaseRx(m_records.empty() ? 0 : m_records.front().time_us);
+    }
+
+    sim_modem::onTransmit([this](const std::string& bytes) { onTransmit(bytes); });
+}
+
+size_t TranscriptReplay::mismatches() const {
+    std::lock_guard lock(m_mutex);
+    return m_mismatches;
+}
+
+size_t TranscriptReplay::pendingTx() const {
+    std::lock_guard lock(m_mutex);
+    size_t count = 0;
+    for (size_t i = m_cursor; i < m_records.size(); ++i) {
+        count += (m_records[i].dir == ModemTranscript::Direction::Tx) ? 1 : 0;
+    }
+    return count;
+}
+
+void TranscriptReplay::onTransmit(const std::string& bytes) {
+    std::lock_guard lock(m_mutex);
+
+    if (m_cursor >= m_records.size() || m_records[m_cursor].bytes != bytes) {
+        printf("replay: unexpected write \"%s\", recording has \"%s\"\n", bytes.c_str(),
+               m_cursor < m_records.size() ? m_records[m_cursor].bytes.c_str() : "(end)");
+        ++m_mismatches;
+        return;
+    }
+
+    const uint32_t sent_us = m_records[m_cursor].time_us;
+    ++m_cursor;
+    releaseRx(sent_us);
+}
+
+void TranscriptReplay::releaseRx(uint32_t since_us) {
+    while (m_cursor < m_records.size() && m_records[m_cursor].dir == ModemTranscript::Direction::Rx) {
+        const Record& record = m_records[m_cursor];
+        sim_modem::reply(record.bytes, (record.time_us - since_us) / 1000);
+        ++m_cursor;
+    }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "ModemTranscript.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/**
+ * @class TranscriptReplay
+ * @brief Plays a ModemTranscript recording back as the modem on the simulated UART.
+ *
+ * Traffic the modem sent before the first command is delivered at once. After that,
+ * every write from the firmware must match the next recorded transmission; it
+ * releases the modem traffic recorded after it, at the recorded offsets, so replies
+ * and URCs arrive with the timing the real modem had.
+ */
+class TranscriptReplay {
+public:
+    struct Record {
+        uint32_t time_us;
+        ModemTranscript::Direction dir;
+        bool dropped;  ///< Traffic was lost just before this record
+        std::string bytes;
+    };
+
+    /**
+     * @brief Reads a transcript file.
+     * @return false if the header is wrong or the file ends inside a record
+     */
+    static bool load(const char* path, std::vector<Record>& records);
+
+    /**
+     * @brief Installs the replay as the simulated modem.
+     */
+    void start(std::vector<Record> records);
+
+    /**
+     * @brief Writes from the firmware that did not match the recording.
+     */
+    size_t mismatches() const;
+
+    /**
+     * @brief Recorded transmissions the firmware has not made yet.
+     */
+    size_t pendingTx() const;
+
+private:
+    void onTransmit(const std::string& bytes);
+    void releaseRx(uint32_t since_us);
+
+    mutable std::mutex m_mutex;
+    std::vector<Record> m_records;
+    size_t m_cursor = 0;
+    size_t m_mismatches = 0;
+};
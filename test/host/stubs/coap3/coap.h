@@ -0,0 +1,3 @@
+#pragma once
+
+// IPacket includes libcoap, but the packet encoders use none of it
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef int uart_port_t;
+
+#define UART_NUM_1 1
+#define UART_NUM_2 2
+#define UART_PIN_NO_CHANGE -1
+#define UART_DATA_8_BITS 3
+#define UART_PARITY_DISABLE 0
+#define UART_STOP_BITS_1 1
+#define UART_HW_FLOWCTRL_DISABLE 0
+#define UART_SCLK_DEFAULT 0
+#define UART_SCLK_APB 0
+
+typedef struct {
+    int baud_rate;
+    int data_bits;
+    int parity;
+    int stop_bits;
+    int flow_ctrl;
+    int rx_flow_ctrl_thresh;
+    int source_clk;
+} uart_config_t;
+
+typedef enum {
+    UART_DATA,
+    UART_BREAK,
+    UART_BUFFER_FULL,
+    UART_FIFO_OVF,
+    UART_FRAME_ERR,
+    UART_PARITY_ERR,
+    UART_DATA_BREAK,
+    UART_PATTERN_DET,
+    UART_EVENT_MAX
+} uart_event_type_t;
+
+typedef struct {
+    uart_event_type_t type;
+    size_t size;
+    bool timeout_flag;
+} uart_event_t;
+
+esp_err_t uart_param_config(uart_port_t port, const uart_config_t* config);
+esp_err_t uart_set_pin(uart_port_t port, int tx, int rx, int rts, int cts);
+esp_err_t uart_driver_install(uart_port_t port, int rx_size, int tx_size, int queue_size,
+                              QueueHandle_t* queue, int intr_flags);
+int uart_write_bytes(uart_port_t port, const void* data, size_t len);
+int uart_read_bytes(uart_port_t port, void* buf, uint32_t len, TickType_t wait);
+esp_err_t uart_get_buffered_data_len(uart_port_t port, size_t* len);
+esp_err_t uart_flush_input(uart_port_t port);
+esp_err_t uart_enable_pattern_det_baud_intr(uart_port_t port, char chr, uint8_t count,
+                                            int chr_tout, int post_idle, int pre_idle);
+esp_err_t uart_pattern_queue_reset(uart_port_t port, int queue_length);
+esp_err_t uart_disable_pattern_det_intr(uart_port_t port);
+int uart_pattern_pop_pos(uart_port_t port);
+int uart_pattern_get_pos(uart_port_t port);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,5 @@
+#pragma once
+
+// No RTC memory on the host: retained data is ordinary static storage
+#define RTC_DATA_ATTR
+#define IRAM_ATTR
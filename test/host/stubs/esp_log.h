@@ -0,0 +1,8 @@
+#pragma once
+
+#include "esp_err.h"
+
+#define ESP_LOGE(tag, ...) (void)(tag)
+#define ESP_LOGW(tag, ...) (void)(tag)
+#define ESP_LOGI(tag, ...) (void)(tag)
+#define ESP_LOGD(tag, ...) (void)(tag)
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef void* StreamBufferHandle_t;
+
+StreamBufferHandle_t xStreamBufferCreate(size_t size, size_t trigger_level);
+size_t xStreamBufferSend(StreamBufferHandle_t stream, const void* data, size_t len, TickType_t wait);
+size_t xStreamBufferReceive(StreamBufferHandle_t stream, void* data, size_t len, TickType_t wait);
+size_t xStreamBufferSpacesAvailable(StreamBufferHandle_t stream);
+BaseType_t xStreamBufferReset(StreamBufferHandle_t stream);
+
+#ifdef __cplusplus
+}
+#endif
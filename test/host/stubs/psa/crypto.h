@@ -0,0 +1,3 @@
+#pragma once
+
+// The packet MAC is provided by sim/HostKey.cpp instead of PSA